@@ -0,0 +1,31 @@
+{
+  'conditions': [['OS=="linux" or OS=="mac"', {
+    'targets': [{
+      'target_name': 'abpd',
+      'type': 'executable',
+      'dependencies': [
+        'libadblockplus.gyp:libadblockplus'
+      ],
+      'sources': [
+        'src/Main.cpp'
+      ],
+      'xcode_settings': {
+        'OTHER_LDFLAGS': ['-stdlib=libstdc++'],
+      },
+    },
+    {
+      'target_name': 'abpd-benchmark',
+      'type': 'executable',
+      'dependencies': [
+        'libadblockplus.gyp:libadblockplus',
+        'libadblockplus.gyp:libadblockplus-client'
+      ],
+      'sources': [
+        'src/Benchmark.cpp'
+      ],
+      'xcode_settings': {
+        'OTHER_LDFLAGS': ['-stdlib=libstdc++'],
+      },
+    }]
+  }]]
+}
@@ -0,0 +1,319 @@
+/*
+ * This file is part of Adblock Plus <https://adblockplus.org/>,
+ * Copyright (C) 2006-present eyeo GmbH
+ *
+ * Adblock Plus is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 3 as
+ * published by the Free Software Foundation.
+ *
+ * Adblock Plus is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Adblock Plus.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <AdblockPlus.h>
+#include <AdblockPlus/FilterEngineClient.h>
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <mutex>
+#include <sstream>
+#include <thread>
+
+namespace
+{
+  typedef std::chrono::steady_clock Clock;
+
+  struct Options
+  {
+    Options()
+      : socketPath("/tmp/abpd.sock"), connectionCount(1), requestCount(10000),
+        batchSize(1), pipelineDepth(1)
+    {
+    }
+
+    std::string socketPath;
+    int connectionCount;
+    int requestCount;
+    int batchSize;
+    int pipelineDepth;
+    std::string requestLog;
+  };
+
+  struct ConnectionResult
+  {
+    ConnectionResult() : matched(0), failed(0)
+    {
+      latencies.name = "Round trip";
+    }
+
+    AdblockPlus::LatencyHistogram latencies;
+    size_t matched;
+    size_t failed;
+    std::string connectError;
+    std::string requestError;
+  };
+
+  void ShowUsage()
+  {
+    std::cerr << "Usage: abpd-benchmark [--socket PATH] [--connections N] [--requests N]"
+              << " [--batch N] [--pipeline N] [REQUEST_LOG]" << std::endl
+              << "REQUEST_LOG has one `URL CONTENT_TYPE [DOCUMENT_URL]` per line,"
+              << " synthetic requests are used without it." << std::endl;
+  }
+
+  bool ParsePositive(const char* value, int& result)
+  {
+    result = std::atoi(value);
+    return result > 0;
+  }
+
+  bool ParseOptions(int argc, char* argv[], Options& options)
+  {
+    for (int i = 1; i < argc; i++)
+    {
+      const std::string argument = argv[i];
+      bool hasValue = i + 1 < argc;
+      if (argument == "--socket" && hasValue)
+        options.socketPath = argv[++i];
+      else if (argument == "--connections" && hasValue)
+      {
+        if (!ParsePositive(argv[++i], options.connectionCount))
+          return false;
+      }
+      else if (argument == "--requests" && hasValue)
+      {
+        if (!ParsePositive(argv[++i], options.requestCount))
+          return false;
+      }
+      else if (argument == "--batch" && hasValue)
+      {
+        if (!ParsePositive(argv[++i], options.batchSize))
+          return false;
+      }
+      else if (argument == "--pipeline" && hasValue)
+      {
+        if (!ParsePositive(argv[++i], options.pipelineDepth))
+          return false;
+      }
+      else if (argument.compare(0, 2, "--") == 0 || !options.requestLog.empty())
+        return false;
+      else
+        options.requestLog = argument;
+    }
+    return true;
+  }
+
+  std::vector<AdblockPlus::FilterEngineClient::Query> ReadQueries(const std::string& fileName)
+  {
+    std::vector<AdblockPlus::FilterEngineClient::Query> queries;
+    std::ifstream file(fileName);
+    if (!file)
+      throw std::runtime_error("Unable to open " + fileName);
+    std::string line;
+    while (std::getline(file, line))
+    {
+      if (line.empty() || line[0] == '#')
+        continue;
+      std::istringstream lineStream(line);
+      AdblockPlus::FilterEngineClient::Query query;
+      std::string contentType;
+      std::string documentUrl;
+      lineStream >> query.url >> contentType >> documentUrl;
+      try
+      {
+        query.contentTypeMask =
+          AdblockPlus::FilterEngine::StringToContentType(contentType);
+      }
+      catch (const std::invalid_argument&)
+      {
+        continue;
+      }
+      if (!documentUrl.empty())
+        query.documentUrls.push_back(documentUrl);
+      queries.push_back(query);
+    }
+    return queries;
+  }
+
+  std::vector<AdblockPlus::FilterEngineClient::Query> CreateQueries()
+  {
+    std::vector<AdblockPlus::FilterEngineClient::Query> queries;
+    const char* paths[] = {"/ads/banner.gif", "/images/logo.png", "/js/tracker.js",
+      "/static/app.js", "/adserver/pixel?id=", "/css/style.css"};
+    for (int i = 0; i < 1000; i++)
+    {
+      AdblockPlus::FilterEngineClient::Query query;
+      query.url = "http://cdn" + std::to_string(i % 17) + ".example.com" +
+        paths[i % 6] + std::to_string(i);
+      query.contentTypeMask = i % 3 ? AdblockPlus::FilterEngine::CONTENT_TYPE_IMAGE :
+        AdblockPlus::FilterEngine::CONTENT_TYPE_SCRIPT;
+      query.documentUrls.push_back("http://site" + std::to_string(i % 29) + ".example.org/");
+      queries.push_back(query);
+    }
+    return queries;
+  }
+
+  // Keeps up to pipelineDepth requests in flight on one connection.
+  void RunConnection(const Options& options,
+    const std::vector<AdblockPlus::FilterEngineClient::Query>& queries,
+    int requestCount, size_t firstQuery, ConnectionResult& result)
+  {
+    AdblockPlus::FilterEngineClientPtr client;
+    try
+    {
+      client = AdblockPlus::FilterEngineClient::Connect(options.socketPath);
+    }
+    catch (const std::exception& e)
+    {
+      result.connectError = e.what();
+      return;
+    }
+
+    std::mutex mutex;
+    std::condition_variable requestCompleted;
+    int inFlight = 0;
+    size_t nextQuery = firstQuery;
+    for (int i = 0; i < requestCount; i++)
+    {
+      std::vector<AdblockPlus::FilterEngineClient::Query> batch;
+      for (int j = 0; j < options.batchSize; j++)
+        batch.push_back(queries[nextQuery++ % queries.size()]);
+      {
+        std::unique_lock<std::mutex> lock(mutex);
+        requestCompleted.wait(lock, [&] { return inFlight < options.pipelineDepth; });
+        inFlight++;
+      }
+      Clock::time_point start = Clock::now();
+      client->MatchesAsync(batch,
+        [&, start](std::vector<AdblockPlus::FilterEngineClient::MatchResult>&& results,
+          const std::string& error)
+        {
+          uint64_t nanoseconds = std::chrono::duration_cast<std::chrono::nanoseconds>(
+            Clock::now() - start).count();
+          std::lock_guard<std::mutex> lock(mutex);
+          AdblockPlus::LatencyHistogram& latencies = result.latencies;
+          latencies.count++;
+          latencies.totalNanoseconds += nanoseconds;
+          latencies.maxNanoseconds = std::max(latencies.maxNanoseconds, nanoseconds);
+          latencies.bucketCounts[AdblockPlus::LatencyHistogram::GetBucketIndex(nanoseconds)]++;
+          if (error.empty())
+          {
+            result.matched += std::count_if(results.begin(), results.end(),
+              [](const AdblockPlus::FilterEngineClient::MatchResult& match)
+              {
+                return match.matched;
+              });
+          }
+          else
+          {
+            result.failed++;
+            result.requestError = error;
+          }
+          inFlight--;
+          requestCompleted.notify_all();
+        });
+    }
+    std::unique_lock<std::mutex> lock(mutex);
+    requestCompleted.wait(lock, [&] { return inFlight == 0; });
+  }
+
+  std::string FormatMicroseconds(uint64_t nanoseconds)
+  {
+    std::ostringstream result;
+    result << std::fixed << std::setprecision(1) << nanoseconds / 1000.0 << " us";
+    return result.str();
+  }
+}
+
+int main(int argc, char* argv[])
+{
+  Options options;
+  if (!ParseOptions(argc, argv, options))
+  {
+    ShowUsage();
+    return 2;
+  }
+
+  std::vector<AdblockPlus::FilterEngineClient::Query> queries;
+  try
+  {
+    queries = options.requestLog.empty() ? CreateQueries() : ReadQueries(options.requestLog);
+  }
+  catch (const std::exception& e)
+  {
+    std::cerr << "Error: " << e.what() << std::endl;
+    return 1;
+  }
+  if (queries.empty())
+  {
+    std::cerr << "No requests in " << options.requestLog << std::endl;
+    return 1;
+  }
+
+  std::vector<ConnectionResult> results(options.connectionCount);
+  std::vector<std::thread> threads;
+  Clock::time_point start = Clock::now();
+  for (int i = 0; i < options.connectionCount; i++)
+  {
+    // Connections start at different queries, so that they don't send the
+    // same batches at the same time.
+    size_t firstQuery = queries.size() * i / options.connectionCount;
+    threads.push_back(std::thread(RunConnection, std::cref(options), std::cref(queries),
+      options.requestCount, firstQuery, std::ref(results[i])));
+  }
+  for (auto& thread : threads)
+    thread.join();
+  double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+
+  AdblockPlus::LatencyHistogram latencies;
+  size_t matched = 0;
+  size_t failed = 0;
+  std::string requestError;
+  for (const auto& result : results)
+  {
+    if (!result.connectError.empty())
+    {
+      std::cerr << "Error: " << result.connectError << std::endl;
+      return 1;
+    }
+    if (!result.requestError.empty())
+      requestError = result.requestError;
+    latencies.count += result.latencies.count;
+    latencies.totalNanoseconds += result.latencies.totalNanoseconds;
+    latencies.maxNanoseconds = std::max(latencies.maxNanoseconds,
+                                        result.latencies.maxNanoseconds);
+    for (size_t i = 0; i < latencies.bucketCounts.size(); i++)
+      latencies.bucketCounts[i] += result.latencies.bucketCounts[i];
+    matched += result.matched;
+    failed += result.failed;
+  }
+
+  uint64_t queryCount = latencies.count * options.batchSize;
+  std::cout << "Sent " << latencies.count << " requests of " << options.batchSize
+            << " queries on " << options.connectionCount << " connections, "
+            << options.pipelineDepth << " in flight each, in " << seconds << " s"
+            << std::endl
+            << "Throughput: " << (seconds > 0 ? latencies.count / seconds : 0)
+            << " requests/s, " << (seconds > 0 ? queryCount / seconds : 0)
+            << " queries/s" << std::endl
+            << "Round trip: mean "
+            << FormatMicroseconds(latencies.count ? latencies.totalNanoseconds / latencies.count : 0)
+            << ", p50 " << FormatMicroseconds(latencies.GetPercentile(50))
+            << ", p90 " << FormatMicroseconds(latencies.GetPercentile(90))
+            << ", p99 " << FormatMicroseconds(latencies.GetPercentile(99))
+            << ", max " << FormatMicroseconds(latencies.maxNanoseconds) << std::endl
+            << "Matched queries: " << matched << ", failed requests: " << failed
+            << std::endl;
+  if (!requestError.empty())
+    std::cerr << "Last error: " << requestError << std::endl;
+  return failed ? 1 : 0;
+}
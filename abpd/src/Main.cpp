@@ -0,0 +1,102 @@
+/*
+ * This file is part of Adblock Plus <https://adblockplus.org/>,
+ * Copyright (C) 2006-present eyeo GmbH
+ *
+ * Adblock Plus is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 3 as
+ * published by the Free Software Foundation.
+ *
+ * Adblock Plus is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Adblock Plus.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <AdblockPlus.h>
+#include <AdblockPlus/FilterEngineService.h>
+#include <AdblockPlus/Platform.h>
+#include <csignal>
+#include <iostream>
+#include <pthread.h>
+
+namespace
+{
+  struct Options
+  {
+    Options() : socketPath("/tmp/abpd.sock")
+    {
+    }
+
+    std::string socketPath;
+    std::string dataDirectory;
+  };
+
+  void ShowUsage()
+  {
+    std::cerr << "Usage: abpd [--socket PATH] [--data DIRECTORY]" << std::endl;
+  }
+
+  bool ParseOptions(int argc, char* argv[], Options& options)
+  {
+    for (int i = 1; i < argc; i++)
+    {
+      const std::string argument = argv[i];
+      if (argument == "--socket" && i + 1 < argc)
+        options.socketPath = argv[++i];
+      else if (argument == "--data" && i + 1 < argc)
+        options.dataDirectory = argv[++i];
+      else
+        return false;
+    }
+    return true;
+  }
+}
+
+int main(int argc, char* argv[])
+{
+  Options options;
+  if (!ParseOptions(argc, argv, options))
+  {
+    ShowUsage();
+    return 2;
+  }
+
+  // Blocked before any thread is started, so that only sigwait() below
+  // receives them.
+  sigset_t stopSignals;
+  sigemptyset(&stopSignals);
+  sigaddset(&stopSignals, SIGINT);
+  sigaddset(&stopSignals, SIGTERM);
+  pthread_sigmask(SIG_BLOCK, &stopSignals, nullptr);
+
+  try
+  {
+    AdblockPlus::AppInfo appInfo;
+    appInfo.version = "1.0";
+    appInfo.name = "abpd";
+    appInfo.application = "standalone";
+    appInfo.applicationVersion = "1.0";
+    appInfo.locale = "en-US";
+
+    AdblockPlus::DefaultPlatformBuilder platformBuilder;
+    if (!options.dataDirectory.empty())
+      platformBuilder.CreateDefaultFileSystem(options.dataDirectory);
+    auto platform = platformBuilder.CreatePlatform();
+    platform->SetUpJsEngine(appInfo);
+    auto& filterEngine = platform->GetFilterEngine();
+
+    AdblockPlus::FilterEngineService service(filterEngine, options.socketPath);
+    std::cerr << "Listening on " << options.socketPath << std::endl;
+    int signal;
+    sigwait(&stopSignals, &signal);
+  }
+  catch (const std::exception& e)
+  {
+    std::cerr << "Error: " << e.what() << std::endl;
+    return 1;
+  }
+  return 0;
+}
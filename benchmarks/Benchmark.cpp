@@ -0,0 +1,102 @@
+/*
+ * This file is part of Adblock Plus <https://adblockplus.org/>,
+ * Copyright (C) 2006-present eyeo GmbH
+ *
+ * Adblock Plus is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 3 as
+ * published by the Free Software Foundation.
+ *
+ * Adblock Plus is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Adblock Plus.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <algorithm>
+#include <exception>
+#include <iostream>
+#include <map>
+#include "Benchmark.h"
+
+using namespace AdblockPlus::Benchmark;
+
+namespace
+{
+  typedef std::map<std::string, BenchmarkFunction> Benchmarks;
+
+  Benchmarks& GetBenchmarks()
+  {
+    static Benchmarks benchmarks;
+    return benchmarks;
+  }
+}
+
+Reporter::Reporter(std::ostream& output)
+  : output(output)
+{
+}
+
+void Reporter::Report(const std::string& benchmark, const std::string& metric,
+  double value, const std::string& unit)
+{
+  output << benchmark << '\t' << metric << '\t' << value << '\t' << unit
+    << std::endl;
+}
+
+Registrar::Registrar(const std::string& name, const BenchmarkFunction& function)
+{
+  GetBenchmarks()[name] = function;
+}
+
+double AdblockPlus::Benchmark::SecondsSince(const Clock::time_point& start)
+{
+  return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+void AdblockPlus::Benchmark::ReportLatencies(Reporter& reporter,
+  const std::string& benchmark, const std::string& prefix,
+  std::vector<double>& latencies, double totalSeconds)
+{
+  if (latencies.empty())
+    return;
+  std::sort(latencies.begin(), latencies.end());
+  auto percentile = [&latencies](double value)
+  {
+    size_t index = static_cast<size_t>(value / 100 * (latencies.size() - 1) + 0.5);
+    return latencies[index] * 1e6;
+  };
+  reporter.Report(benchmark, prefix + "throughput", latencies.size() / totalSeconds, "calls/s");
+  reporter.Report(benchmark, prefix + "p50", percentile(50), "us");
+  reporter.Report(benchmark, prefix + "p90", percentile(90), "us");
+  reporter.Report(benchmark, prefix + "p99", percentile(99), "us");
+  reporter.Report(benchmark, prefix + "p999", percentile(99.9), "us");
+  reporter.Report(benchmark, prefix + "max", latencies.back() * 1e6, "us");
+}
+
+int main(int argc, char* argv[])
+{
+  // The only supported argument is a substring of the names of the
+  // benchmarks to run.
+  std::string filter = argc > 1 ? argv[1] : "";
+  Reporter reporter(std::cout);
+  int result = 0;
+  for (const auto& benchmark : GetBenchmarks())
+  {
+    if (benchmark.first.find(filter) == std::string::npos)
+      continue;
+    std::cerr << "Running " << benchmark.first << std::endl;
+    try
+    {
+      benchmark.second(reporter);
+    }
+    catch (const std::exception& e)
+    {
+      std::cerr << "FAILED " << benchmark.first << ": " << e.what() << std::endl;
+      result = 1;
+    }
+  }
+  return result;
+}
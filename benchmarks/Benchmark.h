@@ -0,0 +1,85 @@
+/*
+ * This file is part of Adblock Plus <https://adblockplus.org/>,
+ * Copyright (C) 2006-present eyeo GmbH
+ *
+ * Adblock Plus is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 3 as
+ * published by the Free Software Foundation.
+ *
+ * Adblock Plus is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Adblock Plus.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef ADBLOCK_PLUS_BENCHMARK_H
+#define ADBLOCK_PLUS_BENCHMARK_H
+
+#include <chrono>
+#include <functional>
+#include <ostream>
+#include <string>
+#include <vector>
+
+namespace AdblockPlus
+{
+  namespace Benchmark
+  {
+    typedef std::chrono::steady_clock Clock;
+
+    /**
+     * Writes measurements as tab separated lines
+     * `benchmark metric value unit`, one line per measurement, so that the
+     * output of two runs can be compared with standard tools.
+     */
+    class Reporter
+    {
+    public:
+      explicit Reporter(std::ostream& output);
+      void Report(const std::string& benchmark, const std::string& metric,
+        double value, const std::string& unit);
+    private:
+      std::ostream& output;
+    };
+
+    typedef std::function<void(Reporter&)> BenchmarkFunction;
+
+    /**
+     * Registers a benchmark, use `ABP_BENCHMARK` instead of instantiating it
+     * directly. A benchmark fails by throwing an exception, which makes the
+     * benchmarks executable exit with a non-zero status.
+     */
+    class Registrar
+    {
+    public:
+      Registrar(const std::string& name, const BenchmarkFunction& function);
+    };
+
+    /**
+     * Returns the number of seconds elapsed since `start`.
+     */
+    double SecondsSince(const Clock::time_point& start);
+
+    /**
+     * Reports throughput and latency percentiles of a series of calls as
+     * `<prefix>throughput`, `<prefix>p50`, `<prefix>p90`, `<prefix>p99`,
+     * `<prefix>p999` and `<prefix>max`.
+     * @param latencies Durations of the individual calls in seconds, they
+     *        are sorted in place.
+     * @param totalSeconds Wall-clock time all calls took together.
+     */
+    void ReportLatencies(Reporter& reporter, const std::string& benchmark,
+      const std::string& prefix, std::vector<double>& latencies,
+      double totalSeconds);
+  }
+}
+
+#define ABP_BENCHMARK(name) \
+  static void Benchmark##name(AdblockPlus::Benchmark::Reporter& reporter); \
+  static AdblockPlus::Benchmark::Registrar benchmark##name##Registrar(#name, Benchmark##name); \
+  static void Benchmark##name(AdblockPlus::Benchmark::Reporter& reporter)
+
+#endif
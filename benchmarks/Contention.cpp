@@ -0,0 +1,180 @@
+/*
+ * This file is part of Adblock Plus <https://adblockplus.org/>,
+ * Copyright (C) 2006-present eyeo GmbH
+ *
+ * Adblock Plus is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 3 as
+ * published by the Free Software Foundation.
+ *
+ * Adblock Plus is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Adblock Plus.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <condition_variable>
+#include <mutex>
+#include <random>
+#include <thread>
+#include <AdblockPlus/FilterEngine.h>
+#include "Benchmark.h"
+#include "FilterEngineFixture.h"
+
+using namespace AdblockPlus;
+using namespace AdblockPlus::Benchmark;
+
+namespace
+{
+  const int callsPerThread = 500;
+
+  enum Operation
+  {
+    OPERATION_MATCHES,
+    OPERATION_IS_DOCUMENT_WHITELISTED,
+    OPERATION_GET_ELEMENT_HIDING_SELECTORS,
+    OPERATION_COUNT
+  };
+
+  const char* const operationNames[] = {"matches", "is_document_whitelisted",
+    "get_element_hiding_selectors"};
+
+  // Roughly what a browser does: a document and its element hiding
+  // selectors are looked up once per page, Matches once per request.
+  Operation PickOperation(std::mt19937& random)
+  {
+    int value = random() % 100;
+    if (value < 90)
+      return OPERATION_MATCHES;
+    if (value < 97)
+      return OPERATION_IS_DOCUMENT_WHITELISTED;
+    return OPERATION_GET_ELEMENT_HIDING_SELECTORS;
+  }
+
+  struct ThreadResult
+  {
+    std::vector<double> latencies[OPERATION_COUNT];
+  };
+
+  void RunThread(FilterEngine& filterEngine, int threadIndex,
+    ThreadResult& result)
+  {
+    const std::vector<std::string>& blockedDomains = GetBlockedDomains();
+    const std::vector<std::string> documentUrls(1, "https://news.example/article.html");
+    std::mt19937 random(threadIndex);
+    for (int i = 0; i < callsPerThread; i++)
+    {
+      // Every URL is unique, so that the result cache of the matcher doesn't
+      // hide the cost of matching.
+      std::string id = std::to_string(threadIndex) + "-" + std::to_string(i);
+      Operation operation = PickOperation(random);
+      std::string argument;
+      switch (operation)
+      {
+        case OPERATION_MATCHES:
+          argument = "https://" + (random() % 10 == 0 ?
+            blockedDomains[random() % blockedDomains.size()] :
+            "static" + std::to_string(random() % 100) + ".example") +
+            "/media/" + id + ".png";
+          break;
+        case OPERATION_IS_DOCUMENT_WHITELISTED:
+          argument = "https://site" + std::to_string(random() % 10000) +
+            ".com/" + id;
+          break;
+        default:
+          argument = "site" + std::to_string(random() % 10000) + ".com";
+      }
+
+      Clock::time_point start = Clock::now();
+      switch (operation)
+      {
+        case OPERATION_MATCHES:
+          filterEngine.Matches(argument, FilterEngine::CONTENT_TYPE_IMAGE,
+            documentUrls);
+          break;
+        case OPERATION_IS_DOCUMENT_WHITELISTED:
+          filterEngine.IsDocumentWhitelisted(argument, documentUrls);
+          break;
+        default:
+          filterEngine.GetElementHidingSelectors(argument);
+      }
+      result.latencies[operation].push_back(SecondsSince(start));
+    }
+  }
+
+  LatencyHistogram GetLockWait(const FilterEngine& filterEngine)
+  {
+    return filterEngine.GetMetrics()[Metrics::OPERATION_V8_LOCK_WAIT];
+  }
+}
+
+ABP_BENCHMARK(Contention)
+{
+  FilterEngine& filterEngine = GetSharedFilterEngineFixture().GetFilterEngine();
+  const int threadCounts[] = {1, 2, 4, 8, 16, 32, 64};
+  for (int threadCount : threadCounts)
+  {
+    std::string prefix = "threads" + std::to_string(threadCount) + "/";
+    std::vector<ThreadResult> results(threadCount);
+    std::vector<std::thread> threads;
+    std::mutex mutex;
+    std::condition_variable startSignal;
+    bool started = false;
+    for (int i = 0; i < threadCount; i++)
+    {
+      threads.push_back(std::thread([&, i]()
+      {
+        {
+          std::unique_lock<std::mutex> lock(mutex);
+          startSignal.wait(lock, [&started]() { return started; });
+        }
+        RunThread(filterEngine, i, results[i]);
+      }));
+    }
+
+    LatencyHistogram lockWaitBefore = GetLockWait(filterEngine);
+    Clock::time_point start = Clock::now();
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      started = true;
+    }
+    startSignal.notify_all();
+    for (auto& thread : threads)
+      thread.join();
+    double totalSeconds = SecondsSince(start);
+    LatencyHistogram lockWaitAfter = GetLockWait(filterEngine);
+
+    std::vector<double> allLatencies;
+    for (int operation = 0; operation < OPERATION_COUNT; operation++)
+    {
+      std::vector<double> latencies;
+      for (const auto& result : results)
+      {
+        latencies.insert(latencies.end(), result.latencies[operation].begin(),
+          result.latencies[operation].end());
+      }
+      allLatencies.insert(allLatencies.end(), latencies.begin(), latencies.end());
+      ReportLatencies(reporter, "Contention",
+        prefix + operationNames[operation] + "/", latencies, totalSeconds);
+    }
+    ReportLatencies(reporter, "Contention", prefix + "all/", allLatencies,
+      totalSeconds);
+
+    // Every entry point takes the v8::Locker, the time spent waiting for it
+    // shows how much the threads are serialized.
+    double lockWaitSeconds = (lockWaitAfter.totalNanoseconds -
+      lockWaitBefore.totalNanoseconds) / 1e9;
+    uint64_t lockCount = lockWaitAfter.count - lockWaitBefore.count;
+    reporter.Report("Contention", prefix + "lock_wait_total",
+      lockWaitSeconds, "s");
+    reporter.Report("Contention", prefix + "lock_wait_share",
+      lockWaitSeconds / (totalSeconds * threadCount) * 100, "%");
+    if (lockCount > 0)
+    {
+      reporter.Report("Contention", prefix + "lock_wait_mean",
+        lockWaitSeconds / lockCount * 1e6, "us");
+    }
+  }
+}
@@ -0,0 +1,372 @@
+/*
+ * This file is part of Adblock Plus <https://adblockplus.org/>,
+ * Copyright (C) 2006-present eyeo GmbH
+ *
+ * Adblock Plus is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 3 as
+ * published by the Free Software Foundation.
+ *
+ * Adblock Plus is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Adblock Plus.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <cstdlib>
+#include <fstream>
+#include <random>
+#include <stdexcept>
+#include <AdblockPlus/DefaultLogSystem.h>
+#include <AdblockPlus/JsEngine.h>
+#include "Benchmark.h"
+#include "FilterEngineFixture.h"
+
+using namespace AdblockPlus;
+using namespace AdblockPlus::Benchmark;
+
+namespace
+{
+  std::vector<std::string> ReadFilterList(const std::string& fileName)
+  {
+    std::ifstream file(fileName);
+    if (!file)
+      throw std::runtime_error("Failed to open " + fileName);
+    std::vector<std::string> filters;
+    std::string line;
+    while (std::getline(file, line))
+    {
+      if (!line.empty() && line[line.size() - 1] == '\r')
+        line.erase(line.size() - 1);
+      // Skip the [Adblock Plus 2.0] header and empty lines
+      if (line.empty() || line[0] == '[')
+        continue;
+      filters.push_back(line);
+    }
+    return filters;
+  }
+}
+
+std::vector<std::string> AdblockPlus::Benchmark::GenerateFilterList(size_t filterCount)
+{
+  std::mt19937 random(20180101);
+  const char* const topLevelDomains[] = {"com", "net", "org", "info"};
+  const char* const pathPatterns[] = {"/banner%/", "/ads/%_", "-ad%-",
+    "_adframe%.", "/adv%.js", "&ad_type%=", "?adzone%="};
+  const char* const contentTypes[] = {"image", "script", "subdocument",
+    "stylesheet", "xmlhttprequest"};
+  auto format = [](const char* pattern, int value)
+  {
+    std::string result(pattern);
+    return result.replace(result.find('%'), 1, std::to_string(value));
+  };
+
+  // The proportions roughly follow EasyList: mostly URL filters, a good share
+  // of element hiding filters and a few exceptions.
+  auto scaled = [filterCount](int count)
+  {
+    return static_cast<int>(count * (filterCount / 60000.0) + 0.5);
+  };
+
+  std::vector<std::string> filters;
+  for (int i = 0, l = scaled(20000); i < l; i++)
+  {
+    filters.push_back("||adserver" + std::to_string(i) + "." +
+      topLevelDomains[random() % 4] + "^");
+  }
+  for (int i = 0, l = scaled(6000); i < l; i++)
+    filters.push_back("||thirdparty" + std::to_string(i) + ".com^$third-party");
+  for (int i = 0, l = scaled(13000); i < l; i++)
+    filters.push_back(format(pathPatterns[random() % 7], i));
+  for (int i = 0, l = scaled(4000); i < l; i++)
+  {
+    filters.push_back("||tracker" + std::to_string(i) + ".com/pixel^$" +
+      contentTypes[random() % 5] + ",domain=site" +
+      std::to_string(random() % 10000) + ".com");
+  }
+  for (int i = 0, l = scaled(20); i < l; i++)
+  {
+    filters.push_back("/^https?:\\/\\/[a-z]{8,15}\\.(com|net)\\/ads" +
+      std::to_string(i) + "\\//");
+  }
+  for (int i = 0, l = scaled(3000); i < l; i++)
+  {
+    filters.push_back("@@||site" + std::to_string(i) + ".com/ads/$" +
+      contentTypes[random() % 5]);
+  }
+  for (int i = 0, l = scaled(12000); i < l; i++)
+  {
+    switch (random() % 3)
+    {
+      case 0:
+        filters.push_back("##.ad-" + std::to_string(i));
+        break;
+      case 1:
+        filters.push_back("###banner-" + std::to_string(i));
+        break;
+      default:
+        filters.push_back("site" + std::to_string(random() % 10000) +
+          ".com##.sponsored-" + std::to_string(i));
+    }
+  }
+  for (int i = 0, l = scaled(2000); i < l; i++)
+  {
+    filters.push_back("site" + std::to_string(i) + ".com#@#.ad-" +
+      std::to_string(random() % 12000));
+  }
+  return filters;
+}
+
+const std::vector<std::string>& AdblockPlus::Benchmark::GetFilterList()
+{
+  static const std::vector<std::string> filters = []()
+  {
+    const char* fileName = std::getenv("ABP_BENCHMARK_FILTER_LIST");
+    return fileName && *fileName ? ReadFilterList(fileName) : GenerateFilterList(60000);
+  }();
+  return filters;
+}
+
+const std::vector<std::string>& AdblockPlus::Benchmark::GetBlockedDomains()
+{
+  static const std::vector<std::string> domains = []()
+  {
+    std::vector<std::string> result;
+    for (const auto& filter : GetFilterList())
+    {
+      if (filter.size() < 4 || filter.compare(0, 2, "||") != 0 ||
+          filter[filter.size() - 1] != '^' ||
+          filter.find_first_of("/*$^|", 2) != filter.size() - 1)
+        continue;
+      result.push_back(filter.substr(2, filter.size() - 3));
+    }
+    if (result.empty())
+      throw std::runtime_error("The filter list contains no ||domain^ filters");
+    return result;
+  }();
+  return domains;
+}
+
+std::string AdblockPlus::Benchmark::CreatePatternsIni(const std::vector<std::string>& filters,
+  size_t subscriptionCount)
+{
+  std::string result = "# Adblock Plus preferences\nversion=5\n";
+  for (size_t i = 0; i < subscriptionCount; i++)
+  {
+    std::string suffix = i > 0 ? std::to_string(i) : "";
+    result += "[Subscription]\nurl=~user~benchmark" + suffix +
+      "\ntitle=Benchmark" + suffix + "\n[Subscription filters]\n";
+    size_t begin = filters.size() * i / subscriptionCount;
+    size_t end = filters.size() * (i + 1) / subscriptionCount;
+    for (size_t j = begin; j < end; j++)
+    {
+      // Square brackets have to be escaped in filters, since they would
+      // start a new section otherwise.
+      for (char c : filters[j])
+      {
+        if (c == '[')
+          result += '\\';
+        result += c;
+      }
+      result += '\n';
+    }
+  }
+  return result;
+}
+
+InMemoryFileSystem::InMemoryFileSystem()
+  : immediate(false)
+{
+}
+
+void InMemoryFileSystem::Schedule(const Task& task) const
+{
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (!immediate)
+    {
+      pendingTasks.push_back(task);
+      return;
+    }
+  }
+  task();
+}
+
+void InMemoryFileSystem::Read(const std::string& fileName,
+  const ReadCallback& callback) const
+{
+  Schedule([this, fileName, callback]()
+  {
+    IOBuffer content;
+    bool exists;
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      auto file = files.find(fileName);
+      exists = file != files.end();
+      if (exists)
+        content = file->second;
+    }
+    if (exists)
+      callback(std::move(content), "");
+    else
+      callback(IOBuffer(), "File not found, " + fileName);
+  });
+}
+
+void InMemoryFileSystem::Write(const std::string& fileName,
+  const IOBuffer& data, const Callback& callback)
+{
+  Schedule([this, fileName, data, callback]()
+  {
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      files[fileName] = data;
+    }
+    callback("");
+  });
+}
+
+void InMemoryFileSystem::Move(const std::string& fromFileName,
+  const std::string& toFileName, const Callback& callback)
+{
+  Schedule([this, fromFileName, toFileName, callback]()
+  {
+    bool exists;
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      auto file = files.find(fromFileName);
+      exists = file != files.end();
+      if (exists)
+      {
+        IOBuffer content = std::move(file->second);
+        files.erase(file);
+        files[toFileName] = std::move(content);
+      }
+    }
+    callback(exists ? "" : "File (from) not found, " + fromFileName);
+  });
+}
+
+void InMemoryFileSystem::Remove(const std::string& fileName,
+  const Callback& callback)
+{
+  Schedule([this, fileName, callback]()
+  {
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      files.erase(fileName);
+    }
+    callback("");
+  });
+}
+
+void InMemoryFileSystem::Stat(const std::string& fileName,
+  const StatCallback& callback) const
+{
+  Schedule([this, fileName, callback]()
+  {
+    StatResult result;
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      result.exists = files.find(fileName) != files.end();
+    }
+    callback(result, "");
+  });
+}
+
+void InMemoryFileSystem::SetFile(const std::string& fileName,
+  const std::string& content)
+{
+  std::lock_guard<std::mutex> lock(mutex);
+  files[fileName] = IOBuffer(content.begin(), content.end());
+}
+
+bool InMemoryFileSystem::RunPendingTasks()
+{
+  std::list<Task> tasks;
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    tasks.swap(pendingTasks);
+  }
+  for (const auto& task : tasks)
+    task();
+  return !tasks.empty();
+}
+
+void InMemoryFileSystem::SetImmediate()
+{
+  for (;;)
+  {
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      if (pendingTasks.empty())
+      {
+        immediate = true;
+        return;
+      }
+    }
+    RunPendingTasks();
+  }
+}
+
+FilterEngineFixture::FilterEngineFixture(const std::vector<std::string>& filters,
+  size_t subscriptionCount)
+{
+  InMemoryFileSystem* fileSystem;
+  Platform::CreationParameters platformParams;
+  platformParams.logSystem.reset(new DefaultLogSystem());
+  platformParams.minLogLevel = LogSystem::LOG_LEVEL_WARN;
+  platformParams.timer.reset(new NoopTimer());
+  platformParams.webRequest.reset(new NoopWebRequest());
+  platformParams.fileSystem.reset(fileSystem = new InMemoryFileSystem());
+  fileSystem->SetFile("patterns.ini", CreatePatternsIni(filters, subscriptionCount));
+  platform.reset(new Platform(std::move(platformParams)));
+
+  Clock::time_point start = Clock::now();
+  FilterEngine::CreationParameters creationParams;
+  creationParams.preconfiguredPrefs.insert(std::make_pair(
+    "first_run_subscription_auto_select",
+    platform->GetJsEngine().NewValue(false)));
+  bool isReady = false;
+  platform->CreateFilterEngineAsync(creationParams,
+    [&isReady](const FilterEngine&)
+    {
+      isReady = true;
+    });
+  while (!isReady && fileSystem->RunPendingTasks())
+  {
+  }
+  if (!isReady)
+    throw std::runtime_error("FilterEngine could not be created");
+  creationSeconds = SecondsSince(start);
+  fileSystem->SetImmediate();
+}
+
+FilterEngineFixture::~FilterEngineFixture()
+{
+}
+
+Platform& FilterEngineFixture::GetPlatform()
+{
+  return *platform;
+}
+
+FilterEngine& FilterEngineFixture::GetFilterEngine()
+{
+  return platform->GetFilterEngine();
+}
+
+double FilterEngineFixture::GetCreationSeconds() const
+{
+  return creationSeconds;
+}
+
+FilterEngineFixture& AdblockPlus::Benchmark::GetSharedFilterEngineFixture()
+{
+  // Intentionally leaked, destroying the engine during static destruction
+  // would race with the shutdown of V8.
+  static FilterEngineFixture* fixture = new FilterEngineFixture();
+  return *fixture;
+}
@@ -0,0 +1,161 @@
+/*
+ * This file is part of Adblock Plus <https://adblockplus.org/>,
+ * Copyright (C) 2006-present eyeo GmbH
+ *
+ * Adblock Plus is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 3 as
+ * published by the Free Software Foundation.
+ *
+ * Adblock Plus is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Adblock Plus.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef ADBLOCK_PLUS_BENCHMARK_FILTER_ENGINE_FIXTURE_H
+#define ADBLOCK_PLUS_BENCHMARK_FILTER_ENGINE_FIXTURE_H
+
+#include <list>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+#include <AdblockPlus/FilterEngine.h>
+#include <AdblockPlus/IFileSystem.h>
+#include <AdblockPlus/ITimer.h>
+#include <AdblockPlus/IWebRequest.h>
+#include <AdblockPlus/Platform.h>
+
+namespace AdblockPlus
+{
+  namespace Benchmark
+  {
+    /**
+     * Returns the filters to benchmark with.
+     * If the environment variable `ABP_BENCHMARK_FILTER_LIST` names a file,
+     * e.g. a copy of EasyList, its lines are used. Otherwise a synthetic list
+     * of about the size and composition of EasyList is generated, the same
+     * on every run.
+     */
+    const std::vector<std::string>& GetFilterList();
+
+    /**
+     * Returns the domains of filters like `||example.com^` in
+     * `GetFilterList()`, a request to such a domain is blocked regardless of
+     * its content type.
+     */
+    const std::vector<std::string>& GetBlockedDomains();
+
+    /**
+     * Generates a synthetic filter list resembling EasyList.
+     * @param filterCount Approximate number of filters.
+     */
+    std::vector<std::string> GenerateFilterList(size_t filterCount);
+
+    /**
+     * Converts a filter list into the `patterns.ini` format, as user-defined
+     * subscriptions, so that no downloads are triggered.
+     * @param subscriptionCount Number of subscriptions to spread the filters
+     *        over evenly.
+     */
+    std::string CreatePatternsIni(const std::vector<std::string>& filters,
+      size_t subscriptionCount = 1);
+
+    /**
+     * `ITimer` whose timers never fire.
+     */
+    class NoopTimer : public ITimer
+    {
+    public:
+      void SetTimer(const std::chrono::milliseconds& timeout,
+        const TimerCallback& timerCallback) override
+      {
+      }
+    };
+
+    /**
+     * `IWebRequest` whose requests are never answered.
+     */
+    class NoopWebRequest : public IWebRequest
+    {
+    public:
+      void GET(const std::string& url, const HeaderList& requestHeaders,
+        const GetCallback& callback) override
+      {
+      }
+    };
+
+    /**
+     * `IFileSystem` keeping the files in memory.
+     * Operations are queued until `RunPendingTasks()` is called, once
+     * `SetImmediate()` has been called they are executed right away.
+     */
+    class InMemoryFileSystem : public IFileSystem
+    {
+    public:
+      InMemoryFileSystem();
+      void Read(const std::string& fileName,
+        const ReadCallback& callback) const override;
+      void Write(const std::string& fileName, const IOBuffer& data,
+        const Callback& callback) override;
+      void Move(const std::string& fromFileName, const std::string& toFileName,
+        const Callback& callback) override;
+      void Remove(const std::string& fileName, const Callback& callback) override;
+      void Stat(const std::string& fileName,
+        const StatCallback& callback) const override;
+
+      void SetFile(const std::string& fileName, const std::string& content);
+      bool RunPendingTasks();
+      void SetImmediate();
+
+    private:
+      typedef std::function<void()> Task;
+      void Schedule(const Task& task) const;
+
+      mutable std::mutex mutex;
+      mutable std::list<Task> pendingTasks;
+      bool immediate;
+      std::map<std::string, IOBuffer> files;
+    };
+
+    /**
+     * Platform with a `FilterEngine` which has a given filter list loaded.
+     * Web requests are never answered and timers never fire, so nothing
+     * changes the filters while measuring.
+     */
+    class FilterEngineFixture
+    {
+    public:
+      explicit FilterEngineFixture(const std::vector<std::string>& filters = GetFilterList(),
+        size_t subscriptionCount = 1);
+      ~FilterEngineFixture();
+
+      Platform& GetPlatform();
+      FilterEngine& GetFilterEngine();
+
+      /**
+       * Returns the time creating the `FilterEngine` took in seconds.
+       */
+      double GetCreationSeconds() const;
+
+    private:
+      FilterEngineFixture(const FilterEngineFixture&);
+      FilterEngineFixture& operator=(const FilterEngineFixture&);
+
+      std::unique_ptr<Platform> platform;
+      double creationSeconds;
+    };
+
+    /**
+     * Returns a fixture with the default filter list which is shared by all
+     * benchmarks, since loading a large filter list takes a while.
+     */
+    FilterEngineFixture& GetSharedFilterEngineFixture();
+  }
+}
+
+#endif
@@ -0,0 +1,160 @@
+/*
+ * This file is part of Adblock Plus <https://adblockplus.org/>,
+ * Copyright (C) 2006-present eyeo GmbH
+ *
+ * Adblock Plus is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 3 as
+ * published by the Free Software Foundation.
+ *
+ * Adblock Plus is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Adblock Plus.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <random>
+#include <AdblockPlus/FilterEngine.h>
+#include "Benchmark.h"
+#include "FilterEngineFixture.h"
+
+using namespace AdblockPlus;
+using namespace AdblockPlus::Benchmark;
+
+namespace
+{
+  const int callsPerScenario = 2000;
+
+  // Every URL is unique, so that the result cache of the matcher doesn't
+  // hide the cost of matching.
+  std::vector<std::string> CreateUrls(int hitPercent, std::mt19937& random)
+  {
+    const std::vector<std::string>& blockedDomains = GetBlockedDomains();
+    std::vector<std::string> urls;
+    for (int i = 0; i < callsPerScenario; i++)
+    {
+      if (static_cast<int>(random() % 100) < hitPercent)
+      {
+        urls.push_back("https://" + blockedDomains[random() % blockedDomains.size()] +
+          "/media/" + std::to_string(i) + ".png");
+      }
+      else
+      {
+        urls.push_back("https://static" + std::to_string(random() % 100) +
+          ".example/content/" + std::to_string(i) + ".png");
+      }
+    }
+    return urls;
+  }
+
+  std::vector<std::string> CreateDocumentUrls(int frameDepth)
+  {
+    std::vector<std::string> documentUrls;
+    for (int i = frameDepth - 1; i > 0; i--)
+      documentUrls.push_back("https://frame" + std::to_string(i) + ".example/");
+    documentUrls.push_back("https://news.example/article.html");
+    return documentUrls;
+  }
+
+  template<class MatchFunction>
+  void Measure(Reporter& reporter, const std::string& benchmark,
+    const std::string& prefix, const std::vector<std::string>& urls,
+    const MatchFunction& match)
+  {
+    std::vector<double> latencies;
+    latencies.reserve(urls.size());
+    int hits = 0;
+    Clock::time_point start = Clock::now();
+    for (const auto& url : urls)
+    {
+      Clock::time_point callStart = Clock::now();
+      FilterPtr filter = match(url);
+      latencies.push_back(SecondsSince(callStart));
+      if (filter && filter->GetType() == Filter::TYPE_BLOCKING)
+        hits++;
+    }
+    double totalSeconds = SecondsSince(start);
+    reporter.Report(benchmark, prefix + "blocked", hits, "calls");
+    ReportLatencies(reporter, benchmark, prefix, latencies, totalSeconds);
+  }
+
+  void MeasureMatches(Reporter& reporter, const std::string& benchmark,
+    const std::string& prefix, FilterEngine::ContentType contentType,
+    int hitPercent, int frameDepth)
+  {
+    FilterEngine& filterEngine = GetSharedFilterEngineFixture().GetFilterEngine();
+    std::mt19937 random(hitPercent * 100 + frameDepth);
+    std::vector<std::string> urls = CreateUrls(hitPercent, random);
+    std::vector<std::string> documentUrls = CreateDocumentUrls(frameDepth);
+    Measure(reporter, benchmark, prefix, urls,
+      [&filterEngine, contentType, &documentUrls](const std::string& url)
+      {
+        return filterEngine.Matches(url, contentType, documentUrls);
+      });
+  }
+}
+
+ABP_BENCHMARK(MatchesContentTypes)
+{
+  reporter.Report("MatchesContentTypes", "filters", GetFilterList().size(), "count");
+  const FilterEngine::ContentType contentTypes[] = {
+    FilterEngine::CONTENT_TYPE_IMAGE, FilterEngine::CONTENT_TYPE_SCRIPT,
+    FilterEngine::CONTENT_TYPE_STYLESHEET, FilterEngine::CONTENT_TYPE_SUBDOCUMENT,
+    FilterEngine::CONTENT_TYPE_XMLHTTPREQUEST
+  };
+  for (auto contentType : contentTypes)
+  {
+    MeasureMatches(reporter, "MatchesContentTypes",
+      FilterEngine::ContentTypeToString(contentType) + "/", contentType, 10, 1);
+  }
+}
+
+ABP_BENCHMARK(MatchesHitRatio)
+{
+  const int hitPercents[] = {0, 10, 50, 100};
+  for (int hitPercent : hitPercents)
+  {
+    MeasureMatches(reporter, "MatchesHitRatio",
+      "hits" + std::to_string(hitPercent) + "/",
+      FilterEngine::CONTENT_TYPE_IMAGE, hitPercent, 1);
+  }
+}
+
+ABP_BENCHMARK(MatchesFrameDepth)
+{
+  const int frameDepths[] = {1, 2, 4, 8};
+  for (int frameDepth : frameDepths)
+  {
+    MeasureMatches(reporter, "MatchesFrameDepth",
+      "depth" + std::to_string(frameDepth) + "/",
+      FilterEngine::CONTENT_TYPE_IMAGE, 10, frameDepth);
+  }
+
+  // The same with the frame structure registered in the FrameTree, which
+  // caches the document whitelisting state.
+  FilterEngine& filterEngine = GetSharedFilterEngineFixture().GetFilterEngine();
+  FrameTree& frameTree = filterEngine.GetFrameTree();
+  for (int frameDepth : frameDepths)
+  {
+    std::vector<std::string> documentUrls = CreateDocumentUrls(frameDepth);
+    FrameTree::FrameId frameId = 1;
+    frameTree.AddFrame(frameId, documentUrls.back());
+    for (int i = static_cast<int>(documentUrls.size()) - 2; i >= 0; i--)
+    {
+      frameTree.AddFrame(frameId + 1, frameId, documentUrls[i]);
+      frameId++;
+    }
+
+    std::mt19937 random(10 * 100 + frameDepth);
+    std::vector<std::string> urls = CreateUrls(10, random);
+    Measure(reporter, "MatchesFrameDepth",
+      "frametree" + std::to_string(frameDepth) + "/", urls,
+      [&filterEngine, frameId](const std::string& url)
+      {
+        return filterEngine.Matches(url, FilterEngine::CONTENT_TYPE_IMAGE, frameId);
+      });
+    frameTree.RemoveFrame(1);
+  }
+}
@@ -0,0 +1,194 @@
+/*
+ * This file is part of Adblock Plus <https://adblockplus.org/>,
+ * Copyright (C) 2006-present eyeo GmbH
+ *
+ * Adblock Plus is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 3 as
+ * published by the Free Software Foundation.
+ *
+ * Adblock Plus is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Adblock Plus.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <cstdlib>
+#include <stdexcept>
+#if defined(__linux__)
+#include <fstream>
+#include <unistd.h>
+#elif defined(__APPLE__)
+#include <mach/mach.h>
+#endif
+#include <AdblockPlus/JsEngine.h>
+#include "Benchmark.h"
+#include "FilterEngineFixture.h"
+
+using namespace AdblockPlus;
+using namespace AdblockPlus::Benchmark;
+
+namespace
+{
+  // Heap used per 10k filters of the default mix above which the benchmark
+  // fails, can be overridden with ABP_BENCHMARK_MAX_HEAP_PER_10K_FILTERS.
+  const double defaultMaxHeapPer10kFilters = 16 * 1024;
+
+  struct MemoryUsage
+  {
+    double heapUsed;
+    double heapTotal;
+    double external;
+    double rss;
+  };
+
+  // Returns the resident set size of the process in bytes or 0 where that
+  // isn't supported.
+  double GetResidentSetSize()
+  {
+#if defined(__linux__)
+    std::ifstream statm("/proc/self/statm");
+    size_t size = 0;
+    size_t resident = 0;
+    if (!(statm >> size >> resident))
+      return 0;
+    return static_cast<double>(resident) * sysconf(_SC_PAGESIZE);
+#elif defined(__APPLE__)
+    mach_task_basic_info_data_t info;
+    mach_msg_type_number_t count = MACH_TASK_BASIC_INFO_COUNT;
+    if (task_info(mach_task_self(), MACH_TASK_BASIC_INFO,
+        reinterpret_cast<task_info_t>(&info), &count) != KERN_SUCCESS)
+      return 0;
+    return static_cast<double>(info.resident_size);
+#else
+    return 0;
+#endif
+  }
+
+  MemoryUsage MeasureMemory(JsEngine& jsEngine)
+  {
+    jsEngine.Gc();
+    JsEngine::HeapStatistics statistics = jsEngine.GetHeapStatistics();
+    MemoryUsage usage;
+    usage.heapUsed = static_cast<double>(statistics.usedHeapSize);
+    usage.heapTotal = static_cast<double>(statistics.totalHeapSize);
+    usage.external = static_cast<double>(statistics.externalMemory);
+    usage.rss = GetResidentSetSize();
+    return usage;
+  }
+
+  // Returns the memory a filter engine with the given filters uses beyond
+  // one without any filters.
+  MemoryUsage MeasureFilters(const std::vector<std::string>& filters,
+    const MemoryUsage& baseline, size_t subscriptionCount = 1)
+  {
+    double rssBefore = GetResidentSetSize();
+    FilterEngineFixture fixture(filters, subscriptionCount);
+    MemoryUsage usage = MeasureMemory(fixture.GetPlatform().GetJsEngine());
+    usage.heapUsed -= baseline.heapUsed;
+    usage.heapTotal -= baseline.heapTotal;
+    usage.external -= baseline.external;
+    usage.rss -= rssBefore;
+    return usage;
+  }
+
+  void ReportPer10kFilters(Reporter& reporter, const std::string& prefix,
+    const MemoryUsage& usage, size_t filterCount)
+  {
+    double factor = 10000.0 / filterCount / 1024;
+    reporter.Report("Memory", prefix + "heap_used_per_10k", usage.heapUsed * factor, "KiB");
+    reporter.Report("Memory", prefix + "heap_total_per_10k", usage.heapTotal * factor, "KiB");
+    reporter.Report("Memory", prefix + "external_per_10k", usage.external * factor, "KiB");
+    if (usage.rss > 0)
+      reporter.Report("Memory", prefix + "rss_per_10k", usage.rss * factor, "KiB");
+  }
+
+  std::vector<std::string> GenerateFilters(const std::string& type, size_t count)
+  {
+    std::vector<std::string> filters;
+    for (size_t i = 0; i < count; i++)
+    {
+      std::string n = std::to_string(i);
+      if (type == "blocking")
+        filters.push_back("||adserver" + n + ".com^");
+      else if (type == "blocking_options")
+        filters.push_back("||tracker" + n + ".com/pixel^$script,domain=site" + n + ".com");
+      else if (type == "regexp")
+        filters.push_back("/^https?:\\/\\/[a-z]{8,15}\\.(com|net)\\/ads" + n + "\\//");
+      else if (type == "whitelist")
+        filters.push_back("@@||site" + n + ".com/ads/$image");
+      else if (type == "elemhide")
+        filters.push_back("##.ad-" + n);
+      else if (type == "elemhide_domain")
+        filters.push_back("site" + n + ".com##.sponsored-" + n);
+      else if (type == "elemhide_exception")
+        filters.push_back("site" + n + ".com#@#.ad-" + n);
+      else
+        throw std::logic_error("Unknown filter type " + type);
+    }
+    return filters;
+  }
+
+  double GetMaxHeapPer10kFilters()
+  {
+    const char* value = std::getenv("ABP_BENCHMARK_MAX_HEAP_PER_10K_FILTERS");
+    return value && *value ? std::atof(value) : defaultMaxHeapPer10kFilters;
+  }
+}
+
+ABP_BENCHMARK(Memory)
+{
+  MemoryUsage baseline;
+  {
+    const std::vector<std::string> noFilters;
+    FilterEngineFixture fixture(noFilters);
+    baseline = MeasureMemory(fixture.GetPlatform().GetJsEngine());
+  }
+  reporter.Report("Memory", "empty/heap_used", baseline.heapUsed / 1024, "KiB");
+  reporter.Report("Memory", "empty/external", baseline.external / 1024, "KiB");
+
+  const size_t filterCountPerType = 10000;
+  const char* const filterTypes[] = {"blocking", "blocking_options", "regexp",
+    "whitelist", "elemhide", "elemhide_domain", "elemhide_exception"};
+  for (const char* filterType : filterTypes)
+  {
+    MemoryUsage usage = MeasureFilters(
+      GenerateFilters(filterType, filterCountPerType), baseline);
+    ReportPer10kFilters(reporter, std::string(filterType) + "/", usage,
+      filterCountPerType);
+  }
+
+  // Memory should grow linearly with the number of filters, the limit is
+  // checked against the largest list.
+  double heapUsedPer10k = 0;
+  const size_t filterCounts[] = {10000, 50000, 100000};
+  for (size_t filterCount : filterCounts)
+  {
+    MemoryUsage usage = MeasureFilters(GenerateFilterList(filterCount), baseline);
+    ReportPer10kFilters(reporter, "mixed" + std::to_string(filterCount) + "/",
+      usage, filterCount);
+    heapUsedPer10k = usage.heapUsed * 10000 / filterCount / 1024;
+  }
+
+  // The same filters spread over more subscriptions.
+  const size_t subscriptionCounts[] = {10, 50};
+  for (size_t subscriptionCount : subscriptionCounts)
+  {
+    const size_t filterCount = 50000;
+    MemoryUsage usage = MeasureFilters(GenerateFilterList(filterCount),
+      baseline, subscriptionCount);
+    ReportPer10kFilters(reporter, "mixed" + std::to_string(filterCount) +
+      "_subscriptions" + std::to_string(subscriptionCount) + "/", usage,
+      filterCount);
+  }
+
+  double maxHeapPer10k = GetMaxHeapPer10kFilters();
+  if (heapUsedPer10k > maxHeapPer10k)
+  {
+    throw std::runtime_error("Heap used per 10k filters is " +
+      std::to_string(heapUsedPer10k) + " KiB, more than the limit of " +
+      std::to_string(maxHeapPer10k) + " KiB");
+  }
+}
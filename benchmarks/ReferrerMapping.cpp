@@ -0,0 +1,96 @@
+/*
+ * This file is part of Adblock Plus <https://adblockplus.org/>,
+ * Copyright (C) 2006-present eyeo GmbH
+ *
+ * Adblock Plus is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 3 as
+ * published by the Free Software Foundation.
+ *
+ * Adblock Plus is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Adblock Plus.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <AdblockPlus/ConcurrentReferrerMapping.h>
+#include <AdblockPlus/ReferrerMapping.h>
+#include "Benchmark.h"
+
+using namespace AdblockPlus;
+
+namespace
+{
+  const int requestsPerThread = 20000;
+
+  // Mimics a browser tab: a page, a frame in it and resources requested by
+  // the frame.
+  template<class Mapping>
+  void SimulateRequests(Mapping& mapping, int threadId)
+  {
+    const std::string page = "https://example" + std::to_string(threadId) + ".com/";
+    for (int i = 0; i < requestsPerThread; i++)
+    {
+      const std::string frame = page + "frame" + std::to_string(i % 50);
+      const std::string resource = frame + "/resource" + std::to_string(i);
+      mapping.Add(frame, page);
+      mapping.Add(resource, frame);
+      mapping.BuildReferrerChain(resource);
+    }
+  }
+
+  class LockedReferrerMapping
+  {
+  public:
+    void Add(const std::string& url, const std::string& referrer)
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      mapping.Add(url, referrer);
+    }
+
+    std::vector<std::string> BuildReferrerChain(const std::string& url) const
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      return mapping.BuildReferrerChain(url);
+    }
+  private:
+    mutable std::mutex mutex;
+    ReferrerMapping mapping;
+  };
+
+  template<class Mapping>
+  void RunContention(Benchmark::Reporter& reporter, const std::string& name)
+  {
+    for (int threadCount = 8; threadCount <= 32; threadCount *= 2)
+    {
+      Mapping mapping;
+      std::vector<std::thread> threads;
+      Benchmark::Clock::time_point start = Benchmark::Clock::now();
+      for (int i = 0; i < threadCount; i++)
+        threads.emplace_back([&mapping, i]
+        {
+          SimulateRequests(mapping, i);
+        });
+      for (auto& thread : threads)
+        thread.join();
+      double seconds = Benchmark::SecondsSince(start);
+      reporter.Report(name + "/threads:" + std::to_string(threadCount),
+        "throughput", threadCount * requestsPerThread / seconds, "requests/s");
+    }
+  }
+}
+
+ABP_BENCHMARK(ReferrerMappingContentionGlobalLock)
+{
+  RunContention<LockedReferrerMapping>(reporter, "ReferrerMappingContentionGlobalLock");
+}
+
+ABP_BENCHMARK(ReferrerMappingContentionSharded)
+{
+  RunContention<ConcurrentReferrerMapping>(reporter, "ReferrerMappingContentionSharded");
+}
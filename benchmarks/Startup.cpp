@@ -0,0 +1,250 @@
+/*
+ * This file is part of Adblock Plus <https://adblockplus.org/>,
+ * Copyright (C) 2006-present eyeo GmbH
+ *
+ * Adblock Plus is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 3 as
+ * published by the Free Software Foundation.
+ *
+ * Adblock Plus is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Adblock Plus.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <algorithm>
+#include <condition_variable>
+#include <cstdlib>
+#include <map>
+#include <mutex>
+#include <stdexcept>
+#ifdef _WIN32
+#include <direct.h>
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+#include <AdblockPlus/JsEngine.h>
+#include <AdblockPlus/Platform.h>
+#include "../src/DefaultFileSystem.h"
+#include "Benchmark.h"
+#include "FilterEngineFixture.h"
+
+using namespace AdblockPlus;
+using namespace AdblockPlus::Benchmark;
+
+namespace
+{
+  const int runsPerSize = 3;
+
+  const char prefsJson[] = "{\"currentVersion\": \"1.0\", "
+    "\"update_last_check\": 1514764800000, \"notificationdata\": {}}";
+
+  std::string CreateTemporaryDirectory()
+  {
+#ifdef _WIN32
+    const char* base = std::getenv("TEMP");
+    std::string path = std::string(base && *base ? base : ".") + "\\abp-startup-XXXXXX";
+    if (_mktemp_s(&path[0], path.size() + 1) != 0 || _mkdir(path.c_str()) != 0)
+      throw std::runtime_error("Failed to create a directory in " + path);
+#else
+    const char* base = std::getenv("TMPDIR");
+    std::string path = std::string(base && *base ? base : "/tmp") + "/abp-startup-XXXXXX";
+    if (!mkdtemp(&path[0]))
+      throw std::runtime_error("Failed to create a directory in " + path);
+#endif
+    return path;
+  }
+
+  void RemoveTemporaryDirectory(const std::string& path)
+  {
+    DefaultFileSystemSync files(path);
+    const char* const fileNames[] = {"patterns.ini", "prefs.json", "prefs.json.tmp"};
+    for (const char* fileName : fileNames)
+    {
+      if (files.Stat(fileName).exists)
+        files.Remove(fileName);
+    }
+#ifdef _WIN32
+    _rmdir(path.c_str());
+#else
+    rmdir(path.c_str());
+#endif
+  }
+
+  // Records when the first read of each file was requested and how long the
+  // callback processing its content took.
+  class TimingFileSystem : public IFileSystem
+  {
+  public:
+    struct ReadTimes
+    {
+      Clock::time_point requested;
+      Clock::time_point callbackStarted;
+      Clock::time_point callbackFinished;
+    };
+
+    explicit TimingFileSystem(FileSystemPtr fileSystem)
+      : fileSystem(std::move(fileSystem))
+    {
+    }
+
+    void Read(const std::string& fileName, const ReadCallback& callback) const override
+    {
+      Clock::time_point requested = Clock::now();
+      fileSystem->Read(fileName,
+        [this, fileName, requested, callback](IOBuffer&& content, const std::string& error)
+        {
+          ReadTimes times;
+          times.requested = requested;
+          times.callbackStarted = Clock::now();
+          callback(std::move(content), error);
+          times.callbackFinished = Clock::now();
+          std::lock_guard<std::mutex> lock(mutex);
+          reads.insert(std::make_pair(fileName, times));
+        });
+    }
+
+    void Write(const std::string& fileName, const IOBuffer& data,
+      const Callback& callback) override
+    {
+      fileSystem->Write(fileName, data, callback);
+    }
+
+    void Move(const std::string& fromFileName, const std::string& toFileName,
+      const Callback& callback) override
+    {
+      fileSystem->Move(fromFileName, toFileName, callback);
+    }
+
+    void Remove(const std::string& fileName, const Callback& callback) override
+    {
+      fileSystem->Remove(fileName, callback);
+    }
+
+    void Stat(const std::string& fileName, const StatCallback& callback) const override
+    {
+      fileSystem->Stat(fileName, callback);
+    }
+
+    ReadTimes GetReadTimes(const std::string& fileName) const
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      auto times = reads.find(fileName);
+      if (times == reads.end())
+        throw std::runtime_error(fileName + " was not read");
+      return times->second;
+    }
+
+  private:
+    FileSystemPtr fileSystem;
+    mutable std::mutex mutex;
+    mutable std::map<std::string, ReadTimes> reads;
+  };
+
+  double Milliseconds(Clock::duration duration)
+  {
+    return std::chrono::duration<double, std::milli>(duration).count();
+  }
+
+  struct StartupTimes
+  {
+    double total;
+    double jsEngine;
+    double scripts;
+    double prefsLoad;
+    double patternsRead;
+    double patternsParse;
+  };
+
+  StartupTimes MeasureStartup(const std::string& patternsIni)
+  {
+    std::string directory = CreateTemporaryDirectory();
+    DefaultFileSystemSync files(directory);
+    files.Write("patterns.ini", IFileSystem::IOBuffer(patternsIni.begin(), patternsIni.end()));
+    files.Write("prefs.json", IFileSystem::IOBuffer(prefsJson, prefsJson + sizeof(prefsJson) - 1));
+
+    StartupTimes times;
+    {
+      DefaultPlatformBuilder builder;
+      builder.minLogLevel = LogSystem::LOG_LEVEL_WARN;
+      builder.CreateDefaultFileSystem(directory);
+      TimingFileSystem* fileSystem = new TimingFileSystem(std::move(builder.fileSystem));
+      builder.fileSystem.reset(fileSystem);
+      builder.timer.reset(new NoopTimer());
+      builder.webRequest.reset(new NoopWebRequest());
+      std::unique_ptr<Platform> platform = builder.CreatePlatform();
+
+      Clock::time_point start = Clock::now();
+      platform->SetUpJsEngine();
+      Clock::time_point jsEngineReady = Clock::now();
+
+      FilterEngine::CreationParameters creationParams;
+      creationParams.preconfiguredPrefs.insert(std::make_pair(
+        "first_run_subscription_auto_select",
+        platform->GetJsEngine().NewValue(false)));
+      std::mutex mutex;
+      std::condition_variable created;
+      bool isCreated = false;
+      Clock::time_point createdAt;
+      platform->CreateFilterEngineAsync(creationParams,
+        [&mutex, &created, &isCreated, &createdAt](const FilterEngine&)
+        {
+          std::lock_guard<std::mutex> lock(mutex);
+          createdAt = Clock::now();
+          isCreated = true;
+          created.notify_one();
+        });
+      // The bundled scripts are evaluated synchronously, loading the data
+      // happens in file system callbacks.
+      Clock::time_point scriptsEvaluated = Clock::now();
+      {
+        std::unique_lock<std::mutex> lock(mutex);
+        created.wait(lock, [&isCreated]() { return isCreated; });
+      }
+
+      TimingFileSystem::ReadTimes prefs = fileSystem->GetReadTimes("prefs.json");
+      TimingFileSystem::ReadTimes patterns = fileSystem->GetReadTimes("patterns.ini");
+      times.total = Milliseconds(createdAt - start);
+      times.jsEngine = Milliseconds(jsEngineReady - start);
+      times.scripts = Milliseconds(scriptsEvaluated - jsEngineReady);
+      times.prefsLoad = Milliseconds(prefs.callbackFinished - prefs.callbackStarted);
+      times.patternsRead = Milliseconds(patterns.callbackStarted - patterns.requested);
+      times.patternsParse = Milliseconds(patterns.callbackFinished - patterns.callbackStarted);
+    }
+    RemoveTemporaryDirectory(directory);
+    return times;
+  }
+}
+
+ABP_BENCHMARK(Startup)
+{
+  // Initializing V8 is a one-time cost of the process, keep it out of the
+  // measurements.
+  MeasureStartup(CreatePatternsIni(GenerateFilterList(100)));
+
+  const size_t filterCounts[] = {10000, 100000, 300000};
+  for (size_t filterCount : filterCounts)
+  {
+    std::string patternsIni = CreatePatternsIni(GenerateFilterList(filterCount));
+    std::vector<StartupTimes> runs;
+    for (int i = 0; i < runsPerSize; i++)
+      runs.push_back(MeasureStartup(patternsIni));
+    std::sort(runs.begin(), runs.end(),
+      [](const StartupTimes& a, const StartupTimes& b) { return a.total < b.total; });
+
+    // Report the breakdown of the median run, so that the phases add up.
+    const StartupTimes& median = runs[runs.size() / 2];
+    std::string prefix = "filters" + std::to_string(filterCount) + "/";
+    reporter.Report("Startup", prefix + "total", median.total, "ms");
+    reporter.Report("Startup", prefix + "jsengine", median.jsEngine, "ms");
+    reporter.Report("Startup", prefix + "scripts", median.scripts, "ms");
+    reporter.Report("Startup", prefix + "prefs_load", median.prefsLoad, "ms");
+    reporter.Report("Startup", prefix + "patterns_read", median.patternsRead, "ms");
+    reporter.Report("Startup", prefix + "patterns_parse", median.patternsParse, "ms");
+    reporter.Report("Startup", prefix + "patterns_size", patternsIni.size() / 1024.0, "KiB");
+  }
+}
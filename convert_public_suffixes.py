@@ -0,0 +1,50 @@
+#!/usr/bin/env python
+# coding: utf-8
+
+import io
+import json
+import re
+import argparse
+
+sourceTemplate = """#include "NativeFilter.h"
+
+const AdblockPlus::NativeFilter::PublicSuffix AdblockPlus::NativeFilter::publicSuffixes[] = {
+%s
+  {nullptr, 0}
+};"""
+
+
+def toCString(string):
+    result = []
+    for byte in bytearray(string.encode('utf-8')):
+        if byte < 0x20 or byte >= 0x7F or byte in (ord('"'), ord('\\'), ord('?')):
+            result.append('\\%03o' % byte)
+        else:
+            result.append(chr(byte))
+    return '"%s"' % ''.join(result)
+
+
+def convert(inFile, outFile):
+    with io.open(inFile, encoding='utf-8') as inHandle:
+        content = inHandle.read()
+    match = re.search(r'=\s*(\{.*\})\s*;', content, re.DOTALL)
+    if not match:
+        raise Exception('No public suffix list found in %s' % inFile)
+    suffixes = json.loads(match.group(1))
+
+    entries = []
+    for suffix in sorted(suffixes):
+        entries.append('  {%s, %i},' % (toCString(suffix), suffixes[suffix]))
+
+    with open(outFile, 'w') as outHandle:
+        outHandle.write(sourceTemplate % '\n'.join(entries))
+        outHandle.write('\n')
+
+if __name__ == '__main__':
+    parser = argparse.ArgumentParser(description='Convert the public suffix list for the native matcher')
+    parser.add_argument('input_file',
+                        help='JavaScript file defining publicSuffixes')
+    parser.add_argument('output_file',
+                        help='output from the conversion')
+    args = parser.parse_args()
+    convert(args.input_file, args.output_file)
@@ -31,11 +31,18 @@
 #define ADBLOCK_PLUS_ADBLOCK_PLUS_H
 
 #include <AdblockPlus/AppInfo.h>
+#include <AdblockPlus/AsyncLogSystem.h>
+#include <AdblockPlus/ConcurrentReferrerMapping.h>
 #include <AdblockPlus/FilterEngine.h>
+#include <AdblockPlus/FilterIndex.h>
+#include <AdblockPlus/FilterStore.h>
+#include <AdblockPlus/FrameTree.h>
 #include <AdblockPlus/LogSystem.h>
+#include <AdblockPlus/Metrics.h>
 #include <AdblockPlus/JsEngine.h>
 #include <AdblockPlus/JsValue.h>
 #include <AdblockPlus/ReferrerMapping.h>
+#include <AdblockPlus/Tracer.h>
 #include "AdblockPlus/Notification.h"
 
 #endif
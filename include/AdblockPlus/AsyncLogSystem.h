@@ -0,0 +1,113 @@
+/*
+ * This file is part of Adblock Plus <https://adblockplus.org/>,
+ * Copyright (C) 2006-present eyeo GmbH
+ *
+ * Adblock Plus is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 3 as
+ * published by the Free Software Foundation.
+ *
+ * Adblock Plus is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Adblock Plus.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef ADBLOCK_PLUS_ASYNC_LOG_SYSTEM_H
+#define ADBLOCK_PLUS_ASYNC_LOG_SYSTEM_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include "LogSystem.h"
+
+namespace AdblockPlus
+{
+  /**
+   * `LogSystem` implementation which passes messages on to another
+   * `LogSystem` on a background thread.
+   * Messages are stored in a bounded lock-free ring buffer, so that logging
+   * never waits for a slow sink. When the buffer is full new messages are
+   * dropped and counted, the number of dropped messages is reported to the
+   * sink as a warning once there is room again.
+   */
+  class AsyncLogSystem : public LogSystem
+  {
+  public:
+    /**
+     * Constructor.
+     * @param sink `LogSystem` the messages are passed to, `DefaultLogSystem`
+     *        is used if this is `nullptr`.
+     * @param capacity Number of messages the buffer can hold, rounded up to
+     *        a power of two.
+     */
+    explicit AsyncLogSystem(LogSystemPtr sink = LogSystemPtr(), size_t capacity = 1024);
+
+    /**
+     * Destructor, passes the remaining messages to the sink before returning.
+     */
+    ~AsyncLogSystem();
+
+    void operator()(LogLevel logLevel, const std::string& message,
+          const std::string& source) override;
+
+    /**
+     * Blocks until all messages logged before the call have been passed to
+     * the sink. Must not be called from the sink.
+     */
+    void Flush();
+
+    /**
+     * Retrieves the number of messages dropped because the buffer was full.
+     * @return Total number of dropped messages.
+     */
+    uint64_t GetDroppedCount() const;
+
+  private:
+    struct Record
+    {
+      LogLevel logLevel;
+      std::string message;
+      std::string source;
+    };
+
+    struct Cell
+    {
+      std::atomic<size_t> sequence;
+      Record record;
+    };
+
+    AsyncLogSystem(const AsyncLogSystem&);
+    AsyncLogSystem& operator=(const AsyncLogSystem&);
+
+    bool HasRecord() const;
+    bool TryPop(Record& record);
+    void ReportDropped();
+    void Run();
+
+    LogSystemPtr sink;
+    size_t mask;
+    std::unique_ptr<Cell[]> cells;
+    std::atomic<size_t> enqueuePos;
+    size_t dequeuePos;
+    std::atomic<uint64_t> droppedCount;
+    uint64_t reportedDroppedCount;
+    // Set while the background thread waits for records, producers only
+    // notify it then.
+    std::atomic<bool> sleeping;
+
+    std::mutex mutex;
+    std::condition_variable hasRecords;
+    std::condition_variable processed;
+    size_t processedPos;
+    bool stopped;
+    std::thread thread;
+  };
+}
+
+#endif
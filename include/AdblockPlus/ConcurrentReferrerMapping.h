@@ -0,0 +1,82 @@
+/*
+ * This file is part of Adblock Plus <https://adblockplus.org/>,
+ * Copyright (C) 2006-present eyeo GmbH
+ *
+ * Adblock Plus is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 3 as
+ * published by the Free Software Foundation.
+ *
+ * Adblock Plus is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Adblock Plus.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef ADBLOCK_PLUS_CONCURRENT_REFERRER_MAPPING_H
+#define ADBLOCK_PLUS_CONCURRENT_REFERRER_MAPPING_H
+
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+#include <AdblockPlus/ReferrerMapping.h>
+
+namespace AdblockPlus
+{
+  /**
+   * Thread-safe variant of `ReferrerMapping`.
+   * The mappings are distributed over several shards by URL hash, each shard
+   * has its own lock, so that concurrent calls of `Add()` and
+   * `BuildReferrerChain()` rarely wait for each other.
+   * Since each shard drops its own least recently added mappings, the limits
+   * are only approximately applied in the order of addition.
+   */
+  class ConcurrentReferrerMapping
+  {
+  public:
+    /**
+     * Constructor.
+     * @param maxCachedUrls Number of URL mappings to store, see
+     *        `ReferrerMapping::ReferrerMapping()`.
+     * @param maxCachedBytes Approximate amount of memory the stored URLs may
+     *        occupy.
+     * @param shardCount Number of independently locked shards.
+     */
+    ConcurrentReferrerMapping(const int maxCachedUrls = 5000,
+      const size_t maxCachedBytes = std::numeric_limits<size_t>::max(),
+      const int shardCount = 16);
+
+    /**
+     * Records the refferer for a URL.
+     * @param url Request URL.
+     * @param referrer Request referrer.
+     */
+    void Add(const std::string& url, const std::string& referrer);
+
+    /**
+     * Builds a chain of referrers for the supplied URL.
+     * This should reconstruct a document's parent frame URLs.
+     * @param url URL to build the chain for.
+     * @return List of URLs, starting with `url`.
+     */
+    std::vector<std::string> BuildReferrerChain(const std::string& url) const;
+
+  private:
+    struct Shard
+    {
+      Shard(const int maxCachedUrls, const size_t maxCachedBytes);
+      std::mutex mutex;
+      ReferrerMapping mapping;
+    };
+
+    Shard& GetShard(const std::string& url) const;
+
+    std::vector<std::unique_ptr<Shard>> shards;
+  };
+}
+
+#endif
@@ -18,10 +18,14 @@
 #ifndef ADBLOCK_PLUS_FILTER_ENGINE_H
 #define ADBLOCK_PLUS_FILTER_ENGINE_H
 
+#include <atomic>
+#include <chrono>
 #include <functional>
 #include <map>
 #include <string>
 #include <vector>
+#include <AdblockPlus/FilterTypes.h>
+#include <AdblockPlus/FrameTree.h>
 #include <AdblockPlus/JsEngine.h>
 #include <AdblockPlus/JsValue.h>
 #include <AdblockPlus/Notification.h>
@@ -29,6 +33,7 @@
 namespace AdblockPlus
 {
   class FilterEngine;
+  class FilterHitStatistics;
   typedef std::shared_ptr<FilterEngine> FilterEnginePtr;
 
   /**
@@ -37,7 +42,7 @@ namespace AdblockPlus
    * [filter properties](https://adblockplus.org/jsdoc/adblockpluscore/Filter.html),
    * use `GetProperty()` to retrieve them by name.
    */
-  class Filter : public JsValue
+  class Filter : public JsValue, public FilterTypes
   {
     friend class FilterEngine;
   public:
@@ -46,14 +51,6 @@ namespace AdblockPlus
     Filter& operator=(const Filter& src);
     Filter& operator=(Filter&& src);
 
-    /**
-     * Filter types, see https://adblockplus.org/en/filters.
-     */
-    enum Type {TYPE_BLOCKING, TYPE_EXCEPTION,
-               TYPE_ELEMHIDE, TYPE_ELEMHIDE_EXCEPTION,
-               TYPE_ELEMHIDE_EMULATION,
-               TYPE_COMMENT, TYPE_INVALID};
-
     /**
      * Retrieves the type of this filter.
      * @return Type of this filter.
@@ -189,42 +186,9 @@ namespace AdblockPlus
    * - Subscription management and synchronization.
    * - Update checks for the application.
    */
-  class FilterEngine
+  class FilterEngine : public ContentTypes
   {
   public:
-    // Make sure to keep ContentType in sync with FilterEngine::contentTypes
-    // and with RegExpFilter.typeMap from filterClasses.js.
-    /**
-     * Possible resource content types.
-     */
-    enum ContentType
-    {
-      CONTENT_TYPE_OTHER = 1,
-      CONTENT_TYPE_SCRIPT = 2,
-      CONTENT_TYPE_IMAGE = 4,
-      CONTENT_TYPE_STYLESHEET = 8,
-      CONTENT_TYPE_OBJECT = 16,
-      CONTENT_TYPE_SUBDOCUMENT = 32,
-      CONTENT_TYPE_DOCUMENT = 64,
-      CONTENT_TYPE_WEBSOCKET = 128,
-      CONTENT_TYPE_WEBRTC = 256,
-      CONTENT_TYPE_PING = 1024,
-      CONTENT_TYPE_XMLHTTPREQUEST = 2048,
-      CONTENT_TYPE_OBJECT_SUBREQUEST = 4096,
-      CONTENT_TYPE_MEDIA = 16384,
-      CONTENT_TYPE_FONT = 32768,
-      CONTENT_TYPE_GENERICBLOCK = 0x20000000,
-      CONTENT_TYPE_ELEMHIDE = 0x40000000,
-      CONTENT_TYPE_GENERICHIDE = 0x80000000
-    };
-
-    /**
-     * Bitmask of `ContentType` values.
-     * The underlying type is signed 32 bit integer because it is actually used
-     * in JavaScript where it is converted into 32 bit signed integer.
-     */
-    typedef int32_t ContentTypeMask;
-
     /**
      * Callback type invoked when an update becomes available.
      * The parameter is the download URL of the update.
@@ -246,6 +210,80 @@ namespace AdblockPlus
      */
     typedef std::function<void(const std::string&, JsValue&&)> FilterChangeCallback;
 
+    /**
+     * Summary of a change of the filters, see `FilterChangesCallback`.
+     */
+    struct FilterChange
+    {
+      /**
+       * Action event code, see `FilterChangeCallback`.
+       */
+      std::string action;
+
+      /**
+       * Text of the affected filter or URL of the affected subscription,
+       * empty if the change doesn't concern a single filter or subscription.
+       */
+      std::string item;
+    };
+
+    /**
+     * Text and type of a filter, see `FilterTextPage`.
+     */
+    typedef AdblockPlus::FilterText FilterText;
+
+    /**
+     * Page of a list of filters, see `GetListedFilterTexts()` and
+     * `GetSubscriptionFilterTexts()`.
+     */
+    struct FilterTextPage
+    {
+      FilterTextPage() : totalCount(0)
+      {
+      }
+
+      /**
+       * Filters on the page, in list order.
+       */
+      std::vector<FilterText> filters;
+
+      /**
+       * Number of filters in the whole list.
+       */
+      size_t totalCount;
+    };
+
+    /**
+     * Hit statistics of a filter, see `GetFilterHitStats()`.
+     */
+    struct FilterHitStats
+    {
+      FilterHitStats() : hitCount(0), lastHit(0)
+      {
+      }
+
+      /**
+       * Text representation of the filter.
+       */
+      std::string text;
+
+      /**
+       * Number of times the filter matched.
+       */
+      uint64_t hitCount;
+
+      /**
+       * Time of the last match, in milliseconds since the epoch.
+       */
+      int64_t lastHit;
+    };
+
+    /**
+     * Callback type invoked with the changes of the filters collected over
+     * one tick of the JavaScript engine, in the order they happened.
+     */
+    typedef std::function<void(std::vector<FilterChange>&&)> FilterChangesCallback;
+
     /**
      * Container of name-value pairs representing a set of preferences.
      */
@@ -269,6 +307,11 @@ namespace AdblockPlus
      */
     struct CreationParameters
     {
+      CreationParameters()
+        : prefsSaveDelay(0), filterHitStatsSaveDelay(std::chrono::minutes(1))
+      {
+      }
+
       /**
        * `AdblockPlus::FilterEngine::Prefs` name - value list of preconfigured
        * prefs.
@@ -280,6 +323,19 @@ namespace AdblockPlus
        * on the current connection.
        */
       IsConnectionAllowedAsyncCallback isSubscriptionDownloadAllowedCallback;
+      /**
+       * Time to wait after a preference change before prefs.json is written,
+       * all changes made within this time are saved together. Zero means
+       * that the preferences are saved immediately.
+       * See also `FilterEngine::FlushPrefs()`.
+       */
+      std::chrono::milliseconds prefsSaveDelay;
+      /**
+       * Time to wait after a filter hit before the hit statistics are
+       * written, all hits within this time are saved together.
+       * See also `FilterEngine::SaveFilterHitStats()`.
+       */
+      std::chrono::milliseconds filterHitStatsSaveDelay;
     };
 
     /**
@@ -287,6 +343,11 @@ namespace AdblockPlus
      */
     typedef std::function<void(const FilterEnginePtr&)> OnCreatedCallback;
 
+    /**
+     * Callback type invoked when all pending preference changes are saved.
+     */
+    typedef std::function<void()> PrefsFlushedCallback;
+
     /**
      * Asynchronously constructs FilterEngine.
      * @param jsEngine `JsEngine` instance used to run JavaScript code
@@ -299,12 +360,26 @@ namespace AdblockPlus
       const OnCreatedCallback& onCreated,
       const CreationParameters& parameters = CreationParameters());
 
+    /**
+     * Saves filter hits which are still waiting for
+     * `CreationParameters::filterHitStatsSaveDelay` to pass, provided the
+     * `IFileSystem` is still available. `Platform` implementations flush
+     * the hits before dropping it, see `Platform::FlushModules()`.
+     */
+    ~FilterEngine();
+
     /**
      * Retrieves the `JsEngine` instance associated with this `FilterEngine`
      * instance.
      */
     JsEngine& GetJsEngine() const { return *jsEngine; }
 
+    /**
+     * Retrieves the `FrameTree` instance used by
+     * Matches(const std::string&, ContentTypeMask, FrameTree::FrameId) const.
+     */
+    FrameTree& GetFrameTree() { return frameTree; }
+
     /**
      * Checks if this is the first run of the application.
      * @return `true` if the application is running for the first time.
@@ -332,6 +407,66 @@ namespace AdblockPlus
      */
     std::vector<Filter> GetListedFilters() const;
 
+    /**
+     * Checks whether a filter is in the list of custom filters, like
+     * `Filter::IsListed()`, without creating a `Filter` object. The answer
+     * comes from a native index of the custom filters in enabled groups.
+     * Added and removed filters update it, it is only rebuilt as a whole
+     * after changes of entire subscriptions.
+     * @param text Text representation of the filter. Texts containing
+     *        whitespace are normalized by JavaScript first, like in
+     *        `GetFilter()`.
+     * @param type If not `nullptr` and the filter is listed, receives the
+     *        type of the filter.
+     * @return `true` if the filter is listed.
+     */
+    bool IsListedFilter(const std::string& text, Filter::Type* type = nullptr) const;
+
+    /**
+     * Retrieves a page of the list of custom filters, see
+     * `GetListedFilters()`, as plain text. Unlike `GetListedFilters()`, this
+     * doesn't create a JavaScript object handle per filter, so it is suited
+     * for paging through long lists.
+     * @param offset Index of the first filter to retrieve.
+     * @param count Maximum number of filters to retrieve.
+     * @return The filters, empty if `offset` is beyond the end of the list.
+     */
+    FilterTextPage GetListedFilterTexts(size_t offset, size_t count) const;
+
+    /**
+     * Retrieves a page of the filters of a subscription as plain text,
+     * see `GetListedFilterTexts()`.
+     * @param url URL of the subscription.
+     * @param offset Index of the first filter to retrieve.
+     * @param count Maximum number of filters to retrieve.
+     * @return The filters, empty if `offset` is beyond the end of the list
+     *         or if the subscription has no filters.
+     */
+    FilterTextPage GetSubscriptionFilterTexts(const std::string& url,
+      size_t offset, size_t count) const;
+
+    /**
+     * Adds filters to the list of custom filters, like `Filter::AddToList()`
+     * for each of them. If the filters make up a large part of the affected
+     * subscription, e.g. when importing many filters, its filters are
+     * replaced at once, with a single change notification and save.
+     * Otherwise the filters are added one by one, which is cheaper for a few
+     * filters added to a long list.
+     * Empty filters and filters which are already listed are skipped.
+     * @param texts Text representations of the filters,
+     *        see https://adblockplus.org/en/filters.
+     */
+    void AddFilters(const std::vector<std::string>& texts);
+
+    /**
+     * Removes filters from the list of custom filters, like
+     * `Filter::RemoveFromList()` for each of them. Like in `AddFilters()`,
+     * subscriptions losing a large part of their filters are updated at once.
+     * Filters which aren't listed are skipped.
+     * @param texts Text representations of the filters.
+     */
+    void RemoveFilters(const std::vector<std::string>& texts);
+
     /**
      * Retrieves all subscriptions.
      * @return List of subscriptions.
@@ -419,6 +554,22 @@ namespace AdblockPlus
         ContentTypeMask contentTypeMask,
         const std::vector<std::string>& documentUrls) const;
 
+    /**
+     * Checks if any active filter matches the supplied URL.
+     * The frame structure is taken from `GetFrameTree()` and the document
+     * whitelisting state of each frame is cached until the filters change,
+     * so this is cheaper than passing the document URLs explicitly.
+     * @param url URL to match.
+     * @param contentTypeMask Content type mask of the requested resource.
+     * @param frameId ID of the frame requesting the resource. If the frame
+     *        is not registered in the `FrameTree`, the URL is matched as if
+     *        there was no document.
+     * @return Matching filter, or a `null` if there was no match.
+     */
+    FilterPtr Matches(const std::string& url,
+        ContentTypeMask contentTypeMask,
+        FrameTree::FrameId frameId) const;
+
     /**
      * Checks whether the document at the supplied URL is whitelisted.
      * @param url URL of the document.
@@ -462,6 +613,23 @@ namespace AdblockPlus
      */
     JsValue GetPref(const std::string& pref) const;
 
+    //@{
+    /**
+     * Retrieves a preference value without entering JavaScript.
+     * The values are read from a native copy of the preferences which is
+     * kept in sync with the JavaScript ones, so these methods do not lock
+     * the JavaScript engine and can be called from any thread.
+     * Only boolean, number and string preferences are available this way.
+     * @param pref Preference name.
+     * @return Preference value.
+     * @throw `std::invalid_argument`, if the preference doesn't exist or has
+     *        a different type.
+     */
+    bool GetPrefBool(const std::string& pref) const;
+    std::string GetPrefString(const std::string& pref) const;
+    int64_t GetPrefInt(const std::string& pref) const;
+    //@}
+
     /**
      * Sets a preference value.
      * @param pref Preference name.
@@ -469,6 +637,79 @@ namespace AdblockPlus
      */
     void SetPref(const std::string& pref, const JsValue& value);
 
+    /**
+     * Sets several preference values at once.
+     * Either all values are applied or none of them, the preferences are
+     * saved only once and the listeners are notified once per preference.
+     * Unknown preferences are ignored.
+     * @param prefs Name-value pairs of the preferences to set.
+     * @throw `std::runtime_error`, if a value has a type different from the
+     *        type of the corresponding preference.
+     */
+    void SetPrefs(const Prefs& prefs);
+
+    /**
+     * Saves pending preference changes immediately instead of waiting for
+     * `CreationParameters::prefsSaveDelay` to pass. Applications using a
+     * save delay should call it before shutting down.
+     * @param callback Optional callback to invoke when the preferences are
+     *        saved.
+     */
+    void FlushPrefs(const PrefsFlushedCallback& callback = PrefsFlushedCallback());
+
+    /**
+     * Retrieves call counters and latency histograms of the `FilterEngine`
+     * and `JsEngine` entry points, see `Metrics`.
+     * @return One histogram per `Metrics::Operation`.
+     */
+    std::vector<LatencyHistogram> GetMetrics() const;
+
+    /**
+     * Writes the metrics returned by `GetMetrics()` to a file in the
+     * Prometheus text exposition format.
+     * @param fileName File to write the metrics to, using `IFileSystem`.
+     * @param callback Called when the file has been written.
+     */
+    void WriteMetrics(const std::string& fileName,
+      const IFileSystem::Callback& callback = IFileSystem::Callback()) const;
+
+    /**
+     * Retrieves the hit statistics of the filters returned by `Matches()`,
+     * `IsDocumentWhitelisted()` and `IsElemhideWhitelisted()`.
+     * The hits are counted natively and include the statistics saved by
+     * previous sessions, they are independent of the `savestats` pref.
+     * @param topN Maximal number of filters to return, zero means all.
+     * @return Filters ordered by descending hit count.
+     */
+    std::vector<FilterHitStats> GetFilterHitStats(size_t topN = 0) const;
+
+    /**
+     * Writes the filter hit statistics immediately instead of waiting for
+     * `CreationParameters::filterHitStatsSaveDelay` to pass. Unsaved hits
+     * are also written when the `Platform` or the `FilterEngine` is
+     * destroyed. The file is
+     * written to a temporary file first, which then replaces it, so that a
+     * crash doesn't leave truncated statistics behind.
+     * @param callback Called when the statistics have been written, the
+     *        parameter is an error message, empty on success.
+     */
+    void SaveFilterHitStats(const IFileSystem::Callback& callback = IFileSystem::Callback());
+
+    /**
+     * Writes the active filters to a file which can be opened with
+     * `FilterIndex::Open()`, so that they can be matched without a
+     * `JsEngine`, e.g. by other processes. Filters of disabled
+     * subscriptions and disabled filters are left out.
+     * The index is written to `fileName + ".tmp"` first, which is then
+     * moved over `fileName`. An existing file is replaced rather than
+     * overwritten, so indexes other processes have opened stay valid.
+     * @param fileName File to write the index to, using `IFileSystem`.
+     * @param callback Called when the file has been written, the parameter
+     *        is an error message, empty on success.
+     */
+    void WriteFilterIndex(const std::string& fileName,
+      const IFileSystem::Callback& callback = IFileSystem::Callback()) const;
+
     /**
      * Extracts the host from a URL.
      * @param url URL to extract the host from.
@@ -513,6 +754,27 @@ namespace AdblockPlus
      */
     void RemoveFilterChangeCallback();
 
+    /**
+     * Sets a callback receiving the changes of the filters in batches,
+     * which is much cheaper than `SetFilterChangeCallback()` when many
+     * filters change at once, e.g. on subscription updates.
+     * While this callback is set, the callback set with
+     * `SetFilterChangeCallback()` isn't invoked.
+     * @param callback Callback to invoke.
+     * @param scheduler Scheduler the callback is executed on. If empty, the
+     *        callback is invoked directly on the JavaScript thread and must
+     *        not call back into the `FilterEngine`.
+     */
+    void SetFilterChangesCallback(const FilterChangesCallback& callback,
+      const Scheduler& scheduler = Scheduler());
+
+    /**
+     * Removes the callback set with `SetFilterChangesCallback()`, changes
+     * are reported to the callback set with `SetFilterChangeCallback()`
+     * again.
+     */
+    void RemoveFilterChangesCallback();
+
     /**
      * Stores the value indicating what connection types are allowed, it is
      * passed to CreateParameters::isConnectionAllowed callback.
@@ -556,17 +818,49 @@ namespace AdblockPlus
     static std::string ContentTypeToString(ContentType contentType);
 
   private:
+    struct NativePrefs;
+    typedef std::shared_ptr<const NativePrefs> NativePrefsPtr;
+    struct ListedFilterIndex;
+    typedef std::shared_ptr<const ListedFilterIndex> ListedFilterIndexPtr;
+
     JsEnginePtr jsEngine;
     bool firstRun;
     int updateCheckId;
+    int prefsFlushId;
+    // Only replaced as a whole, use std::atomic_load and std::atomic_store.
+    NativePrefsPtr nativePrefs;
+    FrameTree frameTree;
+    // Incremented whenever a filter change may affect matching results.
+    std::atomic<uint32_t> filtersGeneration;
+    // Only replaced as a whole, use std::atomic_load and std::atomic_store.
+    mutable ListedFilterIndexPtr listedFilterIndex;
+    std::shared_ptr<FilterHitStatistics> filterHitStatistics;
+    std::chrono::milliseconds filterHitStatsSaveDelay;
     static const std::map<ContentType, std::string> contentTypes;
 
     explicit FilterEngine(const JsEnginePtr& jsEngine);
 
+    void InitNativePrefs(const JsValue& prefs);
+    void UpdateNativePref(const std::string& pref, const JsValue& value);
+    NativePrefsPtr GetNativePrefs() const;
+    ListedFilterIndexPtr GetListedFilterIndex() const;
+    void UpdateListedFilterIndex(const std::string& text, const std::string& type,
+      bool listed);
+
+    static void SaveFilterHitStats(const JsEnginePtr& jsEngine,
+      FilterHitStatistics& statistics, const IFileSystem::Callback& callback);
+    void RecordFilterHit(const FilterPtr& filter) const;
+    FilterPtr FindMatch(const std::string& url,
+                        ContentTypeMask contentTypeMask,
+                        const std::vector<std::string>& documentUrls) const;
     FilterPtr CheckFilterMatch(const std::string& url,
                                ContentTypeMask contentTypeMask,
                                const std::string& documentUrl) const;
+    FilterPtr GetDocumentWhitelistingFilter(
+      const std::vector<std::string>& documentUrls) const;
     void FilterChanged(const FilterChangeCallback& callback, JsValueList&& params) const;
+    void FilterChangesReported(const FilterChangesCallback& callback,
+      const Scheduler& scheduler, JsValueList&& params) const;
     FilterPtr GetWhitelistingFilter(const std::string& url,
       ContentTypeMask contentTypeMask, const std::string& documentUrl) const;
     FilterPtr GetWhitelistingFilter(const std::string& url,
@@ -0,0 +1,233 @@
+/*
+ * This file is part of Adblock Plus <https://adblockplus.org/>,
+ * Copyright (C) 2006-present eyeo GmbH
+ *
+ * Adblock Plus is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 3 as
+ * published by the Free Software Foundation.
+ *
+ * Adblock Plus is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Adblock Plus.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef ADBLOCK_PLUS_FILTER_ENGINE_CLIENT_H
+#define ADBLOCK_PLUS_FILTER_ENGINE_CLIENT_H
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include "FilterTypes.h"
+
+namespace AdblockPlus
+{
+  class FilterEngineClient;
+
+  /**
+   * A smart pointer to a `FilterEngineClient` instance.
+   */
+  typedef std::unique_ptr<FilterEngineClient> FilterEngineClientPtr;
+
+  /**
+   * Queries a `FilterEngineService` in another process, e.g. the `abpd`
+   * daemon, so that this process doesn't have to embed V8.
+   * All methods are thread-safe. Requests are pipelined: any number of them
+   * can be in flight on the connection, each caller only waits for its own
+   * response. The `...Async()` methods send a batch of queries in a single
+   * request and pass the results to a callback, which is called on the
+   * client's receiving thread and must not call the synchronous methods.
+   * Only available on Linux and OS X.
+   */
+  class FilterEngineClient
+  {
+  public:
+    /**
+     * Query for `MatchesAsync()`, `IsDocumentWhitelistedAsync()` and
+     * `IsElemhideWhitelistedAsync()`.
+     */
+    struct Query
+    {
+      Query() : contentTypeMask(0)
+      {
+      }
+
+      /**
+       * URL to match.
+       */
+      std::string url;
+
+      /**
+       * Content type mask of the requested resource, ignored by the
+       * whitelisting queries.
+       */
+      ContentTypes::ContentTypeMask contentTypeMask;
+
+      /**
+       * Chain of documents requesting the resource, see
+       * `FilterEngine::Matches()`.
+       */
+      std::vector<std::string> documentUrls;
+    };
+
+    /**
+     * Result of a `Matches()` query.
+     */
+    struct MatchResult
+    {
+      MatchResult() : matched(false)
+      {
+        filter.type = FilterTypes::TYPE_INVALID;
+      }
+
+      /**
+       * Whether a filter matched. This can be an exception filter.
+       */
+      bool matched;
+
+      /**
+       * The matching filter, if any.
+       */
+      FilterText filter;
+    };
+
+    /**
+     * Receives the results of `MatchesAsync()` in query order, or an error
+     * message if the request failed.
+     */
+    typedef std::function<void(std::vector<MatchResult>&& results,
+      const std::string& error)> MatchesCallback;
+
+    /**
+     * Receives the results of `IsDocumentWhitelistedAsync()` and
+     * `IsElemhideWhitelistedAsync()` in query order, or an error message if
+     * the request failed.
+     */
+    typedef std::function<void(std::vector<bool>&& results,
+      const std::string& error)> WhitelistCallback;
+
+    /**
+     * Receives the selectors per domain of `GetElementHidingSelectorsAsync()`
+     * in query order, or an error message if the request failed.
+     */
+    typedef std::function<void(std::vector<std::vector<std::string>>&& results,
+      const std::string& error)> SelectorsCallback;
+
+    /**
+     * Connects to a `FilterEngineService`.
+     * @param socketPath Path of the service's socket.
+     * @return New `FilterEngineClient` instance.
+     * @throw `std::runtime_error`, if the connection fails.
+     */
+    static FilterEngineClientPtr Connect(const std::string& socketPath);
+
+    /**
+     * Destructor, closes the connection. Requests still in flight fail.
+     * Must not be called from a callback.
+     */
+    ~FilterEngineClient();
+
+    /**
+     * Checks if any active filter matches the supplied URL, like
+     * `FilterEngine::Matches()`.
+     * @param url URL to match.
+     * @param contentTypeMask Content type mask of the requested resource.
+     * @param documentUrls Chain of documents requesting the resource.
+     * @param filter Optional, receives the matching filter.
+     * @return `true` if a filter matched. This can be an exception filter.
+     * @throw `std::runtime_error`, if the request failed.
+     */
+    bool Matches(const std::string& url,
+      ContentTypes::ContentTypeMask contentTypeMask,
+      const std::vector<std::string>& documentUrls,
+      FilterText* filter = nullptr);
+
+    /**
+     * Like `FilterEngine::IsDocumentWhitelisted()`.
+     * @throw `std::runtime_error`, if the request failed.
+     */
+    bool IsDocumentWhitelisted(const std::string& url,
+      const std::vector<std::string>& documentUrls);
+
+    /**
+     * Like `FilterEngine::IsElemhideWhitelisted()`.
+     * @throw `std::runtime_error`, if the request failed.
+     */
+    bool IsElemhideWhitelisted(const std::string& url,
+      const std::vector<std::string>& documentUrls);
+
+    /**
+     * Like `FilterEngine::GetElementHidingSelectors()`.
+     * @throw `std::runtime_error`, if the request failed.
+     */
+    std::vector<std::string> GetElementHidingSelectors(const std::string& domain);
+
+    /**
+     * Matches a batch of queries with a single request.
+     * @param queries Queries to match.
+     * @param callback Receives the results.
+     */
+    void MatchesAsync(const std::vector<Query>& queries,
+      const MatchesCallback& callback);
+
+    /**
+     * Checks a batch of documents for whitelisting with a single request.
+     * @param queries Documents to check.
+     * @param callback Receives the results.
+     */
+    void IsDocumentWhitelistedAsync(const std::vector<Query>& queries,
+      const WhitelistCallback& callback);
+
+    /**
+     * Checks a batch of documents for element hiding whitelisting with a
+     * single request.
+     * @param queries Documents to check.
+     * @param callback Receives the results.
+     */
+    void IsElemhideWhitelistedAsync(const std::vector<Query>& queries,
+      const WhitelistCallback& callback);
+
+    /**
+     * Retrieves the element hiding selectors of a batch of domains with a
+     * single request.
+     * @param domains Domains to retrieve selectors for.
+     * @param callback Receives the results.
+     */
+    void GetElementHidingSelectorsAsync(const std::vector<std::string>& domains,
+      const SelectorsCallback& callback);
+
+  private:
+    // Receives the payload of a response or an error message.
+    typedef std::function<void(const char* data, size_t size,
+      const std::string& error)> ResponseHandler;
+
+    explicit FilterEngineClient(int socket);
+    FilterEngineClient(const FilterEngineClient&);
+    FilterEngineClient& operator=(const FilterEngineClient&);
+
+    void Send(uint8_t opcode, const std::string& payload,
+      const ResponseHandler& handler);
+    void IsWhitelistedAsync(uint8_t opcode, const std::vector<Query>& queries,
+      const WhitelistCallback& callback);
+    void Receive();
+    void Close(const std::string& error);
+
+    int socket;
+    std::mutex sendMutex;
+    std::mutex mutex;
+    uint32_t nextRequestId;
+    std::unordered_map<uint32_t, ResponseHandler> pendingRequests;
+    std::string closedError;
+    std::thread receiveThread;
+  };
+}
+
+#endif
@@ -0,0 +1,75 @@
+/*
+ * This file is part of Adblock Plus <https://adblockplus.org/>,
+ * Copyright (C) 2006-present eyeo GmbH
+ *
+ * Adblock Plus is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 3 as
+ * published by the Free Software Foundation.
+ *
+ * Adblock Plus is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Adblock Plus.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef ADBLOCK_PLUS_FILTER_ENGINE_SERVICE_H
+#define ADBLOCK_PLUS_FILTER_ENGINE_SERVICE_H
+
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <thread>
+#include "FilterEngine.h"
+
+namespace AdblockPlus
+{
+  /**
+   * Serves queries of `FilterEngineClient` instances in other processes
+   * over a Unix domain socket, so that only one process has to embed V8.
+   * Each connection is served by its own thread. Requests contain batches
+   * of queries and can be pipelined, all requests received at once are
+   * answered with a single write.
+   * Only available on Linux and OS X.
+   */
+  class FilterEngineService
+  {
+  public:
+    /**
+     * Starts listening for connections.
+     * @param filterEngine `FilterEngine` answering the queries, has to
+     *        outlive the service.
+     * @param socketPath Path of the socket. A file left behind at this path
+     *        by a previous instance is replaced.
+     * @throw `std::runtime_error`, if the socket can't be created.
+     */
+    FilterEngineService(FilterEngine& filterEngine, const std::string& socketPath);
+
+    /**
+     * Destructor, closes all connections and removes the socket.
+     */
+    ~FilterEngineService();
+
+  private:
+    FilterEngineService(const FilterEngineService&);
+    FilterEngineService& operator=(const FilterEngineService&);
+
+    void Accept();
+    void Serve(int socket);
+
+    FilterEngine& filterEngine;
+    std::string socketPath;
+    int listenSocket;
+    // Becomes readable on shutdown, wakes up all threads.
+    int stopPipe[2];
+    std::thread acceptThread;
+
+    std::mutex mutex;
+    std::condition_variable connectionsClosed;
+    size_t connectionCount;
+  };
+}
+
+#endif
@@ -0,0 +1,245 @@
+/*
+ * This file is part of Adblock Plus <https://adblockplus.org/>,
+ * Copyright (C) 2006-present eyeo GmbH
+ *
+ * Adblock Plus is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 3 as
+ * published by the Free Software Foundation.
+ *
+ * Adblock Plus is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Adblock Plus.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef ADBLOCK_PLUS_FILTER_INDEX_H
+#define ADBLOCK_PLUS_FILTER_INDEX_H
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+#include <AdblockPlus/FilterTypes.h>
+
+namespace AdblockPlus
+{
+  class FilterIndex;
+
+  /**
+   * A smart pointer to a `FilterIndex` instance.
+   */
+  typedef std::unique_ptr<FilterIndex> FilterIndexPtr;
+
+  /**
+   * Compiles filters into the file format read by `FilterIndex`.
+   * See also `FilterEngine::WriteFilterIndex()`.
+   */
+  class FilterIndexBuilder
+  {
+  public:
+    FilterIndexBuilder();
+    ~FilterIndexBuilder();
+
+    /**
+     * Adds a filter. Comments, invalid filters, element hiding emulation
+     * filters and filters which were added before are ignored.
+     * @param text Text representation of the filter,
+     *        see https://adblockplus.org/en/filters.
+     */
+    void AddFilter(const std::string& text);
+
+    /**
+     * Adds all filters of a filter list. Lines are normalized like
+     * `FilterEngine::GetFilter()` does, the `[Adblock Plus ...]` header is
+     * skipped.
+     * @param text Contents of the filter list.
+     */
+    void AddFilterList(const std::string& text);
+
+    /**
+     * Adds an entry of the public suffix list, used to tell whether
+     * requests are third-party.
+     * @param suffix Public suffix, e.g. "co.uk".
+     * @param labels Value of the entry in the list, i.e. the number of
+     *        labels preceding the suffix that belong to the base domain.
+     */
+    void AddPublicSuffix(const std::string& suffix, int labels);
+
+    /**
+     * Adds the public suffix list `FilterEngine` uses.
+     */
+    void AddDefaultPublicSuffixes();
+
+    /**
+     * Builds the index.
+     * @return Contents of the file to be opened with `FilterIndex`.
+     */
+    std::vector<uint8_t> Build() const;
+
+    /**
+     * Builds the index and opens it from memory, without writing a file.
+     * @return New `FilterIndex` instance owning the built data.
+     */
+    FilterIndexPtr BuildIndex() const;
+
+  private:
+    struct Data;
+
+    FilterIndexBuilder(const FilterIndexBuilder&);
+    FilterIndexBuilder& operator=(const FilterIndexBuilder&);
+
+    std::unique_ptr<Data> data;
+  };
+
+  /**
+   * Read-only filter index matching requests without a `JsEngine`.
+   * The file is position-independent and queried in place, so processes
+   * mapping the same file share one copy of it in memory.
+   * The results are the same as those of `FilterEngine` for the filters
+   * the index was built from, except that filters restricted to sitekeys
+   * never match and that element hiding emulation filters are left out.
+   * All methods are thread-safe.
+   */
+  class FilterIndex
+  {
+    friend class FilterIndexBuilder;
+  public:
+    ~FilterIndex();
+
+    /**
+     * Maps an index file into memory.
+     * @param path Path of the file, as built by `FilterIndexBuilder`.
+     * @return New `FilterIndex` instance.
+     * @throw `std::runtime_error`, if the file can't be mapped or isn't a
+     *        valid index.
+     */
+    static FilterIndexPtr Open(const std::string& path);
+
+    /**
+     * Uses an index which is already in memory, e.g. in shared memory.
+     * @param data Contents of the index, aligned to at least 4 bytes. They
+     *        aren't copied and have to outlive the returned instance.
+     * @param size Size of the contents.
+     * @return New `FilterIndex` instance.
+     * @throw `std::runtime_error`, if the data isn't a valid index.
+     */
+    static FilterIndexPtr FromBuffer(const uint8_t* data, size_t size);
+
+    /**
+     * Retrieves the number of filters in the index.
+     */
+    size_t GetFilterCount() const;
+
+    /**
+     * Checks if any active filter matches the supplied URL, like
+     * FilterEngine::Matches(const std::string&, ContentTypeMask, const std::string&) const.
+     * @param url URL to match.
+     * @param contentTypeMask Content type mask of the requested resource.
+     * @param documentUrl URL of the document requesting the resource.
+     * @param filter Optional, receives the matching filter.
+     * @return `true` if a filter matched. This can be an exception filter.
+     */
+    bool Matches(const std::string& url,
+      ContentTypes::ContentTypeMask contentTypeMask,
+      const std::string& documentUrl,
+      FilterText* filter = nullptr) const;
+
+    /**
+     * Checks if any active filter matches the supplied URL, like
+     * FilterEngine::Matches(const std::string&, ContentTypeMask, const std::vector<std::string>&) const.
+     * @param url URL to match.
+     * @param contentTypeMask Content type mask of the requested resource.
+     * @param documentUrls Chain of documents requesting the resource,
+     *        starting with the current resource's parent frame, ending with
+     *        the top-level frame.
+     * @param filter Optional, receives the matching filter.
+     * @return `true` if a filter matched. This can be an exception filter.
+     */
+    bool Matches(const std::string& url,
+      ContentTypes::ContentTypeMask contentTypeMask,
+      const std::vector<std::string>& documentUrls,
+      FilterText* filter = nullptr) const;
+
+    /**
+     * Retrieves CSS selectors for all element hiding filters active on the
+     * supplied domain, like `FilterEngine::GetElementHidingSelectors()`.
+     * @param domain Domain to retrieve CSS selectors for.
+     * @return List of CSS selectors.
+     */
+    std::vector<std::string> GetElementHidingSelectors(const std::string& domain) const;
+
+    /**
+     * Checks if any filter of several indexes matches the supplied URL, as
+     * if they were a single index. Exception filters of any index override
+     * blocking filters of the others.
+     * @param indexes Indexes to match against. Public suffixes are looked up
+     *        in the first one.
+     * @param url URL to match.
+     * @param contentTypeMask Content type mask of the requested resource.
+     * @param documentUrls Chain of documents requesting the resource,
+     *        starting with the current resource's parent frame, ending with
+     *        the top-level frame.
+     * @param filter Optional, receives the matching filter.
+     * @return `true` if a filter matched. This can be an exception filter.
+     */
+    static bool Matches(const std::vector<const FilterIndex*>& indexes,
+      const std::string& url,
+      ContentTypes::ContentTypeMask contentTypeMask,
+      const std::vector<std::string>& documentUrls,
+      FilterText* filter = nullptr);
+
+    /**
+     * Retrieves CSS selectors for all element hiding filters of several
+     * indexes active on the supplied domain, as if they were a single index.
+     * Element hiding exceptions of any index apply to the filters of the
+     * others.
+     * @param indexes Indexes to retrieve CSS selectors from.
+     * @param domain Domain to retrieve CSS selectors for.
+     * @return List of CSS selectors.
+     */
+    static std::vector<std::string> GetElementHidingSelectors(
+      const std::vector<const FilterIndex*>& indexes, const std::string& domain);
+
+  private:
+    struct Header;
+    struct FilterRecord;
+    struct DomainRecord;
+    struct Table;
+    struct Bucket;
+    struct Mapping;
+    struct RegExpTable;
+
+    FilterIndex(const uint8_t* data, size_t size, std::unique_ptr<Mapping> mapping);
+    FilterIndex(const FilterIndex&);
+    FilterIndex& operator=(const FilterIndex&);
+
+    void Validate() const;
+    const char* GetString(uint32_t offset) const;
+    const uint32_t* GetIds(uint32_t first) const;
+    const Bucket* Find(const Table& table, const std::string& key) const;
+    int GetPublicSuffixLabels(const std::string& suffix) const;
+    bool IsActiveOnDomain(const FilterRecord& filter, const std::string& domain,
+      bool ignoreTrailingDot) const;
+    bool MatchesFilter(uint32_t id, const std::string& url,
+      const std::string& lowerCaseUrl, ContentTypes::ContentTypeMask contentTypeMask,
+      const std::string& documentHost, bool thirdParty) const;
+    static bool MatchesAny(const std::vector<const FilterIndex*>& indexes,
+      const std::string& url, ContentTypes::ContentTypeMask contentTypeMask,
+      const std::string& documentUrl, FilterText* filter);
+    bool IsElementHidingExcepted(const std::string& selector,
+      const std::string& domain) const;
+    void GetFilterText(uint32_t id, FilterText* filter) const;
+
+    const uint8_t* data;
+    size_t size;
+    const Header* header;
+    const FilterRecord* filters;
+    std::unique_ptr<Mapping> mapping;
+    std::unique_ptr<const RegExpTable> regExpTable;
+  };
+}
+
+#endif
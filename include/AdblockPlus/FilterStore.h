@@ -0,0 +1,253 @@
+/*
+ * This file is part of Adblock Plus <https://adblockplus.org/>,
+ * Copyright (C) 2006-present eyeo GmbH
+ *
+ * Adblock Plus is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 3 as
+ * published by the Free Software Foundation.
+ *
+ * Adblock Plus is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Adblock Plus.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef ADBLOCK_PLUS_FILTER_STORE_H
+#define ADBLOCK_PLUS_FILTER_STORE_H
+
+#include <map>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <string>
+#include <vector>
+#include <AdblockPlus/FilterIndex.h>
+
+namespace AdblockPlus
+{
+  class FilterStore;
+
+  /**
+   * A shared smart pointer to a `FilterStore` instance.
+   */
+  typedef std::shared_ptr<FilterStore> FilterStorePtr;
+
+  /**
+   * Subscription filters shared by any number of `FilterProfile` instances,
+   * so that profiles using the same subscriptions hold only one copy of
+   * them. Each subscription is an immutable `FilterIndex`, replacing it
+   * doesn't affect queries which are already running, the old index is
+   * released with the last query using it.
+   * All methods are thread-safe.
+   */
+  class FilterStore
+  {
+    friend class FilterProfile;
+  public:
+    /**
+     * Subscription indexes by subscription URL.
+     */
+    typedef std::map<std::string, std::shared_ptr<const FilterIndex>> Subscriptions;
+
+    FilterStore();
+
+    /**
+     * Adds or replaces a subscription.
+     * @param url URL of the subscription.
+     * @param filterList Contents of the filter list, see
+     *        `FilterIndexBuilder::AddFilterList()`.
+     */
+    void SetSubscription(const std::string& url, const std::string& filterList);
+
+    /**
+     * Adds or replaces a subscription with an index which is already built,
+     * e.g. one mapped by `FilterIndex::Open()`.
+     * @param url URL of the subscription.
+     * @param index Index of the subscription's filters.
+     */
+    void SetSubscription(const std::string& url, FilterIndexPtr index);
+
+    /**
+     * Removes a subscription.
+     * @param url URL of the subscription.
+     */
+    void RemoveSubscription(const std::string& url);
+
+    /**
+     * Retrieves the current subscriptions.
+     * @return Snapshot of the subscriptions, later changes don't affect it.
+     */
+    std::shared_ptr<const Subscriptions> GetSubscriptions() const;
+
+    /**
+     * Sets the default value of a preference for all profiles, see
+     * `FilterProfile::SetPref()`.
+     * @param name Name of the preference.
+     * @param value New default value.
+     */
+    void SetPref(const std::string& name, const std::string& value);
+
+    /**
+     * Retrieves the default value of a preference.
+     * @param name Name of the preference.
+     * @return Default value, or an empty string if there is none.
+     */
+    std::string GetPref(const std::string& name) const;
+
+  private:
+    FilterStore(const FilterStore&);
+    FilterStore& operator=(const FilterStore&);
+
+    // Serializes changes, readers don't lock it.
+    mutable std::mutex mutex;
+    // Only replaced as a whole, use std::atomic_load and std::atomic_store.
+    std::shared_ptr<const Subscriptions> subscriptions;
+    std::map<std::string, std::string> prefs;
+    // Subscription indexes are built without the public suffix list, it's
+    // kept once here instead.
+    std::shared_ptr<const FilterIndex> publicSuffixes;
+  };
+
+  /**
+   * Filters and preferences of one user profile on top of a shared
+   * `FilterStore`. A profile only stores what it changes: its custom
+   * filters, the subscriptions it disabled and its own preference values,
+   * all subscriptions of the store are enabled by default.
+   * Queries give the same results as a single `FilterIndex` built from the
+   * custom filters and the filters of all enabled subscriptions.
+   * All methods are thread-safe.
+   */
+  class FilterProfile
+  {
+  public:
+    /**
+     * Constructor.
+     * @param store Store providing the subscriptions, it is kept alive by
+     *        the profile.
+     */
+    explicit FilterProfile(const FilterStorePtr& store);
+    ~FilterProfile();
+
+    /**
+     * Adds filters to the custom filters of this profile. Texts are
+     * normalized, empty filters and filters which are already listed are
+     * skipped.
+     * @param texts Text representations of the filters,
+     *        see https://adblockplus.org/en/filters.
+     */
+    void AddFilters(const std::vector<std::string>& texts);
+
+    /**
+     * Removes a filter from the custom filters of this profile.
+     * @param text Text representation of the filter.
+     */
+    void RemoveFilter(const std::string& text);
+
+    /**
+     * Retrieves the custom filters of this profile.
+     * @return Filter texts, in the order they were added.
+     */
+    std::vector<std::string> GetFilters() const;
+
+    /**
+     * Enables or disables a subscription of the store for this profile.
+     * The setting is kept if the subscription isn't in the store (yet).
+     * @param url URL of the subscription.
+     * @param disabled Whether the subscription should be disabled.
+     */
+    void SetSubscriptionDisabled(const std::string& url, bool disabled);
+
+    /**
+     * Checks whether a subscription is disabled for this profile.
+     * @param url URL of the subscription.
+     * @return `true` if the subscription is disabled.
+     */
+    bool IsSubscriptionDisabled(const std::string& url) const;
+
+    /**
+     * Sets the value of a preference for this profile, overriding the
+     * default of the store.
+     * @param name Name of the preference.
+     * @param value New value.
+     */
+    void SetPref(const std::string& name, const std::string& value);
+
+    /**
+     * Removes the value of a preference for this profile, so that the
+     * default of the store applies again.
+     * @param name Name of the preference.
+     */
+    void ResetPref(const std::string& name);
+
+    /**
+     * Retrieves the value of a preference.
+     * @param name Name of the preference.
+     * @return Value set for this profile, or the default of the store.
+     */
+    std::string GetPref(const std::string& name) const;
+
+    /**
+     * Checks if any active filter matches the supplied URL, see
+     * `FilterIndex::Matches()`.
+     * @param url URL to match.
+     * @param contentTypeMask Content type mask of the requested resource.
+     * @param documentUrl URL of the document requesting the resource.
+     * @param filter Optional, receives the matching filter.
+     * @return `true` if a filter matched. This can be an exception filter.
+     */
+    bool Matches(const std::string& url,
+      ContentTypes::ContentTypeMask contentTypeMask,
+      const std::string& documentUrl,
+      FilterText* filter = nullptr) const;
+
+    /**
+     * Checks if any active filter matches the supplied URL, see
+     * `FilterIndex::Matches()`.
+     * @param url URL to match.
+     * @param contentTypeMask Content type mask of the requested resource.
+     * @param documentUrls Chain of documents requesting the resource,
+     *        starting with the current resource's parent frame, ending with
+     *        the top-level frame.
+     * @param filter Optional, receives the matching filter.
+     * @return `true` if a filter matched. This can be an exception filter.
+     */
+    bool Matches(const std::string& url,
+      ContentTypes::ContentTypeMask contentTypeMask,
+      const std::vector<std::string>& documentUrls,
+      FilterText* filter = nullptr) const;
+
+    /**
+     * Retrieves CSS selectors for all element hiding filters active on the
+     * supplied domain, see `FilterIndex::GetElementHidingSelectors()`.
+     * @param domain Domain to retrieve CSS selectors for.
+     * @return List of CSS selectors.
+     */
+    std::vector<std::string> GetElementHidingSelectors(const std::string& domain) const;
+
+  private:
+    struct Snapshot;
+
+    FilterProfile(const FilterProfile&);
+    FilterProfile& operator=(const FilterProfile&);
+
+    void UpdateFilters();
+    std::shared_ptr<const Snapshot> GetSnapshot() const;
+
+    FilterStorePtr store;
+    mutable std::mutex mutex;
+    std::vector<std::string> filters;
+    std::set<std::string> filterSet;
+    std::shared_ptr<const FilterIndex> filterIndex;
+    std::set<std::string> disabledSubscriptions;
+    std::map<std::string, std::string> prefs;
+    // Indexes to query, rebuilt when the profile or the store's
+    // subscriptions change. Only replaced as a whole, use std::atomic_load
+    // and std::atomic_store.
+    mutable std::shared_ptr<const Snapshot> snapshot;
+  };
+}
+
+#endif
@@ -0,0 +1,100 @@
+/*
+ * This file is part of Adblock Plus <https://adblockplus.org/>,
+ * Copyright (C) 2006-present eyeo GmbH
+ *
+ * Adblock Plus is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 3 as
+ * published by the Free Software Foundation.
+ *
+ * Adblock Plus is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Adblock Plus.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef ADBLOCK_PLUS_FILTER_TYPES_H
+#define ADBLOCK_PLUS_FILTER_TYPES_H
+
+#include <cstdint>
+#include <string>
+
+namespace AdblockPlus
+{
+  /**
+   * Base of `Filter`, defines the filter types without depending on V8, so
+   * that they can be shared with `FilterIndex`.
+   */
+  class FilterTypes
+  {
+  public:
+    /**
+     * Filter types, see https://adblockplus.org/en/filters.
+     */
+    enum Type {TYPE_BLOCKING, TYPE_EXCEPTION,
+               TYPE_ELEMHIDE, TYPE_ELEMHIDE_EXCEPTION,
+               TYPE_ELEMHIDE_EMULATION,
+               TYPE_COMMENT, TYPE_INVALID};
+  };
+
+  /**
+   * Base of `FilterEngine`, defines the content types without depending on
+   * V8, so that they can be shared with `FilterIndex`.
+   */
+  class ContentTypes
+  {
+  public:
+    // Make sure to keep ContentType in sync with FilterEngine::contentTypes
+    // and with RegExpFilter.typeMap from filterClasses.js.
+    /**
+     * Possible resource content types.
+     */
+    enum ContentType
+    {
+      CONTENT_TYPE_OTHER = 1,
+      CONTENT_TYPE_SCRIPT = 2,
+      CONTENT_TYPE_IMAGE = 4,
+      CONTENT_TYPE_STYLESHEET = 8,
+      CONTENT_TYPE_OBJECT = 16,
+      CONTENT_TYPE_SUBDOCUMENT = 32,
+      CONTENT_TYPE_DOCUMENT = 64,
+      CONTENT_TYPE_WEBSOCKET = 128,
+      CONTENT_TYPE_WEBRTC = 256,
+      CONTENT_TYPE_PING = 1024,
+      CONTENT_TYPE_XMLHTTPREQUEST = 2048,
+      CONTENT_TYPE_OBJECT_SUBREQUEST = 4096,
+      CONTENT_TYPE_MEDIA = 16384,
+      CONTENT_TYPE_FONT = 32768,
+      CONTENT_TYPE_GENERICBLOCK = 0x20000000,
+      CONTENT_TYPE_ELEMHIDE = 0x40000000,
+      CONTENT_TYPE_GENERICHIDE = 0x80000000
+    };
+
+    /**
+     * Bitmask of `ContentType` values.
+     * The underlying type is signed 32 bit integer because it is actually used
+     * in JavaScript where it is converted into 32 bit signed integer.
+     */
+    typedef int32_t ContentTypeMask;
+  };
+
+  /**
+   * Text and type of a filter.
+   */
+  struct FilterText
+  {
+    /**
+     * Text representation of the filter.
+     */
+    std::string text;
+
+    /**
+     * Type of the filter.
+     */
+    FilterTypes::Type type;
+  };
+}
+
+#endif
@@ -0,0 +1,127 @@
+/*
+ * This file is part of Adblock Plus <https://adblockplus.org/>,
+ * Copyright (C) 2006-present eyeo GmbH
+ *
+ * Adblock Plus is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 3 as
+ * published by the Free Software Foundation.
+ *
+ * Adblock Plus is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Adblock Plus.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef ADBLOCK_PLUS_FRAME_TREE_H
+#define ADBLOCK_PLUS_FRAME_TREE_H
+
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace AdblockPlus
+{
+  class Filter;
+
+  /**
+   * Frame structure of the documents known to the application.
+   * Applications which know the frames that requests originate from should
+   * register them here and use
+   * FilterEngine::Matches(const std::string&, ContentTypeMask, FrameTree::FrameId) const
+   * instead of approximating the frame structure with `ReferrerMapping`.
+   * All methods are thread-safe.
+   */
+  class FrameTree
+  {
+    friend class FilterEngine;
+  public:
+    /**
+     * Application defined frame identifier.
+     */
+    typedef int64_t FrameId;
+
+    /**
+     * Registers a top-level frame.
+     * If a frame with the same ID is already known, it is replaced together
+     * with all its descendants, e.g. when the frame navigates.
+     * @param frameId ID of the frame.
+     * @param url URL of the document loaded in the frame.
+     */
+    void AddFrame(FrameId frameId, const std::string& url);
+
+    /**
+     * Registers a frame embedded in another frame.
+     * If a frame with the same ID is already known, it is replaced together
+     * with all its descendants, e.g. when the frame navigates.
+     * @param frameId ID of the frame.
+     * @param parentFrameId ID of the parent frame.
+     * @param url URL of the document loaded in the frame.
+     * @throw `std::invalid_argument`, if the parent frame is not known, or
+     *        if it is the frame itself or one of its descendants.
+     */
+    void AddFrame(FrameId frameId, FrameId parentFrameId, const std::string& url);
+
+    /**
+     * Unregisters a frame and all its descendants.
+     * @param frameId ID of the frame.
+     */
+    void RemoveFrame(FrameId frameId);
+
+    /**
+     * Checks whether a frame is registered.
+     * @param frameId ID of the frame.
+     * @return `true` if the frame is known.
+     */
+    bool HasFrame(FrameId frameId) const;
+
+    /**
+     * Retrieves the URLs of the documents of a frame and its ancestors.
+     * @param frameId ID of the frame.
+     * @return List of URLs, starting with the URL of the frame itself, ending
+     *         with the URL of the top-level frame, or an empty list if the
+     *         frame is not known.
+     */
+    std::vector<std::string> GetDocumentUrls(FrameId frameId) const;
+
+  private:
+    struct Frame
+    {
+      // Neither of these changes after the frame is registered.
+      FrameId id;
+      std::string url;
+      std::shared_ptr<const Frame> parent;
+
+      // Cached document whitelisting state of the frame, maintained by
+      // FilterEngine and guarded by FrameTree::mutex.
+      mutable bool isWhitelistingCached;
+      mutable uint32_t whitelistingGeneration;
+      mutable std::shared_ptr<const Filter> whitelistingFilter;
+    };
+    typedef std::shared_ptr<const Frame> FramePtr;
+    typedef std::unordered_map<FrameId, FramePtr> Frames;
+    typedef std::unordered_map<FrameId, std::vector<FrameId>> Children;
+
+    void AddFrame(FrameId frameId, const FrameId* parentFrameId, const std::string& url);
+    void RemoveFrameLocked(FrameId frameId, std::vector<FramePtr>& removedFrames);
+    FramePtr GetFrame(FrameId frameId) const;
+    static std::vector<std::string> GetDocumentUrls(const Frame& frame);
+    bool GetCachedWhitelistingFilter(const Frame& frame, uint32_t generation,
+      std::shared_ptr<const Filter>& filter) const;
+    void SetCachedWhitelistingFilter(const Frame& frame, uint32_t generation,
+      const std::shared_ptr<const Filter>& filter) const;
+
+    mutable std::mutex mutex;
+    Frames frames;
+    // IDs of the child frames by parent frame ID, frames without children
+    // aren't listed.
+    Children children;
+  };
+}
+
+#endif
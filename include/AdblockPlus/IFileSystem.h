@@ -94,6 +94,9 @@ namespace AdblockPlus
 
     /**
      * Moves a file (i.e.\ renames it).
+     * An existing file at the target is replaced, atomically if possible,
+     * since this is used to replace files without losing their content on
+     * a crash.
      * @param fromFileName Current file name.
      * @param toFileName New file name.
      * @param callback The function called on completion.
@@ -27,6 +27,7 @@
 #include <mutex>
 #include <AdblockPlus/AppInfo.h>
 #include <AdblockPlus/LogSystem.h>
+#include <AdblockPlus/Metrics.h>
 #include <AdblockPlus/IFileSystem.h>
 #include <AdblockPlus/JsValue.h>
 #include <AdblockPlus/IWebRequest.h>
@@ -92,6 +93,38 @@ namespace AdblockPlus
      */
     typedef std::map<std::string, EventCallback> EventMap;
 
+    /**
+     * Memory usage of the JavaScript heap, see `GetHeapStatistics()`.
+     */
+    struct HeapStatistics
+    {
+      HeapStatistics()
+        : totalHeapSize(0), usedHeapSize(0), heapSizeLimit(0), externalMemory(0)
+      {
+      }
+
+      /**
+       * Bytes reserved for the heap.
+       */
+      size_t totalHeapSize;
+
+      /**
+       * Bytes occupied by objects on the heap.
+       */
+      size_t usedHeapSize;
+
+      /**
+       * Maximum size of the heap in bytes.
+       */
+      size_t heapSizeLimit;
+
+      /**
+       * Bytes allocated outside of the heap and owned by JavaScript objects,
+       * e.g. by array buffers.
+       */
+      int64_t externalMemory;
+    };
+
     /**
      * An opaque structure representing ID of stored JsValueList.
      */
@@ -148,6 +181,12 @@ namespace AdblockPlus
      */
     void Gc();
 
+    /**
+     * Retrieves the current memory usage of the JavaScript heap.
+     * @return Heap statistics.
+     */
+    HeapStatistics GetHeapStatistics();
+
     //@{
     /**
      * Creates a new JavaScript value.
@@ -261,6 +300,16 @@ namespace AdblockPlus
      */
     void NotifyLowMemory();
 
+    /**
+     * Retrieves the call counters and latency histograms of this engine
+     * and of the `FilterEngine` using it.
+     * @return Metrics of this engine.
+     */
+    Metrics& GetMetrics()
+    {
+      return metrics;
+    }
+
     /**
      * Private functionality.
      */
@@ -276,6 +325,7 @@ namespace AdblockPlus
     JsValue GetGlobalObject();
 
     Platform& platform;
+    Metrics metrics;
     /// Isolate must be disposed only after disposing of all objects which are
     /// using it.
     std::unique_ptr<IV8IsolateProvider> isolate;
@@ -0,0 +1,202 @@
+/*
+ * This file is part of Adblock Plus <https://adblockplus.org/>,
+ * Copyright (C) 2006-present eyeo GmbH
+ *
+ * Adblock Plus is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 3 as
+ * published by the Free Software Foundation.
+ *
+ * Adblock Plus is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Adblock Plus.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef ADBLOCK_PLUS_METRICS_H
+#define ADBLOCK_PLUS_METRICS_H
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace AdblockPlus
+{
+  /**
+   * Latency distribution of an operation.
+   * Durations are counted in log-linear buckets: each power of two is split
+   * into 8 buckets, so that any recorded value is known with a relative
+   * error of at most 12.5%.
+   */
+  struct LatencyHistogram
+  {
+    /**
+     * Number of buckets in `bucketCounts`.
+     */
+    static const size_t bucketCount = 312;
+
+    LatencyHistogram();
+
+    /**
+     * Retrieves the exclusive upper bound of a bucket.
+     * @param index Bucket index.
+     * @return Upper bound in nanoseconds.
+     */
+    static uint64_t GetBucketUpperBound(size_t index);
+
+    /**
+     * Retrieves the bucket a duration is counted in.
+     * @param nanoseconds Duration.
+     * @return Bucket index, durations above the range of the histogram end
+     *         up in the last bucket.
+     */
+    static size_t GetBucketIndex(uint64_t nanoseconds);
+
+    /**
+     * Estimates a percentile of the recorded durations.
+     * @param percentile Percentile between 0 and 100.
+     * @return Upper bound of the bucket containing the percentile in
+     *         nanoseconds, capped by the maximum, or 0 if nothing has been
+     *         recorded.
+     */
+    uint64_t GetPercentile(double percentile) const;
+
+    /**
+     * Name of the operation.
+     */
+    std::string name;
+
+    /**
+     * Number of calls.
+     */
+    uint64_t count;
+
+    /**
+     * Sum of all durations in nanoseconds.
+     */
+    uint64_t totalNanoseconds;
+
+    /**
+     * Longest duration in nanoseconds.
+     */
+    uint64_t maxNanoseconds;
+
+    /**
+     * Number of calls per bucket, see `GetBucketUpperBound()`.
+     */
+    std::vector<uint64_t> bucketCounts;
+  };
+
+  /**
+   * Call counters and latency histograms of the `FilterEngine` and
+   * `JsEngine` entry points.
+   * Every thread records into its own set of histograms, so recording only
+   * consists of two clock reads and a few uncontended stores. The histograms
+   * of all threads are added up when they are retrieved.
+   */
+  class Metrics
+  {
+  public:
+    /**
+     * Measured operations.
+     */
+    enum Operation
+    {
+      OPERATION_CREATE_FILTER_ENGINE,
+      OPERATION_MATCHES,
+      OPERATION_IS_DOCUMENT_WHITELISTED,
+      OPERATION_IS_ELEMHIDE_WHITELISTED,
+      OPERATION_GET_ELEMENT_HIDING_SELECTORS,
+      OPERATION_GET_FILTER,
+      OPERATION_GET_LISTED_FILTERS,
+      OPERATION_GET_SUBSCRIPTION,
+      OPERATION_GET_LISTED_SUBSCRIPTIONS,
+      OPERATION_GET_PREF,
+      OPERATION_SET_PREF,
+      OPERATION_EVALUATE,
+      OPERATION_TRIGGER_EVENT,
+      OPERATION_V8_LOCK_WAIT,
+      OPERATION_GET_SUBSCRIPTION_FILTERS,
+      OPERATION_COUNT
+    };
+
+    typedef std::chrono::steady_clock Clock;
+
+    /**
+     * Records the duration of a scope.
+     */
+    class Timer
+    {
+    public:
+      Timer(Metrics& metrics, Operation operation)
+        : metrics(metrics), operation(operation), start(Clock::now())
+      {
+      }
+
+      ~Timer()
+      {
+        metrics.Record(operation, Clock::now() - start);
+      }
+
+    private:
+      Timer(const Timer&);
+      Timer& operator=(const Timer&);
+
+      Metrics& metrics;
+      Operation operation;
+      Clock::time_point start;
+    };
+
+    Metrics();
+    ~Metrics();
+
+    /**
+     * Retrieves the name of an operation.
+     * @param operation Operation.
+     * @return Name of the operation, e.g. "Matches".
+     */
+    static const char* GetOperationName(Operation operation);
+
+    /**
+     * Records a call of an operation.
+     * @param operation Operation which was called.
+     * @param duration Time the call took.
+     */
+    void Record(Operation operation, Clock::duration duration);
+
+    /**
+     * Retrieves the accumulated histograms of all threads.
+     * @return One histogram per operation, in the order of `Operation`.
+     */
+    std::vector<LatencyHistogram> GetHistograms() const;
+
+    /**
+     * Formats histograms in the Prometheus text exposition format.
+     * @param histograms Histograms as returned by `GetHistograms()`.
+     * @return Text with an `abp_latency_seconds` histogram per operation.
+     */
+    static std::string ToPrometheusText(const std::vector<LatencyHistogram>& histograms);
+
+  private:
+    struct Shard;
+
+    Metrics(const Metrics&);
+    Metrics& operator=(const Metrics&);
+
+    Shard& GetShard();
+
+    const uint64_t id;
+    mutable std::mutex mutex;
+    std::map<std::thread::id, std::unique_ptr<Shard>> shards;
+  };
+}
+
+#endif
@@ -24,8 +24,10 @@
 #include "IWebRequest.h"
 #include "AppInfo.h"
 #include "Scheduler.h"
+#include "Tracer.h"
 #include "FilterEngine.h"
 #include <mutex>
+#include <atomic>
 #include <future>
 
 namespace AdblockPlus
@@ -50,13 +52,18 @@ namespace AdblockPlus
      * @param timer Implementation of timer.
      * @param webRequest Implementation of web request.
      * @param fileSystem Implementation of filesystem.
+     * @param minLogLevel Messages below this level are dropped before they
+     *        are formatted, the default is to pass everything through.
      */
     struct CreationParameters
     {
+      CreationParameters();
+
       LogSystemPtr logSystem;
       TimerPtr timer;
       WebRequestPtr webRequest;
       FileSystemPtr fileSystem;
+      LogSystem::LogLevel minLogLevel;
     };
 
     /**
@@ -119,12 +126,58 @@ namespace AdblockPlus
     typedef std::function<void(LogSystem&)> WithLogSystemCallback;
     virtual void WithLogSystem(const WithLogSystemCallback&);
 
+    /**
+     * Changes the minimum log level, messages with a lower level are not
+     * passed to the `LogSystem`.
+     * @param logLevel New minimum log level.
+     */
+    void SetMinLogLevel(LogSystem::LogLevel logLevel);
+
+    /**
+     * Checks whether messages of a given level are passed to the
+     * `LogSystem`. Callers should check this before formatting a message.
+     * @param logLevel Log level to check.
+     * @return `true` if messages of that level are logged.
+     */
+    bool IsLogLevelEnabled(LogSystem::LogLevel logLevel) const;
+
+    /**
+     * Starts recording trace events, previously recorded events are
+     * discarded. Events are only recorded if the library was compiled with
+     * `ABP_TRACE_EVENTS` defined.
+     */
+    void StartTracing();
+
+    /**
+     * Stops recording trace events and writes them to a file in the Chrome
+     * trace event format.
+     * @param fileName File to write the events to, using `IFileSystem`.
+     * @param callback Called when the file has been written.
+     */
+    void StopTracing(const std::string& fileName,
+      const IFileSystem::Callback& callback = IFileSystem::Callback());
+
+    /**
+     * Retrieves the `Tracer` used to record trace events.
+     */
+    Tracer& GetTracer();
+
   protected:
+    /**
+     * Writes the state of modules which is otherwise saved after a delay,
+     * e.g. the filter hit statistics, and waits for it to be written.
+     * Implementations dropping their interfaces before `~Platform()` runs
+     * have to call this first.
+     */
+    void FlushModules();
+
     LogSystemPtr logSystem;
     TimerPtr timer;
     FileSystemPtr fileSystem;
     WebRequestPtr webRequest;
   private:
+    std::atomic<int> minLogLevel;
+    Tracer tracer;
     // used for creation and deletion of modules.
     std::mutex modulesMutex;
     std::shared_ptr<JsEngine> jsEngine;
@@ -18,9 +18,10 @@
 #ifndef ADBLOCK_PLUS_REFERRER_MAPPING_H
 #define ADBLOCK_PLUS_REFERRER_MAPPING_H
 
-#include <list>
-#include <map>
+#include <cstddef>
+#include <limits>
 #include <string>
+#include <unordered_map>
 #include <vector>
 
 namespace AdblockPlus
@@ -39,8 +40,12 @@ namespace AdblockPlus
      * @param maxCachedUrls Number of URL mappings to store. The higher the
      *        better - clients typically cache requests, and a single cached
      *        request will break the referrer chain.
+     * @param maxCachedBytes Approximate amount of memory the stored URLs may
+     *        occupy. The least recently added mappings are dropped when
+     *        either limit is exceeded.
      */
-    ReferrerMapping(const int maxCachedUrls = 5000);
+    ReferrerMapping(const int maxCachedUrls = 5000,
+      const size_t maxCachedBytes = std::numeric_limits<size_t>::max());
 
     /**
      * Records the refferer for a URL.
@@ -58,9 +63,41 @@ namespace AdblockPlus
     std::vector<std::string> BuildReferrerChain(const std::string& url) const;
 
   private:
+    friend class ConcurrentReferrerMapping;
+
+    // We need to limit the chain length to ensure we don't block indefinitely
+    // if there's a referrer loop.
+    static const int maxChainLength = 10;
+
+    // Every URL is stored only once, no matter whether it is used as a
+    // request URL, as a referrer or both. An entry with a referrer is also
+    // a node of the list of mappings ordered by the time of addition.
+    struct Entry
+    {
+      const std::string* url;
+      Entry* referrer;
+      Entry* prev;
+      Entry* next;
+      size_t refCount;
+    };
+    typedef std::unordered_map<std::string, Entry> Entries;
+
+    ReferrerMapping(const ReferrerMapping&);
+    ReferrerMapping& operator=(const ReferrerMapping&);
+
+    const std::string* FindReferrer(const std::string& url) const;
+    Entry* Intern(const std::string& url);
+    void Release(Entry* entry);
+    void Unlink(Entry* entry);
+    void RemoveOldest();
+
     const int maxCachedUrls;
-    std::map<std::string, std::string> mapping;
-    std::list<std::string> cachedUrls;
+    const size_t maxCachedBytes;
+    Entries entries;
+    Entry* oldest;
+    Entry* newest;
+    int cachedUrls;
+    size_t cachedBytes;
   };
 }
 
@@ -0,0 +1,148 @@
+/*
+ * This file is part of Adblock Plus <https://adblockplus.org/>,
+ * Copyright (C) 2006-present eyeo GmbH
+ *
+ * Adblock Plus is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 3 as
+ * published by the Free Software Foundation.
+ *
+ * Adblock Plus is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Adblock Plus.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef ADBLOCK_PLUS_TRACER_H
+#define ADBLOCK_PLUS_TRACER_H
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace AdblockPlus
+{
+  /**
+   * Collects trace events in the Chrome trace event format, see
+   * https://docs.google.com/document/d/1CvAClvFfyA5R-PhYUmn5OOQtYMH4h6I0nSsKchNAySU
+   * The resulting JSON can be loaded in chrome://tracing.
+   *
+   * Events are only recorded by the `ABP_TRACE_*` macros when the library is
+   * compiled with `ABP_TRACE_EVENTS` defined, otherwise the macros expand to
+   * nothing. Recording itself is switched on and off at runtime, see
+   * `Platform::StartTracing()`.
+   */
+  class Tracer
+  {
+  public:
+    typedef std::chrono::steady_clock Clock;
+
+    /**
+     * Records the duration of a scope as a complete event.
+     * Nothing is recorded if tracing is disabled when the scope is entered.
+     */
+    class Scope
+    {
+    public:
+      /**
+       * Constructor.
+       * @param tracer Tracer to record the event with.
+       * @param category Event category, must outlive the scope.
+       * @param name Event name, must outlive the scope.
+       * @param detail Optional event argument, must outlive the scope.
+       */
+      Scope(Tracer& tracer, const char* category, const char* name,
+        const char* detail = nullptr);
+      ~Scope();
+
+    private:
+      Scope(const Scope&);
+      Scope& operator=(const Scope&);
+
+      Tracer& tracer;
+      const char* category;
+      const char* name;
+      const char* detail;
+      bool enabled;
+      Clock::time_point start;
+    };
+
+    Tracer();
+
+    /**
+     * Checks whether events are being recorded.
+     * @return `true` between `Start()` and `Stop()`.
+     */
+    bool IsEnabled() const
+    {
+      return enabled.load(std::memory_order_relaxed);
+    }
+
+    /**
+     * Discards all recorded events and starts recording.
+     */
+    void Start();
+
+    /**
+     * Stops recording.
+     * @return Recorded events in the JSON object format.
+     */
+    std::string Stop();
+
+    /**
+     * Records a complete event, i.e. an event with a known duration.
+     * Has no effect if tracing is disabled.
+     * @param category Event category.
+     * @param name Event name.
+     * @param start Time when the event started.
+     * @param end Time when the event finished.
+     * @param detail Optional event argument, may be `nullptr`.
+     */
+    void AddCompleteEvent(const char* category, const char* name,
+      Clock::time_point start, Clock::time_point end,
+      const char* detail = nullptr);
+
+  private:
+    struct Event
+    {
+      const char* category;
+      const char* name;
+      std::string detail;
+      int64_t timestamp;
+      int64_t duration;
+      int threadId;
+    };
+
+    Tracer(const Tracer&);
+    Tracer& operator=(const Tracer&);
+
+    std::atomic<bool> enabled;
+    std::mutex mutex;
+    Clock::time_point startTime;
+    std::vector<Event> events;
+    std::map<std::thread::id, int> threadIds;
+  };
+}
+
+#define ABP_TRACE_CONCAT_IMPL(a, b) a##b
+#define ABP_TRACE_CONCAT(a, b) ABP_TRACE_CONCAT_IMPL(a, b)
+
+#ifdef ABP_TRACE_EVENTS
+/**
+ * Records the duration of the enclosing scope, see `Tracer::Scope`.
+ */
+#define ABP_TRACE_SCOPE(tracer, category, ...) \
+  const AdblockPlus::Tracer::Scope ABP_TRACE_CONCAT(abpTraceScope, __LINE__)( \
+    tracer, category, __VA_ARGS__)
+#else
+#define ABP_TRACE_SCOPE(tracer, category, ...) static_cast<void>(0)
+#endif
+
+#endif
@@ -20,7 +20,9 @@
 let API = (() =>
 {
   const {Services} = Cu.import("resource://gre/modules/Services.jsm", {});
-  const {Filter} = require("filterClasses");
+  const {Filter, BlockingFilter, WhitelistFilter, ElemHideFilter,
+         ElemHideException, ElemHideEmulationFilter,
+         CommentFilter} = require("filterClasses");
   const {Subscription} = require("subscriptionClasses");
   const {SpecialSubscription} = require("subscriptionClasses");
   const {FilterStorage} = require("filterStorage");
@@ -30,6 +32,100 @@ let API = (() =>
   const {Prefs} = require("prefs");
   const {checkForUpdates} = require("updater");
   const {Notification} = require("notification");
+  const {FilterNotifier} = require("filterNotifier");
+  const {setFilterChangesBatched,
+         getFiltersGeneration} = require("filterUpdateRegistration");
+
+  function getFilterType(filter)
+  {
+    if (filter instanceof BlockingFilter)
+      return "blocking";
+    if (filter instanceof WhitelistFilter)
+      return "exception";
+    if (filter instanceof ElemHideFilter)
+      return "elemhide";
+    if (filter instanceof ElemHideException)
+      return "elemhideexception";
+    if (filter instanceof ElemHideEmulationFilter)
+      return "elemhideemulation";
+    if (filter instanceof CommentFilter)
+      return "comment";
+    return "invalid";
+  }
+
+  // Returns the total number of filters followed by one "type\ttext" line
+  // per filter on the page, so that a page only needs a single string to be
+  // passed to C++.
+  function formatFilterPage(filters, offset, count)
+  {
+    let lines = [String(filters.length)];
+    for (let filter of filters.slice(offset, offset + count))
+      lines.push(getFilterType(filter) + "\t" + filter.text);
+    return lines.join("\n");
+  }
+
+  // Replacing the filters of a group processes all of them again, adding or
+  // removing filters one by one is cheaper unless a large part of the group
+  // changes, e.g. when a few filters are added to a long custom list.
+  function isBulkChange(subscription, changeCount)
+  {
+    return changeCount * 4 >= subscription.filters.length;
+  }
+
+  // The deduplicated custom filters, kept while the filters don't change so
+  // that paging through them doesn't collect them again for every page.
+  let listedFilters = null;
+  let listedFiltersGeneration = -1;
+
+  function getListedFilterList()
+  {
+    if (listedFilters && listedFiltersGeneration == getFiltersGeneration())
+      return listedFilters;
+
+    listedFilters = [];
+    let seen = new Set();
+    for (let subscription of FilterStorage.subscriptions)
+    {
+      if (!(subscription instanceof SpecialSubscription))
+        continue;
+      for (let filter of subscription.filters)
+      {
+        if (!seen.has(filter.text))
+        {
+          seen.add(filter.text);
+          listedFilters.push(filter);
+        }
+      }
+    }
+    listedFiltersGeneration = getFiltersGeneration();
+    return listedFilters;
+  }
+
+  function isFilterListed(filter)
+  {
+    return filter.subscriptions.some(s =>
+    {
+      return (s instanceof SpecialSubscription && !s.disabled);
+    });
+  }
+
+  // Keeps the native index of FilterEngine::IsListedFilter() up to date,
+  // changes of whole subscriptions make it rebuild the index.
+  const listedFiltersResetActions = new Set([
+    "load", "subscription.added", "subscription.removed",
+    "subscription.disabled", "subscription.updated"
+  ]);
+
+  FilterNotifier.addListener((action, item) =>
+  {
+    if (action == "filter.added" || action == "filter.removed")
+    {
+      _triggerEvent("_listedFilterChanged", item.text, getFilterType(item),
+                    isFilterListed(item));
+    }
+    else if (listedFiltersResetActions.has(action))
+      _triggerEvent("_listedFiltersReset");
+  });
 
   return {
     getFilterFromText(text)
@@ -42,10 +138,7 @@ let API = (() =>
 
     isListedFilter(filter)
     {
-      return filter.subscriptions.some(s =>
-      {
-        return (s instanceof SpecialSubscription && !s.disabled);
-      });
+      return isFilterListed(filter);
     },
 
     addFilterToList(filter)
@@ -58,6 +151,127 @@ let API = (() =>
       FilterStorage.removeFilter(filter);
     },
 
+    addFilters(texts)
+    {
+      // Collect the new filters per custom filter group first, so that every
+      // group is updated only once.
+      let newFilters = new Map();
+      let seen = new Set();
+      for (let text of texts.split("\n"))
+      {
+        text = Filter.normalize(text);
+        if (!text)
+          continue;
+        let filter = Filter.fromText(text);
+        if (seen.has(filter) || isFilterListed(filter))
+          continue;
+        seen.add(filter);
+
+        let subscription = FilterStorage.getGroupForFilter(filter);
+        if (!subscription)
+        {
+          // There is no group for this type of filters yet, creating one
+          // adds the filter as well.
+          FilterStorage.addSubscription(
+            SpecialSubscription.createForFilter(filter));
+          continue;
+        }
+        if (!newFilters.has(subscription))
+          newFilters.set(subscription, []);
+        newFilters.get(subscription).push(filter);
+      }
+      for (let [subscription, filters] of newFilters)
+      {
+        if (isBulkChange(subscription, filters.length))
+        {
+          FilterStorage.updateSubscriptionFilters(subscription,
+            subscription.filters.concat(filters));
+        }
+        else
+        {
+          for (let filter of filters)
+            FilterStorage.addFilter(filter, subscription);
+        }
+      }
+    },
+
+    removeFilters(texts)
+    {
+      let removed = new Set();
+      for (let text of texts.split("\n"))
+      {
+        text = Filter.normalize(text);
+        if (text)
+          removed.add(Filter.fromText(text));
+      }
+
+      let removedFilters = new Map();
+      for (let filter of removed)
+      {
+        for (let subscription of filter.subscriptions)
+        {
+          if (!(subscription instanceof SpecialSubscription))
+            continue;
+          if (!removedFilters.has(subscription))
+            removedFilters.set(subscription, []);
+          removedFilters.get(subscription).push(filter);
+        }
+      }
+      for (let [subscription, filters] of removedFilters)
+      {
+        if (isBulkChange(subscription, filters.length))
+        {
+          FilterStorage.updateSubscriptionFilters(subscription,
+            subscription.filters.filter(filter => !removed.has(filter)));
+        }
+        else
+        {
+          for (let filter of filters)
+            FilterStorage.removeFilter(filter, subscription);
+        }
+      }
+    },
+
+    setFilterChangesBatched(enabled)
+    {
+      setFilterChangesBatched(enabled);
+    },
+
+    getListedFilterPage(offset, count)
+    {
+      return formatFilterPage(getListedFilterList(), offset, count);
+    },
+
+    getEnabledListedFilterTexts()
+    {
+      // Matches isListedFilter(), filters of disabled groups don't count.
+      let filters = [];
+      let seen = new Set();
+      for (let subscription of FilterStorage.subscriptions)
+      {
+        if (!(subscription instanceof SpecialSubscription) ||
+            subscription.disabled)
+          continue;
+        for (let filter of subscription.filters)
+        {
+          if (!seen.has(filter.text))
+          {
+            seen.add(filter.text);
+            filters.push(filter);
+          }
+        }
+      }
+      return formatFilterPage(filters, 0, filters.length);
+    },
+
+    getSubscriptionFilterPage(url, offset, count)
+    {
+      // Subscription.fromURL() would register unknown URLs.
+      let subscription = FilterStorage.knownSubscriptions[url];
+      return formatFilterPage(subscription ? subscription.filters : [],
+        offset, count);
+    },
+
     getListedFilters()
     {
       let filters = {};
@@ -203,6 +417,22 @@ let API = (() =>
                                             ElemHide.ALL_MATCHING, false);
     },
 
+    getActiveFilterTexts()
+    {
+      let texts = new Set();
+      for (let subscription of FilterStorage.subscriptions)
+      {
+        if (subscription.disabled)
+          continue;
+        for (let filter of subscription.filters)
+        {
+          if (!filter.disabled)
+            texts.add(filter.text);
+        }
+      }
+      return Array.from(texts).join("\n");
+    },
+
     getPref(pref)
     {
       return Prefs[pref];
@@ -213,6 +443,21 @@ let API = (() =>
       Prefs[pref] = value;
     },
 
+    getPrefs()
+    {
+      return Prefs.getValues();
+    },
+
+    setPrefs(prefs)
+    {
+      Prefs.setValues(prefs);
+    },
+
+    flushPrefs(eventName)
+    {
+      Prefs.flush(eventName ? _triggerEvent.bind(null, eventName) : null);
+    },
+
     forceUpdateCheck(eventName)
     {
       checkForUpdates(eventName ? _triggerEvent.bind(null, eventName) : null);
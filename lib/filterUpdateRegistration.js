@@ -18,8 +18,70 @@
 "use strict";
 
 let {FilterNotifier} = require("filterNotifier");
+let {Utils} = require("utils");
+
+// If batching is enabled, changes are collected and reported once per tick as
+// "action\titem" lines instead of one event per change, see
+// FilterEngine::SetFilterChangesCallback().
+let batchChanges = false;
+let pendingChanges = null;
+
+function getItemSummary(item)
+{
+  if (item && typeof item.text == "string")
+    return item.text;
+  if (item && typeof item.url == "string")
+    return item.url;
+  return "";
+}
+
+function reportPendingChanges()
+{
+  let changes = pendingChanges;
+  pendingChanges = null;
+  _triggerEvent("filterChanges", changes.join("\n"));
+}
 
 FilterNotifier.addListener((action, item) =>
 {
-  _triggerEvent("filterChange", action, item);
+  if (!batchChanges)
+  {
+    _triggerEvent("filterChange", action, item);
+    return;
+  }
+
+  if (!pendingChanges)
+  {
+    pendingChanges = [];
+    Utils.runAsync(reportPendingChanges);
+  }
+  pendingChanges.push(action + "\t" + getItemSummary(item));
+});
+
+exports.setFilterChangesBatched = enabled =>
+{
+  batchChanges = enabled;
+};
+
+// Notifications which cannot change the result of matching
+let statisticsActions = new Set([
+  "save", "filter.hitCount", "filter.lastHit", "subscription.title",
+  "subscription.fixedTitle", "subscription.homepage",
+  "subscription.lastCheck", "subscription.lastDownload",
+  "subscription.downloadStatus", "subscription.errors"
+]);
+
+// Incremented whenever the filters change, so that data derived from them
+// can be cached.
+let filtersGeneration = 0;
+
+exports.getFiltersGeneration = () => filtersGeneration;
+
+FilterNotifier.addListener(action =>
+{
+  if (!statisticsActions.has(action))
+  {
+    filtersGeneration++;
+    _triggerEvent("_filtersChanged");
+  }
 });
@@ -39,6 +39,11 @@ Prefs._initListener = function()
 if (Prefs.initialized)
   checkInitialized();
 
+Prefs.addListener(key =>
+{
+  _triggerEvent("_prefChange", key, Prefs[key]);
+});
+
 FilterNotifier.addListener(action =>
 {
   if (action === "load")
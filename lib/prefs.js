@@ -55,9 +55,35 @@ let preconfigurable = [
 
 let values;
 let prefsFileName = "prefs.json";
+let prefsTempFileName = prefsFileName + ".tmp";
 let listeners = [];
 let isDirty = false;
 let isSaving = false;
+let isSaveScheduled = false;
+let flushCallbacks = [];
+
+// Changes made within this time window are written to disk together
+let saveDelay = typeof _prefsSaveDelay == "number" ? _prefsSaveDelay : 0;
+
+function checkType(key, value)
+{
+  if (typeof value != typeof defaults[key])
+    throw new Error("Attempt to change preference type");
+}
+
+function setValue(key, value)
+{
+  if (value == defaults[key])
+    delete values[key];
+  else
+    values[key] = value;
+}
+
+function notifyListeners(key)
+{
+  for (let listener of listeners)
+    listener(key);
+}
 
 function defineProperty(key)
 {
@@ -66,17 +92,10 @@ function defineProperty(key)
       get: () => values[key],
       set(value)
       {
-        if (typeof value != typeof defaults[key])
-          throw new Error("Attempt to change preference type");
-
-        if (value == defaults[key])
-          delete values[key];
-        else
-          values[key] = value;
+        checkType(key, value);
+        setValue(key, value);
         save();
-
-        for (let listener of listeners)
-          listener(key);
+        notifyListeners(key);
       },
       enumerable: true
     });
@@ -109,23 +128,75 @@ function load()
 }
 
 function save()
+{
+  isDirty = true;
+  if (isSaving || isSaveScheduled)
+    return;
+
+  if (saveDelay > 0)
+  {
+    isSaveScheduled = true;
+    setTimeout(() =>
+    {
+      isSaveScheduled = false;
+      writePrefs();
+    }, saveDelay);
+  }
+  else
+    writePrefs();
+}
+
+function writePrefs()
 {
   if (isSaving)
+    return;
+
+  if (!isDirty)
   {
-    isDirty = true;
+    let callbacks = flushCallbacks;
+    flushCallbacks = [];
+    for (let callback of callbacks)
+      callback();
     return;
   }
 
   isDirty = false;
   isSaving = true;
-  _fileSystem.write(prefsFileName, JSON.stringify(values), () =>
+  writePrefsFile(JSON.stringify(values), () =>
   {
     isSaving = false;
-    if (isDirty)
+    if (flushCallbacks.length > 0)
+      writePrefs();
+    else if (isDirty)
       save();
   });
 }
 
+function writePrefsFile(content, callback)
+{
+  // Write to a temporary file first and replace prefs.json only once the
+  // data is completely written, so that a crash cannot leave a truncated
+  // prefs.json behind.
+  _fileSystem.write(prefsTempFileName, content, error =>
+  {
+    if (error)
+    {
+      callback();
+      return;
+    }
+
+    _fileSystem.move(prefsTempFileName, prefsFileName, error =>
+    {
+      // Not every file system can replace an existing file, fall back to
+      // writing in place then.
+      if (error)
+        _fileSystem.write(prefsFileName, content, callback);
+      else
+        callback();
+    });
+  });
+}
+
 let Prefs = exports.Prefs = {
   initialized: false,
 
@@ -140,6 +211,53 @@ let Prefs = exports.Prefs = {
     let index = listeners.indexOf(listener);
     if (index >= 0)
       listeners.splice(index, 1);
+  },
+
+  /**
+   * Writes pending changes to disk immediately, without waiting for the save
+   * delay to pass.
+   * @param {Function} [callback] called once all changes made so far have
+   *                              been saved
+   */
+  flush(callback)
+  {
+    flushCallbacks.push(callback || (() => {}));
+    writePrefs();
+  },
+
+  /**
+   * Returns the current values of all preferences, including the ones which
+   * still have their default values.
+   * @return {Object} name-value pairs of all preferences
+   */
+  getValues()
+  {
+    let result = {};
+    for (let key in defaults)
+      result[key] = values[key];
+    return result;
+  },
+
+  /**
+   * Sets several preferences at once. Either all values are applied or, if
+   * any of them has a wrong type, none. The preferences are saved once and
+   * listeners are notified once per key after all values have been applied.
+   * @param {Object} newValues name-value pairs of the preferences to set
+   */
+  setValues(newValues)
+  {
+    let keys = Object.keys(newValues).filter(key => key in defaults);
+    for (let key of keys)
+      checkType(key, newValues[key]);
+    if (keys.length == 0)
+      return;
+
+    for (let key of keys)
+      setValue(key, newValues[key]);
+    save();
+
+    for (let key of keys)
+      notifyListeners(key);
   }
 };
 
@@ -1,4 +1,9 @@
 {
+  'variables': {
+    # Set to 1 to compile in the trace event instrumentation, see
+    # include/AdblockPlus/Tracer.h
+    'abp_trace_events%': 0
+  },
   'conditions': [[
     # We don't want to use curl on Windows and Android, skip the check there
     'OS=="win" or OS=="android"',
@@ -12,12 +17,76 @@
         'have_curl': '<!(python check_curl.py)'
       }
     }
-  ]],
-  'includes': ['v8.gypi', 'shell/shell.gyp'],
+  ],
+  ['OS=="linux" or OS=="mac"', {
+    'targets': [{
+      # Client of FilterEngineService, doesn't depend on V8.
+      'target_name': 'libadblockplus-client',
+      'type': '<(library)',
+      'xcode_settings': {},
+      'include_dirs': [
+        'include'
+      ],
+      'sources': [
+        'include/AdblockPlus/FilterEngineClient.h',
+        'src/FilterEngineClient.cpp',
+        'src/ServiceProtocol.cpp',
+        'src/ServiceProtocol.h'
+      ],
+      'direct_dependent_settings': {
+        'include_dirs': ['include']
+      }
+    }]
+  }]],
+  'includes': ['v8.gypi', 'shell/shell.gyp', 'abpd/abpd.gyp'],
   'targets': [{
+    # Native request matching, doesn't depend on V8.
+    'target_name': 'libadblockplus-matcher',
+    'type': '<(library)',
+    'xcode_settings': {},
+    'include_dirs': [
+      'include',
+      'src'
+    ],
+    'sources': [
+      'include/AdblockPlus/FilterIndex.h',
+      'include/AdblockPlus/FilterStore.h',
+      'include/AdblockPlus/FilterTypes.h',
+      'src/FilterIndex.cpp',
+      'src/FilterStore.cpp',
+      'src/NativeFilter.cpp',
+      'src/NativeFilter.h',
+      'src/NativeRegExp.cpp',
+      'src/NativeRegExp.h',
+      '<(INTERMEDIATE_DIR)/publicSuffixList.cpp'
+    ],
+    'direct_dependent_settings': {
+      'include_dirs': ['include']
+    },
+    'actions': [{
+      'action_name': 'convert_public_suffixes',
+      'inputs': [
+        'convert_public_suffixes.py',
+        'lib/publicSuffixList.js'
+      ],
+      'outputs': [
+        '<(INTERMEDIATE_DIR)/publicSuffixList.cpp'
+      ],
+      'action': [
+        'python',
+        'convert_public_suffixes.py',
+        'lib/publicSuffixList.js',
+        '<@(_outputs)'
+      ]
+    }]
+  },
+  {
     'target_name': 'libadblockplus',
     'type': '<(library)',
-    'dependencies': ['<@(libv8_build_targets)'],
+    'dependencies': [
+      'libadblockplus-matcher',
+      '<@(libv8_build_targets)'
+    ],
     'xcode_settings':{},
     'include_dirs': [
       'include',
@@ -29,7 +98,11 @@
       'include/AdblockPlus/IFileSystem.h',
       'include/AdblockPlus/Scheduler.h',
       'include/AdblockPlus/Platform.h',
+      'include/AdblockPlus/Metrics.h',
+      'include/AdblockPlus/Tracer.h',
       'src/AppInfoJsObject.cpp',
+      'src/AsyncLogSystem.cpp',
+      'src/ConcurrentReferrerMapping.cpp',
       'src/ConsoleJsObject.cpp',
       'src/DefaultLogSystem.cpp',
       'src/DefaultFileSystem.h',
@@ -40,15 +113,20 @@
       'src/DefaultWebRequest.cpp',
       'src/FileSystemJsObject.cpp',
       'src/FilterEngine.cpp',
+      'src/FilterHitStatistics.cpp',
+      'src/FilterHitStatistics.h',
+      'src/FrameTree.cpp',
       'src/GlobalJsObject.cpp',
       'src/JsContext.cpp',
       'src/JsEngine.cpp',
       'src/JsError.cpp',
       'src/JsValue.cpp',
+      'src/Metrics.cpp',
       'src/Notification.cpp',
       'src/Platform.cpp',
       'src/ReferrerMapping.cpp',
       'src/Thread.cpp',
+      'src/Tracer.cpp',
       'src/Utils.cpp',
       'src/WebRequestJsObject.cpp',
       '<(INTERMEDIATE_DIR)/adblockplus.js.cpp'
@@ -67,6 +145,11 @@
     },
     'conditions': [
       ['OS=="linux" or OS=="mac"', {
+        'dependencies': ['libadblockplus-client'],
+        'sources': [
+          'include/AdblockPlus/FilterEngineService.h',
+          'src/FilterEngineService.cpp'
+        ],
         'link_settings': {
           'libraries': [
             '<@(libv8_libs)'
@@ -113,6 +196,12 @@
           }
         }
       ],
+      ['abp_trace_events==1', {
+        'defines': ['ABP_TRACE_EVENTS'],
+        'direct_dependent_settings': {
+          'defines': ['ABP_TRACE_EVENTS'],
+        }
+      }],
       ['have_curl!=1 and OS!="win"',
         {
           'sources': [
@@ -191,19 +280,60 @@
       'test/BaseJsTest.h',
       'test/BaseJsTest.cpp',
       'test/AppInfoJsObject.cpp',
+      'test/AsyncLogSystem.cpp',
+      'test/ConcurrentReferrerMapping.cpp',
       'test/ConsoleJsObject.cpp',
       'test/DefaultFileSystem.cpp',
       'test/FileSystemJsObject.cpp',
       'test/FilterEngine.cpp',
+      'test/FilterHitStatistics.cpp',
+      'test/FilterIndex.cpp',
+      'test/FilterStore.cpp',
+      'test/FrameTree.cpp',
       'test/GlobalJsObject.cpp',
       'test/JsEngine.cpp',
       'test/JsValue.cpp',
+      'test/MatcherConformance.cpp',
+      'test/Metrics.cpp',
       'test/Notification.cpp',
       'test/Prefs.cpp',
       'test/ReferrerMapping.cpp',
+      'test/Tracer.cpp',
       'test/UpdateCheck.cpp',
       'test/WebRequest.cpp'
     ],
+    'conditions': [
+      ['OS=="linux" or OS=="mac"', {
+        'sources': [
+          'test/FilterEngineService.cpp'
+        ]
+      }]
+    ],
+    'msvs_settings': {
+      'VCLinkerTool': {
+        'SubSystem': '1',   # Console
+        'EntryPointSymbol': 'mainCRTStartup',
+      },
+    },
+  },
+  {
+    'target_name': 'benchmarks',
+    'type': 'executable',
+    'xcode_settings': {},
+    'dependencies': [
+      'libadblockplus'
+    ],
+    'sources': [
+      'benchmarks/Benchmark.h',
+      'benchmarks/Benchmark.cpp',
+      'benchmarks/Contention.cpp',
+      'benchmarks/FilterEngineFixture.h',
+      'benchmarks/FilterEngineFixture.cpp',
+      'benchmarks/Matches.cpp',
+      'benchmarks/Memory.cpp',
+      'benchmarks/ReferrerMapping.cpp',
+      'benchmarks/Startup.cpp'
+    ],
     'msvs_settings': {
       'VCLinkerTool': {
         'SubSystem': '1',   # Console
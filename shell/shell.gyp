@@ -12,7 +12,10 @@
       'src/HelpCommand.cpp',
       'src/FiltersCommand.cpp',
       'src/MatchesCommand.cpp',
+      'src/MemoryCommand.cpp',
       'src/PrefsCommand.cpp',
+      'src/ReplayCommand.cpp',
+      'src/StatsCommand.cpp',
       'src/SubscriptionsCommand.cpp'
     ],
     'msvs_settings': {
@@ -15,8 +15,6 @@
  * along with Adblock Plus.  If not, see <http://www.gnu.org/licenses/>.
  */
 
-#include <iostream>
-
 #include "Command.h"
 
 Command::Command(const std::string& name) : name(name)
@@ -27,12 +25,12 @@ Command::~Command()
 {
 }
 
-void Command::ShowUsage() const
+NoSuchCommandError::NoSuchCommandError(const std::string& commandName)
+  : std::runtime_error("No such command: " + commandName)
 {
-  std::cout << "Usage: " << GetUsage() << std::endl;
 }
 
-NoSuchCommandError::NoSuchCommandError(const std::string& commandName)
-  : std::runtime_error("No such command: " + commandName)
+UsageError::UsageError(const std::string& usage)
+  : std::runtime_error("Usage: " + usage)
 {
 }
@@ -32,9 +32,6 @@ public:
   virtual void operator()(const std::string& arguments) = 0;
   virtual std::string GetDescription() const = 0;
   virtual std::string GetUsage() const = 0;
-
-protected:
-  void ShowUsage() const;
 };
 
 typedef std::map<const std::string, Command*> CommandMap;
@@ -45,4 +42,10 @@ public:
   explicit NoSuchCommandError(const std::string& commandName);
 };
 
+class UsageError : public std::runtime_error
+{
+public:
+  explicit UsageError(const std::string& usage);
+};
+
 #endif
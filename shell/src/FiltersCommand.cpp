@@ -83,7 +83,7 @@ void FiltersCommand::operator()(const std::string& arguments)
     if (text.size())
       AddFilter(text);
     else
-      ShowUsage();
+      throw UsageError(GetUsage());
   }
   else if (action == "remove")
   {
@@ -92,7 +92,7 @@ void FiltersCommand::operator()(const std::string& arguments)
     if (text.size())
       RemoveFilter(text);
     else
-      ShowUsage();
+      throw UsageError(GetUsage());
   }
   else
     throw NoSuchCommandError(name + " " + action);
@@ -123,9 +123,6 @@ void FiltersCommand::RemoveFilter(const std::string& text)
 {
   AdblockPlus::Filter filter = filterEngine.GetFilter(text);
   if (!filter.IsListed())
-  {
-    std::cout << "No such filter '" << text << "'" << std::endl;
-    return;
-  }
+    throw std::runtime_error("No such filter '" + text + "'");
   filter.RemoveFromList();
 }
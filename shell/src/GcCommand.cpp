@@ -15,6 +15,8 @@
  * along with Adblock Plus.  If not, see <http://www.gnu.org/licenses/>.
  */
 
+#include <iostream>
+
 #include "GcCommand.h"
 
 GcCommand::GcCommand(AdblockPlus::JsEngine& jsEngine)
@@ -24,7 +26,11 @@ GcCommand::GcCommand(AdblockPlus::JsEngine& jsEngine)
 
 void GcCommand::operator()(const std::string& arguments)
 {
+  size_t usedBefore = jsEngine.GetHeapStatistics().usedHeapSize;
   jsEngine.Gc();
+  size_t usedAfter = jsEngine.GetHeapStatistics().usedHeapSize;
+  std::cout << "Heap used: " << usedBefore / 1024 << " KiB -> "
+            << usedAfter / 1024 << " KiB" << std::endl;
 }
 
 std::string GcCommand::GetDescription() const
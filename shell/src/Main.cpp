@@ -17,6 +17,9 @@
 
 #include <AdblockPlus.h>
 #include <AdblockPlus/Platform.h>
+#include <chrono>
+#include <fstream>
+#include <iomanip>
 #include <iostream>
 #include <sstream>
 
@@ -24,21 +27,66 @@
 #include "HelpCommand.h"
 #include "FiltersCommand.h"
 #include "MatchesCommand.h"
+#include "MemoryCommand.h"
 #include "PrefsCommand.h"
+#include "ReplayCommand.h"
+#include "StatsCommand.h"
 #include "SubscriptionsCommand.h"
 
 namespace
 {
+  struct Options
+  {
+    Options() : quiet(false)
+    {
+    }
+
+    std::string scriptFileName;
+    bool quiet;
+    std::string commandLine;
+  };
+
+  void ShowUsage()
+  {
+    std::cerr << "Usage: abpshell [--quiet] [--script FILE | COMMAND [ARGUMENTS...]]"
+              << std::endl;
+  }
+
+  bool ParseOptions(int argc, char* argv[], Options& options)
+  {
+    int i = 1;
+    for (; i < argc; i++)
+    {
+      const std::string argument = argv[i];
+      if (argument == "--quiet")
+        options.quiet = true;
+      else if (argument == "--script" && i + 1 < argc)
+        options.scriptFileName = argv[++i];
+      else if (argument.compare(0, 2, "--") == 0)
+        return false;
+      else
+        break;
+    }
+    for (; i < argc; i++)
+    {
+      if (!options.commandLine.empty())
+        options.commandLine += ' ';
+      options.commandLine += argv[i];
+    }
+    return options.scriptFileName.empty() || options.commandLine.empty();
+  }
+
   void Add(CommandMap& commands, Command* command)
   {
     commands[command->name] = command;
   }
 
-  bool ReadCommandLine(std::string& commandLine)
+  bool ReadCommandLine(std::string& commandLine, bool prompt)
   {
-    std::cout << "> ";
+    if (prompt)
+      std::cout << "> ";
     const bool success = std::getline(std::cin, commandLine).good();
-    if (!success)
+    if (!success && prompt)
       std::cout << std::endl;
     return success;
   }
@@ -50,10 +98,75 @@ namespace
     lineStream >> name;
     std::getline(lineStream, arguments);
   }
+
+  bool RunCommand(const CommandMap& commands, const std::string& commandLine,
+                  bool showTiming)
+  {
+    std::string commandName;
+    std::string arguments;
+    ParseCommandLine(commandLine, commandName, arguments);
+    const CommandMap::const_iterator it = commands.find(commandName);
+    const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    try
+    {
+      if (it != commands.end())
+        (*it->second)(arguments);
+      else
+        throw NoSuchCommandError(commandName);
+    }
+    catch (const NoSuchCommandError& error)
+    {
+      std::cout << error.what() << std::endl;
+      return false;
+    }
+    catch (const UsageError& error)
+    {
+      std::cout << error.what() << std::endl;
+      return false;
+    }
+    catch (const std::exception& e)
+    {
+      std::cout << "Error: " << e.what() << std::endl;
+      return false;
+    }
+    if (showTiming)
+    {
+      // Timings go to stderr, so that the output of the commands can be
+      // compared between runs.
+      std::cerr << "[" << std::fixed << std::setprecision(3)
+                << std::chrono::duration<double, std::milli>(
+                     std::chrono::steady_clock::now() - start).count()
+                << " ms] " << commandLine << std::endl;
+    }
+    return true;
+  }
+
+  // Runs the commands in a script, one per line, until one of them fails.
+  bool RunScript(const CommandMap& commands, std::istream& script,
+                 bool showTiming)
+  {
+    std::string commandLine;
+    while (std::getline(script, commandLine))
+    {
+      const size_t start = commandLine.find_first_not_of(" \t\r");
+      if (start == std::string::npos || commandLine[start] == '#')
+        continue;
+      if (!RunCommand(commands, commandLine, showTiming))
+        return false;
+    }
+    return true;
+  }
 }
 
-int main()
+int main(int argc, char* argv[])
 {
+  Options options;
+  if (!ParseOptions(argc, argv, options))
+  {
+    ShowUsage();
+    return 2;
+  }
+
   try
   {
     AdblockPlus::AppInfo appInfo;
@@ -74,31 +187,42 @@ int main()
     Add(commands, new FiltersCommand(filterEngine));
     Add(commands, new SubscriptionsCommand(filterEngine));
     Add(commands, new MatchesCommand(filterEngine));
+    Add(commands, new MemoryCommand(jsEngine));
     Add(commands, new PrefsCommand(filterEngine));
+    Add(commands, new ReplayCommand(filterEngine));
+    Add(commands, new StatsCommand(filterEngine));
 
-    std::string commandLine;
-    while (ReadCommandLine(commandLine))
+    // A command given on the command line, e.g. `abpshell replay log.txt 4`,
+    // is run instead of reading commands interactively.
+    if (!options.commandLine.empty())
+      return RunCommand(commands, options.commandLine, !options.quiet) ? 0 : 1;
+
+    if (!options.scriptFileName.empty())
     {
-      std::string commandName;
-      std::string arguments;
-      ParseCommandLine(commandLine, commandName, arguments);
-      const CommandMap::const_iterator it = commands.find(commandName);
-      try
-      {
-        if (it != commands.end())
-          (*it->second)(arguments);
-        else
-          throw NoSuchCommandError(commandName);
-      }
-      catch (NoSuchCommandError error)
+      bool success;
+      if (options.scriptFileName == "-")
+        success = RunScript(commands, std::cin, !options.quiet);
+      else
       {
-        std::cout << error.what() << std::endl;
+        std::ifstream script(options.scriptFileName);
+        if (!script)
+        {
+          std::cerr << "Unable to open " << options.scriptFileName << std::endl;
+          return 1;
+        }
+        success = RunScript(commands, script, !options.quiet);
       }
+      return success ? 0 : 1;
     }
+
+    std::string commandLine;
+    while (ReadCommandLine(commandLine, !options.quiet))
+      RunCommand(commands, commandLine, false);
   }
   catch (const std::exception& e)
   {
     std::cerr << "Exception: " << e.what() << std::endl;
+    return 1;
   }
   return 0;
 }
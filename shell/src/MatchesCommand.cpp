@@ -44,10 +44,7 @@ void MatchesCommand::operator()(const std::string& arguments)
     contentTypeStr.clear();
   }
   if (!url.size() || !contentTypeStr.size() || !documentUrl.size())
-  {
-    ShowUsage();
-    return;
-  }
+    throw UsageError(GetUsage());
 
   AdblockPlus::FilterPtr match = filterEngine.Matches(url, contentType, documentUrl);
   if (!match)
@@ -0,0 +1,44 @@
+/*
+ * This file is part of Adblock Plus <https://adblockplus.org/>,
+ * Copyright (C) 2006-present eyeo GmbH
+ *
+ * Adblock Plus is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 3 as
+ * published by the Free Software Foundation.
+ *
+ * Adblock Plus is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Adblock Plus.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <iostream>
+
+#include "MemoryCommand.h"
+
+MemoryCommand::MemoryCommand(AdblockPlus::JsEngine& jsEngine)
+  : Command("memory"), jsEngine(jsEngine)
+{
+}
+
+void MemoryCommand::operator()(const std::string& arguments)
+{
+  AdblockPlus::JsEngine::HeapStatistics statistics = jsEngine.GetHeapStatistics();
+  std::cout << "Heap used: " << statistics.usedHeapSize / 1024 << " KiB" << std::endl
+            << "Heap total: " << statistics.totalHeapSize / 1024 << " KiB" << std::endl
+            << "Heap limit: " << statistics.heapSizeLimit / 1024 << " KiB" << std::endl
+            << "External: " << statistics.externalMemory / 1024 << " KiB" << std::endl;
+}
+
+std::string MemoryCommand::GetDescription() const
+{
+  return "Shows the memory usage of the JavaScript heap";
+}
+
+std::string MemoryCommand::GetUsage() const
+{
+  return name;
+}
@@ -31,10 +31,7 @@ void PrefsCommand::operator()(const std::string& arguments)
   std::string action;
   argumentStream >> action;
   if (!action.size())
-  {
-    ShowUsage();
-    return;
-  }
+    throw UsageError(GetUsage());
 
   if (action == "show")
   {
@@ -43,7 +40,7 @@ void PrefsCommand::operator()(const std::string& arguments)
 
     auto value = filterEngine.GetPref(pref);
     if (value.IsUndefined())
-      std::cout << "No such preference" << std::endl;
+      throw std::runtime_error("No such preference");
     else
     {
       if (value.IsString())
@@ -64,7 +61,7 @@ void PrefsCommand::operator()(const std::string& arguments)
 
     auto current = filterEngine.GetPref(pref);
     if (current.IsUndefined())
-      std::cout << "No such preference" << std::endl;
+      throw std::runtime_error("No such preference");
     else if (current.IsString())
     {
       std::string value;
@@ -84,7 +81,7 @@ void PrefsCommand::operator()(const std::string& arguments)
       filterEngine.SetPref(pref, filterEngine.GetJsEngine().NewValue(value));
     }
     else
-      std::cout << "Cannot set a preference of unknown type" << std::endl;
+      throw std::runtime_error("Cannot set a preference of unknown type");
   }
   else
     throw NoSuchCommandError(name + " " + action);
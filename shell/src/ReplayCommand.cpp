@@ -0,0 +1,248 @@
+/*
+ * This file is part of Adblock Plus <https://adblockplus.org/>,
+ * Copyright (C) 2006-present eyeo GmbH
+ *
+ * Adblock Plus is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 3 as
+ * published by the Free Software Foundation.
+ *
+ * Adblock Plus is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Adblock Plus.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <thread>
+
+#include "ReplayCommand.h"
+
+namespace
+{
+  typedef std::chrono::steady_clock Clock;
+
+  const size_t topFilterCount = 10;
+
+  struct Request
+  {
+    std::string url;
+    AdblockPlus::FilterEngine::ContentType contentType;
+    std::string documentUrl;
+  };
+
+  struct WorkerResult
+  {
+    WorkerResult() : blocked(0), whitelisted(0)
+    {
+      latencies.name = "Matches";
+    }
+
+    AdblockPlus::LatencyHistogram latencies;
+    size_t blocked;
+    size_t whitelisted;
+    std::map<std::string, size_t> filterHits;
+  };
+
+  bool ParseRequest(const std::string& line, Request& request)
+  {
+    std::istringstream lineStream(line);
+    std::string contentType;
+    lineStream >> request.url >> contentType >> request.documentUrl;
+    if (request.url.empty() || contentType.empty())
+      return false;
+    try
+    {
+      request.contentType =
+        AdblockPlus::FilterEngine::StringToContentType(contentType);
+    }
+    catch (std::invalid_argument&)
+    {
+      return false;
+    }
+    return true;
+  }
+
+  void Replay(AdblockPlus::FilterEngine& filterEngine,
+              const std::vector<Request>& requests, int worker,
+              int workerCount, WorkerResult& result)
+  {
+    const std::vector<std::string> noDocumentUrls;
+    for (size_t i = worker; i < requests.size(); i += workerCount)
+    {
+      const Request& request = requests[i];
+      Clock::time_point start = Clock::now();
+      AdblockPlus::FilterPtr match = request.documentUrl.empty() ?
+        filterEngine.Matches(request.url, request.contentType, noDocumentUrls) :
+        filterEngine.Matches(request.url, request.contentType, request.documentUrl);
+      uint64_t nanoseconds = std::chrono::duration_cast<std::chrono::nanoseconds>(
+        Clock::now() - start).count();
+
+      AdblockPlus::LatencyHistogram& latencies = result.latencies;
+      latencies.count++;
+      latencies.totalNanoseconds += nanoseconds;
+      latencies.maxNanoseconds = std::max(latencies.maxNanoseconds, nanoseconds);
+      latencies.bucketCounts[AdblockPlus::LatencyHistogram::GetBucketIndex(nanoseconds)]++;
+
+      if (!match)
+        continue;
+      if (match->GetType() == AdblockPlus::Filter::TYPE_EXCEPTION)
+        result.whitelisted++;
+      else
+        result.blocked++;
+      result.filterHits[match->GetProperty("text").AsString()]++;
+    }
+  }
+
+  void Merge(WorkerResult& total, const WorkerResult& result)
+  {
+    total.latencies.count += result.latencies.count;
+    total.latencies.totalNanoseconds += result.latencies.totalNanoseconds;
+    total.latencies.maxNanoseconds = std::max(total.latencies.maxNanoseconds,
+                                              result.latencies.maxNanoseconds);
+    for (size_t i = 0; i < total.latencies.bucketCounts.size(); i++)
+      total.latencies.bucketCounts[i] += result.latencies.bucketCounts[i];
+    total.blocked += result.blocked;
+    total.whitelisted += result.whitelisted;
+    for (const auto& filterHit : result.filterHits)
+      total.filterHits[filterHit.first] += filterHit.second;
+  }
+
+  std::string FormatMicroseconds(uint64_t nanoseconds)
+  {
+    std::ostringstream result;
+    result << std::fixed << std::setprecision(1) << nanoseconds / 1000.0 << " us";
+    return result.str();
+  }
+
+  void ShowHistogram(const AdblockPlus::LatencyHistogram& latencies)
+  {
+    // The buckets are combined per power of two to keep the output short.
+    std::map<uint64_t, uint64_t> counts;
+    for (size_t i = 0; i < latencies.bucketCounts.size(); i++)
+    {
+      if (!latencies.bucketCounts[i])
+        continue;
+      uint64_t upperBound = 1;
+      while (upperBound < AdblockPlus::LatencyHistogram::GetBucketUpperBound(i))
+        upperBound <<= 1;
+      counts[upperBound] += latencies.bucketCounts[i];
+    }
+    for (const auto& count : counts)
+    {
+      std::cout << "  < " << std::setw(12) << FormatMicroseconds(count.first)
+                << std::setw(10) << count.second << "  "
+                << std::string(static_cast<size_t>(
+                     40.0 * count.second / latencies.count + 0.5), '#')
+                << std::endl;
+    }
+  }
+
+  void ShowTopFilters(const std::map<std::string, size_t>& filterHits)
+  {
+    std::vector<std::pair<size_t, std::string>> filters;
+    for (const auto& filterHit : filterHits)
+      filters.push_back(std::make_pair(filterHit.second, filterHit.first));
+    size_t count = std::min(filters.size(), topFilterCount);
+    std::partial_sort(filters.begin(), filters.begin() + count, filters.end(),
+      [](const std::pair<size_t, std::string>& a,
+         const std::pair<size_t, std::string>& b)
+      {
+        return a.first > b.first || (a.first == b.first && a.second < b.second);
+      });
+    for (size_t i = 0; i < count; i++)
+      std::cout << std::setw(10) << filters[i].first << "  " << filters[i].second << std::endl;
+  }
+}
+
+ReplayCommand::ReplayCommand(AdblockPlus::FilterEngine& filterEngine)
+  : Command("replay"), filterEngine(filterEngine)
+{
+}
+
+void ReplayCommand::operator()(const std::string& arguments)
+{
+  std::istringstream argumentStream(arguments);
+  std::string fileName;
+  argumentStream >> fileName;
+  std::string workers;
+  argumentStream >> workers;
+  int workerCount = workers.size() ? std::atoi(workers.c_str()) : 1;
+  if (!fileName.size() || workerCount < 1)
+    throw UsageError(GetUsage());
+
+  std::ifstream file(fileName);
+  if (!file)
+    throw std::runtime_error("Unable to open " + fileName);
+  std::vector<Request> requests;
+  size_t skipped = 0;
+  std::string line;
+  while (std::getline(file, line))
+  {
+    if (line.empty() || line[0] == '#')
+      continue;
+    Request request;
+    if (ParseRequest(line, request))
+      requests.push_back(request);
+    else
+      skipped++;
+  }
+
+  std::vector<WorkerResult> results(workerCount);
+  std::vector<std::thread> threads;
+  Clock::time_point start = Clock::now();
+  for (int i = 0; i < workerCount; i++)
+  {
+    threads.push_back(std::thread(Replay, std::ref(filterEngine),
+      std::cref(requests), i, workerCount, std::ref(results[i])));
+  }
+  for (auto& thread : threads)
+    thread.join();
+  double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+
+  WorkerResult total;
+  for (const auto& result : results)
+    Merge(total, result);
+  const AdblockPlus::LatencyHistogram& latencies = total.latencies;
+  std::cout << "Replayed " << requests.size() << " requests with "
+            << workerCount << " workers in " << seconds << " s ("
+            << (seconds > 0 ? requests.size() / seconds : 0)
+            << " requests/s)" << std::endl
+            << "Blocked: " << total.blocked
+            << ", whitelisted: " << total.whitelisted
+            << ", no match: " << requests.size() - total.blocked - total.whitelisted
+            << ", skipped lines: " << skipped << std::endl;
+  if (!latencies.count)
+    return;
+  std::cout << "Latency: p50 " << FormatMicroseconds(latencies.GetPercentile(50))
+            << ", p90 " << FormatMicroseconds(latencies.GetPercentile(90))
+            << ", p99 " << FormatMicroseconds(latencies.GetPercentile(99))
+            << ", max " << FormatMicroseconds(latencies.maxNanoseconds)
+            << std::endl;
+  ShowHistogram(latencies);
+  if (!total.filterHits.empty())
+  {
+    std::cout << "Top filters:" << std::endl;
+    ShowTopFilters(total.filterHits);
+  }
+}
+
+std::string ReplayCommand::GetDescription() const
+{
+  return "Runs a log of requests, one \"URL CONTENT_TYPE [DOCUMENT_URL]\" "
+    "per line, through the filters and shows statistics";
+}
+
+std::string ReplayCommand::GetUsage() const
+{
+  return name + " FILE [WORKERS]";
+}
@@ -0,0 +1,67 @@
+/*
+ * This file is part of Adblock Plus <https://adblockplus.org/>,
+ * Copyright (C) 2006-present eyeo GmbH
+ *
+ * Adblock Plus is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 3 as
+ * published by the Free Software Foundation.
+ *
+ * Adblock Plus is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Adblock Plus.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+
+#include "StatsCommand.h"
+
+namespace
+{
+  std::string FormatMicroseconds(uint64_t nanoseconds)
+  {
+    std::ostringstream result;
+    result << std::fixed << std::setprecision(1) << nanoseconds / 1000.0;
+    return result.str();
+  }
+}
+
+StatsCommand::StatsCommand(AdblockPlus::FilterEngine& filterEngine)
+  : Command("stats"), filterEngine(filterEngine)
+{
+}
+
+void StatsCommand::operator()(const std::string& arguments)
+{
+  std::cout << std::left << std::setw(28) << "Operation" << std::right
+            << std::setw(10) << "Calls" << std::setw(12) << "Mean us"
+            << std::setw(12) << "p50 us" << std::setw(12) << "p99 us"
+            << std::setw(12) << "Max us" << std::endl;
+  for (const auto& histogram : filterEngine.GetMetrics())
+  {
+    if (!histogram.count)
+      continue;
+    std::cout << std::left << std::setw(28) << histogram.name << std::right
+              << std::setw(10) << histogram.count
+              << std::setw(12) << FormatMicroseconds(histogram.totalNanoseconds / histogram.count)
+              << std::setw(12) << FormatMicroseconds(histogram.GetPercentile(50))
+              << std::setw(12) << FormatMicroseconds(histogram.GetPercentile(99))
+              << std::setw(12) << FormatMicroseconds(histogram.maxNanoseconds)
+              << std::endl;
+  }
+}
+
+std::string StatsCommand::GetDescription() const
+{
+  return "Shows call counts and latencies of the filter engine operations";
+}
+
+std::string StatsCommand::GetUsage() const
+{
+  return name;
+}
@@ -66,7 +66,7 @@ void SubscriptionsCommand::operator()(const std::string& arguments)
     if (url.size())
       AddSubscription(url, title);
     else
-      ShowUsage();
+      throw UsageError(GetUsage());
   }
   else if (action == "remove")
   {
@@ -75,7 +75,7 @@ void SubscriptionsCommand::operator()(const std::string& arguments)
     if (url.size())
       RemoveSubscription(url);
     else
-      ShowUsage();
+      throw UsageError(GetUsage());
   }
   else if (action == "update")
     UpdateSubscriptions();
@@ -113,10 +113,7 @@ void SubscriptionsCommand::RemoveSubscription(const std::string& url)
 {
   AdblockPlus::Subscription subscription = filterEngine.GetSubscription(url);
   if (!subscription.IsListed())
-  {
-    std::cout << "No subscription with URL '" << url << "'" << std::endl;
-    return;
-  }
+    throw std::runtime_error("No subscription with URL '" + url + "'");
   subscription.RemoveFromList();
 }
 
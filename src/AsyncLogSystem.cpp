@@ -0,0 +1,170 @@
+/*
+ * This file is part of Adblock Plus <https://adblockplus.org/>,
+ * Copyright (C) 2006-present eyeo GmbH
+ *
+ * Adblock Plus is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 3 as
+ * published by the Free Software Foundation.
+ *
+ * Adblock Plus is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Adblock Plus.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <AdblockPlus/AsyncLogSystem.h>
+#include <AdblockPlus/DefaultLogSystem.h>
+
+using namespace AdblockPlus;
+
+namespace
+{
+  size_t RoundUpToPowerOfTwo(size_t value)
+  {
+    size_t result = 2;
+    while (result < value)
+      result <<= 1;
+    return result;
+  }
+}
+
+AsyncLogSystem::AsyncLogSystem(LogSystemPtr sink, size_t capacity)
+  : sink(std::move(sink)), mask(RoundUpToPowerOfTwo(capacity) - 1),
+    cells(new Cell[mask + 1]), enqueuePos(0), dequeuePos(0),
+    droppedCount(0), reportedDroppedCount(0), sleeping(false), processedPos(0),
+    stopped(false)
+{
+  if (!this->sink)
+    this->sink.reset(new DefaultLogSystem());
+  for (size_t i = 0; i <= mask; i++)
+    cells[i].sequence.store(i, std::memory_order_relaxed);
+  thread = std::thread([this]() { Run(); });
+}
+
+AsyncLogSystem::~AsyncLogSystem()
+{
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    stopped = true;
+  }
+  hasRecords.notify_one();
+  thread.join();
+}
+
+void AsyncLogSystem::operator()(LogLevel logLevel, const std::string& message,
+  const std::string& source)
+{
+  // Bounded multi-producer queue as described by Dmitry Vyukov, a cell can
+  // be written once its sequence number matches the enqueue position.
+  size_t pos = enqueuePos.load(std::memory_order_relaxed);
+  Cell* cell;
+  for (;;)
+  {
+    cell = &cells[pos & mask];
+    size_t sequence = cell->sequence.load(std::memory_order_acquire);
+    intptr_t diff = static_cast<intptr_t>(sequence) - static_cast<intptr_t>(pos);
+    if (diff == 0)
+    {
+      if (enqueuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+        break;
+    }
+    else if (diff < 0)
+    {
+      droppedCount.fetch_add(1, std::memory_order_relaxed);
+      return;
+    }
+    else
+      pos = enqueuePos.load(std::memory_order_relaxed);
+  }
+
+  cell->record.logLevel = logLevel;
+  cell->record.message = message;
+  cell->record.source = source;
+  cell->sequence.store(pos + 1, std::memory_order_release);
+
+  // Only take the mutex if the background thread is about to wait. Either it
+  // sees the record before waiting or this sees the flag, see Run().
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  if (sleeping.load(std::memory_order_relaxed))
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    hasRecords.notify_one();
+  }
+}
+
+void AsyncLogSystem::Flush()
+{
+  size_t pos = enqueuePos.load(std::memory_order_acquire);
+  std::unique_lock<std::mutex> lock(mutex);
+  hasRecords.notify_one();
+  processed.wait(lock, [this, pos]() { return processedPos >= pos || stopped; });
+}
+
+uint64_t AsyncLogSystem::GetDroppedCount() const
+{
+  return droppedCount.load(std::memory_order_relaxed);
+}
+
+bool AsyncLogSystem::HasRecord() const
+{
+  return cells[dequeuePos & mask].sequence.load(std::memory_order_acquire) ==
+    dequeuePos + 1;
+}
+
+bool AsyncLogSystem::TryPop(Record& record)
+{
+  Cell& cell = cells[dequeuePos & mask];
+  size_t sequence = cell.sequence.load(std::memory_order_acquire);
+  if (sequence != dequeuePos + 1)
+    return false;
+  record.logLevel = cell.record.logLevel;
+  record.message.swap(cell.record.message);
+  record.source.swap(cell.record.source);
+  cell.sequence.store(dequeuePos + mask + 1, std::memory_order_release);
+  dequeuePos++;
+  return true;
+}
+
+void AsyncLogSystem::ReportDropped()
+{
+  uint64_t dropped = droppedCount.load(std::memory_order_relaxed);
+  if (dropped == reportedDroppedCount)
+    return;
+  (*sink)(LOG_LEVEL_WARN, std::to_string(dropped - reportedDroppedCount) +
+    " log messages dropped", "");
+  reportedDroppedCount = dropped;
+}
+
+void AsyncLogSystem::Run()
+{
+  Record record;
+  for (;;)
+  {
+    bool hadRecords = false;
+    while (TryPop(record))
+    {
+      hadRecords = true;
+      (*sink)(record.logLevel, record.message, record.source);
+    }
+    ReportDropped();
+
+    std::unique_lock<std::mutex> lock(mutex);
+    if (hadRecords)
+    {
+      processedPos = dequeuePos;
+      processed.notify_all();
+      continue;
+    }
+    if (stopped)
+      break;
+    sleeping.store(true, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (!HasRecord())
+      hasRecords.wait(lock);
+    sleeping.store(false, std::memory_order_relaxed);
+  }
+  processed.notify_all();
+}
@@ -0,0 +1,83 @@
+/*
+ * This file is part of Adblock Plus <https://adblockplus.org/>,
+ * Copyright (C) 2006-present eyeo GmbH
+ *
+ * Adblock Plus is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 3 as
+ * published by the Free Software Foundation.
+ *
+ * Adblock Plus is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Adblock Plus.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <algorithm>
+#include <functional>
+#include <AdblockPlus/ConcurrentReferrerMapping.h>
+
+using namespace AdblockPlus;
+
+ConcurrentReferrerMapping::Shard::Shard(const int maxCachedUrls,
+  const size_t maxCachedBytes)
+  : mapping(maxCachedUrls, maxCachedBytes)
+{
+}
+
+ConcurrentReferrerMapping::ConcurrentReferrerMapping(const int maxCachedUrls,
+  const size_t maxCachedBytes, const int shardCount)
+{
+  const int count = std::max(shardCount, 1);
+  const int maxShardUrls = (maxCachedUrls + count - 1) / count;
+  const size_t maxShardBytes = maxCachedBytes == std::numeric_limits<size_t>::max() ?
+    maxCachedBytes : maxCachedBytes / count;
+  for (int i = 0; i < count; i++)
+    shards.emplace_back(new Shard(maxShardUrls, maxShardBytes));
+}
+
+void ConcurrentReferrerMapping::Add(const std::string& url,
+  const std::string& referrer)
+{
+  Shard& shard = GetShard(url);
+  std::lock_guard<std::mutex> lock(shard.mutex);
+  shard.mapping.Add(url, referrer);
+}
+
+std::vector<std::string> ConcurrentReferrerMapping::BuildReferrerChain(
+  const std::string& url) const
+{
+  // Each step only locks the shard of the current URL, so the chain can
+  // reflect concurrent changes in the middle, just like a chain built
+  // between two calls of Add().
+  std::vector<std::string> referrerChain;
+  referrerChain.push_back(url);
+  for (int i = 0; i < ReferrerMapping::maxChainLength; i++)
+  {
+    Shard& shard = GetShard(referrerChain.back());
+    std::string referrer;
+    {
+      std::lock_guard<std::mutex> lock(shard.mutex);
+      const std::string* currentReferrer =
+        shard.mapping.FindReferrer(referrerChain.back());
+      if (!currentReferrer)
+        break;
+      referrer = *currentReferrer;
+    }
+    referrerChain.push_back(std::move(referrer));
+  }
+  std::reverse(referrerChain.begin(), referrerChain.end());
+  return referrerChain;
+}
+
+ConcurrentReferrerMapping::Shard& ConcurrentReferrerMapping::GetShard(
+  const std::string& url) const
+{
+  // Mix the high bits in, the low ones also select the bucket inside of the
+  // shard's hash map.
+  size_t hash = std::hash<std::string>()(url);
+  hash ^= hash >> 16;
+  return *shards[hash % shards.size()];
+}
@@ -30,26 +30,33 @@ namespace
     const v8::FunctionCallbackInfo<v8::Value>& arguments)
   {
     AdblockPlus::JsEnginePtr jsEngine = AdblockPlus::JsEngine::FromArguments(arguments);
-    const AdblockPlus::JsContext context(*jsEngine);
-    AdblockPlus::JsValueList converted = jsEngine->ConvertArguments(arguments);
+    AdblockPlus::Platform& platform = jsEngine->GetPlatform();
+    if (!platform.IsLogLevelEnabled(logLevel))
+      return;
 
-    std::stringstream message;
-    for (size_t i = 0; i < converted.size(); i++)
+    const AdblockPlus::JsContext context(*jsEngine);
+    std::string message;
+    for (int i = 0; i < arguments.Length(); i++)
     {
       if (i > 0)
-        message << " ";
-      message << converted[i].AsString();
+        message += " ";
+      message += AdblockPlus::Utils::FromV8String(arguments[i]);
     }
 
-    std::stringstream source;
-    v8::Local<v8::StackFrame> frame = v8::StackTrace::CurrentStackTrace(arguments.GetIsolate(), 1)->GetFrame(0);
-    source << AdblockPlus::Utils::FromV8String(frame->GetScriptName());
-    source << ":" << frame->GetLineNumber();
+    // Capturing the stack is expensive, only do it for messages which are
+    // likely to be looked at.
+    std::string source;
+    if (logLevel >= AdblockPlus::LogSystem::LOG_LEVEL_WARN)
+    {
+      v8::Local<v8::StackFrame> frame = v8::StackTrace::CurrentStackTrace(arguments.GetIsolate(), 1)->GetFrame(0);
+      source = AdblockPlus::Utils::FromV8String(frame->GetScriptName());
+      source += ":" + std::to_string(frame->GetLineNumber());
+    }
 
-    jsEngine->GetPlatform().WithLogSystem(
+    platform.WithLogSystem(
       [logLevel, &message, &source](AdblockPlus::LogSystem& callback)
       {
-        callback(logLevel, message.str(), source.str());
+        callback(logLevel, message, source);
       });
   }
 
@@ -81,9 +88,10 @@ namespace
   void TraceCallback(const v8::FunctionCallbackInfo<v8::Value>& arguments)
   {
     AdblockPlus::JsEnginePtr jsEngine = AdblockPlus::JsEngine::FromArguments(arguments);
-    const AdblockPlus::JsContext context(*jsEngine);
-    AdblockPlus::JsValueList converted = jsEngine->ConvertArguments(arguments);
+    if (!jsEngine->GetPlatform().IsLogLevelEnabled(AdblockPlus::LogSystem::LOG_LEVEL_TRACE))
+      return;
 
+    const AdblockPlus::JsContext context(*jsEngine);
     std::stringstream traceback;
     v8::Local<v8::StackTrace> frames = v8::StackTrace::CurrentStackTrace(arguments.GetIsolate(), 100);
     for (int i = 0, l = frames->GetFrameCount(); i < l; i++)
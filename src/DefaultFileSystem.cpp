@@ -56,7 +56,6 @@ namespace
     return Utils::ToUtf16String(path);
   }
 
-  #define rename _wrename
   #define remove _wremove
 #else
   // POSIX systems: assume that file system encoding is UTF-8 and just use the
@@ -105,8 +104,19 @@ void DefaultFileSystemSync::Write(const std::string& path,
 void DefaultFileSystemSync::Move(const std::string& fromPath,
                                  const std::string& toPath)
 {
+#ifdef WIN32
+  // _wrename() fails if the target exists, callers rely on Move() replacing
+  // files atomically.
+  if (!MoveFileExW(NormalizePath(fromPath).c_str(), NormalizePath(toPath).c_str(),
+    MOVEFILE_REPLACE_EXISTING))
+  {
+    throw std::runtime_error("Failed to move " + fromPath + " to " + toPath +
+      " (error " + std::to_string(GetLastError()) + ")");
+  }
+#else
   if (rename(NormalizePath(fromPath).c_str(), NormalizePath(toPath).c_str()))
     throw RuntimeErrorWithErrno("Failed to move " + fromPath + " to " + toPath);
+#endif
 }
 
 void DefaultFileSystemSync::Remove(const std::string& path)
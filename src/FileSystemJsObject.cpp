@@ -59,6 +59,7 @@ namespace
             if (!jsEngine)
               return;
 
+            ABP_TRACE_SCOPE(jsEngine->GetPlatform().GetTracer(), "FileSystem", "read callback");
             const JsContext context(*jsEngine);
             auto result = jsEngine->NewObject();
             result.SetStringBufferProperty("content", std::move(content));
@@ -118,6 +119,7 @@ namespace
             if (!jsEngine)
               return;
 
+            ABP_TRACE_SCOPE(jsEngine->GetPlatform().GetTracer(), "FileSystem", "readFromFile callback");
             const JsContext context(*jsEngine);
 
             auto jsValues = jsEngine->TakeJsValues(weakCallback);
@@ -181,6 +183,7 @@ namespace
             if (!jsEngine)
               return;
 
+            ABP_TRACE_SCOPE(jsEngine->GetPlatform().GetTracer(), "FileSystem", "write callback");
             const JsContext context(*jsEngine);
             JsValueList params;
             if (!error.empty())
@@ -217,6 +220,7 @@ namespace
             if (!jsEngine)
               return;
 
+            ABP_TRACE_SCOPE(jsEngine->GetPlatform().GetTracer(), "FileSystem", "move callback");
             const JsContext context(*jsEngine);
             JsValueList params;
             if (!error.empty())
@@ -252,6 +256,7 @@ namespace
             if (!jsEngine)
               return;
 
+            ABP_TRACE_SCOPE(jsEngine->GetPlatform().GetTracer(), "FileSystem", "remove callback");
             const JsContext context(*jsEngine);
             JsValueList params;
             if (!error.empty())
@@ -288,6 +293,7 @@ namespace
              if (!jsEngine)
                return;
 
+             ABP_TRACE_SCOPE(jsEngine->GetPlatform().GetTracer(), "FileSystem", "stat callback");
              const JsContext context(*jsEngine);
              auto result = jsEngine->NewObject();
 
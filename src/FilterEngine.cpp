@@ -17,12 +17,19 @@
 
 #include <algorithm>
 #include <cctype>
+#include <chrono>
 #include <functional>
+#include <limits>
+#include <memory>
 #include <string>
 #include <cassert>
 #include <thread>
+#include <unordered_map>
+#include <unordered_set>
 
 #include <AdblockPlus.h>
+#include <AdblockPlus/Platform.h>
+#include "FilterHitStatistics.h"
 #include "JsContext.h"
 #include "Thread.h"
 #include <mutex>
@@ -32,6 +39,37 @@ using namespace AdblockPlus;
 
 extern std::string jsSources[];
 
+namespace
+{
+  const std::string filterHitStatsFileName = "filterhits.txt";
+
+  // Writes a temporary file and moves it over the target, so that the
+  // target is never left truncated, like prefs.js does for prefs.json.
+  void WriteFileReplacing(IFileSystem& fileSystem, const std::string& fileName,
+    const IFileSystem::IOBuffer& data, const IFileSystem::Callback& callback)
+  {
+    std::string tempFileName = fileName + ".tmp";
+    // The file system calls back itself, so it is still alive then.
+    IFileSystem* fileSystemPtr = &fileSystem;
+    fileSystem.Write(tempFileName, data,
+      [fileSystemPtr, tempFileName, fileName, callback](const std::string& error)
+      {
+        if (!error.empty())
+        {
+          if (callback)
+            callback(error);
+          return;
+        }
+        fileSystemPtr->Move(tempFileName, fileName,
+          [callback](const std::string& error)
+          {
+            if (callback)
+              callback(error);
+          });
+      });
+  }
+}
+
 Filter::Filter(JsValue&& value)
     : JsValue(std::move(value))
 {
@@ -182,15 +220,102 @@ bool Subscription::operator==(const Subscription& subscription) const
   return GetProperty("url").AsString() == subscription.GetProperty("url").AsString();
 }
 
+struct FilterEngine::NativePrefs
+{
+  struct Value
+  {
+    enum Type {TYPE_BOOL, TYPE_INT, TYPE_STRING};
+    Type type;
+    bool boolValue;
+    int64_t intValue;
+    std::string stringValue;
+  };
+  typedef std::map<std::string, Value> Values;
+
+  Values values;
+
+  void Set(const std::string& pref, const JsValue& jsValue)
+  {
+    Value value = {Value::TYPE_BOOL, false, 0, std::string()};
+    if (jsValue.IsBool())
+      value.boolValue = jsValue.AsBool();
+    else if (jsValue.IsNumber())
+    {
+      value.type = Value::TYPE_INT;
+      value.intValue = jsValue.AsInt();
+    }
+    else if (jsValue.IsString())
+    {
+      value.type = Value::TYPE_STRING;
+      value.stringValue = jsValue.AsString();
+    }
+    else
+    {
+      values.erase(pref);
+      return;
+    }
+    values[pref] = value;
+  }
+
+  const Value& Get(const std::string& pref, Value::Type type) const
+  {
+    Values::const_iterator it = values.find(pref);
+    if (it == values.end())
+      throw std::invalid_argument("Unknown preference: " + pref);
+    if (it->second.type != type)
+      throw std::invalid_argument("Preference has a different type: " + pref);
+    return it->second;
+  }
+};
+
+struct FilterEngine::ListedFilterIndex
+{
+  typedef std::unordered_map<std::string, Filter::Type> Types;
+
+  // Built from all listed filters, shared by the copies made on changes.
+  std::shared_ptr<const Types> base;
+  // Changes since base was built, copied on every change, so they are
+  // merged into base once they grow too large.
+  Types added;
+  std::unordered_set<std::string> removed;
+
+  bool Find(const std::string& text, Filter::Type* type) const
+  {
+    auto it = added.find(text);
+    if (it == added.end())
+    {
+      if (removed.count(text))
+        return false;
+      it = base->find(text);
+      if (it == base->end())
+        return false;
+    }
+    if (type)
+      *type = it->second;
+    return true;
+  }
+};
+
 FilterEngine::FilterEngine(const JsEnginePtr& jsEngine)
-  : jsEngine(jsEngine), firstRun(false), updateCheckId(0)
+  : jsEngine(jsEngine), firstRun(false), updateCheckId(0), prefsFlushId(0),
+    nativePrefs(std::make_shared<NativePrefs>()), filtersGeneration(0),
+    filterHitStatistics(std::make_shared<FilterHitStatistics>()),
+    filterHitStatsSaveDelay(0)
+{
+}
+
+FilterEngine::~FilterEngine()
 {
+  // Hits recorded within the save delay would be lost otherwise.
+  if (filterHitStatistics->HasUnsavedHits())
+    SaveFilterHitStats();
 }
 
 void FilterEngine::CreateAsync(const JsEnginePtr& jsEngine,
   const FilterEngine::OnCreatedCallback& onCreated,
   const FilterEngine::CreationParameters& params)
 {
+  Metrics::Clock::time_point createStart = Metrics::Clock::now();
   FilterEnginePtr filterEngine(new FilterEngine(jsEngine));
   {
     // TODO: replace weakFilterEngine by this when it's possible to control the
@@ -229,9 +354,68 @@ void FilterEngine::CreateAsync(const JsEnginePtr& jsEngine,
     });
   }
   
-  jsEngine->SetEventCallback("_init", [jsEngine, filterEngine, onCreated](JsValueList&& params)
+  {
+    std::weak_ptr<FilterEngine> weakFilterEngine = filterEngine;
+    jsEngine->SetEventCallback("_prefChange", [weakFilterEngine](JsValueList&& params)
+    {
+      auto filterEngine = weakFilterEngine.lock();
+      if (!filterEngine || params.size() < 2 || !params[0].IsString())
+        return;
+      filterEngine->UpdateNativePref(params[0].AsString(), params[1]);
+    });
+  }
+
+  {
+    std::weak_ptr<FilterEngine> weakFilterEngine = filterEngine;
+    jsEngine->SetEventCallback("_filtersChanged", [weakFilterEngine](JsValueList&& params)
+    {
+      if (auto filterEngine = weakFilterEngine.lock())
+        ++filterEngine->filtersGeneration;
+    });
+    // Both are triggered while JavaScript holds the V8 lock, which
+    // serializes them with rebuilding the index.
+    jsEngine->SetEventCallback("_listedFilterChanged", [weakFilterEngine](JsValueList&& params)
+    {
+      auto filterEngine = weakFilterEngine.lock();
+      if (!filterEngine || params.size() < 3)
+        return;
+      filterEngine->UpdateListedFilterIndex(params[0].AsString(),
+        params[1].AsString(), params[2].AsBool());
+    });
+    jsEngine->SetEventCallback("_listedFiltersReset", [weakFilterEngine](JsValueList&& params)
+    {
+      if (auto filterEngine = weakFilterEngine.lock())
+        std::atomic_store(&filterEngine->listedFilterIndex, ListedFilterIndexPtr());
+    });
+  }
+
+  {
+    filterEngine->filterHitStatsSaveDelay = params.filterHitStatsSaveDelay;
+    std::weak_ptr<JsEngine> weakJsEngine = jsEngine;
+    std::weak_ptr<FilterHitStatistics> weakStatistics = filterEngine->filterHitStatistics;
+    jsEngine->GetPlatform().WithFileSystem([weakJsEngine, weakStatistics](IFileSystem& fileSystem)
+    {
+      fileSystem.Read(filterHitStatsFileName,
+        [weakJsEngine, weakStatistics](IFileSystem::IOBuffer&& data, const std::string& error)
+        {
+          auto statistics = weakStatistics.lock();
+          if (!statistics)
+            return;
+          // The file doesn't exist before the first save.
+          if (!statistics->Load(error.empty() ? std::string(data.begin(), data.end()) : std::string()))
+            return;
+          if (auto jsEngine = weakJsEngine.lock())
+            SaveFilterHitStats(jsEngine, *statistics, IFileSystem::Callback());
+        });
+    });
+  }
+
+  jsEngine->SetEventCallback("_init", [jsEngine, filterEngine, onCreated, createStart](JsValueList&& params)
   {
     filterEngine->firstRun = params.size() && params[0].AsBool();
+    filterEngine->InitNativePrefs(jsEngine->Evaluate("API.getPrefs()"));
+    jsEngine->GetMetrics().Record(Metrics::OPERATION_CREATE_FILTER_ENGINE,
+      Metrics::Clock::now() - createStart);
     onCreated(filterEngine);
     jsEngine->RemoveEventCallback("_init");
   });
@@ -256,7 +440,10 @@ void FilterEngine::CreateAsync(const JsEnginePtr& jsEngine,
     preconfiguredPrefsObject.SetProperty(pref.first, pref.second);
   }
   jsEngine->SetGlobalProperty("_preconfiguredPrefs", preconfiguredPrefsObject);
+  jsEngine->SetGlobalProperty("_prefsSaveDelay",
+    jsEngine->NewValue(static_cast<int64_t>(params.prefsSaveDelay.count())));
   // Load adblockplus scripts
+  ABP_TRACE_SCOPE(jsEngine->GetPlatform().GetTracer(), "FilterEngine", "LoadScripts");
   for (int i = 0; !jsSources[i].empty(); i += 2)
     jsEngine->Evaluate(jsSources[i + 1], jsSources[i]);
 }
@@ -318,18 +505,21 @@ bool FilterEngine::IsFirstRun() const
 
 Filter FilterEngine::GetFilter(const std::string& text) const
 {
+  const Metrics::Timer timer(jsEngine->GetMetrics(), Metrics::OPERATION_GET_FILTER);
   JsValue func = jsEngine->Evaluate("API.getFilterFromText");
   return Filter(func.Call(jsEngine->NewValue(text)));
 }
 
 Subscription FilterEngine::GetSubscription(const std::string& url) const
 {
+  const Metrics::Timer timer(jsEngine->GetMetrics(), Metrics::OPERATION_GET_SUBSCRIPTION);
   JsValue func = jsEngine->Evaluate("API.getSubscriptionFromUrl");
   return Subscription(func.Call(jsEngine->NewValue(url)));
 }
 
 std::vector<Filter> FilterEngine::GetListedFilters() const
 {
+  const Metrics::Timer timer(jsEngine->GetMetrics(), Metrics::OPERATION_GET_LISTED_FILTERS);
   JsValue func = jsEngine->Evaluate("API.getListedFilters");
   JsValueList values = func.Call().AsList();
   std::vector<Filter> result;
@@ -338,8 +528,190 @@ std::vector<Filter> FilterEngine::GetListedFilters() const
   return result;
 }
 
+namespace
+{
+  // Filters can't contain line breaks, so a list of them is passed to
+  // JavaScript as a single string rather than one value per filter.
+  std::string JoinFilterTexts(const std::vector<std::string>& texts)
+  {
+    std::string result;
+    for (const auto& text : texts)
+    {
+      if (!result.empty())
+        result += '\n';
+      result += text;
+    }
+    return result;
+  }
+
+  Filter::Type FilterTypeFromString(const std::string& type)
+  {
+    if (type == "blocking")
+      return Filter::TYPE_BLOCKING;
+    else if (type == "exception")
+      return Filter::TYPE_EXCEPTION;
+    else if (type == "elemhide")
+      return Filter::TYPE_ELEMHIDE;
+    else if (type == "elemhideexception")
+      return Filter::TYPE_ELEMHIDE_EXCEPTION;
+    else if (type == "elemhideemulation")
+      return Filter::TYPE_ELEMHIDE_EMULATION;
+    else if (type == "comment")
+      return Filter::TYPE_COMMENT;
+    else
+      return Filter::TYPE_INVALID;
+  }
+
+  // Pages arrive as the total count followed by "type\ttext" lines.
+  FilterEngine::FilterTextPage ParseFilterTextPage(const std::string& page)
+  {
+    FilterEngine::FilterTextPage result;
+    size_t end = page.find('\n');
+    result.totalCount = std::stoul(page.substr(0, end));
+    while (end != std::string::npos)
+    {
+      size_t start = end + 1;
+      end = page.find('\n', start);
+      size_t separator = page.find('\t', start);
+      FilterEngine::FilterText filter;
+      filter.type = FilterTypeFromString(page.substr(start, separator - start));
+      filter.text = page.substr(separator + 1,
+        end == std::string::npos ? std::string::npos : end - separator - 1);
+      result.filters.push_back(std::move(filter));
+    }
+    return result;
+  }
+
+  int64_t ClampToInt32(size_t value)
+  {
+    return static_cast<int64_t>(std::min<size_t>(value, std::numeric_limits<int32_t>::max()));
+  }
+}
+
+bool FilterEngine::IsListedFilter(const std::string& text, Filter::Type* type) const
+{
+  if (text.empty())
+    return false;
+  if (text.find_first_of(" \t\n\r\f\v") != std::string::npos)
+  {
+    // Normalizing is involved, leave it to the filter classes.
+    Filter filter = GetFilter(text);
+    if (!filter.IsListed())
+      return false;
+    if (type)
+      *type = filter.GetType();
+    return true;
+  }
+
+  return GetListedFilterIndex()->Find(text, type);
+}
+
+FilterEngine::ListedFilterIndexPtr FilterEngine::GetListedFilterIndex() const
+{
+  ListedFilterIndexPtr index = std::atomic_load(&listedFilterIndex);
+  if (index)
+    return index;
+
+  // Holding the lock until the index is stored, so that no change is
+  // reported in between.
+  const JsContext context(*jsEngine);
+  index = std::atomic_load(&listedFilterIndex);
+  if (index)
+    return index;
+  FilterTextPage page;
+  {
+    const Metrics::Timer timer(jsEngine->GetMetrics(), Metrics::OPERATION_GET_LISTED_FILTERS);
+    JsValue func = jsEngine->Evaluate("API.getEnabledListedFilterTexts");
+    page = ParseFilterTextPage(func.Call().AsString());
+  }
+  std::shared_ptr<ListedFilterIndex::Types> types =
+    std::make_shared<ListedFilterIndex::Types>();
+  for (auto& filter : page.filters)
+    types->insert(std::make_pair(std::move(filter.text), filter.type));
+  std::shared_ptr<ListedFilterIndex> newIndex = std::make_shared<ListedFilterIndex>();
+  newIndex->base = types;
+  index = newIndex;
+  std::atomic_store(&listedFilterIndex, index);
+  return index;
+}
+
+void FilterEngine::UpdateListedFilterIndex(const std::string& text,
+  const std::string& type, bool listed)
+{
+  // Not built yet or reset, the next query rebuilds it anyway.
+  ListedFilterIndexPtr index = std::atomic_load(&listedFilterIndex);
+  if (!index)
+    return;
+
+  std::shared_ptr<ListedFilterIndex> newIndex = std::make_shared<ListedFilterIndex>(*index);
+  if (listed)
+  {
+    newIndex->removed.erase(text);
+    newIndex->added[text] = FilterTypeFromString(type);
+  }
+  else
+  {
+    newIndex->added.erase(text);
+    if (newIndex->base->count(text))
+      newIndex->removed.insert(text);
+  }
+
+  // The changes are copied on every change. Merging them once there are
+  // more than sqrt(base size) keeps the cost per change at O(sqrt(n)).
+  size_t changeCount = newIndex->added.size() + newIndex->removed.size();
+  if (changeCount * changeCount > std::max<size_t>(newIndex->base->size(), 4096))
+  {
+    std::shared_ptr<ListedFilterIndex::Types> types =
+      std::make_shared<ListedFilterIndex::Types>(*newIndex->base);
+    for (const auto& removedText : newIndex->removed)
+      types->erase(removedText);
+    for (const auto& addedFilter : newIndex->added)
+      (*types)[addedFilter.first] = addedFilter.second;
+    newIndex->base = types;
+    newIndex->added.clear();
+    newIndex->removed.clear();
+  }
+  std::atomic_store(&listedFilterIndex, ListedFilterIndexPtr(newIndex));
+}
+
+FilterEngine::FilterTextPage FilterEngine::GetListedFilterTexts(size_t offset,
+  size_t count) const
+{
+  const Metrics::Timer timer(jsEngine->GetMetrics(), Metrics::OPERATION_GET_LISTED_FILTERS);
+  JsValueList params;
+  params.push_back(jsEngine->NewValue(ClampToInt32(offset)));
+  params.push_back(jsEngine->NewValue(ClampToInt32(count)));
+  JsValue func = jsEngine->Evaluate("API.getListedFilterPage");
+  return ParseFilterTextPage(func.Call(params).AsString());
+}
+
+FilterEngine::FilterTextPage FilterEngine::GetSubscriptionFilterTexts(
+  const std::string& url, size_t offset, size_t count) const
+{
+  const Metrics::Timer timer(jsEngine->GetMetrics(), Metrics::OPERATION_GET_SUBSCRIPTION_FILTERS);
+  JsValueList params;
+  params.push_back(jsEngine->NewValue(url));
+  params.push_back(jsEngine->NewValue(ClampToInt32(offset)));
+  params.push_back(jsEngine->NewValue(ClampToInt32(count)));
+  JsValue func = jsEngine->Evaluate("API.getSubscriptionFilterPage");
+  return ParseFilterTextPage(func.Call(params).AsString());
+}
+
+void FilterEngine::AddFilters(const std::vector<std::string>& texts)
+{
+  JsValue func = jsEngine->Evaluate("API.addFilters");
+  func.Call(jsEngine->NewValue(JoinFilterTexts(texts)));
+}
+
+void FilterEngine::RemoveFilters(const std::vector<std::string>& texts)
+{
+  JsValue func = jsEngine->Evaluate("API.removeFilters");
+  func.Call(jsEngine->NewValue(JoinFilterTexts(texts)));
+}
+
 std::vector<Subscription> FilterEngine::GetListedSubscriptions() const
 {
+  const Metrics::Timer timer(jsEngine->GetMetrics(), Metrics::OPERATION_GET_LISTED_SUBSCRIPTIONS);
   JsValue func = jsEngine->Evaluate("API.getListedSubscriptions");
   JsValueList values = func.Call().AsList();
   std::vector<Subscription> result;
@@ -370,7 +742,7 @@ bool FilterEngine::IsAAEnabled() const
 
 std::string FilterEngine::GetAAUrl() const
 {
-  return GetPref("subscriptions_exceptionsurl").AsString();
+  return GetPrefString("subscriptions_exceptionsurl");
 }
 
 void FilterEngine::ShowNextNotification(const std::string& url) const
@@ -416,9 +788,67 @@ AdblockPlus::FilterPtr FilterEngine::Matches(const std::string& url,
     ContentTypeMask contentTypeMask,
     const std::vector<std::string>& documentUrls) const
 {
+  FilterPtr match = FindMatch(url, contentTypeMask, documentUrls);
+  RecordFilterHit(match);
+  return match;
+}
+
+AdblockPlus::FilterPtr FilterEngine::FindMatch(const std::string& url,
+    ContentTypeMask contentTypeMask,
+    const std::vector<std::string>& documentUrls) const
+{
+  ABP_TRACE_SCOPE(jsEngine->GetPlatform().GetTracer(), "FilterEngine", "Matches", url.c_str());
+  const Metrics::Timer timer(jsEngine->GetMetrics(), Metrics::OPERATION_MATCHES);
   if (documentUrls.empty())
     return CheckFilterMatch(url, contentTypeMask, "");
 
+  AdblockPlus::FilterPtr match = GetDocumentWhitelistingFilter(documentUrls);
+  if (match)
+    return match;
+
+  return CheckFilterMatch(url, contentTypeMask, documentUrls.back());
+}
+
+AdblockPlus::FilterPtr FilterEngine::Matches(const std::string& url,
+    ContentTypeMask contentTypeMask,
+    FrameTree::FrameId frameId) const
+{
+  ABP_TRACE_SCOPE(jsEngine->GetPlatform().GetTracer(), "FilterEngine", "Matches", url.c_str());
+  const Metrics::Timer timer(jsEngine->GetMetrics(), Metrics::OPERATION_MATCHES);
+  FrameTree::FramePtr frame = frameTree.GetFrame(frameId);
+  FilterPtr match;
+  if (!frame)
+  {
+    match = CheckFilterMatch(url, contentTypeMask, "");
+    RecordFilterHit(match);
+    return match;
+  }
+
+  // Read the generation before matching, so that a result computed while
+  // the filters change is not considered valid afterwards.
+  uint32_t generation = filtersGeneration;
+  std::shared_ptr<const Filter> whitelistingFilter;
+  if (!frameTree.GetCachedWhitelistingFilter(*frame, generation, whitelistingFilter))
+  {
+    whitelistingFilter = GetDocumentWhitelistingFilter(FrameTree::GetDocumentUrls(*frame));
+    frameTree.SetCachedWhitelistingFilter(*frame, generation, whitelistingFilter);
+  }
+  if (whitelistingFilter)
+    match.reset(new Filter(*whitelistingFilter));
+  else
+  {
+    const FrameTree::Frame* topFrame = frame.get();
+    while (topFrame->parent)
+      topFrame = topFrame->parent.get();
+    match = CheckFilterMatch(url, contentTypeMask, topFrame->url);
+  }
+  RecordFilterHit(match);
+  return match;
+}
+
+AdblockPlus::FilterPtr FilterEngine::GetDocumentWhitelistingFilter(
+    const std::vector<std::string>& documentUrls) const
+{
   std::string lastDocumentUrl = documentUrls.front();
   for (const auto& documentUrl : documentUrls) {
     AdblockPlus::FilterPtr match = CheckFilterMatch(documentUrl,
@@ -428,20 +858,25 @@ AdblockPlus::FilterPtr FilterEngine::Matches(const std::string& url,
       return match;
     lastDocumentUrl = documentUrl;
   }
-
-  return CheckFilterMatch(url, contentTypeMask, lastDocumentUrl);
+  return FilterPtr();
 }
 
 bool FilterEngine::IsDocumentWhitelisted(const std::string& url,
     const std::vector<std::string>& documentUrls) const
 {
-    return !!GetWhitelistingFilter(url, CONTENT_TYPE_DOCUMENT, documentUrls);
+    const Metrics::Timer timer(jsEngine->GetMetrics(), Metrics::OPERATION_IS_DOCUMENT_WHITELISTED);
+    FilterPtr filter = GetWhitelistingFilter(url, CONTENT_TYPE_DOCUMENT, documentUrls);
+    RecordFilterHit(filter);
+    return !!filter;
 }
 
 bool FilterEngine::IsElemhideWhitelisted(const std::string& url,
     const std::vector<std::string>& documentUrls) const
 {
-    return !!GetWhitelistingFilter(url, CONTENT_TYPE_ELEMHIDE, documentUrls);
+    const Metrics::Timer timer(jsEngine->GetMetrics(), Metrics::OPERATION_IS_ELEMHIDE_WHITELISTED);
+    FilterPtr filter = GetWhitelistingFilter(url, CONTENT_TYPE_ELEMHIDE, documentUrls);
+    RecordFilterHit(filter);
+    return !!filter;
 }
 
 AdblockPlus::FilterPtr FilterEngine::CheckFilterMatch(const std::string& url,
@@ -462,6 +897,7 @@ AdblockPlus::FilterPtr FilterEngine::CheckFilterMatch(const std::string& url,
 
 std::vector<std::string> FilterEngine::GetElementHidingSelectors(const std::string& domain) const
 {
+  const Metrics::Timer timer(jsEngine->GetMetrics(), Metrics::OPERATION_GET_ELEMENT_HIDING_SELECTORS);
   JsValue func = jsEngine->Evaluate("API.getElementHidingSelectors");
   JsValueList result = func.Call(jsEngine->NewValue(domain)).AsList();
   std::vector<std::string> selectors;
@@ -472,12 +908,29 @@ std::vector<std::string> FilterEngine::GetElementHidingSelectors(const std::stri
 
 JsValue FilterEngine::GetPref(const std::string& pref) const
 {
+  const Metrics::Timer timer(jsEngine->GetMetrics(), Metrics::OPERATION_GET_PREF);
   JsValue func = jsEngine->Evaluate("API.getPref");
   return func.Call(jsEngine->NewValue(pref));
 }
 
+bool FilterEngine::GetPrefBool(const std::string& pref) const
+{
+  return GetNativePrefs()->Get(pref, NativePrefs::Value::TYPE_BOOL).boolValue;
+}
+
+std::string FilterEngine::GetPrefString(const std::string& pref) const
+{
+  return GetNativePrefs()->Get(pref, NativePrefs::Value::TYPE_STRING).stringValue;
+}
+
+int64_t FilterEngine::GetPrefInt(const std::string& pref) const
+{
+  return GetNativePrefs()->Get(pref, NativePrefs::Value::TYPE_INT).intValue;
+}
+
 void FilterEngine::SetPref(const std::string& pref, const JsValue& value)
 {
+  const Metrics::Timer timer(jsEngine->GetMetrics(), Metrics::OPERATION_SET_PREF);
   JsValue func = jsEngine->Evaluate("API.setPref");
   JsValueList params;
   params.push_back(jsEngine->NewValue(pref));
@@ -485,6 +938,135 @@ void FilterEngine::SetPref(const std::string& pref, const JsValue& value)
   func.Call(params);
 }
 
+void FilterEngine::SetPrefs(const Prefs& prefs)
+{
+  const Metrics::Timer timer(jsEngine->GetMetrics(), Metrics::OPERATION_SET_PREF);
+  JsValue prefsObject = jsEngine->NewObject();
+  for (const auto& pref : prefs)
+    prefsObject.SetProperty(pref.first, pref.second);
+  JsValue func = jsEngine->Evaluate("API.setPrefs");
+  func.Call(prefsObject);
+}
+
+std::vector<LatencyHistogram> FilterEngine::GetMetrics() const
+{
+  return jsEngine->GetMetrics().GetHistograms();
+}
+
+void FilterEngine::WriteMetrics(const std::string& fileName,
+  const IFileSystem::Callback& callback) const
+{
+  std::string text = Metrics::ToPrometheusText(GetMetrics());
+  jsEngine->GetPlatform().WithFileSystem(
+    [&fileName, &text, &callback](IFileSystem& fileSystem)
+    {
+      fileSystem.Write(fileName, IFileSystem::IOBuffer(text.begin(), text.end()),
+        [callback](const std::string& error)
+        {
+          if (callback)
+            callback(error);
+        });
+    });
+}
+
+std::vector<FilterEngine::FilterHitStats> FilterEngine::GetFilterHitStats(size_t topN) const
+{
+  return filterHitStatistics->GetTop(topN);
+}
+
+void FilterEngine::SaveFilterHitStats(const IFileSystem::Callback& callback)
+{
+  SaveFilterHitStats(jsEngine, *filterHitStatistics, callback);
+}
+
+void FilterEngine::SaveFilterHitStats(const JsEnginePtr& jsEngine,
+  FilterHitStatistics& statistics, const IFileSystem::Callback& callback)
+{
+  std::string text;
+  if (!statistics.Serialize(text))
+  {
+    // Saved once the statistics of the previous session are loaded.
+    if (callback)
+      callback("Filter hit statistics aren't loaded yet");
+    return;
+  }
+  jsEngine->GetPlatform().WithFileSystem(
+    [&text, &callback](IFileSystem& fileSystem)
+    {
+      WriteFileReplacing(fileSystem, filterHitStatsFileName,
+        IFileSystem::IOBuffer(text.begin(), text.end()), callback);
+    });
+}
+
+void FilterEngine::WriteFilterIndex(const std::string& fileName,
+  const IFileSystem::Callback& callback) const
+{
+  FilterIndexBuilder builder;
+  builder.AddDefaultPublicSuffixes();
+  // The filters arrive as one text per line.
+  std::string lines = jsEngine->Evaluate("API.getActiveFilterTexts").Call().AsString();
+  size_t start = 0;
+  while (start < lines.size())
+  {
+    size_t end = lines.find('\n', start);
+    if (end == std::string::npos)
+      end = lines.size();
+    builder.AddFilter(lines.substr(start, end - start));
+    start = end + 1;
+  }
+
+  IFileSystem::IOBuffer index = builder.Build();
+  jsEngine->GetPlatform().WithFileSystem(
+    [&fileName, &index, &callback](IFileSystem& fileSystem)
+    {
+      // Writing in place would change the mapped pages of opened indexes.
+      WriteFileReplacing(fileSystem, fileName, index, callback);
+    });
+}
+
+void FilterEngine::RecordFilterHit(const FilterPtr& filter) const
+{
+  if (!filter)
+    return;
+
+  // Only reads the filter text, the JavaScript filter objects aren't touched.
+  int64_t now = std::chrono::duration_cast<std::chrono::milliseconds>(
+    std::chrono::system_clock::now().time_since_epoch()).count();
+  if (!filterHitStatistics->RecordHit(filter->GetProperty("text").AsString(), now))
+    return;
+
+  std::weak_ptr<JsEngine> weakJsEngine = jsEngine;
+  std::weak_ptr<FilterHitStatistics> weakStatistics = filterHitStatistics;
+  std::chrono::milliseconds delay = filterHitStatsSaveDelay;
+  jsEngine->GetPlatform().WithTimer([weakJsEngine, weakStatistics, delay](ITimer& timer)
+  {
+    timer.SetTimer(delay, [weakJsEngine, weakStatistics]
+    {
+      auto jsEngine = weakJsEngine.lock();
+      auto statistics = weakStatistics.lock();
+      if (jsEngine && statistics)
+        SaveFilterHitStats(jsEngine, *statistics, IFileSystem::Callback());
+    });
+  });
+}
+
+void FilterEngine::FlushPrefs(const FilterEngine::PrefsFlushedCallback& callback)
+{
+  JsValue func = jsEngine->Evaluate("API.flushPrefs");
+  JsValueList params;
+  if (callback)
+  {
+    std::string eventName = "_prefsFlushed" + std::to_string(++prefsFlushId);
+    jsEngine->SetEventCallback(eventName, [this, eventName, callback](JsValueList&& params)
+    {
+      callback();
+      jsEngine->RemoveEventCallback(eventName);
+    });
+    params.push_back(jsEngine->NewValue(eventName));
+  }
+  func.Call(params);
+}
+
 std::string FilterEngine::GetHostFromURL(const std::string& url) const
 {
   JsValue func = jsEngine->Evaluate("API.getHostFromUrl");
@@ -538,6 +1120,22 @@ void FilterEngine::RemoveFilterChangeCallback()
   jsEngine->RemoveEventCallback("filterChange");
 }
 
+void FilterEngine::SetFilterChangesCallback(const FilterChangesCallback& callback,
+  const Scheduler& scheduler)
+{
+  jsEngine->SetEventCallback("filterChanges", [this, callback, scheduler](JsValueList&& params)
+  {
+    this->FilterChangesReported(callback, scheduler, move(params));
+  });
+  jsEngine->Evaluate("API.setFilterChangesBatched").Call(jsEngine->NewValue(true));
+}
+
+void FilterEngine::RemoveFilterChangesCallback()
+{
+  jsEngine->Evaluate("API.setFilterChangesBatched").Call(jsEngine->NewValue(false));
+  jsEngine->RemoveEventCallback("filterChanges");
+}
+
 void FilterEngine::SetAllowedConnectionType(const std::string* value)
 {
   SetPref("allowed_connection_type", value ? jsEngine->NewValue(*value) : jsEngine->NewValue(""));
@@ -545,10 +1143,32 @@ void FilterEngine::SetAllowedConnectionType(const std::string* value)
 
 std::unique_ptr<std::string> FilterEngine::GetAllowedConnectionType() const
 {
-   auto prefValue = GetPref("allowed_connection_type");
-   if (prefValue.AsString().empty())
+   auto prefValue = GetPrefString("allowed_connection_type");
+   if (prefValue.empty())
      return nullptr;
-   return std::unique_ptr<std::string>(new std::string(prefValue.AsString()));
+   return std::unique_ptr<std::string>(new std::string(prefValue));
+}
+
+void FilterEngine::InitNativePrefs(const JsValue& prefs)
+{
+  std::shared_ptr<NativePrefs> newPrefs = std::make_shared<NativePrefs>();
+  for (const auto& pref : prefs.GetOwnPropertyNames())
+    newPrefs->Set(pref, prefs.GetProperty(pref));
+  std::atomic_store(&nativePrefs, NativePrefsPtr(newPrefs));
+}
+
+void FilterEngine::UpdateNativePref(const std::string& pref, const JsValue& value)
+{
+  // Called only from JavaScript, i.e. while the JsEngine is locked, so there
+  // are no concurrent writers.
+  std::shared_ptr<NativePrefs> newPrefs = std::make_shared<NativePrefs>(*GetNativePrefs());
+  newPrefs->Set(pref, value);
+  std::atomic_store(&nativePrefs, NativePrefsPtr(newPrefs));
+}
+
+FilterEngine::NativePrefsPtr FilterEngine::GetNativePrefs() const
+{
+  return std::atomic_load(&nativePrefs);
 }
 
 void FilterEngine::FilterChanged(const FilterEngine::FilterChangeCallback& callback, JsValueList&& params) const
@@ -558,6 +1178,53 @@ void FilterEngine::FilterChanged(const FilterEngine::FilterChangeCallback& callb
   callback(action, std::move(item));
 }
 
+void FilterEngine::FilterChangesReported(const FilterChangesCallback& callback,
+  const Scheduler& scheduler, JsValueList&& params) const
+{
+  // The changes arrive as "action\titem" lines.
+  std::vector<FilterChange> changes;
+  std::string lines = params.size() >= 1 ? params[0].AsString() : "";
+  size_t start = 0;
+  while (start < lines.size())
+  {
+    size_t end = lines.find('\n', start);
+    if (end == std::string::npos)
+      end = lines.size();
+    size_t separator = lines.find('\t', start);
+    FilterChange change;
+    if (separator < end)
+    {
+      change.action = lines.substr(start, separator - start);
+      change.item = lines.substr(separator + 1, end - separator - 1);
+    }
+    else
+      change.action = lines.substr(start, end - start);
+    changes.push_back(std::move(change));
+    start = end + 1;
+  }
+
+  // Replaces the handling of "save" by the per change callback set in
+  // CreateAsync().
+  for (const auto& change : changes)
+  {
+    if (change.action == "save")
+    {
+      jsEngine->NotifyLowMemory();
+      break;
+    }
+  }
+
+  if (scheduler)
+  {
+    scheduler([callback, changes]() mutable
+    {
+      callback(std::move(changes));
+    });
+  }
+  else
+    callback(std::move(changes));
+}
+
 int FilterEngine::CompareVersions(const std::string& v1, const std::string& v2) const
 {
   JsValueList params;
@@ -570,7 +1237,8 @@ int FilterEngine::CompareVersions(const std::string& v1, const std::string& v2)
 FilterPtr FilterEngine::GetWhitelistingFilter(const std::string& url,
   ContentTypeMask contentTypeMask, const std::string& documentUrl) const
 {
-  FilterPtr match = Matches(url, contentTypeMask, documentUrl);
+  FilterPtr match = FindMatch(url, contentTypeMask,
+    std::vector<std::string>(1, documentUrl));
   if (match && match->GetType() == Filter::TYPE_EXCEPTION)
   {
     return match;
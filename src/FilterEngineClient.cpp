@@ -0,0 +1,353 @@
+/*
+ * This file is part of Adblock Plus <https://adblockplus.org/>,
+ * Copyright (C) 2006-present eyeo GmbH
+ *
+ * Adblock Plus is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 3 as
+ * published by the Free Software Foundation.
+ *
+ * Adblock Plus is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Adblock Plus.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <cerrno>
+#include <future>
+#include <stdexcept>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <AdblockPlus/FilterEngineClient.h>
+
+#include "ServiceProtocol.h"
+
+using namespace AdblockPlus;
+
+namespace
+{
+  const std::string connectionClosedError = "Connection to the filter engine service closed";
+
+  std::string WriteQueries(const std::vector<FilterEngineClient::Query>& queries)
+  {
+    std::string payload;
+    ServiceProtocol::Writer writer(payload);
+    writer.WriteUint32(static_cast<uint32_t>(queries.size()));
+    for (const auto& query : queries)
+    {
+      writer.WriteUint32(static_cast<uint32_t>(query.contentTypeMask));
+      writer.WriteString(query.url);
+      writer.WriteStrings(query.documentUrls);
+    }
+    return payload;
+  }
+
+  void ReadCount(ServiceProtocol::Reader& reader, size_t expectedCount)
+  {
+    if (reader.ReadUint32() != expectedCount)
+      throw std::runtime_error("Unexpected number of results");
+  }
+
+  // Creates a callback passing the results or the error to a promise.
+  template<class Results>
+  std::function<void(Results&&, const std::string&)> Fulfill(std::promise<Results>& promise)
+  {
+    return [&promise](Results&& results, const std::string& error)
+    {
+      if (error.empty())
+        promise.set_value(std::move(results));
+      else
+        promise.set_exception(std::make_exception_ptr(std::runtime_error(error)));
+    };
+  }
+
+  std::vector<FilterEngineClient::Query> MakeQueries(const std::string& url,
+    ContentTypes::ContentTypeMask contentTypeMask,
+    const std::vector<std::string>& documentUrls)
+  {
+    std::vector<FilterEngineClient::Query> queries(1);
+    queries[0].url = url;
+    queries[0].contentTypeMask = contentTypeMask;
+    queries[0].documentUrls = documentUrls;
+    return queries;
+  }
+}
+
+FilterEngineClientPtr FilterEngineClient::Connect(const std::string& socketPath)
+{
+  return FilterEngineClientPtr(new FilterEngineClient(ServiceProtocol::Connect(socketPath)));
+}
+
+FilterEngineClient::FilterEngineClient(int socket)
+  : socket(socket), nextRequestId(0)
+{
+  receiveThread = std::thread([this] { Receive(); });
+}
+
+FilterEngineClient::~FilterEngineClient()
+{
+  Close(connectionClosedError);
+  receiveThread.join();
+  close(socket);
+}
+
+bool FilterEngineClient::Matches(const std::string& url,
+  ContentTypes::ContentTypeMask contentTypeMask,
+  const std::vector<std::string>& documentUrls,
+  FilterText* filter)
+{
+  std::promise<std::vector<MatchResult>> promise;
+  MatchesAsync(MakeQueries(url, contentTypeMask, documentUrls), Fulfill(promise));
+  MatchResult result = promise.get_future().get()[0];
+  if (result.matched && filter)
+    *filter = result.filter;
+  return result.matched;
+}
+
+bool FilterEngineClient::IsDocumentWhitelisted(const std::string& url,
+  const std::vector<std::string>& documentUrls)
+{
+  std::promise<std::vector<bool>> promise;
+  IsDocumentWhitelistedAsync(MakeQueries(url, 0, documentUrls), Fulfill(promise));
+  return promise.get_future().get()[0];
+}
+
+bool FilterEngineClient::IsElemhideWhitelisted(const std::string& url,
+  const std::vector<std::string>& documentUrls)
+{
+  std::promise<std::vector<bool>> promise;
+  IsElemhideWhitelistedAsync(MakeQueries(url, 0, documentUrls), Fulfill(promise));
+  return promise.get_future().get()[0];
+}
+
+std::vector<std::string> FilterEngineClient::GetElementHidingSelectors(const std::string& domain)
+{
+  std::promise<std::vector<std::vector<std::string>>> promise;
+  GetElementHidingSelectorsAsync(std::vector<std::string>(1, domain), Fulfill(promise));
+  return std::move(promise.get_future().get()[0]);
+}
+
+void FilterEngineClient::MatchesAsync(const std::vector<Query>& queries,
+  const MatchesCallback& callback)
+{
+  size_t count = queries.size();
+  Send(ServiceProtocol::OPCODE_MATCHES, WriteQueries(queries),
+    [callback, count](const char* data, size_t size, const std::string& error)
+    {
+      std::vector<MatchResult> results;
+      if (!error.empty())
+      {
+        callback(std::move(results), error);
+        return;
+      }
+      try
+      {
+        ServiceProtocol::Reader reader(data, size);
+        ReadCount(reader, count);
+        results.resize(count);
+        for (auto& result : results)
+        {
+          uint8_t type = reader.ReadUint8();
+          if (type == ServiceProtocol::NO_FILTER)
+            continue;
+          result.matched = true;
+          result.filter.type = static_cast<FilterTypes::Type>(type);
+          result.filter.text = reader.ReadString();
+        }
+      }
+      catch (const std::runtime_error& e)
+      {
+        callback(std::vector<MatchResult>(), e.what());
+        return;
+      }
+      callback(std::move(results), "");
+    });
+}
+
+void FilterEngineClient::IsDocumentWhitelistedAsync(const std::vector<Query>& queries,
+  const WhitelistCallback& callback)
+{
+  IsWhitelistedAsync(ServiceProtocol::OPCODE_IS_DOCUMENT_WHITELISTED, queries, callback);
+}
+
+void FilterEngineClient::IsElemhideWhitelistedAsync(const std::vector<Query>& queries,
+  const WhitelistCallback& callback)
+{
+  IsWhitelistedAsync(ServiceProtocol::OPCODE_IS_ELEMHIDE_WHITELISTED, queries, callback);
+}
+
+void FilterEngineClient::IsWhitelistedAsync(uint8_t opcode,
+  const std::vector<Query>& queries, const WhitelistCallback& callback)
+{
+  size_t count = queries.size();
+  Send(opcode, WriteQueries(queries),
+    [callback, count](const char* data, size_t size, const std::string& error)
+    {
+      std::vector<bool> results;
+      if (!error.empty())
+      {
+        callback(std::move(results), error);
+        return;
+      }
+      try
+      {
+        ServiceProtocol::Reader reader(data, size);
+        ReadCount(reader, count);
+        for (size_t i = 0; i < count; i++)
+          results.push_back(reader.ReadUint8() != 0);
+      }
+      catch (const std::runtime_error& e)
+      {
+        callback(std::vector<bool>(), e.what());
+        return;
+      }
+      callback(std::move(results), "");
+    });
+}
+
+void FilterEngineClient::GetElementHidingSelectorsAsync(
+  const std::vector<std::string>& domains, const SelectorsCallback& callback)
+{
+  std::string payload;
+  ServiceProtocol::Writer(payload).WriteStrings(domains);
+  size_t count = domains.size();
+  Send(ServiceProtocol::OPCODE_GET_ELEMENT_HIDING_SELECTORS, payload,
+    [callback, count](const char* data, size_t size, const std::string& error)
+    {
+      std::vector<std::vector<std::string>> results;
+      if (!error.empty())
+      {
+        callback(std::move(results), error);
+        return;
+      }
+      try
+      {
+        ServiceProtocol::Reader reader(data, size);
+        ReadCount(reader, count);
+        for (size_t i = 0; i < count; i++)
+          results.push_back(reader.ReadStrings());
+      }
+      catch (const std::runtime_error& e)
+      {
+        callback(std::vector<std::vector<std::string>>(), e.what());
+        return;
+      }
+      callback(std::move(results), "");
+    });
+}
+
+void FilterEngineClient::Send(uint8_t opcode, const std::string& payload,
+  const ResponseHandler& handler)
+{
+  if (payload.size() > ServiceProtocol::maxMessageSize - sizeof(uint32_t) - sizeof(uint8_t))
+  {
+    handler(nullptr, 0, "Request exceeds the maximal message size");
+    return;
+  }
+
+  uint32_t requestId;
+  std::string error;
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    error = closedError;
+    if (error.empty())
+    {
+      requestId = nextRequestId++;
+      pendingRequests[requestId] = handler;
+    }
+  }
+  if (!error.empty())
+  {
+    handler(nullptr, 0, error);
+    return;
+  }
+
+  std::string message;
+  ServiceProtocol::Writer writer(message);
+  writer.BeginMessage(requestId, opcode);
+  message += payload;
+  writer.EndMessage();
+  bool sent;
+  {
+    std::lock_guard<std::mutex> lock(sendMutex);
+    sent = ServiceProtocol::SendAll(socket, message);
+  }
+  if (!sent)
+    Close(connectionClosedError);
+}
+
+void FilterEngineClient::Receive()
+{
+  std::string received;
+  char chunk[64 * 1024];
+  std::string error = connectionClosedError;
+  while (true)
+  {
+    ssize_t length = recv(socket, chunk, sizeof(chunk), 0);
+    if (length < 0 && errno == EINTR)
+      continue;
+    if (length <= 0)
+      break;
+    received.append(chunk, length);
+
+    size_t offset = 0;
+    bool valid = true;
+    while (true)
+    {
+      uint32_t requestId;
+      uint8_t status;
+      ServiceProtocol::Reader payload;
+      std::string message;
+      try
+      {
+        if (!ServiceProtocol::NextMessage(received, offset, requestId, status, payload))
+          break;
+        if (status != ServiceProtocol::STATUS_OK)
+          message = payload.ReadString();
+      }
+      catch (const std::runtime_error& e)
+      {
+        error = std::string("Invalid response: ") + e.what();
+        valid = false;
+        break;
+      }
+
+      ResponseHandler handler;
+      {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto it = pendingRequests.find(requestId);
+        if (it == pendingRequests.end())
+          continue;
+        handler = std::move(it->second);
+        pendingRequests.erase(it);
+      }
+      if (status == ServiceProtocol::STATUS_OK)
+        handler(payload.GetData(), payload.GetSize(), "");
+      else
+        handler(nullptr, 0, message.empty() ? "Request failed" : message);
+    }
+    if (!valid)
+      break;
+    received.erase(0, offset);
+  }
+  Close(error);
+}
+
+void FilterEngineClient::Close(const std::string& error)
+{
+  std::unordered_map<uint32_t, ResponseHandler> failedRequests;
+  std::string closeError;
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (closedError.empty())
+      closedError = error;
+    closeError = closedError;
+    failedRequests.swap(pendingRequests);
+  }
+  // Makes the receiving thread return.
+  shutdown(socket, SHUT_RDWR);
+  for (const auto& request : failedRequests)
+    request.second(nullptr, 0, closeError);
+}
@@ -0,0 +1,222 @@
+/*
+ * This file is part of Adblock Plus <https://adblockplus.org/>,
+ * Copyright (C) 2006-present eyeo GmbH
+ *
+ * Adblock Plus is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 3 as
+ * published by the Free Software Foundation.
+ *
+ * Adblock Plus is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Adblock Plus.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <poll.h>
+#include <stdexcept>
+#include <system_error>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <AdblockPlus/FilterEngineService.h>
+
+#include "ServiceProtocol.h"
+
+using namespace AdblockPlus;
+
+namespace
+{
+  void HandleRequest(FilterEngine& filterEngine, uint32_t requestId,
+    uint8_t opcode, ServiceProtocol::Reader& payload, std::string& responses)
+  {
+    ServiceProtocol::Writer response(responses);
+    response.BeginMessage(requestId, ServiceProtocol::STATUS_OK);
+    try
+    {
+      switch (opcode)
+      {
+        case ServiceProtocol::OPCODE_MATCHES:
+        case ServiceProtocol::OPCODE_IS_DOCUMENT_WHITELISTED:
+        case ServiceProtocol::OPCODE_IS_ELEMHIDE_WHITELISTED:
+        {
+          uint32_t count = payload.ReadUint32();
+          response.WriteUint32(count);
+          for (uint32_t i = 0; i < count; i++)
+          {
+            FilterEngine::ContentTypeMask contentTypeMask = payload.ReadUint32();
+            std::string url = payload.ReadString();
+            std::vector<std::string> documentUrls = payload.ReadStrings();
+            if (opcode == ServiceProtocol::OPCODE_MATCHES)
+            {
+              FilterPtr filter = filterEngine.Matches(url, contentTypeMask, documentUrls);
+              if (filter)
+              {
+                response.WriteUint8(static_cast<uint8_t>(filter->GetType()));
+                response.WriteString(filter->GetProperty("text").AsString());
+              }
+              else
+                response.WriteUint8(ServiceProtocol::NO_FILTER);
+            }
+            else if (opcode == ServiceProtocol::OPCODE_IS_DOCUMENT_WHITELISTED)
+              response.WriteUint8(filterEngine.IsDocumentWhitelisted(url, documentUrls));
+            else
+              response.WriteUint8(filterEngine.IsElemhideWhitelisted(url, documentUrls));
+          }
+          break;
+        }
+        case ServiceProtocol::OPCODE_GET_ELEMENT_HIDING_SELECTORS:
+        {
+          std::vector<std::string> domains = payload.ReadStrings();
+          response.WriteUint32(static_cast<uint32_t>(domains.size()));
+          for (const auto& domain : domains)
+            response.WriteStrings(filterEngine.GetElementHidingSelectors(domain));
+          break;
+        }
+        default:
+          throw std::runtime_error("Unknown opcode " + std::to_string(opcode));
+      }
+      if (!payload.AtEnd())
+        throw std::runtime_error("Unexpected data at the end of the request");
+      // The client would drop the connection on reading it.
+      if (response.GetMessageLength() > ServiceProtocol::maxMessageSize)
+        throw std::runtime_error("Response exceeds the maximum message size");
+    }
+    catch (const std::exception& e)
+    {
+      response.AbortMessage();
+      response.BeginMessage(requestId, ServiceProtocol::STATUS_ERROR);
+      response.WriteString(e.what());
+    }
+    response.EndMessage();
+  }
+}
+
+FilterEngineService::FilterEngineService(FilterEngine& filterEngine,
+  const std::string& socketPath)
+  : filterEngine(filterEngine), socketPath(socketPath), connectionCount(0)
+{
+  listenSocket = ServiceProtocol::Listen(socketPath);
+  if (pipe(stopPipe) != 0)
+  {
+    close(listenSocket);
+    unlink(socketPath.c_str());
+    throw std::runtime_error(std::string("Unable to create pipe: ") + std::strerror(errno));
+  }
+  acceptThread = std::thread([this] { Accept(); });
+}
+
+FilterEngineService::~FilterEngineService()
+{
+  // The pipe stays readable, so that every thread polling it returns.
+  char stop = 0;
+  while (write(stopPipe[1], &stop, 1) < 0 && errno == EINTR)
+    ;
+  acceptThread.join();
+  {
+    std::unique_lock<std::mutex> lock(mutex);
+    connectionsClosed.wait(lock, [this] { return connectionCount == 0; });
+  }
+  close(listenSocket);
+  close(stopPipe[0]);
+  close(stopPipe[1]);
+  unlink(socketPath.c_str());
+}
+
+void FilterEngineService::Accept()
+{
+  while (true)
+  {
+    pollfd fds[] = {{listenSocket, POLLIN, 0}, {stopPipe[0], POLLIN, 0}};
+    if (poll(fds, 2, -1) < 0)
+    {
+      if (errno == EINTR)
+        continue;
+      return;
+    }
+    if (fds[1].revents)
+      return;
+    int socket = accept(listenSocket, nullptr, nullptr);
+    if (socket < 0)
+      continue;
+#ifdef SO_NOSIGPIPE
+    int enabled = 1;
+    setsockopt(socket, SOL_SOCKET, SO_NOSIGPIPE, &enabled, sizeof(enabled));
+#endif
+    // Sending polls the stop pipe too, so that clients which don't read
+    // their responses can't block the destructor.
+    fcntl(socket, F_SETFL, fcntl(socket, F_GETFL) | O_NONBLOCK);
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      connectionCount++;
+    }
+    // Detached, the destructor waits for connectionCount to drop to zero.
+    try
+    {
+      std::thread([this, socket] { Serve(socket); }).detach();
+    }
+    catch (const std::system_error&)
+    {
+      close(socket);
+      std::lock_guard<std::mutex> lock(mutex);
+      connectionCount--;
+    }
+  }
+}
+
+void FilterEngineService::Serve(int socket)
+{
+  std::string received;
+  std::string responses;
+  char chunk[64 * 1024];
+  while (true)
+  {
+    pollfd fds[] = {{socket, POLLIN, 0}, {stopPipe[0], POLLIN, 0}};
+    if (poll(fds, 2, -1) < 0)
+    {
+      if (errno == EINTR)
+        continue;
+      break;
+    }
+    if (fds[1].revents)
+      break;
+    ssize_t length = recv(socket, chunk, sizeof(chunk), 0);
+    if (length < 0 && (errno == EINTR || errno == EAGAIN || errno == EWOULDBLOCK))
+      continue;
+    if (length <= 0)
+      break;
+    received.append(chunk, length);
+
+    // Answers all requests received completely, so that pipelined requests
+    // are answered with a single write.
+    size_t offset = 0;
+    uint32_t requestId;
+    uint8_t opcode;
+    ServiceProtocol::Reader payload;
+    try
+    {
+      while (ServiceProtocol::NextMessage(received, offset, requestId, opcode, payload))
+        HandleRequest(filterEngine, requestId, opcode, payload, responses);
+    }
+    catch (const std::runtime_error&)
+    {
+      // Invalid message length, the stream can't be resynchronized.
+      break;
+    }
+    received.erase(0, offset);
+    if (!responses.empty() && !ServiceProtocol::SendAll(socket, responses, stopPipe[0]))
+      break;
+    responses.clear();
+  }
+  close(socket);
+
+  // Notifies while holding the lock, the service may be destroyed as soon as
+  // it is released.
+  std::lock_guard<std::mutex> lock(mutex);
+  if (--connectionCount == 0)
+    connectionsClosed.notify_all();
+}
@@ -0,0 +1,189 @@
+/*
+ * This file is part of Adblock Plus <https://adblockplus.org/>,
+ * Copyright (C) 2006-present eyeo GmbH
+ *
+ * Adblock Plus is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 3 as
+ * published by the Free Software Foundation.
+ *
+ * Adblock Plus is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Adblock Plus.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <algorithm>
+#include <sstream>
+#include "FilterHitStatistics.h"
+
+using namespace AdblockPlus;
+
+namespace
+{
+  const char* const header = "# Adblock Plus filter hits";
+
+  std::atomic<uint64_t> nextStatisticsId(1);
+
+  struct ThreadCache
+  {
+    uint64_t statisticsId;
+    void* shard;
+  };
+
+  thread_local ThreadCache threadCache = {0, nullptr};
+}
+
+struct FilterHitStatistics::Shard
+{
+  // Locked by the owning thread for every hit, so it is only contended
+  // while the shards are being merged.
+  std::mutex mutex;
+  Entries entries;
+};
+
+FilterHitStatistics::FilterHitStatistics()
+  : id(nextStatisticsId++), saveScheduled(false), loaded(false)
+{
+}
+
+FilterHitStatistics::~FilterHitStatistics()
+{
+}
+
+FilterHitStatistics::Shard& FilterHitStatistics::GetShard()
+{
+  if (threadCache.statisticsId == id)
+    return *static_cast<Shard*>(threadCache.shard);
+
+  std::lock_guard<std::mutex> lock(mutex);
+  std::unique_ptr<Shard>& shard = shards[std::this_thread::get_id()];
+  if (!shard)
+    shard.reset(new Shard());
+  threadCache.statisticsId = id;
+  threadCache.shard = shard.get();
+  return *shard;
+}
+
+bool FilterHitStatistics::RecordHit(const std::string& text, int64_t time)
+{
+  Shard& shard = GetShard();
+  {
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    Entry& entry = shard.entries.emplace(text, Entry{0, 0}).first->second;
+    entry.hitCount++;
+    entry.lastHit = std::max(entry.lastHit, time);
+  }
+
+  // Check before exchanging, so that threads don't fight over the cache line
+  // while a save is already scheduled.
+  return !saveScheduled.load(std::memory_order_relaxed) &&
+    !saveScheduled.exchange(true);
+}
+
+void FilterHitStatistics::AddEntries(Entries& entries, const Entries& added)
+{
+  for (const auto& addedEntry : added)
+  {
+    Entry& entry = entries.emplace(addedEntry.first, Entry{0, 0}).first->second;
+    entry.hitCount += addedEntry.second.hitCount;
+    entry.lastHit = std::max(entry.lastHit, addedEntry.second.lastHit);
+  }
+}
+
+void FilterHitStatistics::MergeShards()
+{
+  for (const auto& shard : shards)
+  {
+    Entries shardEntries;
+    {
+      std::lock_guard<std::mutex> lock(shard.second->mutex);
+      shardEntries.swap(shard.second->entries);
+    }
+    AddEntries(entries, shardEntries);
+  }
+}
+
+std::vector<FilterEngine::FilterHitStats> FilterHitStatistics::GetTop(size_t topN)
+{
+  std::vector<FilterEngine::FilterHitStats> result;
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    MergeShards();
+    result.reserve(entries.size());
+    for (const auto& entry : entries)
+    {
+      FilterEngine::FilterHitStats stats;
+      stats.text = entry.first;
+      stats.hitCount = entry.second.hitCount;
+      stats.lastHit = entry.second.lastHit;
+      result.push_back(std::move(stats));
+    }
+  }
+
+  auto compare = [](const FilterEngine::FilterHitStats& a,
+    const FilterEngine::FilterHitStats& b)
+  {
+    if (a.hitCount != b.hitCount)
+      return a.hitCount > b.hitCount;
+    if (a.lastHit != b.lastHit)
+      return a.lastHit > b.lastHit;
+    return a.text < b.text;
+  };
+  if (topN && topN < result.size())
+  {
+    std::partial_sort(result.begin(), result.begin() + topN, result.end(), compare);
+    result.resize(topN);
+  }
+  else
+    std::sort(result.begin(), result.end(), compare);
+  return result;
+}
+
+bool FilterHitStatistics::Load(const std::string& data)
+{
+  Entries loadedEntries;
+  std::istringstream lines(data);
+  std::string line;
+  while (std::getline(lines, line))
+  {
+    // Each line is "hitCount<TAB>lastHit<TAB>text".
+    size_t first = line.find('\t');
+    size_t second = first == std::string::npos ? first : line.find('\t', first + 1);
+    if (line.empty() || line[0] == '#' || second == std::string::npos)
+      continue;
+    Entry entry;
+    std::istringstream count(line.substr(0, first));
+    std::istringstream time(line.substr(first + 1, second - first - 1));
+    if (!(count >> entry.hitCount) || !(time >> entry.lastHit))
+      continue;
+    loadedEntries[line.substr(second + 1)] = entry;
+  }
+
+  std::lock_guard<std::mutex> lock(mutex);
+  AddEntries(entries, loadedEntries);
+  loaded = true;
+  return saveScheduled;
+}
+
+bool FilterHitStatistics::Serialize(std::string& data)
+{
+  std::lock_guard<std::mutex> lock(mutex);
+  if (!loaded)
+    return false;
+
+  // Reset before merging, hits recorded meanwhile schedule the next save.
+  saveScheduled = false;
+  MergeShards();
+  std::stringstream result;
+  result << header << "\n";
+  for (const auto& entry : entries)
+  {
+    result << entry.second.hitCount << "\t" << entry.second.lastHit << "\t"
+      << entry.first << "\n";
+  }
+  data = result.str();
+  return true;
+}
@@ -0,0 +1,86 @@
+/*
+ * This file is part of Adblock Plus <https://adblockplus.org/>,
+ * Copyright (C) 2006-present eyeo GmbH
+ *
+ * Adblock Plus is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 3 as
+ * published by the Free Software Foundation.
+ *
+ * Adblock Plus is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Adblock Plus.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef ADBLOCK_PLUS_FILTER_HIT_STATISTICS_H
+#define ADBLOCK_PLUS_FILTER_HIT_STATISTICS_H
+
+#include <atomic>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include <AdblockPlus/FilterEngine.h>
+
+namespace AdblockPlus
+{
+  // Counts filter hits natively instead of in the JavaScript filter objects.
+  // Hits are recorded into per-thread shards, which are merged whenever the
+  // statistics are read or serialized.
+  class FilterHitStatistics
+  {
+  public:
+    FilterHitStatistics();
+    ~FilterHitStatistics();
+
+    // Returns true for the first hit after the statistics were last
+    // serialized, the caller is then expected to schedule a save.
+    bool RecordHit(const std::string& text, int64_t time);
+    // Ordered by descending hit count, zero topN means all filters.
+    std::vector<FilterEngine::FilterHitStats> GetTop(size_t topN);
+    // Adds the hits of previously serialized statistics. Returns true if a
+    // save was requested before, the caller is then expected to save now.
+    bool Load(const std::string& data);
+    // Fails until Load() was called, so that saved statistics aren't
+    // overwritten before they are read.
+    bool Serialize(std::string& data);
+    // True if hits were recorded since the statistics were last serialized.
+    bool HasUnsavedHits() const
+    {
+      return saveScheduled;
+    }
+
+  private:
+    struct Entry
+    {
+      uint64_t hitCount;
+      int64_t lastHit;
+    };
+    typedef std::unordered_map<std::string, Entry> Entries;
+    struct Shard;
+
+    FilterHitStatistics(const FilterHitStatistics&);
+    FilterHitStatistics& operator=(const FilterHitStatistics&);
+
+    Shard& GetShard();
+    static void AddEntries(Entries& entries, const Entries& added);
+    // Requires mutex to be locked.
+    void MergeShards();
+
+    const uint64_t id;
+    std::atomic<bool> saveScheduled;
+    mutable std::mutex mutex;
+    bool loaded;
+    Entries entries;
+    std::map<std::thread::id, std::unique_ptr<Shard>> shards;
+  };
+}
+
+#endif
@@ -0,0 +1,855 @@
+/*
+ * This file is part of Adblock Plus <https://adblockplus.org/>,
+ * Copyright (C) 2006-present eyeo GmbH
+ *
+ * Adblock Plus is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 3 as
+ * published by the Free Software Foundation.
+ *
+ * Adblock Plus is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Adblock Plus.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <algorithm>
+#include <cstring>
+#include <limits>
+#include <map>
+#include <stdexcept>
+#include <unordered_map>
+#include <unordered_set>
+#include <AdblockPlus/FilterIndex.h>
+#include "NativeFilter.h"
+#include "NativeRegExp.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+using namespace AdblockPlus;
+
+namespace
+{
+  const char fileMagic[8] = {'A', 'B', 'P', 'I', 'N', 'D', 'E', 'X'};
+  const uint32_t formatVersion = 1;
+  // Indexes are written in the byte order of the machine building them.
+  const uint32_t byteOrderMark = 0x01020304;
+
+  uint32_t Hash(const char* key, size_t length)
+  {
+    // FNV-1a
+    uint32_t hash = 2166136261u;
+    for (size_t i = 0; i < length; i++)
+    {
+      hash ^= static_cast<uint8_t>(key[i]);
+      hash *= 16777619u;
+    }
+    return hash;
+  }
+
+  std::string StripTrailingDots(const std::string& text)
+  {
+    size_t end = text.find_last_not_of('.');
+    return end == std::string::npos ? std::string() : text.substr(0, end + 1);
+  }
+
+  typedef std::unordered_map<std::string, std::vector<uint32_t>> FilterLists;
+}
+
+// All offsets are relative to the beginning of the file, string offsets to
+// the beginning of the string section.
+struct FilterIndex::Table
+{
+  uint32_t offset;
+  // Power of two, open addressing with linear probing.
+  uint32_t bucketCount;
+};
+
+struct FilterIndex::Header
+{
+  char magic[8];
+  uint32_t version;
+  uint32_t byteOrder;
+  uint32_t size;
+  uint32_t filterCount;
+  uint32_t filtersOffset;
+  uint32_t domainCount;
+  uint32_t domainsOffset;
+  uint32_t idCount;
+  uint32_t idsOffset;
+  uint32_t stringsOffset;
+  uint32_t stringsSize;
+  uint32_t genericElemHideFirst;
+  uint32_t genericElemHideCount;
+  // Request filters by keyword.
+  Table blocking;
+  Table whitelist;
+  // Element hiding filters by the domains they are restricted to, filters
+  // which aren't restricted are in the generic list.
+  Table elemHideByDomain;
+  // Element hiding exceptions by selector.
+  Table elemHideExceptions;
+  Table publicSuffixes;
+};
+
+struct FilterIndex::FilterRecord
+{
+  uint32_t textOffset;
+  uint32_t textLength;
+  uint32_t patternOffset;
+  uint32_t patternLength;
+  uint32_t contentType;
+  uint32_t flags;
+  uint32_t type;
+  uint32_t domainDefault;
+  // Sorted by domain.
+  uint32_t domainsFirst;
+  uint32_t domainCount;
+};
+
+struct FilterIndex::DomainRecord
+{
+  uint32_t offset;
+  uint32_t length;
+  uint32_t include;
+};
+
+struct FilterIndex::Bucket
+{
+  uint32_t keyOffset;
+  uint32_t keyLength;
+  // Range of filter IDs, buckets with a zero count are empty. In the public
+  // suffix table first is the number of labels.
+  uint32_t first;
+  uint32_t count;
+};
+
+struct FilterIndex::Mapping
+{
+  Mapping(void* address, size_t length)
+    : address(address), length(length)
+  {
+  }
+
+  explicit Mapping(std::vector<uint8_t>&& buffer)
+    : address(nullptr), length(0), buffer(std::move(buffer))
+  {
+  }
+
+  ~Mapping()
+  {
+    if (!address)
+      return;
+#ifdef _WIN32
+    UnmapViewOfFile(address);
+#else
+    munmap(address, length);
+#endif
+  }
+
+  void* address;
+  size_t length;
+  // Used instead of a mapped file by FilterIndexBuilder::BuildIndex().
+  std::vector<uint8_t> buffer;
+};
+
+struct FilterIndex::RegExpTable
+{
+  // Compiled when the index is opened and never changed afterwards, so it
+  // is read without locking. Null if the expression isn't supported.
+  std::unordered_map<uint32_t, std::unique_ptr<const NativeRegExp>> regExps;
+};
+
+struct FilterIndexBuilder::Data
+{
+  std::vector<NativeFilter::Parsed> filters;
+  std::vector<std::string> keywords;
+  std::unordered_set<std::string> texts;
+  // Number of blocking and exception filters per keyword.
+  std::unordered_map<std::string, size_t> keywordCounts[2];
+  std::map<std::string, int> publicSuffixes;
+};
+
+FilterIndexBuilder::FilterIndexBuilder()
+  : data(new Data())
+{
+}
+
+FilterIndexBuilder::~FilterIndexBuilder()
+{
+}
+
+void FilterIndexBuilder::AddFilter(const std::string& text)
+{
+  if (text.empty() || !data->texts.insert(text).second)
+    return;
+
+  NativeFilter::Parsed filter = NativeFilter::Parse(text);
+  std::string keyword;
+  switch (filter.type)
+  {
+    case FilterTypes::TYPE_BLOCKING:
+    case FilterTypes::TYPE_EXCEPTION:
+    {
+      // Prefer the keyword with the fewest filters, like Matcher.findKeyword().
+      auto& counts = data->keywordCounts[filter.type == FilterTypes::TYPE_BLOCKING ? 0 : 1];
+      size_t resultCount = std::numeric_limits<size_t>::max();
+      for (const auto& candidate : NativeFilter::GetKeywordCandidates(text))
+      {
+        auto it = counts.find(candidate);
+        size_t count = it == counts.end() ? 0 : it->second;
+        if (count < resultCount || (count == resultCount && candidate.size() > keyword.size()))
+        {
+          keyword = candidate;
+          resultCount = count;
+        }
+      }
+      counts[keyword]++;
+      break;
+    }
+    case FilterTypes::TYPE_ELEMHIDE:
+    case FilterTypes::TYPE_ELEMHIDE_EXCEPTION:
+      break;
+    default:
+      return;
+  }
+  data->filters.push_back(std::move(filter));
+  data->keywords.push_back(keyword);
+}
+
+void FilterIndexBuilder::AddFilterList(const std::string& text)
+{
+  size_t lineStart = 0;
+  for (bool firstLine = true; lineStart < text.size(); firstLine = false)
+  {
+    size_t lineEnd = text.find('\n', lineStart);
+    if (lineEnd == std::string::npos)
+      lineEnd = text.size();
+    std::string line = NativeFilter::Normalize(
+      text.substr(lineStart, lineEnd - lineStart));
+    lineStart = lineEnd + 1;
+    // The header of the list, e.g. [Adblock Plus 2.0], like Synchronizer.
+    if (firstLine && line.size() > 1 && line[0] == '[' && line.back() == ']' &&
+      NativeFilter::ToLowerCase(line.substr(1, 7)) == "adblock")
+    {
+      continue;
+    }
+    AddFilter(line);
+  }
+}
+
+void FilterIndexBuilder::AddPublicSuffix(const std::string& suffix, int labels)
+{
+  if (labels >= 0)
+    data->publicSuffixes[suffix] = labels;
+}
+
+void FilterIndexBuilder::AddDefaultPublicSuffixes()
+{
+  for (const auto* entry = NativeFilter::publicSuffixes; entry->suffix; entry++)
+    AddPublicSuffix(entry->suffix, entry->labels);
+}
+
+std::vector<uint8_t> FilterIndexBuilder::Build() const
+{
+  std::string strings;
+  std::unordered_map<std::string, uint32_t> stringOffsets;
+  auto addString = [&strings, &stringOffsets](const std::string& text)
+  {
+    auto it = stringOffsets.find(text);
+    if (it != stringOffsets.end())
+      return it->second;
+    uint32_t offset = static_cast<uint32_t>(strings.size());
+    strings += text;
+    stringOffsets[text] = offset;
+    return offset;
+  };
+
+  FilterIndex::Header header;
+  std::memset(&header, 0, sizeof(header));
+  std::memcpy(header.magic, fileMagic, sizeof(fileMagic));
+  header.version = formatVersion;
+  header.byteOrder = byteOrderMark;
+
+  std::vector<FilterIndex::FilterRecord> records;
+  std::vector<FilterIndex::DomainRecord> domains;
+  std::vector<uint32_t> ids;
+  std::vector<FilterIndex::Bucket> buckets;
+  FilterLists blocking;
+  FilterLists whitelist;
+  FilterLists elemHideByDomain;
+  FilterLists elemHideExceptions;
+  std::vector<uint32_t> genericElemHide;
+
+  for (size_t i = 0; i < data->filters.size(); i++)
+  {
+    const NativeFilter::Parsed& filter = data->filters[i];
+    uint32_t id = static_cast<uint32_t>(i);
+    FilterIndex::FilterRecord record;
+    record.textOffset = addString(filter.text);
+    record.textLength = static_cast<uint32_t>(filter.text.size());
+    record.patternOffset = addString(filter.pattern);
+    record.patternLength = static_cast<uint32_t>(filter.pattern.size());
+    record.contentType = filter.contentType;
+    record.flags = filter.flags;
+    record.type = filter.type;
+    record.domainDefault = filter.domainDefault;
+    record.domainsFirst = static_cast<uint32_t>(domains.size());
+    record.domainCount = static_cast<uint32_t>(filter.domains.size());
+    for (const auto& domain : filter.domains)
+    {
+      FilterIndex::DomainRecord domainRecord = {addString(domain.first),
+        static_cast<uint32_t>(domain.first.size()), domain.second};
+      domains.push_back(domainRecord);
+    }
+    records.push_back(record);
+
+    switch (filter.type)
+    {
+      case FilterTypes::TYPE_BLOCKING:
+        blocking[data->keywords[i]].push_back(id);
+        break;
+      case FilterTypes::TYPE_EXCEPTION:
+        whitelist[data->keywords[i]].push_back(id);
+        break;
+      case FilterTypes::TYPE_ELEMHIDE:
+        if (filter.domainDefault)
+          genericElemHide.push_back(id);
+        for (const auto& domain : filter.domains)
+        {
+          if (domain.second)
+            elemHideByDomain[domain.first].push_back(id);
+        }
+        break;
+      default:
+        elemHideExceptions[filter.pattern].push_back(id);
+        break;
+    }
+  }
+
+  header.genericElemHideFirst = static_cast<uint32_t>(ids.size());
+  header.genericElemHideCount = static_cast<uint32_t>(genericElemHide.size());
+  ids.insert(ids.end(), genericElemHide.begin(), genericElemHide.end());
+
+  // Table offsets are bucket indexes until the layout is known.
+  auto addTable = [&](const std::vector<std::pair<std::string, std::vector<uint32_t>>>& entries,
+    bool isSuffixTable)
+  {
+    FilterIndex::Table table;
+    table.offset = static_cast<uint32_t>(buckets.size());
+    table.bucketCount = 1;
+    while (table.bucketCount < entries.size() * 2)
+      table.bucketCount *= 2;
+    buckets.resize(buckets.size() + table.bucketCount, FilterIndex::Bucket());
+    for (const auto& entry : entries)
+    {
+      FilterIndex::Bucket bucket;
+      bucket.keyOffset = addString(entry.first);
+      bucket.keyLength = static_cast<uint32_t>(entry.first.size());
+      if (isSuffixTable)
+      {
+        bucket.first = entry.second[0];
+        bucket.count = 1;
+      }
+      else
+      {
+        bucket.first = static_cast<uint32_t>(ids.size());
+        bucket.count = static_cast<uint32_t>(entry.second.size());
+        ids.insert(ids.end(), entry.second.begin(), entry.second.end());
+      }
+      uint32_t mask = table.bucketCount - 1;
+      uint32_t index = Hash(entry.first.data(), entry.first.size()) & mask;
+      while (buckets[table.offset + index].count)
+        index = (index + 1) & mask;
+      buckets[table.offset + index] = bucket;
+    }
+    return table;
+  };
+  auto toEntries = [](const FilterLists& lists)
+  {
+    return std::vector<std::pair<std::string, std::vector<uint32_t>>>(lists.begin(), lists.end());
+  };
+  header.blocking = addTable(toEntries(blocking), false);
+  header.whitelist = addTable(toEntries(whitelist), false);
+  header.elemHideByDomain = addTable(toEntries(elemHideByDomain), false);
+  header.elemHideExceptions = addTable(toEntries(elemHideExceptions), false);
+  std::vector<std::pair<std::string, std::vector<uint32_t>>> suffixes;
+  for (const auto& suffix : data->publicSuffixes)
+    suffixes.push_back(std::make_pair(suffix.first, std::vector<uint32_t>(1, suffix.second)));
+  header.publicSuffixes = addTable(suffixes, true);
+
+  uint64_t size = sizeof(header);
+  header.filterCount = static_cast<uint32_t>(records.size());
+  header.filtersOffset = static_cast<uint32_t>(size);
+  size += records.size() * sizeof(FilterIndex::FilterRecord);
+  header.domainCount = static_cast<uint32_t>(domains.size());
+  header.domainsOffset = static_cast<uint32_t>(size);
+  size += domains.size() * sizeof(FilterIndex::DomainRecord);
+  header.idCount = static_cast<uint32_t>(ids.size());
+  header.idsOffset = static_cast<uint32_t>(size);
+  size += ids.size() * sizeof(uint32_t);
+  uint64_t bucketsOffset = size;
+  size += buckets.size() * sizeof(FilterIndex::Bucket);
+  header.stringsOffset = static_cast<uint32_t>(size);
+  header.stringsSize = static_cast<uint32_t>(strings.size());
+  size += strings.size();
+  if (size > std::numeric_limits<uint32_t>::max())
+    throw std::runtime_error("Filter index exceeds 4 GiB");
+  header.size = static_cast<uint32_t>(size);
+  for (FilterIndex::Table* table : {&header.blocking, &header.whitelist,
+    &header.elemHideByDomain, &header.elemHideExceptions, &header.publicSuffixes})
+  {
+    table->offset = static_cast<uint32_t>(bucketsOffset + table->offset * sizeof(FilterIndex::Bucket));
+  }
+
+  std::vector<uint8_t> result(static_cast<size_t>(size));
+  uint8_t* out = result.data();
+  std::memcpy(out, &header, sizeof(header));
+  if (!records.empty())
+    std::memcpy(out + header.filtersOffset, records.data(), records.size() * sizeof(records[0]));
+  if (!domains.empty())
+    std::memcpy(out + header.domainsOffset, domains.data(), domains.size() * sizeof(domains[0]));
+  if (!ids.empty())
+    std::memcpy(out + header.idsOffset, ids.data(), ids.size() * sizeof(ids[0]));
+  std::memcpy(out + bucketsOffset, buckets.data(), buckets.size() * sizeof(buckets[0]));
+  if (!strings.empty())
+    std::memcpy(out + header.stringsOffset, strings.data(), strings.size());
+  return result;
+}
+
+FilterIndexPtr FilterIndexBuilder::BuildIndex() const
+{
+  std::unique_ptr<FilterIndex::Mapping> mapping(new FilterIndex::Mapping(Build()));
+  const uint8_t* buffer = mapping->buffer.data();
+  size_t size = mapping->buffer.size();
+  return FilterIndexPtr(new FilterIndex(buffer, size, std::move(mapping)));
+}
+
+FilterIndex::FilterIndex(const uint8_t* data, size_t size, std::unique_ptr<Mapping> mapping)
+  : data(data), size(size), header(reinterpret_cast<const Header*>(data)),
+    filters(nullptr), mapping(std::move(mapping))
+{
+  Validate();
+  filters = reinterpret_cast<const FilterRecord*>(data + header->filtersOffset);
+
+  std::unique_ptr<RegExpTable> table(new RegExpTable());
+  for (uint32_t id = 0; id < header->filterCount; id++)
+  {
+    const FilterRecord& filter = filters[id];
+    if (filter.flags & NativeFilter::FLAG_REGEXP)
+    {
+      table->regExps[id] = NativeRegExp::Compile(
+        std::string(GetString(filter.patternOffset), filter.patternLength),
+        (filter.flags & NativeFilter::FLAG_MATCH_CASE) != 0);
+    }
+  }
+  regExpTable = std::move(table);
+}
+
+FilterIndex::~FilterIndex()
+{
+}
+
+FilterIndexPtr FilterIndex::Open(const std::string& path)
+{
+#ifdef _WIN32
+  int length = MultiByteToWideChar(CP_UTF8, 0, path.c_str(), -1, nullptr, 0);
+  std::wstring widePath(length, L'\0');
+  MultiByteToWideChar(CP_UTF8, 0, path.c_str(), -1, &widePath[0], length);
+  HANDLE file = CreateFileW(widePath.c_str(), GENERIC_READ, FILE_SHARE_READ,
+    nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+  if (file == INVALID_HANDLE_VALUE)
+    throw std::runtime_error("Unable to open filter index " + path);
+  LARGE_INTEGER fileSize;
+  HANDLE fileMapping = nullptr;
+  if (GetFileSizeEx(file, &fileSize) && fileSize.QuadPart > 0)
+    fileMapping = CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+  CloseHandle(file);
+  if (!fileMapping)
+    throw std::runtime_error("Unable to map filter index " + path);
+  void* address = MapViewOfFile(fileMapping, FILE_MAP_READ, 0, 0, 0);
+  CloseHandle(fileMapping);
+  if (!address)
+    throw std::runtime_error("Unable to map filter index " + path);
+  size_t size = static_cast<size_t>(fileSize.QuadPart);
+#else
+  int file = open(path.c_str(), O_RDONLY);
+  if (file < 0)
+    throw std::runtime_error("Unable to open filter index " + path);
+  struct stat fileStat;
+  void* address = MAP_FAILED;
+  if (fstat(file, &fileStat) == 0 && fileStat.st_size > 0)
+    address = mmap(nullptr, fileStat.st_size, PROT_READ, MAP_SHARED, file, 0);
+  close(file);
+  if (address == MAP_FAILED)
+    throw std::runtime_error("Unable to map filter index " + path);
+  size_t size = static_cast<size_t>(fileStat.st_size);
+#endif
+  std::unique_ptr<Mapping> mapping(new Mapping(address, size));
+  return FilterIndexPtr(new FilterIndex(static_cast<const uint8_t*>(address),
+    size, std::move(mapping)));
+}
+
+FilterIndexPtr FilterIndex::FromBuffer(const uint8_t* data, size_t size)
+{
+  if (reinterpret_cast<uintptr_t>(data) % sizeof(uint32_t))
+    throw std::runtime_error("Filter index data must be aligned to 4 bytes");
+  return FilterIndexPtr(new FilterIndex(data, size, std::unique_ptr<Mapping>()));
+}
+
+void FilterIndex::Validate() const
+{
+  // Checks everything that is accessed without bounds checks later, so that
+  // a corrupt file can't make queries read outside of it.
+  auto isSection = [this](uint64_t offset, uint64_t count, uint64_t itemSize)
+  {
+    return offset % sizeof(uint32_t) == 0 && offset <= size &&
+      count * itemSize <= size - offset;
+  };
+  if (size < sizeof(Header) || std::memcmp(header->magic, fileMagic, sizeof(fileMagic)) ||
+    header->version != formatVersion || header->byteOrder != byteOrderMark ||
+    header->size != size ||
+    !isSection(header->filtersOffset, header->filterCount, sizeof(FilterRecord)) ||
+    !isSection(header->domainsOffset, header->domainCount, sizeof(DomainRecord)) ||
+    !isSection(header->idsOffset, header->idCount, sizeof(uint32_t)) ||
+    header->stringsOffset > size || header->stringsSize > size - header->stringsOffset)
+  {
+    throw std::runtime_error("Invalid filter index");
+  }
+
+  auto isString = [this](uint64_t offset, uint64_t length)
+  {
+    return offset <= header->stringsSize && length <= header->stringsSize - offset;
+  };
+  auto isIdRange = [this](uint64_t first, uint64_t count)
+  {
+    if (first > header->idCount || count > header->idCount - first)
+      return false;
+    const uint32_t* ids = GetIds(static_cast<uint32_t>(first));
+    return std::all_of(ids, ids + count, [this](uint32_t id) { return id < header->filterCount; });
+  };
+
+  const FilterRecord* records = reinterpret_cast<const FilterRecord*>(data + header->filtersOffset);
+  for (const FilterRecord* record = records; record != records + header->filterCount; record++)
+  {
+    if (!isString(record->textOffset, record->textLength) ||
+      !isString(record->patternOffset, record->patternLength) ||
+      record->domainsFirst > header->domainCount ||
+      record->domainCount > header->domainCount - record->domainsFirst)
+    {
+      throw std::runtime_error("Invalid filter index");
+    }
+  }
+  const DomainRecord* domains = reinterpret_cast<const DomainRecord*>(data + header->domainsOffset);
+  for (const DomainRecord* domain = domains; domain != domains + header->domainCount; domain++)
+  {
+    if (!isString(domain->offset, domain->length))
+      throw std::runtime_error("Invalid filter index");
+  }
+  for (const Table* table : {&header->blocking, &header->whitelist,
+    &header->elemHideByDomain, &header->elemHideExceptions, &header->publicSuffixes})
+  {
+    if (!table->bucketCount || (table->bucketCount & (table->bucketCount - 1)) ||
+      !isSection(table->offset, table->bucketCount, sizeof(Bucket)))
+    {
+      throw std::runtime_error("Invalid filter index");
+    }
+    const Bucket* buckets = reinterpret_cast<const Bucket*>(data + table->offset);
+    for (const Bucket* bucket = buckets; bucket != buckets + table->bucketCount; bucket++)
+    {
+      if (bucket->count && (!isString(bucket->keyOffset, bucket->keyLength) ||
+        (table != &header->publicSuffixes && !isIdRange(bucket->first, bucket->count))))
+      {
+        throw std::runtime_error("Invalid filter index");
+      }
+    }
+  }
+  if (!isIdRange(header->genericElemHideFirst, header->genericElemHideCount))
+    throw std::runtime_error("Invalid filter index");
+}
+
+const char* FilterIndex::GetString(uint32_t offset) const
+{
+  return reinterpret_cast<const char*>(data + header->stringsOffset + offset);
+}
+
+const uint32_t* FilterIndex::GetIds(uint32_t first) const
+{
+  return reinterpret_cast<const uint32_t*>(data + header->idsOffset) + first;
+}
+
+const FilterIndex::Bucket* FilterIndex::Find(const Table& table, const std::string& key) const
+{
+  const Bucket* buckets = reinterpret_cast<const Bucket*>(data + table.offset);
+  uint32_t mask = table.bucketCount - 1;
+  uint32_t index = Hash(key.data(), key.size()) & mask;
+  for (uint32_t probes = 0; probes < table.bucketCount; probes++, index = (index + 1) & mask)
+  {
+    const Bucket& bucket = buckets[index];
+    if (!bucket.count)
+      return nullptr;
+    if (bucket.keyLength == key.size() &&
+      std::memcmp(GetString(bucket.keyOffset), key.data(), key.size()) == 0)
+    {
+      return &bucket;
+    }
+  }
+  return nullptr;
+}
+
+size_t FilterIndex::GetFilterCount() const
+{
+  return header->filterCount;
+}
+
+int FilterIndex::GetPublicSuffixLabels(const std::string& suffix) const
+{
+  const Bucket* bucket = Find(header->publicSuffixes, suffix);
+  return bucket ? static_cast<int>(bucket->first) : -1;
+}
+
+bool FilterIndex::IsActiveOnDomain(const FilterRecord& filter,
+  const std::string& domain, bool ignoreTrailingDot) const
+{
+  // See ActiveFilter.isActiveOnDomain().
+  if (filter.flags & NativeFilter::FLAG_SITEKEY)
+    return false;
+  if (!filter.domainCount || domain.empty())
+    return filter.domainDefault != 0;
+
+  std::string current = NativeFilter::ToLowerCase(
+    ignoreTrailingDot ? StripTrailingDots(domain) : domain);
+  const DomainRecord* first = reinterpret_cast<const DomainRecord*>(
+    data + header->domainsOffset) + filter.domainsFirst;
+  const DomainRecord* last = first + filter.domainCount;
+  auto less = [this](const DomainRecord& record, const std::string& value)
+  {
+    int result = std::memcmp(GetString(record.offset), value.data(),
+      std::min<size_t>(record.length, value.size()));
+    return result < 0 || (result == 0 && record.length < value.size());
+  };
+  while (true)
+  {
+    const DomainRecord* record = std::lower_bound(first, last, current, less);
+    if (record != last && record->length == current.size() &&
+      std::memcmp(GetString(record->offset), current.data(), current.size()) == 0)
+    {
+      return record->include != 0;
+    }
+    size_t nextDot = current.find('.');
+    if (nextDot == std::string::npos)
+      break;
+    current.erase(0, nextDot + 1);
+  }
+  return filter.domainDefault != 0;
+}
+
+bool FilterIndex::MatchesFilter(uint32_t id, const std::string& url,
+  const std::string& lowerCaseUrl, ContentTypes::ContentTypeMask contentTypeMask,
+  const std::string& documentHost, bool thirdParty) const
+{
+  // See RegExpFilter.matches().
+  const FilterRecord& filter = filters[id];
+  if (!(filter.contentType & static_cast<uint32_t>(contentTypeMask)) ||
+    ((filter.flags & NativeFilter::FLAG_THIRD_PARTY) && !thirdParty) ||
+    ((filter.flags & NativeFilter::FLAG_FIRST_PARTY) && thirdParty) ||
+    !IsActiveOnDomain(filter, documentHost, true))
+  {
+    return false;
+  }
+  if (!(filter.flags & NativeFilter::FLAG_REGEXP))
+  {
+    return NativeFilter::MatchesPattern(GetString(filter.patternOffset),
+      filter.patternLength, filter.flags,
+      filter.flags & NativeFilter::FLAG_MATCH_CASE ? url : lowerCaseUrl);
+  }
+
+  // Expressions which aren't supported never match.
+  auto it = regExpTable->regExps.find(id);
+  return it != regExpTable->regExps.end() && it->second && it->second->Test(url);
+}
+
+void FilterIndex::GetFilterText(uint32_t id, FilterText* filter) const
+{
+  if (!filter)
+    return;
+  filter->text.assign(GetString(filters[id].textOffset), filters[id].textLength);
+  filter->type = static_cast<FilterTypes::Type>(filters[id].type);
+}
+
+bool FilterIndex::MatchesAny(const std::vector<const FilterIndex*>& indexes,
+  const std::string& url, ContentTypes::ContentTypeMask contentTypeMask,
+  const std::string& documentUrl, FilterText* filter)
+{
+  // See CombinedMatcher.matchesAny(), exception filters win.
+  std::string lowerCaseUrl = NativeFilter::ToLowerCase(url);
+  std::string documentHost = NativeFilter::ExtractHost(documentUrl);
+  const FilterIndex* suffixIndex = indexes.front();
+  bool thirdParty = NativeFilter::IsThirdParty(NativeFilter::ExtractHost(url),
+    documentHost, [suffixIndex](const std::string& suffix)
+    {
+      return suffixIndex->GetPublicSuffixLabels(suffix);
+    });
+
+  const FilterIndex* blockingIndex = nullptr;
+  const uint32_t* blockingHit = nullptr;
+  for (const auto& keyword : NativeFilter::GetUrlKeywordCandidates(lowerCaseUrl))
+  {
+    for (const FilterIndex* index : indexes)
+    {
+      if (const Bucket* bucket = index->Find(index->header->whitelist, keyword))
+      {
+        const uint32_t* ids = index->GetIds(bucket->first);
+        for (const uint32_t* id = ids; id != ids + bucket->count; id++)
+        {
+          if (index->MatchesFilter(*id, url, lowerCaseUrl, contentTypeMask, documentHost, thirdParty))
+          {
+            index->GetFilterText(*id, filter);
+            return true;
+          }
+        }
+      }
+    }
+    for (const FilterIndex* index : indexes)
+    {
+      if (blockingHit)
+        break;
+      if (const Bucket* bucket = index->Find(index->header->blocking, keyword))
+      {
+        const uint32_t* ids = index->GetIds(bucket->first);
+        for (const uint32_t* id = ids; id != ids + bucket->count && !blockingHit; id++)
+        {
+          if (index->MatchesFilter(*id, url, lowerCaseUrl, contentTypeMask, documentHost, thirdParty))
+          {
+            blockingIndex = index;
+            blockingHit = id;
+          }
+        }
+      }
+    }
+  }
+  if (!blockingHit)
+    return false;
+  blockingIndex->GetFilterText(*blockingHit, filter);
+  return true;
+}
+
+bool FilterIndex::Matches(const std::string& url,
+  ContentTypes::ContentTypeMask contentTypeMask,
+  const std::string& documentUrl, FilterText* filter) const
+{
+  return Matches(url, contentTypeMask, std::vector<std::string>(1, documentUrl), filter);
+}
+
+bool FilterIndex::Matches(const std::string& url,
+  ContentTypes::ContentTypeMask contentTypeMask,
+  const std::vector<std::string>& documentUrls,
+  FilterText* filter) const
+{
+  return Matches(std::vector<const FilterIndex*>(1, this), url, contentTypeMask,
+    documentUrls, filter);
+}
+
+bool FilterIndex::Matches(const std::vector<const FilterIndex*>& indexes,
+  const std::string& url, ContentTypes::ContentTypeMask contentTypeMask,
+  const std::vector<std::string>& documentUrls, FilterText* filter)
+{
+  if (indexes.empty())
+    return false;
+  if (documentUrls.empty())
+    return MatchesAny(indexes, url, contentTypeMask, "", filter);
+
+  // Whitelisted documents, see FilterEngine::GetDocumentWhitelistingFilter().
+  std::string lastDocumentUrl = documentUrls.front();
+  for (const auto& documentUrl : documentUrls)
+  {
+    FilterText documentFilter;
+    if (MatchesAny(indexes, documentUrl, ContentTypes::CONTENT_TYPE_DOCUMENT,
+      lastDocumentUrl, &documentFilter) && documentFilter.type == FilterTypes::TYPE_EXCEPTION)
+    {
+      if (filter)
+        *filter = documentFilter;
+      return true;
+    }
+    lastDocumentUrl = documentUrl;
+  }
+  return MatchesAny(indexes, url, contentTypeMask, documentUrls.back(), filter);
+}
+
+bool FilterIndex::IsElementHidingExcepted(const std::string& selector,
+  const std::string& domain) const
+{
+  const Bucket* bucket = Find(header->elemHideExceptions, selector);
+  if (!bucket)
+    return false;
+  const uint32_t* ids = GetIds(bucket->first);
+  return std::any_of(ids, ids + bucket->count, [this, &domain](uint32_t id)
+  {
+    return IsActiveOnDomain(filters[id], domain, false);
+  });
+}
+
+std::vector<std::string> FilterIndex::GetElementHidingSelectors(const std::string& domain) const
+{
+  return GetElementHidingSelectors(std::vector<const FilterIndex*>(1, this), domain);
+}
+
+std::vector<std::string> FilterIndex::GetElementHidingSelectors(
+  const std::vector<const FilterIndex*>& indexes, const std::string& domain)
+{
+  // See ElemHide.getSelectorsForDomain().
+  std::vector<std::string> selectors;
+  // A filter listed in several indexes is still only one filter.
+  std::unordered_set<std::string> seenTexts;
+  for (const FilterIndex* index : indexes)
+  {
+    auto addSelector = [index, &indexes, &selectors, &seenTexts, &domain](uint32_t id)
+    {
+      const FilterRecord& filter = index->filters[id];
+      if (!index->IsActiveOnDomain(filter, domain, false))
+        return;
+      if (indexes.size() > 1 && !seenTexts.insert(std::string(
+        index->GetString(filter.textOffset), filter.textLength)).second)
+      {
+        return;
+      }
+      std::string selector(index->GetString(filter.patternOffset), filter.patternLength);
+      for (const FilterIndex* exceptionIndex : indexes)
+      {
+        if (exceptionIndex->IsElementHidingExcepted(selector, domain))
+          return;
+      }
+      selectors.push_back(std::move(selector));
+    };
+
+    const uint32_t* generic = index->GetIds(index->header->genericElemHideFirst);
+    std::for_each(generic, generic + index->header->genericElemHideCount, addSelector);
+
+    std::unordered_set<uint32_t> seen;
+    std::string current = NativeFilter::ToLowerCase(domain);
+    while (!current.empty())
+    {
+      if (const Bucket* bucket = index->Find(index->header->elemHideByDomain, current))
+      {
+        const uint32_t* ids = index->GetIds(bucket->first);
+        for (const uint32_t* id = ids; id != ids + bucket->count; id++)
+        {
+          if (seen.insert(*id).second)
+            addSelector(*id);
+        }
+      }
+      size_t nextDot = current.find('.');
+      current.erase(0, nextDot == std::string::npos ? current.size() : nextDot + 1);
+    }
+  }
+  return selectors;
+}
@@ -0,0 +1,234 @@
+/*
+ * This file is part of Adblock Plus <https://adblockplus.org/>,
+ * Copyright (C) 2006-present eyeo GmbH
+ *
+ * Adblock Plus is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 3 as
+ * published by the Free Software Foundation.
+ *
+ * Adblock Plus is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Adblock Plus.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <algorithm>
+#include <stdexcept>
+#include <AdblockPlus/FilterStore.h>
+#include "NativeFilter.h"
+
+using namespace AdblockPlus;
+
+struct FilterProfile::Snapshot
+{
+  std::shared_ptr<const FilterStore::Subscriptions> subscriptions;
+  std::shared_ptr<const FilterIndex> filterIndex;
+  std::shared_ptr<const FilterIndex> publicSuffixes;
+  std::vector<const FilterIndex*> indexes;
+};
+
+FilterStore::FilterStore()
+  : subscriptions(std::make_shared<Subscriptions>())
+{
+  FilterIndexBuilder builder;
+  builder.AddDefaultPublicSuffixes();
+  publicSuffixes = builder.BuildIndex();
+}
+
+void FilterStore::SetSubscription(const std::string& url, const std::string& filterList)
+{
+  // Built outside of the lock, this takes a while for large lists.
+  FilterIndexBuilder builder;
+  builder.AddFilterList(filterList);
+  SetSubscription(url, builder.BuildIndex());
+}
+
+void FilterStore::SetSubscription(const std::string& url, FilterIndexPtr index)
+{
+  std::shared_ptr<const FilterIndex> sharedIndex(std::move(index));
+  std::lock_guard<std::mutex> lock(mutex);
+  // Copy on write, snapshots handed out before stay unchanged.
+  std::shared_ptr<Subscriptions> newSubscriptions =
+    std::make_shared<Subscriptions>(*subscriptions);
+  (*newSubscriptions)[url] = sharedIndex;
+  std::atomic_store(&subscriptions,
+    std::shared_ptr<const Subscriptions>(newSubscriptions));
+}
+
+void FilterStore::RemoveSubscription(const std::string& url)
+{
+  std::lock_guard<std::mutex> lock(mutex);
+  if (subscriptions->find(url) == subscriptions->end())
+    return;
+  std::shared_ptr<Subscriptions> newSubscriptions =
+    std::make_shared<Subscriptions>(*subscriptions);
+  newSubscriptions->erase(url);
+  std::atomic_store(&subscriptions,
+    std::shared_ptr<const Subscriptions>(newSubscriptions));
+}
+
+std::shared_ptr<const FilterStore::Subscriptions> FilterStore::GetSubscriptions() const
+{
+  return std::atomic_load(&subscriptions);
+}
+
+void FilterStore::SetPref(const std::string& name, const std::string& value)
+{
+  std::lock_guard<std::mutex> lock(mutex);
+  prefs[name] = value;
+}
+
+std::string FilterStore::GetPref(const std::string& name) const
+{
+  std::lock_guard<std::mutex> lock(mutex);
+  auto it = prefs.find(name);
+  return it == prefs.end() ? std::string() : it->second;
+}
+
+FilterProfile::FilterProfile(const FilterStorePtr& store)
+  : store(store)
+{
+  if (!store)
+    throw std::invalid_argument("FilterProfile requires a FilterStore");
+  UpdateFilters();
+}
+
+FilterProfile::~FilterProfile()
+{
+}
+
+void FilterProfile::AddFilters(const std::vector<std::string>& texts)
+{
+  std::lock_guard<std::mutex> lock(mutex);
+  bool changed = false;
+  for (const auto& text : texts)
+  {
+    std::string normalized = NativeFilter::Normalize(text);
+    if (normalized.empty() || !filterSet.insert(normalized).second)
+      continue;
+    filters.push_back(normalized);
+    changed = true;
+  }
+  if (changed)
+    UpdateFilters();
+}
+
+void FilterProfile::RemoveFilter(const std::string& text)
+{
+  std::lock_guard<std::mutex> lock(mutex);
+  std::string normalized = NativeFilter::Normalize(text);
+  if (!filterSet.erase(normalized))
+    return;
+  filters.erase(std::find(filters.begin(), filters.end(), normalized));
+  UpdateFilters();
+}
+
+std::vector<std::string> FilterProfile::GetFilters() const
+{
+  std::lock_guard<std::mutex> lock(mutex);
+  return filters;
+}
+
+void FilterProfile::SetSubscriptionDisabled(const std::string& url, bool disabled)
+{
+  std::lock_guard<std::mutex> lock(mutex);
+  bool changed = disabled ? disabledSubscriptions.insert(url).second :
+    disabledSubscriptions.erase(url) > 0;
+  if (changed)
+    std::atomic_store(&snapshot, std::shared_ptr<const Snapshot>());
+}
+
+bool FilterProfile::IsSubscriptionDisabled(const std::string& url) const
+{
+  std::lock_guard<std::mutex> lock(mutex);
+  return disabledSubscriptions.count(url) > 0;
+}
+
+void FilterProfile::SetPref(const std::string& name, const std::string& value)
+{
+  std::lock_guard<std::mutex> lock(mutex);
+  prefs[name] = value;
+}
+
+void FilterProfile::ResetPref(const std::string& name)
+{
+  std::lock_guard<std::mutex> lock(mutex);
+  prefs.erase(name);
+}
+
+std::string FilterProfile::GetPref(const std::string& name) const
+{
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = prefs.find(name);
+    if (it != prefs.end())
+      return it->second;
+  }
+  return store->GetPref(name);
+}
+
+bool FilterProfile::Matches(const std::string& url,
+  ContentTypes::ContentTypeMask contentTypeMask,
+  const std::string& documentUrl, FilterText* filter) const
+{
+  return Matches(url, contentTypeMask, std::vector<std::string>(1, documentUrl), filter);
+}
+
+bool FilterProfile::Matches(const std::string& url,
+  ContentTypes::ContentTypeMask contentTypeMask,
+  const std::vector<std::string>& documentUrls, FilterText* filter) const
+{
+  std::shared_ptr<const Snapshot> current = GetSnapshot();
+  return FilterIndex::Matches(current->indexes, url, contentTypeMask,
+    documentUrls, filter);
+}
+
+std::vector<std::string> FilterProfile::GetElementHidingSelectors(const std::string& domain) const
+{
+  std::shared_ptr<const Snapshot> current = GetSnapshot();
+  return FilterIndex::GetElementHidingSelectors(current->indexes, domain);
+}
+
+void FilterProfile::UpdateFilters()
+{
+  // Custom filter lists are short, so the index is simply rebuilt.
+  FilterIndexBuilder builder;
+  for (const auto& text : filters)
+    builder.AddFilter(text);
+  filterIndex = builder.BuildIndex();
+  std::atomic_store(&snapshot, std::shared_ptr<const Snapshot>());
+}
+
+std::shared_ptr<const FilterProfile::Snapshot> FilterProfile::GetSnapshot() const
+{
+  // Queries only take the lock when the snapshot needs to be rebuilt.
+  std::shared_ptr<const Snapshot> current = std::atomic_load(&snapshot);
+  if (current && current->subscriptions == store->GetSubscriptions())
+    return current;
+
+  std::lock_guard<std::mutex> lock(mutex);
+  std::shared_ptr<const FilterStore::Subscriptions> subscriptions =
+    store->GetSubscriptions();
+  current = std::atomic_load(&snapshot);
+  if (current && current->subscriptions == subscriptions)
+    return current;
+
+  std::shared_ptr<Snapshot> newSnapshot = std::make_shared<Snapshot>();
+  newSnapshot->subscriptions = subscriptions;
+  newSnapshot->filterIndex = filterIndex;
+  newSnapshot->publicSuffixes = store->publicSuffixes;
+  // Public suffixes are looked up in the first index.
+  newSnapshot->indexes.push_back(newSnapshot->publicSuffixes.get());
+  for (const auto& subscription : *subscriptions)
+  {
+    if (!disabledSubscriptions.count(subscription.first))
+      newSnapshot->indexes.push_back(subscription.second.get());
+  }
+  newSnapshot->indexes.push_back(newSnapshot->filterIndex.get());
+  current = newSnapshot;
+  std::atomic_store(&snapshot, current);
+  return current;
+}
@@ -0,0 +1,157 @@
+/*
+ * This file is part of Adblock Plus <https://adblockplus.org/>,
+ * Copyright (C) 2006-present eyeo GmbH
+ *
+ * Adblock Plus is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 3 as
+ * published by the Free Software Foundation.
+ *
+ * Adblock Plus is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Adblock Plus.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <algorithm>
+#include <stdexcept>
+#include <AdblockPlus/FrameTree.h>
+
+using namespace AdblockPlus;
+
+void FrameTree::AddFrame(FrameId frameId, const std::string& url)
+{
+  AddFrame(frameId, nullptr, url);
+}
+
+void FrameTree::AddFrame(FrameId frameId, FrameId parentFrameId,
+  const std::string& url)
+{
+  AddFrame(frameId, &parentFrameId, url);
+}
+
+void FrameTree::AddFrame(FrameId frameId, const FrameId* parentFrameId,
+  const std::string& url)
+{
+  std::shared_ptr<Frame> frame = std::make_shared<Frame>();
+  frame->id = frameId;
+  frame->url = url;
+  frame->isWhitelistingCached = false;
+  frame->whitelistingGeneration = 0;
+
+  // The removed frames can hold cached filters, which must not be destroyed
+  // while the mutex is locked because that locks the JsEngine.
+  std::vector<FramePtr> removedFrames;
+  std::lock_guard<std::mutex> lock(mutex);
+  if (parentFrameId)
+  {
+    // The parent has to be looked up under the same lock as the frame is
+    // added, and it must not be removed together with the replaced frame.
+    Frames::const_iterator parent = frames.find(*parentFrameId);
+    if (parent == frames.end())
+      throw std::invalid_argument("Unknown parent frame: " + std::to_string(*parentFrameId));
+    for (const Frame* ancestor = parent->second.get(); ancestor; ancestor = ancestor->parent.get())
+    {
+      if (ancestor->id == frameId)
+      {
+        throw std::invalid_argument("Frame " + std::to_string(frameId) +
+          " can't be embedded in itself or its descendants");
+      }
+    }
+    frame->parent = parent->second;
+  }
+  RemoveFrameLocked(frameId, removedFrames);
+  frames[frameId] = frame;
+  if (parentFrameId)
+    children[*parentFrameId].push_back(frameId);
+}
+
+void FrameTree::RemoveFrame(FrameId frameId)
+{
+  std::vector<FramePtr> removedFrames;
+  std::lock_guard<std::mutex> lock(mutex);
+  RemoveFrameLocked(frameId, removedFrames);
+}
+
+void FrameTree::RemoveFrameLocked(FrameId frameId,
+  std::vector<FramePtr>& removedFrames)
+{
+  Frames::iterator it = frames.find(frameId);
+  if (it == frames.end())
+    return;
+  if (const Frame* parent = it->second->parent.get())
+  {
+    std::vector<FrameId>& siblings = children[parent->id];
+    siblings.erase(std::find(siblings.begin(), siblings.end(), frameId));
+    if (siblings.empty())
+      children.erase(parent->id);
+  }
+
+  std::vector<FrameId> pending(1, frameId);
+  while (!pending.empty())
+  {
+    FrameId current = pending.back();
+    pending.pop_back();
+    it = frames.find(current);
+    removedFrames.push_back(it->second);
+    frames.erase(it);
+    Children::iterator childIt = children.find(current);
+    if (childIt != children.end())
+    {
+      pending.insert(pending.end(), childIt->second.begin(), childIt->second.end());
+      children.erase(childIt);
+    }
+  }
+}
+
+bool FrameTree::HasFrame(FrameId frameId) const
+{
+  return !!GetFrame(frameId);
+}
+
+std::vector<std::string> FrameTree::GetDocumentUrls(FrameId frameId) const
+{
+  FramePtr frame = GetFrame(frameId);
+  if (!frame)
+    return std::vector<std::string>();
+  return GetDocumentUrls(*frame);
+}
+
+FrameTree::FramePtr FrameTree::GetFrame(FrameId frameId) const
+{
+  std::lock_guard<std::mutex> lock(mutex);
+  Frames::const_iterator it = frames.find(frameId);
+  return it != frames.end() ? it->second : FramePtr();
+}
+
+std::vector<std::string> FrameTree::GetDocumentUrls(const Frame& frame)
+{
+  // The URLs and parents are immutable, no need to lock.
+  std::vector<std::string> documentUrls;
+  for (const Frame* current = &frame; current; current = current->parent.get())
+    documentUrls.push_back(current->url);
+  return documentUrls;
+}
+
+bool FrameTree::GetCachedWhitelistingFilter(const Frame& frame,
+  uint32_t generation, std::shared_ptr<const Filter>& filter) const
+{
+  std::lock_guard<std::mutex> lock(mutex);
+  if (!frame.isWhitelistingCached || frame.whitelistingGeneration != generation)
+    return false;
+  filter = frame.whitelistingFilter;
+  return true;
+}
+
+void FrameTree::SetCachedWhitelistingFilter(const Frame& frame,
+  uint32_t generation, const std::shared_ptr<const Filter>& filter) const
+{
+  std::shared_ptr<const Filter> previousFilter;
+  std::lock_guard<std::mutex> lock(mutex);
+  frame.isWhitelistingCached = true;
+  frame.whitelistingGeneration = generation;
+  previousFilter = std::move(frame.whitelistingFilter);
+  frame.whitelistingFilter = filter;
+}
@@ -15,12 +15,39 @@
  * along with Adblock Plus.  If not, see <http://www.gnu.org/licenses/>.
  */
 
+#include <AdblockPlus/Platform.h>
 #include "JsContext.h"
 
+namespace
+{
+  AdblockPlus::Metrics::Clock::time_point NowIf(bool condition)
+  {
+    return condition ? AdblockPlus::Metrics::Clock::now() :
+      AdblockPlus::Metrics::Clock::time_point();
+  }
+}
+
 AdblockPlus::JsContext::JsContext(JsEngine& jsEngine)
-    : locker(jsEngine.GetIsolate()), isolateScope(jsEngine.GetIsolate()),
+    : isOutermost(!v8::Locker::IsLocked(jsEngine.GetIsolate())),
+      lockRequested(NowIf(isOutermost)),
+      locker(jsEngine.GetIsolate()),
+      lockAcquired(NowIf(isOutermost)),
+      isolateScope(jsEngine.GetIsolate()),
       handleScope(jsEngine.GetIsolate()),
       context(v8::Local<v8::Context>::New(jsEngine.GetIsolate(), *jsEngine.context)),
       contextScope(context)
 {
+  // Nested contexts already hold the lock, recording them would only bury
+  // the actual waits under zeros.
+  if (!isOutermost)
+    return;
+  jsEngine.GetMetrics().Record(Metrics::OPERATION_V8_LOCK_WAIT,
+    lockAcquired - lockRequested);
+#ifdef ABP_TRACE_EVENTS
+  // Only trace waits which are long enough to indicate lock contention,
+  // everything else would drown the trace.
+  if (lockAcquired - lockRequested >= std::chrono::microseconds(10))
+    jsEngine.GetPlatform().GetTracer().AddCompleteEvent("JsEngine",
+      "JsContext lock wait", lockRequested, lockAcquired);
+#endif
 }
@@ -34,7 +34,12 @@ namespace AdblockPlus
     }
 
   private:
+    // Whether this thread didn't hold the lock yet, only then the wait for
+    // it is measured.
+    const bool isOutermost;
+    const Metrics::Clock::time_point lockRequested;
     const v8::Locker locker;
+    const Metrics::Clock::time_point lockAcquired;
     const v8::Isolate::Scope isolateScope;
     const v8::HandleScope handleScope;
     const v8::Local<v8::Context> context;
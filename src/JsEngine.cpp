@@ -146,6 +146,7 @@ void JsEngine::ScheduleTimer(const v8::FunctionCallbackInfo<v8::Value>& argument
 
 void JsEngine::CallTimerTask(const JsWeakValuesID& timerParamsID)
 {
+  ABP_TRACE_SCOPE(platform.GetTracer(), "Timer", "CallTimerTask");
   auto timerParams = TakeJsValues(timerParamsID);
   JsValue callback = std::move(timerParams[0]);
 
@@ -189,6 +190,8 @@ AdblockPlus::JsValue AdblockPlus::JsEngine::GetGlobalObject()
 AdblockPlus::JsValue AdblockPlus::JsEngine::Evaluate(const std::string& source,
     const std::string& filename)
 {
+  ABP_TRACE_SCOPE(platform.GetTracer(), "JsEngine", "Evaluate", filename.c_str());
+  const Metrics::Timer timer(metrics, Metrics::OPERATION_EVALUATE);
   const JsContext context(*this);
   const v8::TryCatch tryCatch;
   const v8::Handle<v8::Script> script = CompileScript(GetIsolate(), source,
@@ -227,14 +230,29 @@ void AdblockPlus::JsEngine::TriggerEvent(const std::string& eventName, AdblockPl
       return;
     callback = it->second;
   }
+  const Metrics::Timer timer(metrics, Metrics::OPERATION_TRIGGER_EVENT);
   callback(move(params));
 }
 
 void AdblockPlus::JsEngine::Gc()
 {
+  const JsContext context(*this);
   while (!GetIsolate()->IdleNotification(1000));
 }
 
+AdblockPlus::JsEngine::HeapStatistics AdblockPlus::JsEngine::GetHeapStatistics()
+{
+  const JsContext context(*this);
+  v8::HeapStatistics v8Statistics;
+  GetIsolate()->GetHeapStatistics(&v8Statistics);
+  HeapStatistics statistics;
+  statistics.totalHeapSize = v8Statistics.total_heap_size();
+  statistics.usedHeapSize = v8Statistics.used_heap_size();
+  statistics.heapSizeLimit = v8Statistics.heap_size_limit();
+  statistics.externalMemory = GetIsolate()->AdjustAmountOfExternalAllocatedMemory(0);
+  return statistics;
+}
+
 AdblockPlus::JsValue AdblockPlus::JsEngine::NewValue(const std::string& val)
 {
   const JsContext context(*this);
@@ -0,0 +1,268 @@
+/*
+ * This file is part of Adblock Plus <https://adblockplus.org/>,
+ * Copyright (C) 2006-present eyeo GmbH
+ *
+ * Adblock Plus is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 3 as
+ * published by the Free Software Foundation.
+ *
+ * Adblock Plus is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Adblock Plus.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <algorithm>
+#include <sstream>
+#include <AdblockPlus/Metrics.h>
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+using namespace AdblockPlus;
+
+namespace
+{
+  // Durations of 2^41 ns (about 37 minutes) and above share the last bucket.
+  const int maxExponent = 40;
+
+  int GetMostSignificantBit(uint64_t value)
+  {
+#ifdef _MSC_VER
+    unsigned long index;
+#ifdef _WIN64
+    _BitScanReverse64(&index, value);
+#else
+    if (_BitScanReverse(&index, static_cast<unsigned long>(value >> 32)))
+      return static_cast<int>(index) + 32;
+    _BitScanReverse(&index, static_cast<unsigned long>(value));
+#endif
+    return static_cast<int>(index);
+#else
+    return 63 - __builtin_clzll(value);
+#endif
+  }
+
+  std::atomic<uint64_t> nextMetricsId(1);
+
+  struct ThreadCache
+  {
+    uint64_t metricsId;
+    void* shard;
+  };
+
+  thread_local ThreadCache threadCache = {0, nullptr};
+
+  void WriteSeconds(std::ostream& out, uint64_t nanoseconds)
+  {
+    out << nanoseconds / 1e9;
+  }
+}
+
+struct Metrics::Shard
+{
+  Shard()
+  {
+    for (int operation = 0; operation < OPERATION_COUNT; operation++)
+    {
+      totalNanoseconds[operation] = 0;
+      maxNanoseconds[operation] = 0;
+      for (size_t i = 0; i < LatencyHistogram::bucketCount; i++)
+        bucketCounts[operation][i] = 0;
+    }
+  }
+
+  // Only written by the owning thread, other threads read them while
+  // collecting the histograms.
+  std::atomic<uint64_t> totalNanoseconds[OPERATION_COUNT];
+  std::atomic<uint64_t> maxNanoseconds[OPERATION_COUNT];
+  std::atomic<uint64_t> bucketCounts[OPERATION_COUNT][LatencyHistogram::bucketCount];
+};
+
+LatencyHistogram::LatencyHistogram()
+  : count(0), totalNanoseconds(0), maxNanoseconds(0), bucketCounts(bucketCount)
+{
+}
+
+uint64_t LatencyHistogram::GetBucketUpperBound(size_t index)
+{
+  if (index < 8)
+    return index + 1;
+  int exponent = static_cast<int>(index / 8) + 2;
+  uint64_t subBucket = index % 8;
+  return (9 + subBucket) << (exponent - 3);
+}
+
+size_t LatencyHistogram::GetBucketIndex(uint64_t nanoseconds)
+{
+  if (nanoseconds < 8)
+    return static_cast<size_t>(nanoseconds);
+  int exponent = GetMostSignificantBit(nanoseconds);
+  if (exponent > maxExponent)
+    return bucketCount - 1;
+  size_t subBucket = static_cast<size_t>(nanoseconds >> (exponent - 3)) & 7;
+  return static_cast<size_t>(exponent - 2) * 8 + subBucket;
+}
+
+uint64_t LatencyHistogram::GetPercentile(double percentile) const
+{
+  if (count == 0)
+    return 0;
+  uint64_t rank = static_cast<uint64_t>(percentile / 100 * count + 0.5);
+  if (rank < 1)
+    rank = 1;
+  uint64_t seen = 0;
+  for (size_t i = 0; i < bucketCounts.size(); i++)
+  {
+    seen += bucketCounts[i];
+    if (seen >= rank)
+      return std::min(GetBucketUpperBound(i), maxNanoseconds);
+  }
+  return maxNanoseconds;
+}
+
+Metrics::Metrics()
+  : id(nextMetricsId++)
+{
+}
+
+Metrics::~Metrics()
+{
+}
+
+const char* Metrics::GetOperationName(Operation operation)
+{
+  switch (operation)
+  {
+    case OPERATION_CREATE_FILTER_ENGINE:
+      return "CreateFilterEngine";
+    case OPERATION_MATCHES:
+      return "Matches";
+    case OPERATION_IS_DOCUMENT_WHITELISTED:
+      return "IsDocumentWhitelisted";
+    case OPERATION_IS_ELEMHIDE_WHITELISTED:
+      return "IsElemhideWhitelisted";
+    case OPERATION_GET_ELEMENT_HIDING_SELECTORS:
+      return "GetElementHidingSelectors";
+    case OPERATION_GET_FILTER:
+      return "GetFilter";
+    case OPERATION_GET_LISTED_FILTERS:
+      return "GetListedFilters";
+    case OPERATION_GET_SUBSCRIPTION:
+      return "GetSubscription";
+    case OPERATION_GET_LISTED_SUBSCRIPTIONS:
+      return "GetListedSubscriptions";
+    case OPERATION_GET_PREF:
+      return "GetPref";
+    case OPERATION_SET_PREF:
+      return "SetPref";
+    case OPERATION_EVALUATE:
+      return "Evaluate";
+    case OPERATION_TRIGGER_EVENT:
+      return "TriggerEvent";
+    case OPERATION_V8_LOCK_WAIT:
+      return "V8LockWait";
+    case OPERATION_GET_SUBSCRIPTION_FILTERS:
+      return "GetSubscriptionFilters";
+    case OPERATION_COUNT:
+      break;
+  }
+  return "";
+}
+
+Metrics::Shard& Metrics::GetShard()
+{
+  if (threadCache.metricsId == id)
+    return *static_cast<Shard*>(threadCache.shard);
+
+  std::lock_guard<std::mutex> lock(mutex);
+  std::unique_ptr<Shard>& shard = shards[std::this_thread::get_id()];
+  if (!shard)
+    shard.reset(new Shard());
+  threadCache.metricsId = id;
+  threadCache.shard = shard.get();
+  return *shard;
+}
+
+void Metrics::Record(Operation operation, Clock::duration duration)
+{
+  int64_t nanoseconds = std::chrono::duration_cast<std::chrono::nanoseconds>(duration).count();
+  uint64_t value = nanoseconds > 0 ? static_cast<uint64_t>(nanoseconds) : 0;
+  Shard& shard = GetShard();
+
+  // There is only one writer per shard, so plain loads and stores suffice.
+  std::atomic<uint64_t>& bucket = shard.bucketCounts[operation][LatencyHistogram::GetBucketIndex(value)];
+  bucket.store(bucket.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+  std::atomic<uint64_t>& total = shard.totalNanoseconds[operation];
+  total.store(total.load(std::memory_order_relaxed) + value, std::memory_order_relaxed);
+  std::atomic<uint64_t>& max = shard.maxNanoseconds[operation];
+  if (value > max.load(std::memory_order_relaxed))
+    max.store(value, std::memory_order_relaxed);
+}
+
+std::vector<LatencyHistogram> Metrics::GetHistograms() const
+{
+  std::vector<LatencyHistogram> result(OPERATION_COUNT);
+  for (int operation = 0; operation < OPERATION_COUNT; operation++)
+    result[operation].name = GetOperationName(static_cast<Operation>(operation));
+
+  std::lock_guard<std::mutex> lock(mutex);
+  for (const auto& entry : shards)
+  {
+    const Shard& shard = *entry.second;
+    for (int operation = 0; operation < OPERATION_COUNT; operation++)
+    {
+      LatencyHistogram& histogram = result[operation];
+      for (size_t i = 0; i < LatencyHistogram::bucketCount; i++)
+      {
+        uint64_t count = shard.bucketCounts[operation][i].load(std::memory_order_relaxed);
+        histogram.bucketCounts[i] += count;
+        histogram.count += count;
+      }
+      histogram.totalNanoseconds += shard.totalNanoseconds[operation].load(std::memory_order_relaxed);
+      histogram.maxNanoseconds = std::max(histogram.maxNanoseconds,
+        shard.maxNanoseconds[operation].load(std::memory_order_relaxed));
+    }
+  }
+  return result;
+}
+
+std::string Metrics::ToPrometheusText(const std::vector<LatencyHistogram>& histograms)
+{
+  std::stringstream result;
+  result.precision(10);
+  result << "# HELP abp_latency_seconds Duration of libadblockplus operations.\n";
+  result << "# TYPE abp_latency_seconds histogram\n";
+  for (const auto& histogram : histograms)
+  {
+    // Bucket boundaries are powers of two from about 1 microsecond to
+    // 17 seconds, each of them is also a boundary of the internal buckets.
+    uint64_t cumulativeCount = 0;
+    size_t index = 0;
+    for (int exponent = 10; exponent <= 34; exponent++)
+    {
+      uint64_t upperBound = static_cast<uint64_t>(1) << exponent;
+      while (index < histogram.bucketCounts.size() &&
+        LatencyHistogram::GetBucketUpperBound(index) <= upperBound)
+      {
+        cumulativeCount += histogram.bucketCounts[index++];
+      }
+      result << "abp_latency_seconds_bucket{operation=\"" << histogram.name
+        << "\",le=\"";
+      WriteSeconds(result, upperBound);
+      result << "\"} " << cumulativeCount << "\n";
+    }
+    result << "abp_latency_seconds_bucket{operation=\"" << histogram.name
+      << "\",le=\"+Inf\"} " << histogram.count << "\n";
+    result << "abp_latency_seconds_sum{operation=\"" << histogram.name << "\"} ";
+    WriteSeconds(result, histogram.totalNanoseconds);
+    result << "\n";
+    result << "abp_latency_seconds_count{operation=\"" << histogram.name
+      << "\"} " << histogram.count << "\n";
+  }
+  return result.str();
+}
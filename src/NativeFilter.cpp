@@ -0,0 +1,755 @@
+/*
+ * This file is part of Adblock Plus <https://adblockplus.org/>,
+ * Copyright (C) 2006-present eyeo GmbH
+ *
+ * Adblock Plus is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 3 as
+ * published by the Free Software Foundation.
+ *
+ * Adblock Plus is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Adblock Plus.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <algorithm>
+#include <cctype>
+#include <map>
+#include "NativeFilter.h"
+
+using namespace AdblockPlus;
+
+namespace
+{
+  // RegExpFilter.typeMap, including the legacy aliases.
+  const std::map<std::string, uint32_t>& GetTypeMap()
+  {
+    static const std::map<std::string, uint32_t> typeMap = {
+      {"OTHER", ContentTypes::CONTENT_TYPE_OTHER},
+      {"SCRIPT", ContentTypes::CONTENT_TYPE_SCRIPT},
+      {"IMAGE", ContentTypes::CONTENT_TYPE_IMAGE},
+      {"STYLESHEET", ContentTypes::CONTENT_TYPE_STYLESHEET},
+      {"OBJECT", ContentTypes::CONTENT_TYPE_OBJECT},
+      {"SUBDOCUMENT", ContentTypes::CONTENT_TYPE_SUBDOCUMENT},
+      {"DOCUMENT", ContentTypes::CONTENT_TYPE_DOCUMENT},
+      {"WEBSOCKET", ContentTypes::CONTENT_TYPE_WEBSOCKET},
+      {"WEBRTC", ContentTypes::CONTENT_TYPE_WEBRTC},
+      {"PING", ContentTypes::CONTENT_TYPE_PING},
+      {"XMLHTTPREQUEST", ContentTypes::CONTENT_TYPE_XMLHTTPREQUEST},
+      {"OBJECT_SUBREQUEST", ContentTypes::CONTENT_TYPE_OBJECT_SUBREQUEST},
+      {"MEDIA", ContentTypes::CONTENT_TYPE_MEDIA},
+      {"FONT", ContentTypes::CONTENT_TYPE_FONT},
+      {"BACKGROUND", ContentTypes::CONTENT_TYPE_IMAGE},
+      {"XBL", ContentTypes::CONTENT_TYPE_OTHER},
+      {"DTD", ContentTypes::CONTENT_TYPE_OTHER},
+      {"POPUP", 0x10000000},
+      {"GENERICBLOCK", ContentTypes::CONTENT_TYPE_GENERICBLOCK},
+      {"ELEMHIDE", ContentTypes::CONTENT_TYPE_ELEMHIDE},
+      {"GENERICHIDE", ContentTypes::CONTENT_TYPE_GENERICHIDE}
+    };
+    return typeMap;
+  }
+
+  // RegExpFilter.prototype.contentType, the types filters without type
+  // options apply to.
+  const uint32_t defaultContentType = 0x7FFFFFFF &
+    ~(ContentTypes::CONTENT_TYPE_DOCUMENT | ContentTypes::CONTENT_TYPE_ELEMHIDE |
+      0x10000000 | ContentTypes::CONTENT_TYPE_GENERICBLOCK);
+
+  bool IsWordCharacter(char c)
+  {
+    return std::isalnum(static_cast<unsigned char>(c)) || c == '_';
+  }
+
+  bool IsKeywordCharacter(char c)
+  {
+    return (c >= 'a' && c <= 'z') || (c >= '0' && c <= '9') || c == '%';
+  }
+
+  bool IsSpace(char c)
+  {
+    return std::isspace(static_cast<unsigned char>(c)) != 0;
+  }
+
+  bool IsDigit(char c)
+  {
+    return c >= '0' && c <= '9';
+  }
+
+  bool IsHexDigit(char c)
+  {
+    return std::isxdigit(static_cast<unsigned char>(c)) != 0;
+  }
+
+  // Checks whether text, starting at position, is matched by the option list
+  // part of Filter.optionsRegExp. Filter.regexpRegExp is stricter about the
+  // option values.
+  bool IsOptionList(const std::string& text, size_t position, bool strictValues)
+  {
+    size_t length = text.size();
+    while (true)
+    {
+      if (position < length && text[position] == '~')
+        position++;
+      size_t nameStart = position;
+      while (position < length && (IsWordCharacter(text[position]) || text[position] == '-'))
+        position++;
+      if (position == nameStart)
+        return false;
+      if (position < length && text[position] == '=')
+      {
+        size_t valueStart = ++position;
+        while (position < length && text[position] != ',' &&
+          !(strictValues && IsSpace(text[position])))
+        {
+          position++;
+        }
+        if (strictValues && position == valueStart)
+          return false;
+      }
+      if (position == length)
+        return true;
+      if (text[position] != ',')
+        return false;
+      position++;
+    }
+  }
+
+  // Position of the "$" starting the options of a request filter, like
+  // Filter.optionsRegExp.
+  size_t FindOptions(const std::string& text)
+  {
+    for (size_t position = text.find('$'); position != std::string::npos;
+      position = text.find('$', position + 1))
+    {
+      if (IsOptionList(text, position + 1, false))
+        return position;
+    }
+    return std::string::npos;
+  }
+
+  // Filter.regexpRegExp
+  bool IsRegExpFilterText(const std::string& text)
+  {
+    size_t start = text.compare(0, 2, "@@") == 0 ? 2 : 0;
+    if (text.size() < start + 2 || text[start] != '/')
+      return false;
+    for (size_t position = text.size() - 1; position > start; position--)
+    {
+      if (text[position] != '/')
+        continue;
+      if (position == text.size() - 1)
+        return true;
+      if (text[position + 1] == '$' && IsOptionList(text, position + 2, true))
+        return true;
+    }
+    return false;
+  }
+
+  std::string StripTrailingDots(const std::string& text)
+  {
+    size_t end = text.find_last_not_of('.');
+    return end == std::string::npos ? std::string() : text.substr(0, end + 1);
+  }
+
+  std::vector<std::string> Split(const std::string& text, char separator)
+  {
+    std::vector<std::string> result;
+    size_t start = 0;
+    while (true)
+    {
+      size_t end = text.find(separator, start);
+      result.push_back(text.substr(start, end == std::string::npos ? end : end - start));
+      if (end == std::string::npos)
+        return result;
+      start = end + 1;
+    }
+  }
+
+  // ActiveFilter.domains
+  void ParseDomains(const std::string& source, char separator,
+    bool ignoreTrailingDot, NativeFilter::Parsed& filter)
+  {
+    std::vector<std::string> list = Split(NativeFilter::ToLowerCase(source), separator);
+    std::map<std::string, bool> domains;
+    if (list.size() == 1 && (list[0].empty() || list[0][0] != '~'))
+    {
+      domains[ignoreTrailingDot ? StripTrailingDots(list[0]) : list[0]] = true;
+      filter.domainDefault = false;
+    }
+    else
+    {
+      bool hasIncludes = false;
+      for (auto& domain : list)
+      {
+        if (ignoreTrailingDot)
+          domain = StripTrailingDots(domain);
+        if (domain.empty())
+          continue;
+        bool include = domain[0] != '~';
+        if (include)
+          hasIncludes = true;
+        else
+          domain.erase(0, 1);
+        domains[domain] = include;
+      }
+      filter.domainDefault = !hasIncludes;
+    }
+    // The default is stored separately.
+    domains.erase("");
+    filter.domains.assign(domains.begin(), domains.end());
+  }
+
+  // Filter.elemhideRegExp and ElemHideBase.fromText()
+  bool ParseElementHidingFilter(const std::string& text, NativeFilter::Parsed& filter)
+  {
+    for (size_t position = 0; position < text.size(); position++)
+    {
+      char c = text[position];
+      if (c == '/' || c == '*' || c == '|' || c == '@' || c == '"' || c == '!')
+        return false;
+      if (c != '#')
+        continue;
+
+      char type = 0;
+      size_t selectorStart = std::string::npos;
+      if (position + 3 < text.size() && (text[position + 1] == '@' ||
+        text[position + 1] == '?') && text[position + 2] == '#')
+      {
+        type = text[position + 1];
+        selectorStart = position + 3;
+      }
+      else if (position + 2 < text.size() && text[position + 1] == '#')
+        selectorStart = position + 2;
+      if (selectorStart == std::string::npos)
+        continue;
+
+      std::string domains = text.substr(0, position);
+      filter.pattern = text.substr(selectorStart);
+      for (const auto& domain : Split(domains, ','))
+      {
+        if (!domains.empty() && (domain.empty() || domain == "~"))
+          return true;
+      }
+      if (type == '@')
+        filter.type = FilterTypes::TYPE_ELEMHIDE_EXCEPTION;
+      else if (type == '?')
+      {
+        // Emulation filters have to be restricted to a domain.
+        bool hasDomain = false;
+        for (const auto& domain : Split(domains, ','))
+        {
+          size_t dot = domain.empty() ? std::string::npos : domain.find('.', 1);
+          if (dot != std::string::npos && domain[0] != '~' && dot + 1 < domain.size())
+            hasDomain = true;
+        }
+        if (!hasDomain)
+          return true;
+        filter.type = FilterTypes::TYPE_ELEMHIDE_EMULATION;
+      }
+      else
+        filter.type = FilterTypes::TYPE_ELEMHIDE;
+      if (!domains.empty())
+        ParseDomains(domains, ',', false, filter);
+      return true;
+    }
+    return false;
+  }
+
+  // RegExpFilter.fromText() and Filter.toRegExp()
+  void ParseRequestFilter(std::string text, NativeFilter::Parsed& filter)
+  {
+    bool blocking = true;
+    if (text.compare(0, 2, "@@") == 0)
+    {
+      blocking = false;
+      text.erase(0, 2);
+    }
+
+    bool hasContentType = false;
+    uint32_t contentType = 0;
+    size_t optionsStart = FindOptions(text);
+    if (optionsStart != std::string::npos)
+    {
+      for (auto option : Split(text.substr(optionsStart + 1), ','))
+      {
+        std::string value;
+        size_t separator = option.find('=');
+        if (separator != std::string::npos)
+        {
+          value = option.substr(separator + 1);
+          option.erase(separator);
+        }
+        size_t dash = option.find('-');
+        if (dash != std::string::npos)
+          option[dash] = '_';
+        std::transform(option.begin(), option.end(), option.begin(), ::toupper);
+
+        const auto& typeMap = GetTypeMap();
+        auto type = typeMap.find(option);
+        auto inverseType = option[0] == '~' ? typeMap.find(option.substr(1)) : typeMap.end();
+        if (type != typeMap.end())
+        {
+          if (!hasContentType)
+            contentType = 0;
+          hasContentType = true;
+          contentType |= type->second;
+        }
+        else if (inverseType != typeMap.end())
+        {
+          if (!hasContentType)
+            contentType = defaultContentType;
+          hasContentType = true;
+          contentType &= ~inverseType->second;
+        }
+        else if (option == "MATCH_CASE")
+          filter.flags |= NativeFilter::FLAG_MATCH_CASE;
+        else if (option == "~MATCH_CASE")
+          filter.flags &= ~NativeFilter::FLAG_MATCH_CASE;
+        else if (option == "DOMAIN" && !value.empty())
+          ParseDomains(value, '|', true, filter);
+        else if (option == "THIRD_PARTY")
+          filter.flags = (filter.flags & ~NativeFilter::FLAG_FIRST_PARTY) | NativeFilter::FLAG_THIRD_PARTY;
+        else if (option == "~THIRD_PARTY")
+          filter.flags = (filter.flags & ~NativeFilter::FLAG_THIRD_PARTY) | NativeFilter::FLAG_FIRST_PARTY;
+        else if (option == "SITEKEY" && !value.empty())
+          filter.flags |= NativeFilter::FLAG_SITEKEY;
+        else if (option == "COLLAPSE" || option == "~COLLAPSE" ||
+          (option == "REWRITE" && !value.empty()))
+        {
+          // Don't affect matching.
+        }
+        else
+          return;
+      }
+      text.erase(optionsStart);
+    }
+    filter.contentType = hasContentType ? contentType : defaultContentType;
+    filter.type = blocking ? FilterTypes::TYPE_BLOCKING : FilterTypes::TYPE_EXCEPTION;
+
+    if (text.size() >= 2 && text[0] == '/' && text[text.size() - 1] == '/')
+    {
+      filter.flags |= NativeFilter::FLAG_REGEXP;
+      filter.pattern = text.substr(1, text.size() - 2);
+      return;
+    }
+
+    std::string pattern;
+    for (char c : text)
+    {
+      if (c != '*' || pattern.empty() || pattern.back() != '*')
+        pattern += c;
+    }
+    if (pattern.size() >= 2 && pattern.compare(pattern.size() - 2, 2, "^|") == 0)
+      pattern.erase(pattern.size() - 1);
+    if (pattern.compare(0, 2, "||") == 0)
+    {
+      filter.flags |= NativeFilter::FLAG_ANCHOR_DOMAIN;
+      pattern.erase(0, 2);
+    }
+    else if (pattern.compare(0, 1, "|") == 0)
+    {
+      filter.flags |= NativeFilter::FLAG_ANCHOR_START;
+      pattern.erase(0, 1);
+    }
+    if (!pattern.empty() && pattern.back() == '|')
+    {
+      filter.flags |= NativeFilter::FLAG_ANCHOR_END;
+      pattern.erase(pattern.size() - 1);
+    }
+    if (!(filter.flags & NativeFilter::FLAG_MATCH_CASE))
+      pattern = NativeFilter::ToLowerCase(pattern);
+    filter.pattern = pattern;
+  }
+
+  bool IsSeparator(char c)
+  {
+    // All ASCII characters but letters, digits and _%.- are separators.
+    unsigned char value = static_cast<unsigned char>(c);
+    return value < 0x80 && !IsWordCharacter(c) && c != '%' && c != '.' && c != '-';
+  }
+
+  bool MatchesFrom(const char* pattern, const char* patternEnd,
+    const std::string& url, size_t position, bool anchorEnd)
+  {
+    while (pattern < patternEnd)
+    {
+      char c = *pattern++;
+      if (c == '*')
+      {
+        if (pattern == patternEnd)
+          return true;
+        for (; position <= url.size(); position++)
+        {
+          if (*pattern != '*' && *pattern != '^' && position < url.size() &&
+            url[position] != *pattern)
+          {
+            continue;
+          }
+          if (MatchesFrom(pattern, patternEnd, url, position, anchorEnd))
+            return true;
+        }
+        return false;
+      }
+      if (c == '^')
+      {
+        // Matches a separator or the end of the URL.
+        if (position == url.size())
+          continue;
+        if (!IsSeparator(url[position]))
+          return false;
+      }
+      else if (position == url.size() || url[position] != c)
+        return false;
+      position++;
+    }
+    return !anchorEnd || position == url.size();
+  }
+}
+
+std::string NativeFilter::Normalize(const std::string& text)
+{
+  // Spaces are the only whitespace kept.
+  std::string result;
+  for (char c : text)
+  {
+    if (c == ' ' || !std::isspace(static_cast<unsigned char>(c)))
+      result += c;
+  }
+
+  auto trim = [](const std::string& value)
+  {
+    size_t start = value.find_first_not_of(' ');
+    if (start == std::string::npos)
+      return std::string();
+    return value.substr(start, value.find_last_not_of(' ') - start + 1);
+  };
+  auto removeSpaces = [](std::string value)
+  {
+    value.erase(std::remove(value.begin(), value.end(), ' '), value.end());
+    return value;
+  };
+
+  // Spaces inside comments and element hiding selectors are significant.
+  size_t firstChar = result.find_first_not_of(' ');
+  if (firstChar != std::string::npos && result[firstChar] == '!')
+    return trim(result);
+  Parsed elementHidingFilter;
+  if (result.find('#') != std::string::npos &&
+    ParseElementHidingFilter(result, elementHidingFilter))
+  {
+    // Splits at the first #, like the /^(.*?)(#[@?]?#?)(.*)$/ expression.
+    size_t separatorStart = result.find('#');
+    size_t separatorEnd = separatorStart + 1;
+    if (separatorEnd < result.size() && (result[separatorEnd] == '@' ||
+      result[separatorEnd] == '?'))
+    {
+      separatorEnd++;
+    }
+    if (separatorEnd < result.size() && result[separatorEnd] == '#')
+      separatorEnd++;
+    return removeSpaces(result.substr(0, separatorStart)) +
+      result.substr(separatorStart, separatorEnd - separatorStart) +
+      trim(result.substr(separatorEnd));
+  }
+  return removeSpaces(result);
+}
+
+NativeFilter::Parsed NativeFilter::Parse(const std::string& text)
+{
+  Parsed filter;
+  filter.text = text;
+  if (text.empty())
+    return filter;
+  if (text.find('#') != std::string::npos && ParseElementHidingFilter(text, filter))
+    return filter;
+  if (text[0] == '!')
+  {
+    filter.type = FilterTypes::TYPE_COMMENT;
+    return filter;
+  }
+  ParseRequestFilter(text, filter);
+  return filter;
+}
+
+std::vector<std::string> NativeFilter::GetKeywordCandidates(const std::string& text)
+{
+  std::vector<std::string> candidates;
+  if (IsRegExpFilterText(text))
+    return candidates;
+
+  std::string pattern = ToLowerCase(text.substr(0, FindOptions(text)));
+  if (pattern.compare(0, 2, "@@") == 0)
+    pattern.erase(0, 2);
+
+  // [^a-z0-9%*][a-z0-9%]{3,}(?=[^a-z0-9%*])
+  for (size_t position = 0; position < pattern.size(); position++)
+  {
+    if (IsKeywordCharacter(pattern[position]) || pattern[position] == '*')
+      continue;
+    size_t end = position + 1;
+    while (end < pattern.size() && IsKeywordCharacter(pattern[end]))
+      end++;
+    if (end - position > 3 && end < pattern.size() && pattern[end] != '*')
+    {
+      candidates.push_back(pattern.substr(position + 1, end - position - 1));
+      position = end - 1;
+    }
+  }
+  return candidates;
+}
+
+std::vector<std::string> NativeFilter::GetUrlKeywordCandidates(const std::string& lowerCaseUrl)
+{
+  std::vector<std::string> candidates;
+  size_t position = 0;
+  while (position < lowerCaseUrl.size())
+  {
+    size_t end = position;
+    while (end < lowerCaseUrl.size() && IsKeywordCharacter(lowerCaseUrl[end]))
+      end++;
+    if (end - position >= 3)
+      candidates.push_back(lowerCaseUrl.substr(position, end - position));
+    position = end + 1;
+  }
+  candidates.push_back("");
+  return candidates;
+}
+
+bool NativeFilter::MatchesPattern(const char* pattern, size_t patternLength,
+  uint32_t flags, const std::string& url)
+{
+  const char* patternEnd = pattern + patternLength;
+  bool anchorEnd = (flags & FLAG_ANCHOR_END) != 0;
+  if (flags & FLAG_ANCHOR_DOMAIN)
+  {
+    // ^[\w\-]+:\/+(?!\/)(?:[^\/]+\.)?
+    size_t position = 0;
+    while (position < url.size() && (IsWordCharacter(url[position]) || url[position] == '-'))
+      position++;
+    if (position == 0 || position == url.size() || url[position] != ':')
+      return false;
+    size_t slashes = ++position;
+    while (position < url.size() && url[position] == '/')
+      position++;
+    if (position == slashes)
+      return false;
+    if (MatchesFrom(pattern, patternEnd, url, position, anchorEnd))
+      return true;
+    for (size_t dot = position + 1; dot < url.size() && url[dot] != '/'; dot++)
+    {
+      if (url[dot] == '.' && MatchesFrom(pattern, patternEnd, url, dot + 1, anchorEnd))
+        return true;
+    }
+    return false;
+  }
+  if (flags & FLAG_ANCHOR_START)
+    return MatchesFrom(pattern, patternEnd, url, 0, anchorEnd);
+
+  char first = patternLength ? *pattern : '*';
+  for (size_t position = 0; position <= url.size(); position++)
+  {
+    if (first != '*' && first != '^')
+    {
+      position = url.find(first, position);
+      if (position == std::string::npos)
+        return false;
+    }
+    if (MatchesFrom(pattern, patternEnd, url, position, anchorEnd))
+      return true;
+  }
+  return false;
+}
+
+std::string NativeFilter::ToLowerCase(const std::string& text)
+{
+  std::string result(text);
+  for (auto& c : result)
+  {
+    if (c >= 'A' && c <= 'Z')
+      c += 'a' - 'A';
+  }
+  return result;
+}
+
+std::string NativeFilter::ExtractHost(const std::string& url)
+{
+  // See URI in basedomain.js.
+  size_t schemeEnd = url.find(':');
+  if (schemeEnd == std::string::npos || url.compare(schemeEnd + 1, 2, "//") != 0)
+    return std::string();
+  size_t hostPortStart = schemeEnd + 3;
+  if (hostPortStart == url.size())
+    return std::string();
+
+  size_t hostPortEnd = url.find('/', hostPortStart);
+  if (hostPortEnd == std::string::npos)
+  {
+    hostPortEnd = std::min(url.find('?', hostPortStart), url.find('#', hostPortStart));
+    if (hostPortEnd == std::string::npos)
+      hostPortEnd = url.size();
+  }
+
+  size_t authEnd = url.find('@', hostPortStart);
+  if (authEnd != std::string::npos && authEnd < hostPortEnd)
+    hostPortStart = authEnd + 1;
+
+  size_t hostStart = hostPortStart;
+  size_t hostEnd = url.find(']', hostPortStart + 1);
+  if (hostPortStart < url.size() && url[hostPortStart] == '[' &&
+    hostEnd != std::string::npos && hostEnd < hostPortEnd)
+  {
+    // IPv6 literal
+    hostStart++;
+  }
+  else
+  {
+    hostEnd = url.find(':', hostStart);
+    if (hostEnd == std::string::npos || hostEnd >= hostPortEnd)
+      hostEnd = hostPortEnd;
+  }
+  return url.substr(hostStart, hostEnd - hostStart);
+}
+
+namespace
+{
+  bool IsIPv4Part(const std::string& part)
+  {
+    // (?:25[0-5]|2[0-4][0-9]|[01]?[0-9][0-9]?|0x[0-9a-f][0-9a-f]?|0[0-7]{3})
+    if (part.size() >= 3 && part.size() <= 4 && part[0] == '0' &&
+      (part[1] == 'x' || part[1] == 'X'))
+    {
+      return std::all_of(part.begin() + 2, part.end(), IsHexDigit);
+    }
+    if (part.empty() || part.size() > 4 || !std::all_of(part.begin(), part.end(), IsDigit))
+      return false;
+    if (part.size() == 4)
+      return part[0] == '0' && std::all_of(part.begin(), part.end(), [](char c) { return c <= '7'; });
+    if (part.size() == 3 && part[0] == '2')
+      return std::stoi(part) <= 255;
+    return part.size() < 3 || part[0] == '0' || part[0] == '1';
+  }
+
+  bool IsIPv4(const std::string& address)
+  {
+    if (!address.empty() && std::all_of(address.begin(), address.end(), IsDigit))
+      return true;
+    if (address.size() == 10 && address[0] == '0' && (address[1] == 'x' || address[1] == 'X') &&
+      std::all_of(address.begin() + 2, address.end(), IsHexDigit))
+    {
+      return true;
+    }
+    std::vector<std::string> parts = Split(address, '.');
+    return parts.size() == 4 && std::all_of(parts.begin(), parts.end(), IsIPv4Part);
+  }
+
+  size_t Count(const std::string& text, const std::string& part)
+  {
+    size_t count = 0;
+    for (size_t position = text.find(part); position != std::string::npos;
+      position = text.find(part, position + part.size()))
+    {
+      count++;
+    }
+    return count;
+  }
+
+  bool IsIPv6(std::string address)
+  {
+    size_t v4Addon = 0;
+    // A trailing dotted IPv4 address counts as two groups.
+    size_t v4Start = address.find_last_of(':');
+    if (v4Start != std::string::npos && address.find('.', v4Start) != std::string::npos)
+    {
+      std::vector<std::string> parts = Split(address.substr(v4Start + 1), '.');
+      if (parts.size() != 4)
+        return false;
+      for (const auto& part : parts)
+      {
+        if (part.empty() || part.size() > 3 || (part.size() > 1 && part[0] == '0') ||
+          !std::all_of(part.begin(), part.end(), IsDigit) || std::stoi(part) > 255)
+        {
+          return false;
+        }
+      }
+      address = address.substr(0, v4Start + 1) + parts[0] + ":" + parts[1] + ":" +
+        parts[2] + ":" + parts[3];
+      v4Addon = 2;
+    }
+
+    if (!std::all_of(address.begin(), address.end(), [](char c) { return IsHexDigit(c) || c == ':'; }))
+      return false;
+    size_t run = 0;
+    for (char c : address)
+    {
+      run = c == ':' ? 0 : run + 1;
+      if (run >= 5)
+        return false;
+    }
+    if (address.find(":::") != std::string::npos ||
+      (address.size() >= 2 && address.back() == ':' && address[address.size() - 2] != ':') ||
+      (address.size() == 2 && address[0] == ':' && address[1] != ':'))
+    {
+      return false;
+    }
+    size_t halves = Count(address, "::");
+    size_t colons = Count(address, ":");
+    return (halves == 1 && colons <= 6 + 2 + v4Addon) || (halves == 0 && colons == 7 + v4Addon);
+  }
+}
+
+bool NativeFilter::IsIPAddress(const std::string& host)
+{
+  return IsIPv6(host) || IsIPv4(host);
+}
+
+std::string NativeFilter::GetBaseDomain(const std::string& host,
+  const PublicSuffixLookup& lookupSuffix)
+{
+  std::string hostname = StripTrailingDots(host);
+  if (IsIPAddress(hostname))
+    return hostname;
+
+  // Internationalized suffixes of the list aren't found, because host names
+  // aren't converted from punycode.
+  std::vector<size_t> labelStarts;
+  size_t current = 0;
+  int labels = 0;
+  while (true)
+  {
+    labels = lookupSuffix(hostname.substr(current));
+    if (labels >= 0)
+      break;
+    size_t nextDot = hostname.find('.', current);
+    if (nextDot == std::string::npos)
+    {
+      labels = 1;
+      break;
+    }
+    labelStarts.push_back(current);
+    current = nextDot + 1;
+  }
+  while (labels > 0 && !labelStarts.empty())
+  {
+    current = labelStarts.back();
+    labelStarts.pop_back();
+    labels--;
+  }
+  return hostname.substr(current);
+}
+
+bool NativeFilter::IsThirdParty(const std::string& requestHost,
+  const std::string& documentHost, const PublicSuffixLookup& lookupSuffix)
+{
+  std::string request = StripTrailingDots(requestHost);
+  std::string documentDomain = GetBaseDomain(StripTrailingDots(documentHost), lookupSuffix);
+  if (request.size() > documentDomain.size())
+  {
+    return request.compare(request.size() - documentDomain.size() - 1,
+      std::string::npos, "." + documentDomain) != 0;
+  }
+  return request != documentDomain;
+}
@@ -0,0 +1,114 @@
+/*
+ * This file is part of Adblock Plus <https://adblockplus.org/>,
+ * Copyright (C) 2006-present eyeo GmbH
+ *
+ * Adblock Plus is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 3 as
+ * published by the Free Software Foundation.
+ *
+ * Adblock Plus is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Adblock Plus.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef ADBLOCK_PLUS_NATIVE_FILTER_H
+#define ADBLOCK_PLUS_NATIVE_FILTER_H
+
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <utility>
+#include <vector>
+#include <AdblockPlus/FilterTypes.h>
+
+namespace AdblockPlus
+{
+  // Native counterparts of the filter parsing and matching parts of
+  // adblockpluscore (filterClasses.js, matcher.js) and of basedomain.js,
+  // they don't depend on V8.
+  namespace NativeFilter
+  {
+    enum Flags
+    {
+      FLAG_MATCH_CASE = 1,
+      FLAG_REGEXP = 2,
+      FLAG_ANCHOR_START = 4,
+      FLAG_ANCHOR_DOMAIN = 8,
+      FLAG_ANCHOR_END = 16,
+      FLAG_THIRD_PARTY = 32,
+      FLAG_FIRST_PARTY = 64,
+      // Filters restricted to sitekeys, which can't be passed to Matches().
+      FLAG_SITEKEY = 128
+    };
+
+    struct Parsed
+    {
+      Parsed() : type(FilterTypes::TYPE_INVALID), contentType(0), flags(0),
+        domainDefault(true)
+      {
+      }
+
+      FilterTypes::Type type;
+      std::string text;
+      // Blocking and exception filters: the pattern without anchors, lower
+      // case unless FLAG_MATCH_CASE is set, or the regular expression
+      // source. Element hiding filters: the selector.
+      std::string pattern;
+      uint32_t contentType;
+      uint32_t flags;
+      // Sorted by domain, lower case.
+      std::vector<std::pair<std::string, bool>> domains;
+      // Whether the filter is active on domains which aren't listed.
+      bool domainDefault;
+    };
+
+    // Filter.normalize(), removes whitespace which isn't significant.
+    std::string Normalize(const std::string& text);
+
+    // Doesn't normalize the text, filters are expected as stored by
+    // FilterStorage.
+    Parsed Parse(const std::string& text);
+
+    // Keywords a request filter can be indexed by, in the order of
+    // Matcher.findKeyword(). Empty for regular expression filters.
+    std::vector<std::string> GetKeywordCandidates(const std::string& text);
+
+    // Keywords a URL is looked up by, like CombinedMatcher.matchesAny(),
+    // including the empty keyword.
+    std::vector<std::string> GetUrlKeywordCandidates(const std::string& lowerCaseUrl);
+
+    // Matches a pattern produced by Parse() against a URL which has to be
+    // lower case unless FLAG_MATCH_CASE is set. Doesn't handle FLAG_REGEXP.
+    bool MatchesPattern(const char* pattern, size_t patternLength,
+      uint32_t flags, const std::string& url);
+
+    std::string ToLowerCase(const std::string& text);
+    std::string ExtractHost(const std::string& url);
+    bool IsIPAddress(const std::string& host);
+
+    // Returns the value of a public suffix list entry, i.e. the number of
+    // labels preceding the suffix that belong to the base domain, or -1 if
+    // the suffix isn't listed.
+    typedef std::function<int(const std::string& suffix)> PublicSuffixLookup;
+
+    // lib/publicSuffixList.js, generated by convert_public_suffixes.py.
+    // Suffixes are UTF-8 encoded, the list ends with a null suffix.
+    struct PublicSuffix
+    {
+      const char* suffix;
+      int labels;
+    };
+    extern const PublicSuffix publicSuffixes[];
+
+    std::string GetBaseDomain(const std::string& host,
+      const PublicSuffixLookup& lookupSuffix);
+    bool IsThirdParty(const std::string& requestHost,
+      const std::string& documentHost, const PublicSuffixLookup& lookupSuffix);
+  }
+}
+
+#endif
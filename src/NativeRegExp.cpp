@@ -0,0 +1,666 @@
+/*
+ * This file is part of Adblock Plus <https://adblockplus.org/>,
+ * Copyright (C) 2006-present eyeo GmbH
+ *
+ * Adblock Plus is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 3 as
+ * published by the Free Software Foundation.
+ *
+ * Adblock Plus is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Adblock Plus.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <cctype>
+#include <limits>
+#include <stdexcept>
+#include <utility>
+#include "NativeRegExp.h"
+
+using namespace AdblockPlus;
+
+namespace
+{
+  enum Op
+  {
+    OP_CHAR,
+    OP_ANY,
+    OP_CLASS,
+    OP_ASSERT,
+    OP_SPLIT,
+    OP_JUMP,
+    OP_MATCH
+  };
+
+  enum Assertion
+  {
+    ASSERT_START,
+    ASSERT_END,
+    ASSERT_WORD_BOUNDARY,
+    ASSERT_NOT_WORD_BOUNDARY
+  };
+
+  // Bound the program size and the nesting of groups, so that neither
+  // compiling nor matching can take unbounded time or stack space.
+  const size_t maxProgramSize = 2000;
+  const int maxDepth = 50;
+  const uint32_t unbounded = std::numeric_limits<uint32_t>::max();
+
+  typedef std::bitset<256> CharSet;
+
+  uint8_t ToLower(uint8_t c)
+  {
+    return c >= 'A' && c <= 'Z' ? c + ('a' - 'A') : c;
+  }
+
+  bool IsDigit(uint8_t c)
+  {
+    return c >= '0' && c <= '9';
+  }
+
+  bool IsWordChar(uint8_t c)
+  {
+    return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || IsDigit(c) ||
+      c == '_';
+  }
+
+  int HexValue(uint8_t c)
+  {
+    if (IsDigit(c))
+      return c - '0';
+    c = ToLower(c);
+    if (c >= 'a' && c <= 'f')
+      return c - 'a' + 10;
+    return -1;
+  }
+
+  // \d, \w and \s, the negated forms are returned for upper case letters.
+  bool GetCharSetEscape(uint8_t c, CharSet& set)
+  {
+    set.reset();
+    switch (ToLower(c))
+    {
+    case 'd':
+      for (int i = '0'; i <= '9'; i++)
+        set.set(i);
+      break;
+    case 'w':
+      for (int i = 0; i < 256; i++)
+        set.set(i, IsWordChar(static_cast<uint8_t>(i)));
+      break;
+    case 's':
+      for (uint8_t space : {' ', '\t', '\n', '\v', '\f', '\r'})
+        set.set(space);
+      break;
+    default:
+      return false;
+    }
+    if (c != ToLower(c))
+      set.flip();
+    return true;
+  }
+
+  struct Node
+  {
+    enum Kind
+    {
+      CHAR,
+      ANY,
+      CLASS,
+      ASSERT,
+      CONCAT,
+      ALTERNATE,
+      REPEAT
+    };
+
+    explicit Node(Kind kind, uint8_t value = 0)
+      : kind(kind), value(value), index(0), min(0), max(0)
+    {
+    }
+
+    Kind kind;
+    uint8_t value;
+    uint32_t index;
+    uint32_t min;
+    uint32_t max;
+    std::vector<std::unique_ptr<Node>> children;
+  };
+  typedef std::unique_ptr<Node> NodePtr;
+}
+
+class NativeRegExp::Compiler
+{
+public:
+  Compiler(const std::string& source, NativeRegExp& result)
+    : source(source), pos(0), result(result)
+  {
+  }
+
+  // Throws std::invalid_argument for invalid or unsupported expressions.
+  void Compile()
+  {
+    NodePtr node = ParseDisjunction(0);
+    if (pos < source.size())
+      throw std::invalid_argument("Unmatched ')'");
+    Emit(*node);
+    Add(OP_MATCH);
+  }
+
+private:
+  bool Peek(char c) const
+  {
+    return pos < source.size() && source[pos] == c;
+  }
+
+  NodePtr ParseDisjunction(int depth)
+  {
+    if (depth > maxDepth)
+      throw std::invalid_argument("Groups nested too deeply");
+    NodePtr node(new Node(Node::ALTERNATE));
+    node->children.push_back(ParseSequence(depth));
+    while (Peek('|'))
+    {
+      pos++;
+      node->children.push_back(ParseSequence(depth));
+    }
+    if (node->children.size() == 1)
+      return std::move(node->children[0]);
+    return node;
+  }
+
+  NodePtr ParseSequence(int depth)
+  {
+    NodePtr node(new Node(Node::CONCAT));
+    while (pos < source.size() && !Peek('|') && !Peek(')'))
+      node->children.push_back(ParseTerm(depth));
+    return node;
+  }
+
+  NodePtr ParseTerm(int depth)
+  {
+    NodePtr atom = ParseAtom(depth);
+    uint32_t min;
+    uint32_t max;
+    if (Peek('*'))
+    {
+      min = 0;
+      max = unbounded;
+      pos++;
+    }
+    else if (Peek('+'))
+    {
+      min = 1;
+      max = unbounded;
+      pos++;
+    }
+    else if (Peek('?'))
+    {
+      min = 0;
+      max = 1;
+      pos++;
+    }
+    else if (!ParseBraces(min, max))
+      return atom;
+
+    if (atom->kind == Node::ASSERT)
+      throw std::invalid_argument("Nothing to repeat");
+    if (min > max)
+      throw std::invalid_argument("Numbers out of order in quantifier");
+    // Matching stops at the first match, lazy quantifiers don't differ.
+    if (Peek('?'))
+      pos++;
+    NodePtr node(new Node(Node::REPEAT));
+    node->min = min;
+    node->max = max;
+    node->children.push_back(std::move(atom));
+    return node;
+  }
+
+  // {n}, {n,} or {n,m}, a brace not starting any of these is a literal.
+  bool ParseBraces(uint32_t& min, uint32_t& max)
+  {
+    if (!Peek('{'))
+      return false;
+    size_t end = pos + 1;
+    if (!ParseNumber(end, min))
+      return false;
+    max = min;
+    if (end < source.size() && source[end] == ',')
+    {
+      end++;
+      max = unbounded;
+      if (end < source.size() && IsDigit(source[end]))
+        ParseNumber(end, max);
+    }
+    if (end >= source.size() || source[end] != '}')
+      return false;
+    pos = end + 1;
+    return true;
+  }
+
+  bool ParseNumber(size_t& end, uint32_t& value) const
+  {
+    if (end >= source.size() || !IsDigit(source[end]))
+      return false;
+    value = 0;
+    for (; end < source.size() && IsDigit(source[end]); end++)
+    {
+      // Larger counts exceed the program size anyway.
+      value = std::min<uint32_t>(value * 10 + (source[end] - '0'), maxProgramSize);
+    }
+    return true;
+  }
+
+  NodePtr ParseAtom(int depth)
+  {
+    uint8_t c = source[pos++];
+    switch (c)
+    {
+    case '(':
+    {
+      if (Peek('?'))
+      {
+        if (pos + 1 >= source.size() || source[pos + 1] != ':')
+          throw std::invalid_argument("Lookaround assertions aren't supported");
+        pos += 2;
+      }
+      NodePtr node = ParseDisjunction(depth + 1);
+      if (!Peek(')'))
+        throw std::invalid_argument("Unterminated group");
+      pos++;
+      return node;
+    }
+    case '.':
+      return NodePtr(new Node(Node::ANY));
+    case '^':
+      return NodePtr(new Node(Node::ASSERT, ASSERT_START));
+    case '$':
+      return NodePtr(new Node(Node::ASSERT, ASSERT_END));
+    case '[':
+      return ParseClass();
+    case '\\':
+      return ParseAtomEscape();
+    case '*':
+    case '+':
+    case '?':
+      throw std::invalid_argument("Nothing to repeat");
+    case '{':
+    {
+      uint32_t min;
+      uint32_t max;
+      pos--;
+      if (ParseBraces(min, max))
+        throw std::invalid_argument("Nothing to repeat");
+      pos++;
+      return Char(c);
+    }
+    }
+    if (c < 0x80)
+      return Char(c);
+
+    // Keep UTF-8 sequences together, so that quantifiers apply to all of
+    // their bytes.
+    NodePtr node(new Node(Node::CONCAT));
+    node->children.push_back(NodePtr(new Node(Node::CHAR, c)));
+    while (pos < source.size() && (static_cast<uint8_t>(source[pos]) & 0xC0) == 0x80)
+      node->children.push_back(NodePtr(new Node(Node::CHAR, source[pos++])));
+    return node;
+  }
+
+  NodePtr Char(uint8_t c) const
+  {
+    return NodePtr(new Node(Node::CHAR, result.matchCase ? c : ToLower(c)));
+  }
+
+  NodePtr Class(const CharSet& set) const
+  {
+    NodePtr node(new Node(Node::CLASS));
+    node->index = static_cast<uint32_t>(result.classes.size());
+    result.classes.push_back(set);
+    return node;
+  }
+
+  NodePtr ParseAtomEscape()
+  {
+    if (pos >= source.size())
+      throw std::invalid_argument("\\ at end of pattern");
+    uint8_t c = source[pos++];
+    CharSet set;
+    if (GetCharSetEscape(c, set))
+      return Class(set);
+    if (c == 'b')
+      return NodePtr(new Node(Node::ASSERT, ASSERT_WORD_BOUNDARY));
+    if (c == 'B')
+      return NodePtr(new Node(Node::ASSERT, ASSERT_NOT_WORD_BOUNDARY));
+    if (c >= '1' && c <= '9')
+      throw std::invalid_argument("Backreferences aren't supported");
+    return Char(ParseCharacterEscape(c));
+  }
+
+  uint8_t ParseCharacterEscape(uint8_t c)
+  {
+    switch (c)
+    {
+    case 'n':
+      return '\n';
+    case 'r':
+      return '\r';
+    case 't':
+      return '\t';
+    case 'v':
+      return '\v';
+    case 'f':
+      return '\f';
+    case '0':
+      if (pos < source.size() && IsDigit(source[pos]))
+        throw std::invalid_argument("Octal escapes aren't supported");
+      return 0;
+    case 'x':
+    case 'u':
+    {
+      size_t length = c == 'x' ? 2 : 4;
+      int value = 0;
+      for (size_t i = 0; i < length; i++)
+      {
+        int digit = pos + i < source.size() ? HexValue(source[pos + i]) : -1;
+        if (digit < 0)
+          return c;
+        value = value * 16 + digit;
+      }
+      if (value >= 0x80)
+        throw std::invalid_argument("Non-ASCII escapes aren't supported");
+      pos += length;
+      return static_cast<uint8_t>(value);
+    }
+    case 'c':
+      if (pos < source.size() && std::isalpha(static_cast<uint8_t>(source[pos])))
+        return static_cast<uint8_t>(source[pos++]) % 32;
+      throw std::invalid_argument("Invalid control escape");
+    }
+    if (c >= 0x80)
+      throw std::invalid_argument("Non-ASCII escapes aren't supported");
+    return c;
+  }
+
+  // A character of a class or, for \d, \w and \s, a set.
+  bool ParseClassAtom(uint8_t& c, CharSet& set)
+  {
+    c = source[pos++];
+    if (c >= 0x80)
+      throw std::invalid_argument("Non-ASCII character classes aren't supported");
+    if (c != '\\')
+      return false;
+    if (pos >= source.size())
+      throw std::invalid_argument("\\ at end of pattern");
+    c = source[pos++];
+    if (GetCharSetEscape(c, set))
+      return true;
+    if (c == 'b')
+      c = '\b';
+    else if (c >= '1' && c <= '9')
+      throw std::invalid_argument("Octal escapes aren't supported");
+    else
+      c = ParseCharacterEscape(c);
+    return false;
+  }
+
+  NodePtr ParseClass()
+  {
+    bool negate = Peek('^');
+    if (negate)
+      pos++;
+    CharSet set;
+    while (true)
+    {
+      if (pos >= source.size())
+        throw std::invalid_argument("Unterminated character class");
+      if (Peek(']'))
+      {
+        pos++;
+        break;
+      }
+      uint8_t first;
+      CharSet firstSet;
+      bool firstIsSet = ParseClassAtom(first, firstSet);
+      if (!Peek('-') || pos + 1 >= source.size() || source[pos + 1] == ']')
+      {
+        if (firstIsSet)
+          set |= firstSet;
+        else
+          set.set(first);
+        continue;
+      }
+
+      pos++;
+      uint8_t last;
+      CharSet lastSet;
+      bool lastIsSet = ParseClassAtom(last, lastSet);
+      if (firstIsSet || lastIsSet)
+      {
+        // Not a range, like [\d-x] in JavaScript.
+        set |= firstIsSet ? firstSet : CharSet().set(first);
+        set |= lastIsSet ? lastSet : CharSet().set(last);
+        set.set('-');
+        continue;
+      }
+      if (first > last)
+        throw std::invalid_argument("Range out of order in character class");
+      for (int i = first; i <= last; i++)
+        set.set(i);
+    }
+
+    if (!result.matchCase)
+    {
+      for (int i = 'a'; i <= 'z'; i++)
+      {
+        bool included = set[i] || set[i - 'a' + 'A'];
+        set.set(i, included);
+        set.set(i - 'a' + 'A', included);
+      }
+    }
+    if (negate)
+      set.flip();
+    return Class(set);
+  }
+
+  uint32_t Add(Op op, uint8_t value = 0, uint32_t x = 0)
+  {
+    if (result.program.size() >= maxProgramSize)
+      throw std::invalid_argument("Expression too large");
+    Instruction instruction = {static_cast<uint8_t>(op), value, x, 0};
+    result.program.push_back(instruction);
+    return static_cast<uint32_t>(result.program.size() - 1);
+  }
+
+  uint32_t Next() const
+  {
+    return static_cast<uint32_t>(result.program.size());
+  }
+
+  void Emit(const Node& node)
+  {
+    std::vector<Instruction>& program = result.program;
+    switch (node.kind)
+    {
+    case Node::CHAR:
+      Add(OP_CHAR, node.value);
+      break;
+    case Node::ANY:
+      Add(OP_ANY);
+      break;
+    case Node::CLASS:
+      Add(OP_CLASS, 0, node.index);
+      break;
+    case Node::ASSERT:
+      Add(OP_ASSERT, node.value);
+      break;
+    case Node::CONCAT:
+      for (const auto& child : node.children)
+        Emit(*child);
+      break;
+    case Node::ALTERNATE:
+    {
+      std::vector<uint32_t> jumps;
+      for (size_t i = 0; i + 1 < node.children.size(); i++)
+      {
+        uint32_t split = Add(OP_SPLIT, 0, Next() + 1);
+        Emit(*node.children[i]);
+        jumps.push_back(Add(OP_JUMP));
+        program[split].y = Next();
+      }
+      Emit(*node.children.back());
+      for (uint32_t jump : jumps)
+        program[jump].x = Next();
+      break;
+    }
+    case Node::REPEAT:
+    {
+      const Node& child = *node.children[0];
+      for (uint32_t i = 0; i < node.min; i++)
+        Emit(child);
+      if (node.max == unbounded)
+      {
+        uint32_t split = Add(OP_SPLIT, 0, Next() + 1);
+        Emit(child);
+        Add(OP_JUMP, 0, split);
+        program[split].y = Next();
+        break;
+      }
+      std::vector<uint32_t> splits;
+      for (uint32_t i = node.min; i < node.max; i++)
+      {
+        splits.push_back(Add(OP_SPLIT, 0, Next() + 1));
+        Emit(child);
+      }
+      for (uint32_t split : splits)
+        program[split].y = Next();
+      break;
+    }
+    }
+  }
+
+  const std::string& source;
+  size_t pos;
+  NativeRegExp& result;
+};
+
+NativeRegExp::NativeRegExp(bool matchCase)
+  : matchCase(matchCase)
+{
+}
+
+std::unique_ptr<const NativeRegExp> NativeRegExp::Compile(
+  const std::string& source, bool matchCase)
+{
+  std::unique_ptr<NativeRegExp> result(new NativeRegExp(matchCase));
+  try
+  {
+    Compiler(source, *result).Compile();
+  }
+  catch (const std::invalid_argument&)
+  {
+    return nullptr;
+  }
+  return std::unique_ptr<const NativeRegExp>(result.release());
+}
+
+bool NativeRegExp::Test(const std::string& subject) const
+{
+  // Simulates the NFA, keeping the set of instructions all possible matches
+  // started so far have reached. Each instruction is in the set at most
+  // once, marked with the position it was added at.
+  const size_t length = subject.size();
+  std::vector<uint32_t> current;
+  std::vector<uint32_t> next;
+  std::vector<uint32_t> stack;
+  std::vector<size_t> marks(program.size(), std::numeric_limits<size_t>::max());
+
+  // Follows the instructions which don't consume a character, returns true
+  // if the expression matched.
+  auto addThread = [&](std::vector<uint32_t>& list, uint32_t start, size_t pos)
+  {
+    stack.push_back(start);
+    while (!stack.empty())
+    {
+      uint32_t pc = stack.back();
+      stack.pop_back();
+      if (marks[pc] == pos)
+        continue;
+      marks[pc] = pos;
+      const Instruction& instruction = program[pc];
+      switch (instruction.op)
+      {
+      case OP_MATCH:
+        stack.clear();
+        return true;
+      case OP_JUMP:
+        stack.push_back(instruction.x);
+        break;
+      case OP_SPLIT:
+        stack.push_back(instruction.y);
+        stack.push_back(instruction.x);
+        break;
+      case OP_ASSERT:
+      {
+        bool holds;
+        switch (instruction.value)
+        {
+        case ASSERT_START:
+          holds = pos == 0;
+          break;
+        case ASSERT_END:
+          holds = pos == length;
+          break;
+        default:
+          holds = (pos > 0 && IsWordChar(subject[pos - 1])) !=
+            (pos < length && IsWordChar(subject[pos]));
+          if (instruction.value == ASSERT_NOT_WORD_BOUNDARY)
+            holds = !holds;
+        }
+        if (holds)
+          stack.push_back(pc + 1);
+        break;
+      }
+      default:
+        list.push_back(pc);
+      }
+    }
+    return false;
+  };
+
+  if (addThread(current, 0, 0))
+    return true;
+  for (size_t pos = 0; pos < length; pos++)
+  {
+    uint8_t c = subject[pos];
+    uint8_t folded = matchCase ? c : ToLower(c);
+    next.clear();
+    for (uint32_t pc : current)
+    {
+      const Instruction& instruction = program[pc];
+      bool matches;
+      switch (instruction.op)
+      {
+      case OP_CHAR:
+        matches = folded == instruction.value;
+        break;
+      case OP_ANY:
+        matches = c != '\n' && c != '\r';
+        break;
+      default:
+        matches = classes[instruction.x][c];
+      }
+      if (matches && addThread(next, pc + 1, pos + 1))
+        return true;
+    }
+    // The expression isn't anchored, a match can start at any position.
+    if (addThread(next, 0, pos + 1))
+      return true;
+    current.swap(next);
+  }
+  return false;
+}
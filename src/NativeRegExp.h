@@ -0,0 +1,66 @@
+/*
+ * This file is part of Adblock Plus <https://adblockplus.org/>,
+ * Copyright (C) 2006-present eyeo GmbH
+ *
+ * Adblock Plus is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 3 as
+ * published by the Free Software Foundation.
+ *
+ * Adblock Plus is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Adblock Plus.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef ADBLOCK_PLUS_NATIVE_REG_EXP_H
+#define ADBLOCK_PLUS_NATIVE_REG_EXP_H
+
+#include <bitset>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace AdblockPlus
+{
+  // Regular expressions of filters like /banner\d+/, matched without
+  // backtracking: the expression is compiled into a program of bounded size
+  // which is run as an NFA simulation, so matching takes time linear in the
+  // length of the URL and doesn't recurse. Supports the JavaScript syntax
+  // filters use, except for backreferences and lookaround assertions.
+  // Matches bytes, character classes and case folding only cover ASCII.
+  class NativeRegExp
+  {
+  public:
+    // Returns nullptr if the expression is invalid or not supported.
+    static std::unique_ptr<const NativeRegExp> Compile(
+      const std::string& source, bool matchCase);
+
+    // Like RegExp.prototype.test(), safe to call from several threads.
+    bool Test(const std::string& subject) const;
+
+  private:
+    struct Instruction
+    {
+      uint8_t op;
+      uint8_t value;
+      // Jump targets or the index into classes.
+      uint32_t x;
+      uint32_t y;
+    };
+    class Compiler;
+
+    NativeRegExp(const NativeRegExp&);
+    NativeRegExp& operator=(const NativeRegExp&);
+    explicit NativeRegExp(bool matchCase);
+
+    std::vector<Instruction> program;
+    std::vector<std::bitset<256>> classes;
+    bool matchCase;
+  };
+}
+
+#endif
@@ -21,6 +21,7 @@
 #include "DefaultTimer.h"
 #include "DefaultWebRequest.h"
 #include "DefaultFileSystem.h"
+#include <chrono>
 #include <stdexcept>
 
 using namespace AdblockPlus;
@@ -42,7 +43,13 @@ namespace
 
 #define ASSIGN_PLATFORM_PARAM(param) ValidatePlatformCreationParameter(param = std::move(creationParameters.param), #param)
 
+Platform::CreationParameters::CreationParameters()
+  : minLogLevel(LogSystem::LOG_LEVEL_TRACE)
+{
+}
+
 Platform::Platform(CreationParameters&& creationParameters)
+  : minLogLevel(creationParameters.minLogLevel)
 {
   ASSIGN_PLATFORM_PARAM(logSystem);
   ASSIGN_PLATFORM_PARAM(timer);
@@ -95,6 +102,28 @@ FilterEngine& Platform::GetFilterEngine()
   return *std::shared_future<FilterEnginePtr>(filterEngine).get();
 }
 
+void Platform::FlushModules()
+{
+  std::shared_future<FilterEnginePtr> filterEngineFuture;
+  {
+    std::lock_guard<std::mutex> lock(modulesMutex);
+    filterEngineFuture = filterEngine;
+  }
+  if (!filterEngineFuture.valid() ||
+    filterEngineFuture.wait_for(std::chrono::seconds(0)) != std::future_status::ready)
+  {
+    return;
+  }
+
+  auto saved = std::make_shared<std::promise<void>>();
+  filterEngineFuture.get()->SaveFilterHitStats([saved](const std::string&)
+  {
+    saved->set_value();
+  });
+  // Don't hang on file systems which never call back.
+  saved->get_future().wait_for(std::chrono::seconds(10));
+}
+
 void Platform::WithTimer(const WithTimerCallback& callback)
 {
   if (timer && callback)
@@ -119,6 +148,41 @@ void Platform::WithLogSystem(const WithLogSystemCallback& callback)
     callback(*logSystem);
 }
 
+void Platform::SetMinLogLevel(LogSystem::LogLevel logLevel)
+{
+  minLogLevel = logLevel;
+}
+
+bool Platform::IsLogLevelEnabled(LogSystem::LogLevel logLevel) const
+{
+  return logLevel >= minLogLevel;
+}
+
+void Platform::StartTracing()
+{
+  tracer.Start();
+}
+
+void Platform::StopTracing(const std::string& fileName,
+  const IFileSystem::Callback& callback)
+{
+  std::string trace = tracer.Stop();
+  WithFileSystem([&fileName, &trace, &callback](IFileSystem& fileSystem)
+  {
+    fileSystem.Write(fileName, IFileSystem::IOBuffer(trace.begin(), trace.end()),
+      [callback](const std::string& error)
+      {
+        if (callback)
+          callback(error);
+      });
+  });
+}
+
+Tracer& Platform::GetTracer()
+{
+  return tracer;
+}
+
 namespace
 {
   class DefaultPlatform : public Platform
@@ -143,6 +207,8 @@ namespace
 
   DefaultPlatform::~DefaultPlatform()
   {
+    // The base class would find the interfaces gone already.
+    FlushModules();
     asyncExecutor.reset();
     LogSystemPtr tmpLogSystem;
     TimerPtr tmpTimer;
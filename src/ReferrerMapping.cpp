@@ -15,29 +15,46 @@
  * along with Adblock Plus.  If not, see <http://www.gnu.org/licenses/>.
  */
 
+#include <algorithm>
 #include <AdblockPlus/ReferrerMapping.h>
 
 using namespace AdblockPlus;
 
-ReferrerMapping::ReferrerMapping(const int maxCachedUrls)
-  : maxCachedUrls(maxCachedUrls)
+ReferrerMapping::ReferrerMapping(const int maxCachedUrls,
+  const size_t maxCachedBytes)
+  : maxCachedUrls(maxCachedUrls), maxCachedBytes(maxCachedBytes),
+    oldest(nullptr), newest(nullptr), cachedUrls(0), cachedBytes(0)
 {
 }
 
 void ReferrerMapping::Add(const std::string& url, const std::string& referrer)
 {
-  if (mapping.find(url) != mapping.end())
-    cachedUrls.remove(url);
-  cachedUrls.push_back(url);
-  mapping[url] = referrer;
-
-  const int urlsToPop = cachedUrls.size() - maxCachedUrls;
-  for (int i = 0; i < urlsToPop; i++)
+  Entry* referrerEntry = Intern(referrer);
+  Entry* entry = Intern(url);
+  if (entry->referrer)
   {
-    const std::string poppedUrl = cachedUrls.front();
-    cachedUrls.pop_front();
-    mapping.erase(poppedUrl);
+    Unlink(entry);
+    Release(entry->referrer);
   }
+  else
+    entry->refCount++;
+  entry->referrer = referrerEntry;
+  referrerEntry->refCount++;
+
+  entry->prev = newest;
+  entry->next = nullptr;
+  if (newest)
+    newest->next = entry;
+  else
+    oldest = entry;
+  newest = entry;
+  cachedUrls++;
+
+  Release(referrerEntry);
+  Release(entry);
+
+  while (oldest && (cachedUrls > maxCachedUrls || cachedBytes > maxCachedBytes))
+    RemoveOldest();
 }
 
 std::vector<std::string> ReferrerMapping::BuildReferrerChain(
@@ -45,16 +62,72 @@ std::vector<std::string> ReferrerMapping::BuildReferrerChain(
 {
   std::vector<std::string> referrerChain;
   referrerChain.push_back(url);
-  // We need to limit the chain length to ensure we don't block indefinitely
-  // if there's a referrer loop.
-  const int maxChainLength = 10;
-  std::map<std::string, std::string>::const_iterator currentEntry =
-    mapping.find(url);
-  for (int i = 0; i < maxChainLength && currentEntry != mapping.end(); i++)
+  Entries::const_iterator it = entries.find(url);
+  const Entry* currentEntry = it != entries.end() ? &it->second : nullptr;
+  for (int i = 0; i < maxChainLength && currentEntry && currentEntry->referrer; i++)
   {
-    const std::string& currentUrl = currentEntry->second;
-    referrerChain.insert(referrerChain.begin(), currentUrl);
-    currentEntry = mapping.find(currentUrl);
+    currentEntry = currentEntry->referrer;
+    referrerChain.push_back(*currentEntry->url);
   }
+  std::reverse(referrerChain.begin(), referrerChain.end());
   return referrerChain;
 }
+
+const std::string* ReferrerMapping::FindReferrer(const std::string& url) const
+{
+  Entries::const_iterator it = entries.find(url);
+  if (it == entries.end() || !it->second.referrer)
+    return nullptr;
+  return it->second.referrer->url;
+}
+
+ReferrerMapping::Entry* ReferrerMapping::Intern(const std::string& url)
+{
+  // The caller owns one reference of the returned entry and has to release it.
+  std::pair<Entries::iterator, bool> inserted = entries.emplace(url, Entry());
+  Entry& entry = inserted.first->second;
+  if (inserted.second)
+  {
+    entry.url = &inserted.first->first;
+    entry.referrer = nullptr;
+    entry.prev = nullptr;
+    entry.next = nullptr;
+    entry.refCount = 0;
+    cachedBytes += url.size() + sizeof(Entries::value_type);
+  }
+  entry.refCount++;
+  return &entry;
+}
+
+void ReferrerMapping::Release(Entry* entry)
+{
+  if (--entry->refCount > 0)
+    return;
+  cachedBytes -= entry->url->size() + sizeof(Entries::value_type);
+  entries.erase(entries.find(*entry->url));
+}
+
+void ReferrerMapping::Unlink(Entry* entry)
+{
+  if (entry->prev)
+    entry->prev->next = entry->next;
+  else
+    oldest = entry->next;
+  if (entry->next)
+    entry->next->prev = entry->prev;
+  else
+    newest = entry->prev;
+  entry->prev = nullptr;
+  entry->next = nullptr;
+  cachedUrls--;
+}
+
+void ReferrerMapping::RemoveOldest()
+{
+  Entry* entry = oldest;
+  Unlink(entry);
+  Entry* referrer = entry->referrer;
+  entry->referrer = nullptr;
+  Release(referrer);
+  Release(entry);
+}
@@ -0,0 +1,265 @@
+/*
+ * This file is part of Adblock Plus <https://adblockplus.org/>,
+ * Copyright (C) 2006-present eyeo GmbH
+ *
+ * Adblock Plus is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 3 as
+ * published by the Free Software Foundation.
+ *
+ * Adblock Plus is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Adblock Plus.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <cerrno>
+#include <cstring>
+#include <poll.h>
+#include <stdexcept>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "ServiceProtocol.h"
+
+using namespace AdblockPlus;
+
+namespace
+{
+  const size_t headerSize = 2 * sizeof(uint32_t) + sizeof(uint8_t);
+
+  sockaddr_un GetAddress(const std::string& socketPath)
+  {
+    sockaddr_un address;
+    std::memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    if (socketPath.empty() || socketPath.size() >= sizeof(address.sun_path))
+      throw std::runtime_error("Invalid socket path " + socketPath);
+    std::memcpy(address.sun_path, socketPath.c_str(), socketPath.size() + 1);
+    return address;
+  }
+
+  int CreateSocket()
+  {
+    int result = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (result < 0)
+      throw std::runtime_error(std::string("Unable to create socket: ") + std::strerror(errno));
+#ifdef SO_NOSIGPIPE
+    int enabled = 1;
+    setsockopt(result, SOL_SOCKET, SO_NOSIGPIPE, &enabled, sizeof(enabled));
+#endif
+    return result;
+  }
+}
+
+ServiceProtocol::Writer::Writer(std::string& buffer)
+  : buffer(buffer), messageStart(buffer.size())
+{
+}
+
+void ServiceProtocol::Writer::BeginMessage(uint32_t requestId, uint8_t code)
+{
+  messageStart = buffer.size();
+  WriteUint32(0);
+  WriteUint32(requestId);
+  WriteUint8(code);
+}
+
+void ServiceProtocol::Writer::EndMessage()
+{
+  uint32_t length = static_cast<uint32_t>(buffer.size() - messageStart - sizeof(length));
+  std::memcpy(&buffer[messageStart], &length, sizeof(length));
+}
+
+void ServiceProtocol::Writer::AbortMessage()
+{
+  buffer.resize(messageStart);
+}
+
+size_t ServiceProtocol::Writer::GetMessageLength() const
+{
+  return buffer.size() - messageStart - sizeof(uint32_t);
+}
+
+void ServiceProtocol::Writer::WriteUint8(uint8_t value)
+{
+  buffer += static_cast<char>(value);
+}
+
+void ServiceProtocol::Writer::WriteUint32(uint32_t value)
+{
+  buffer.append(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+
+void ServiceProtocol::Writer::WriteString(const std::string& value)
+{
+  WriteUint32(static_cast<uint32_t>(value.size()));
+  buffer += value;
+}
+
+void ServiceProtocol::Writer::WriteStrings(const std::vector<std::string>& values)
+{
+  WriteUint32(static_cast<uint32_t>(values.size()));
+  for (const auto& value : values)
+    WriteString(value);
+}
+
+ServiceProtocol::Reader::Reader()
+  : data(nullptr), size(0)
+{
+}
+
+ServiceProtocol::Reader::Reader(const char* data, size_t size)
+  : data(data), size(size)
+{
+}
+
+const char* ServiceProtocol::Reader::Read(size_t length)
+{
+  if (length > size)
+    throw std::runtime_error("Truncated message");
+  const char* result = data;
+  data += length;
+  size -= length;
+  return result;
+}
+
+uint8_t ServiceProtocol::Reader::ReadUint8()
+{
+  return static_cast<uint8_t>(*Read(sizeof(uint8_t)));
+}
+
+uint32_t ServiceProtocol::Reader::ReadUint32()
+{
+  uint32_t result;
+  std::memcpy(&result, Read(sizeof(result)), sizeof(result));
+  return result;
+}
+
+std::string ServiceProtocol::Reader::ReadString()
+{
+  uint32_t length = ReadUint32();
+  return std::string(Read(length), length);
+}
+
+std::vector<std::string> ServiceProtocol::Reader::ReadStrings()
+{
+  uint32_t count = ReadUint32();
+  // Every string takes at least its length, so a bogus count can't make us
+  // allocate more than the message size.
+  if (count > size / sizeof(uint32_t))
+    throw std::runtime_error("Truncated message");
+  std::vector<std::string> result;
+  result.reserve(count);
+  for (uint32_t i = 0; i < count; i++)
+    result.push_back(ReadString());
+  return result;
+}
+
+bool ServiceProtocol::Reader::AtEnd() const
+{
+  return size == 0;
+}
+
+const char* ServiceProtocol::Reader::GetData() const
+{
+  return data;
+}
+
+size_t ServiceProtocol::Reader::GetSize() const
+{
+  return size;
+}
+
+bool ServiceProtocol::NextMessage(const std::string& buffer, size_t& offset,
+  uint32_t& requestId, uint8_t& code, Reader& payload)
+{
+  if (buffer.size() - offset < headerSize)
+    return false;
+  uint32_t length;
+  std::memcpy(&length, buffer.data() + offset, sizeof(length));
+  if (length > maxMessageSize || length < headerSize - sizeof(length))
+    throw std::runtime_error("Invalid message length");
+  if (buffer.size() - offset - sizeof(length) < length)
+    return false;
+
+  Reader reader(buffer.data() + offset + sizeof(length), length);
+  requestId = reader.ReadUint32();
+  code = reader.ReadUint8();
+  payload = reader;
+  offset += sizeof(length) + length;
+  return true;
+}
+
+int ServiceProtocol::Listen(const std::string& socketPath)
+{
+  sockaddr_un address = GetAddress(socketPath);
+  // Removes the socket of a previous instance which wasn't shut down, but
+  // neither a running instance's socket nor files which aren't sockets.
+  struct stat status;
+  if (lstat(socketPath.c_str(), &status) == 0 && S_ISSOCK(status.st_mode))
+  {
+    int probe = CreateSocket();
+    bool running = connect(probe, reinterpret_cast<sockaddr*>(&address), sizeof(address)) == 0;
+    close(probe);
+    if (running)
+      throw std::runtime_error("Unable to listen on " + socketPath + ": already running");
+    unlink(socketPath.c_str());
+  }
+  int result = CreateSocket();
+  if (bind(result, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0 ||
+    listen(result, SOMAXCONN) != 0)
+  {
+    std::string error = std::strerror(errno);
+    close(result);
+    throw std::runtime_error("Unable to listen on " + socketPath + ": " + error);
+  }
+  return result;
+}
+
+int ServiceProtocol::Connect(const std::string& socketPath)
+{
+  sockaddr_un address = GetAddress(socketPath);
+  int result = CreateSocket();
+  if (connect(result, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0)
+  {
+    std::string error = std::strerror(errno);
+    close(result);
+    throw std::runtime_error("Unable to connect to " + socketPath + ": " + error);
+  }
+  return result;
+}
+
+bool ServiceProtocol::SendAll(int socket, const std::string& data, int stopFd)
+{
+#ifdef MSG_NOSIGNAL
+  const int flags = MSG_NOSIGNAL;
+#else
+  const int flags = 0;
+#endif
+  size_t sent = 0;
+  while (sent < data.size())
+  {
+    ssize_t result = send(socket, data.data() + sent, data.size() - sent, flags);
+    if (result < 0 && errno == EINTR)
+      continue;
+    if (result < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+    {
+      // Negative descriptors are ignored by poll().
+      pollfd fds[] = {{socket, POLLOUT, 0}, {stopFd, POLLIN, 0}};
+      if (poll(fds, 2, -1) < 0 && errno != EINTR)
+        return false;
+      if (fds[1].revents)
+        return false;
+      continue;
+    }
+    if (result <= 0)
+      return false;
+    sent += result;
+  }
+  return true;
+}
@@ -0,0 +1,124 @@
+/*
+ * This file is part of Adblock Plus <https://adblockplus.org/>,
+ * Copyright (C) 2006-present eyeo GmbH
+ *
+ * Adblock Plus is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 3 as
+ * published by the Free Software Foundation.
+ *
+ * Adblock Plus is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Adblock Plus.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef ADBLOCK_PLUS_SERVICE_PROTOCOL_H
+#define ADBLOCK_PLUS_SERVICE_PROTOCOL_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace AdblockPlus
+{
+  // Binary protocol spoken between FilterEngineService and
+  // FilterEngineClient over a Unix domain socket. A message is a uint32
+  // length of the rest of the message, a uint32 request ID chosen by the
+  // client, an opcode (requests) or status (responses) byte and the payload.
+  // Integers are in host byte order since both ends are on the same machine,
+  // strings are a uint32 length followed by the bytes.
+  //
+  // Requests carry a batch of queries and are answered in order, so clients
+  // can pipeline them without waiting for the previous responses.
+  namespace ServiceProtocol
+  {
+    enum Opcode
+    {
+      // Queries: uint32 count, then per query uint32 content type mask,
+      // string URL and a string list of document URLs. Results: uint32
+      // count, then per result a filter type byte, NO_FILTER or followed by
+      // the filter text.
+      OPCODE_MATCHES = 1,
+      // Queries as above. Results: uint32 count, then a byte per result.
+      OPCODE_IS_DOCUMENT_WHITELISTED = 2,
+      OPCODE_IS_ELEMHIDE_WHITELISTED = 3,
+      // Queries: a string list of domains. Results: uint32 count, then a
+      // string list of selectors per domain.
+      OPCODE_GET_ELEMENT_HIDING_SELECTORS = 4
+    };
+
+    enum Status
+    {
+      STATUS_OK = 0,
+      // The payload is an error message.
+      STATUS_ERROR = 1
+    };
+
+    const uint8_t NO_FILTER = 0xFF;
+    const uint32_t maxMessageSize = 16 * 1024 * 1024;
+
+    class Writer
+    {
+    public:
+      explicit Writer(std::string& buffer);
+
+      void BeginMessage(uint32_t requestId, uint8_t code);
+      void EndMessage();
+      // Drops the message begun last, e.g. to replace it by an error.
+      void AbortMessage();
+      // Length of the message begun last, as in its header.
+      size_t GetMessageLength() const;
+      void WriteUint8(uint8_t value);
+      void WriteUint32(uint32_t value);
+      void WriteString(const std::string& value);
+      void WriteStrings(const std::vector<std::string>& values);
+
+    private:
+      std::string& buffer;
+      size_t messageStart;
+    };
+
+    // Throws std::runtime_error when reading beyond the end of the data.
+    class Reader
+    {
+    public:
+      Reader();
+      Reader(const char* data, size_t size);
+
+      uint8_t ReadUint8();
+      uint32_t ReadUint32();
+      std::string ReadString();
+      std::vector<std::string> ReadStrings();
+      bool AtEnd() const;
+      // The data which wasn't read yet.
+      const char* GetData() const;
+      size_t GetSize() const;
+
+    private:
+      const char* Read(size_t length);
+
+      const char* data;
+      size_t size;
+    };
+
+    // Reads the message starting at offset if it was received completely
+    // and advances offset past it. The payload reader points into buffer.
+    // Throws std::runtime_error for messages exceeding maxMessageSize.
+    bool NextMessage(const std::string& buffer, size_t& offset,
+      uint32_t& requestId, uint8_t& code, Reader& payload);
+
+    // Socket helpers, these throw std::runtime_error on failure. Listen()
+    // replaces a stale socket left behind by a previous instance, but fails
+    // if another instance still accepts connections on it.
+    int Listen(const std::string& socketPath);
+    int Connect(const std::string& socketPath);
+    // Returns false if the connection was closed. Waits for non-blocking
+    // sockets to become writable, giving up once stopFd becomes readable.
+    bool SendAll(int socket, const std::string& data, int stopFd = -1);
+  }
+}
+
+#endif
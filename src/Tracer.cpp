@@ -0,0 +1,138 @@
+/*
+ * This file is part of Adblock Plus <https://adblockplus.org/>,
+ * Copyright (C) 2006-present eyeo GmbH
+ *
+ * Adblock Plus is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 3 as
+ * published by the Free Software Foundation.
+ *
+ * Adblock Plus is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Adblock Plus.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <AdblockPlus/Tracer.h>
+#include <sstream>
+
+using namespace AdblockPlus;
+
+namespace
+{
+  void WriteJsonString(std::ostream& out, const char* value)
+  {
+    static const char hexDigits[] = "0123456789abcdef";
+    out << '"';
+    for (const char* c = value; *c; c++)
+    {
+      switch (*c)
+      {
+        case '"':
+          out << "\\\"";
+          break;
+        case '\\':
+          out << "\\\\";
+          break;
+        default:
+          if (static_cast<unsigned char>(*c) < 0x20)
+            out << "\\u00" << hexDigits[*c >> 4] << hexDigits[*c & 0xF];
+          else
+            out << *c;
+      }
+    }
+    out << '"';
+  }
+
+  int64_t ToMicroseconds(Tracer::Clock::duration duration)
+  {
+    return std::chrono::duration_cast<std::chrono::microseconds>(duration).count();
+  }
+}
+
+Tracer::Scope::Scope(Tracer& tracer, const char* category, const char* name,
+  const char* detail)
+  : tracer(tracer), category(category), name(name), detail(detail),
+    enabled(tracer.IsEnabled())
+{
+  if (enabled)
+    start = Clock::now();
+}
+
+Tracer::Scope::~Scope()
+{
+  if (enabled)
+    tracer.AddCompleteEvent(category, name, start, Clock::now(), detail);
+}
+
+Tracer::Tracer()
+  : enabled(false)
+{
+}
+
+void Tracer::Start()
+{
+  std::lock_guard<std::mutex> lock(mutex);
+  events.clear();
+  threadIds.clear();
+  startTime = Clock::now();
+  enabled = true;
+}
+
+std::string Tracer::Stop()
+{
+  std::vector<Event> recordedEvents;
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    enabled = false;
+    recordedEvents.swap(events);
+  }
+
+  std::stringstream result;
+  result << "{\"traceEvents\":[";
+  for (size_t i = 0; i < recordedEvents.size(); i++)
+  {
+    const Event& event = recordedEvents[i];
+    if (i > 0)
+      result << ",";
+    result << "\n{\"cat\":";
+    WriteJsonString(result, event.category);
+    result << ",\"name\":";
+    WriteJsonString(result, event.name);
+    result << ",\"ph\":\"X\",\"pid\":1,\"tid\":" << event.threadId;
+    result << ",\"ts\":" << event.timestamp << ",\"dur\":" << event.duration;
+    if (!event.detail.empty())
+    {
+      result << ",\"args\":{\"detail\":";
+      WriteJsonString(result, event.detail.c_str());
+      result << "}";
+    }
+    result << "}";
+  }
+  result << "\n],\"displayTimeUnit\":\"ms\"}\n";
+  return result.str();
+}
+
+void Tracer::AddCompleteEvent(const char* category, const char* name,
+  Clock::time_point start, Clock::time_point end, const char* detail)
+{
+  if (!IsEnabled())
+    return;
+
+  Event event;
+  event.category = category;
+  event.name = name;
+  if (detail)
+    event.detail = detail;
+  event.duration = ToMicroseconds(end - start);
+
+  std::lock_guard<std::mutex> lock(mutex);
+  // Events which started before Start() was called are clamped.
+  event.timestamp = start > startTime ? ToMicroseconds(start - startTime) : 0;
+  auto threadId = threadIds.insert(std::make_pair(std::this_thread::get_id(),
+    static_cast<int>(threadIds.size() + 1)));
+  event.threadId = threadId.first->second;
+  events.push_back(std::move(event));
+}
@@ -56,11 +56,12 @@ void JsEngine::ScheduleWebRequest(const v8::FunctionCallbackInfo<v8::Value>& arg
 
   auto paramsID = jsEngine->StoreJsValues(converted);
   std::weak_ptr<JsEngine> weakJsEngine = jsEngine;
-  auto getCallback = [weakJsEngine, paramsID](const ServerResponse& response)
+  IWebRequest::GetCallback getCallback = [weakJsEngine, paramsID](const ServerResponse& response)
   {
     auto jsEngine = weakJsEngine.lock();
     if (!jsEngine)
       return;
+    ABP_TRACE_SCOPE(jsEngine->GetPlatform().GetTracer(), "WebRequest", "GET callback");
     auto webRequestParams = jsEngine->TakeJsValues(paramsID);
 
     AdblockPlus::JsContext context(*jsEngine);
@@ -79,6 +80,22 @@ void JsEngine::ScheduleWebRequest(const v8::FunctionCallbackInfo<v8::Value>& arg
 
     webRequestParams[2].Call(resultObject);
   };
+#ifdef ABP_TRACE_EVENTS
+  if (jsEngine->GetPlatform().GetTracer().IsEnabled())
+  {
+    // Record the whole time the request took, not just the processing of
+    // the response.
+    Tracer::Clock::time_point requestStart = Tracer::Clock::now();
+    IWebRequest::GetCallback processResponse = getCallback;
+    getCallback = [weakJsEngine, url, requestStart, processResponse](const ServerResponse& response)
+    {
+      if (auto jsEngine = weakJsEngine.lock())
+        jsEngine->GetPlatform().GetTracer().AddCompleteEvent("WebRequest",
+          "GET", requestStart, Tracer::Clock::now(), url.c_str());
+      processResponse(response);
+    };
+  }
+#endif
   jsEngine->GetPlatform().WithWebRequest(
     [url, headers, getCallback](IWebRequest& webRequest)
     {
@@ -0,0 +1,146 @@
+/*
+ * This file is part of Adblock Plus <https://adblockplus.org/>,
+ * Copyright (C) 2006-present eyeo GmbH
+ *
+ * Adblock Plus is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 3 as
+ * published by the Free Software Foundation.
+ *
+ * Adblock Plus is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Adblock Plus.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <AdblockPlus.h>
+#include <gtest/gtest.h>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+using namespace AdblockPlus;
+
+namespace
+{
+  class RecordingLogSystem : public LogSystem
+  {
+  public:
+    struct Message
+    {
+      LogLevel logLevel;
+      std::string message;
+      std::string source;
+    };
+
+    RecordingLogSystem(std::vector<Message>& messages)
+      : messages(messages), blocked(false)
+    {
+    }
+
+    void operator()(LogLevel logLevel, const std::string& message,
+        const std::string& source) override
+    {
+      std::unique_lock<std::mutex> lock(mutex);
+      unblocked.wait(lock, [this]() { return !blocked; });
+      Message entry = {logLevel, message, source};
+      messages.push_back(entry);
+    }
+
+    void SetBlocked(bool value)
+    {
+      {
+        std::lock_guard<std::mutex> lock(mutex);
+        blocked = value;
+      }
+      unblocked.notify_all();
+    }
+
+  private:
+    std::vector<Message>& messages;
+    std::mutex mutex;
+    std::condition_variable unblocked;
+    bool blocked;
+  };
+}
+
+TEST(AsyncLogSystemTest, PassesMessagesInOrder)
+{
+  std::vector<RecordingLogSystem::Message> messages;
+  AsyncLogSystem logSystem(LogSystemPtr(new RecordingLogSystem(messages)));
+  logSystem(LogSystem::LOG_LEVEL_WARN, "foo", "foo.js:1");
+  logSystem(LogSystem::LOG_LEVEL_ERROR, "bar", "");
+  logSystem.Flush();
+  ASSERT_EQ(2u, messages.size());
+  EXPECT_EQ(LogSystem::LOG_LEVEL_WARN, messages[0].logLevel);
+  EXPECT_EQ("foo", messages[0].message);
+  EXPECT_EQ("foo.js:1", messages[0].source);
+  EXPECT_EQ(LogSystem::LOG_LEVEL_ERROR, messages[1].logLevel);
+  EXPECT_EQ("bar", messages[1].message);
+  EXPECT_EQ("", messages[1].source);
+  EXPECT_EQ(0u, logSystem.GetDroppedCount());
+}
+
+TEST(AsyncLogSystemTest, DestructorPassesRemainingMessages)
+{
+  std::vector<RecordingLogSystem::Message> messages;
+  {
+    AsyncLogSystem logSystem(LogSystemPtr(new RecordingLogSystem(messages)));
+    for (int i = 0; i < 100; i++)
+      logSystem(LogSystem::LOG_LEVEL_LOG, std::to_string(i), "");
+  }
+  ASSERT_EQ(100u, messages.size());
+  for (int i = 0; i < 100; i++)
+    EXPECT_EQ(std::to_string(i), messages[i].message);
+}
+
+TEST(AsyncLogSystemTest, DropsMessagesWhenFull)
+{
+  std::vector<RecordingLogSystem::Message> messages;
+  RecordingLogSystem* sink = new RecordingLogSystem(messages);
+  sink->SetBlocked(true);
+  AsyncLogSystem logSystem(LogSystemPtr(sink), 4);
+
+  // The background thread may have taken the first message out of the buffer
+  // before it got blocked by the sink, so at most 5 messages are kept.
+  for (int i = 0; i < 10; i++)
+    logSystem(LogSystem::LOG_LEVEL_LOG, std::to_string(i), "");
+  uint64_t dropped = logSystem.GetDroppedCount();
+  EXPECT_GE(dropped, 5u);
+  EXPECT_LE(dropped, 6u);
+
+  sink->SetBlocked(false);
+  logSystem.Flush();
+  ASSERT_EQ(10 - dropped + 1, messages.size());
+  for (size_t i = 0; i + 1 < messages.size(); i++)
+    EXPECT_EQ(std::to_string(i), messages[i].message);
+  EXPECT_EQ(LogSystem::LOG_LEVEL_WARN, messages.back().logLevel);
+  EXPECT_EQ(std::to_string(dropped) + " log messages dropped", messages.back().message);
+}
+
+TEST(AsyncLogSystemTest, ConcurrentProducers)
+{
+  std::vector<RecordingLogSystem::Message> messages;
+  AsyncLogSystem logSystem(LogSystemPtr(new RecordingLogSystem(messages)), 64);
+  std::vector<std::thread> threads;
+  for (int i = 0; i < 4; i++)
+  {
+    threads.emplace_back([&logSystem]()
+    {
+      for (int j = 0; j < 1000; j++)
+        logSystem(LogSystem::LOG_LEVEL_LOG, "message", "");
+    });
+  }
+  for (auto& thread : threads)
+    thread.join();
+  logSystem.Flush();
+
+  size_t logged = 0;
+  for (const auto& message : messages)
+    if (message.logLevel == LogSystem::LOG_LEVEL_LOG)
+      logged++;
+  EXPECT_EQ(4000u, logged + logSystem.GetDroppedCount());
+}
@@ -0,0 +1,93 @@
+/*
+ * This file is part of Adblock Plus <https://adblockplus.org/>,
+ * Copyright (C) 2006-present eyeo GmbH
+ *
+ * Adblock Plus is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 3 as
+ * published by the Free Software Foundation.
+ *
+ * Adblock Plus is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Adblock Plus.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <AdblockPlus.h>
+#include <gtest/gtest.h>
+#include <thread>
+
+TEST(ConcurrentReferrerMappingTest, EmptyReferrerChain)
+{
+  AdblockPlus::ConcurrentReferrerMapping referrerMapping;
+  std::vector<std::string> referrerChain =
+    referrerMapping.BuildReferrerChain("first");
+  ASSERT_EQ(1u, referrerChain.size());
+  ASSERT_EQ("first", referrerChain[0]);
+}
+
+TEST(ConcurrentReferrerMappingTest, ReferrerChainAcrossShards)
+{
+  AdblockPlus::ConcurrentReferrerMapping referrerMapping;
+  referrerMapping.Add("second", "first");
+  referrerMapping.Add("third", "second");
+  referrerMapping.Add("fourth", "third");
+  std::vector<std::string> referrerChain =
+    referrerMapping.BuildReferrerChain("fourth");
+  ASSERT_EQ(4u, referrerChain.size());
+  ASSERT_EQ("first", referrerChain[0]);
+  ASSERT_EQ("second", referrerChain[1]);
+  ASSERT_EQ("third", referrerChain[2]);
+  ASSERT_EQ("fourth", referrerChain[3]);
+}
+
+TEST(ConcurrentReferrerMappingTest, ReferrerLoop)
+{
+  AdblockPlus::ConcurrentReferrerMapping referrerMapping;
+  referrerMapping.Add("first", "second");
+  referrerMapping.Add("second", "first");
+  std::vector<std::string> referrerChain =
+    referrerMapping.BuildReferrerChain("first");
+  ASSERT_EQ(11u, referrerChain.size());
+  ASSERT_EQ("first", referrerChain[10]);
+  ASSERT_EQ("second", referrerChain[9]);
+}
+
+TEST(ConcurrentReferrerMappingTest, CacheIsLimited)
+{
+  AdblockPlus::ConcurrentReferrerMapping referrerMapping(16, std::numeric_limits<size_t>::max(), 4);
+  for (int i = 0; i < 1000; i++)
+    referrerMapping.Add(std::to_string(i + 1), std::to_string(i));
+  ASSERT_EQ(1u, referrerMapping.BuildReferrerChain("1").size());
+  std::vector<std::string> referrerChain =
+    referrerMapping.BuildReferrerChain("1000");
+  ASSERT_LE(2u, referrerChain.size());
+  ASSERT_EQ("999", referrerChain[referrerChain.size() - 2]);
+  ASSERT_EQ("1000", referrerChain.back());
+}
+
+TEST(ConcurrentReferrerMappingTest, ConcurrentAddAndBuild)
+{
+  AdblockPlus::ConcurrentReferrerMapping referrerMapping(1000);
+  std::vector<std::thread> threads;
+  for (int t = 0; t < 8; t++)
+  {
+    threads.emplace_back([&referrerMapping, t]
+    {
+      const std::string prefix = "http://example.com/" + std::to_string(t) + "/";
+      for (int i = 0; i < 1000; i++)
+      {
+        referrerMapping.Add(prefix + std::to_string(i + 1), prefix + std::to_string(i));
+        std::vector<std::string> referrerChain =
+          referrerMapping.BuildReferrerChain(prefix + std::to_string(i + 1));
+        EXPECT_LE(1u, referrerChain.size());
+        EXPECT_GE(11u, referrerChain.size());
+        EXPECT_EQ(prefix + std::to_string(i + 1), referrerChain.back());
+      }
+    });
+  }
+  for (auto& thread : threads)
+    thread.join();
+}
@@ -56,7 +56,7 @@ TEST_F(ConsoleJsObjectTest, ConsoleLogCall)
   GetJsEngine().Evaluate("\n\nconsole.log('foo', 'bar');\n\n", "eval");
   ASSERT_EQ(AdblockPlus::LogSystem::LOG_LEVEL_LOG, mockLogSystem->lastLogLevel);
   ASSERT_EQ("foo bar", mockLogSystem->lastMessage);
-  ASSERT_EQ("eval:3", mockLogSystem->lastSource);
+  ASSERT_EQ("", mockLogSystem->lastSource);
 }
 
 TEST_F(ConsoleJsObjectTest, ConsoleDebugCall)
@@ -64,7 +64,7 @@ TEST_F(ConsoleJsObjectTest, ConsoleDebugCall)
   GetJsEngine().Evaluate("console.debug('foo', 'bar')");
   ASSERT_EQ(AdblockPlus::LogSystem::LOG_LEVEL_LOG, mockLogSystem->lastLogLevel);
   ASSERT_EQ("foo bar", mockLogSystem->lastMessage);
-  ASSERT_EQ(":1", mockLogSystem->lastSource);
+  ASSERT_EQ("", mockLogSystem->lastSource);
 }
 
 TEST_F(ConsoleJsObjectTest, ConsoleInfoCall)
@@ -72,7 +72,7 @@ TEST_F(ConsoleJsObjectTest, ConsoleInfoCall)
   GetJsEngine().Evaluate("console.info('foo', 'bar')");
   ASSERT_EQ(AdblockPlus::LogSystem::LOG_LEVEL_INFO, mockLogSystem->lastLogLevel);
   ASSERT_EQ("foo bar", mockLogSystem->lastMessage);
-  ASSERT_EQ(":1", mockLogSystem->lastSource);
+  ASSERT_EQ("", mockLogSystem->lastSource);
 }
 
 TEST_F(ConsoleJsObjectTest, ConsoleWarnCall)
@@ -108,3 +108,42 @@ TEST_F(ConsoleJsObjectTest, ConsoleTraceCall)
 3: /* anonymous */() at eval:8\n", mockLogSystem->lastMessage);
   ASSERT_EQ("", mockLogSystem->lastSource);
 }
+
+TEST_F(ConsoleJsObjectTest, ConsoleWarnSource)
+{
+  GetJsEngine().Evaluate("\n\nconsole.warn('foo', 'bar');\n\n", "eval");
+  ASSERT_EQ(AdblockPlus::LogSystem::LOG_LEVEL_WARN, mockLogSystem->lastLogLevel);
+  ASSERT_EQ("eval:3", mockLogSystem->lastSource);
+}
+
+TEST_F(ConsoleJsObjectTest, MinLogLevel)
+{
+  platform->SetMinLogLevel(AdblockPlus::LogSystem::LOG_LEVEL_WARN);
+  GetJsEngine().Evaluate("console.error('error')");
+  ASSERT_EQ(AdblockPlus::LogSystem::LOG_LEVEL_ERROR, mockLogSystem->lastLogLevel);
+  ASSERT_EQ("error", mockLogSystem->lastMessage);
+
+  // arguments of dropped messages are not even converted to strings
+  GetJsEngine().Evaluate("console.log({toString: function() { throw new Error('converted'); }})");
+  GetJsEngine().Evaluate("console.info('info')");
+  GetJsEngine().Evaluate("console.trace()");
+  ASSERT_EQ(AdblockPlus::LogSystem::LOG_LEVEL_ERROR, mockLogSystem->lastLogLevel);
+  ASSERT_EQ("error", mockLogSystem->lastMessage);
+
+  GetJsEngine().Evaluate("console.warn('warn')");
+  ASSERT_EQ(AdblockPlus::LogSystem::LOG_LEVEL_WARN, mockLogSystem->lastLogLevel);
+  ASSERT_EQ("warn", mockLogSystem->lastMessage);
+}
+
+TEST_F(ConsoleJsObjectTest, MinLogLevelFromCreationParameters)
+{
+  ThrowingPlatformCreationParameters platformParams;
+  platformParams.logSystem.reset(mockLogSystem = new MockLogSystem());
+  platformParams.minLogLevel = AdblockPlus::LogSystem::LOG_LEVEL_ERROR;
+  platform.reset(new Platform(std::move(platformParams)));
+
+  GetJsEngine().Evaluate("console.error('error')");
+  GetJsEngine().Evaluate("console.warn('warn')");
+  ASSERT_EQ(AdblockPlus::LogSystem::LOG_LEVEL_ERROR, mockLogSystem->lastLogLevel);
+  ASSERT_EQ("error", mockLogSystem->lastMessage);
+}
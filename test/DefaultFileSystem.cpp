@@ -239,3 +239,16 @@ TEST_F(DefaultFileSystemTest, WriteMoveStatRemove)
   PumpTask();
   EXPECT_TRUE(hasStatRemovedFileRun);
 }
+
+TEST_F(DefaultFileSystemTest, MoveReplacesExistingFile)
+{
+  DefaultFileSystemSync syncFileSystem("");
+  const std::string newTestFileName = testFileName + "-new";
+  syncFileSystem.Write(testFileName, IFileSystem::IOBuffer{'n', 'e', 'w'});
+  syncFileSystem.Write(newTestFileName, IFileSystem::IOBuffer{'o', 'l', 'd'});
+
+  syncFileSystem.Move(testFileName, newTestFileName);
+  EXPECT_FALSE(syncFileSystem.Stat(testFileName).exists);
+  EXPECT_EQ((IFileSystem::IOBuffer{'n', 'e', 'w'}), syncFileSystem.Read(newTestFileName));
+  syncFileSystem.Remove(newTestFileName);
+}
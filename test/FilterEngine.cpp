@@ -17,6 +17,11 @@
 
 #include "BaseJsTest.h"
 #include <AdblockPlus/DefaultLogSystem.h>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <future>
+#include <iterator>
 #include <thread>
 #include <condition_variable>
 
@@ -72,6 +77,62 @@ namespace
   typedef FilterEngineTestGeneric<LazyFileSystem, AdblockPlus::DefaultLogSystem> FilterEngineTest;
   typedef FilterEngineTestGeneric<NoFilesFileSystem, LazyLogSystem> FilterEngineTestNoData;
 
+  // Writes and moves files in the temporary directory on disk, so that
+  // filter indexes can be opened.
+  class TempDirFileSystem : public LazyFileSystem
+  {
+  public:
+    void Write(const std::string& fileName, const IOBuffer& data,
+      const Callback& callback) override
+    {
+      if (!Utils::BeginsWith(fileName, ::testing::TempDir()))
+        return;
+      scheduler([fileName, data, callback]
+      {
+        std::ofstream file(fileName, std::ios::binary);
+        file.write(reinterpret_cast<const char*>(data.data()), data.size());
+        callback(file ? "" : "Unable to write " + fileName);
+      });
+    }
+
+    void Move(const std::string& fromFileName, const std::string& toFileName,
+      const Callback& callback) override
+    {
+      scheduler([fromFileName, toFileName, callback]
+      {
+        bool moved = std::rename(fromFileName.c_str(), toFileName.c_str()) == 0;
+        callback(moved ? "" : "Unable to move " + fromFileName);
+      });
+    }
+  };
+  typedef FilterEngineTestGeneric<TempDirFileSystem, LazyLogSystem> FilterEngineWithTempDirFS;
+
+  class FilterEngineWithDelayedTimer : public BaseJsTest
+  {
+  protected:
+    DelayedTimer::SharedTasks timerTasks;
+
+    void SetUp() override
+    {
+      LazyFileSystem* fileSystem;
+      ThrowingPlatformCreationParameters platformParams;
+      platformParams.logSystem.reset(new AdblockPlus::DefaultLogSystem());
+      platformParams.timer = DelayedTimer::New(timerTasks);
+      platformParams.fileSystem.reset(fileSystem = new LazyFileSystem());
+      platformParams.webRequest.reset(new NoopWebRequest());
+      platform.reset(new Platform(std::move(platformParams)));
+      FilterEngine::CreationParameters createParams;
+      createParams.preconfiguredPrefs.emplace("first_run_subscription_auto_select", GetJsEngine().NewValue(false));
+      ::CreateFilterEngine(*fileSystem, *platform, createParams);
+      DelayedTimer::ProcessImmediateTimers(timerTasks);
+    }
+
+    FilterEngine& GetFilterEngine()
+    {
+      return platform->GetFilterEngine();
+    }
+  };
+
   class FilterEngineWithInMemoryFS : public BaseJsTest
   {
     LazyFileSystem* fileSystem;
@@ -242,6 +303,187 @@ TEST_F(FilterEngineTest, AddRemoveFilters)
   ASSERT_FALSE(filter.IsListed());
 }
 
+TEST_F(FilterEngineTest, AddRemoveFiltersInBulk)
+{
+  auto& filterEngine = GetFilterEngine();
+  filterEngine.AddFilters({"foo", "", "foo", "bar", "@@baz"});
+  ASSERT_EQ(3u, filterEngine.GetListedFilters().size());
+  ASSERT_TRUE(filterEngine.GetFilter("foo").IsListed());
+  ASSERT_TRUE(filterEngine.GetFilter("bar").IsListed());
+  ASSERT_TRUE(filterEngine.GetFilter("@@baz").IsListed());
+
+  // Adding to existing groups is reported once per group, not per filter.
+  std::vector<std::string> actions;
+  filterEngine.SetFilterChangeCallback([&actions](const std::string& action, JsValue&&)
+  {
+    actions.push_back(action);
+  });
+  filterEngine.AddFilters({"foo", "adbanner.gif", "qux"});
+  ASSERT_EQ(5u, filterEngine.GetListedFilters().size());
+  ASSERT_EQ(std::vector<std::string>(1, "subscription.updated"), actions);
+  AdblockPlus::FilterPtr match = filterEngine.Matches(
+    "http://example.org/adbanner.gif", AdblockPlus::FilterEngine::CONTENT_TYPE_IMAGE, "");
+  ASSERT_TRUE(match);
+  ASSERT_EQ("adbanner.gif", match->GetProperty("text").AsString());
+
+  actions.clear();
+  filterEngine.RemoveFilters({"adbanner.gif", "bar", "notlisted", "@@baz"});
+  ASSERT_FALSE(actions.empty());
+  for (const auto& action : actions)
+    ASSERT_EQ("subscription.updated", action);
+  ASSERT_EQ(2u, filterEngine.GetListedFilters().size());
+  ASSERT_FALSE(filterEngine.GetFilter("bar").IsListed());
+  ASSERT_FALSE(filterEngine.GetFilter("@@baz").IsListed());
+  ASSERT_TRUE(filterEngine.GetFilter("foo").IsListed());
+  ASSERT_FALSE(filterEngine.Matches(
+    "http://example.org/adbanner.gif", AdblockPlus::FilterEngine::CONTENT_TYPE_IMAGE, ""));
+}
+
+TEST_F(FilterEngineTest, AddRemoveFewFiltersIncrementally)
+{
+  auto& filterEngine = GetFilterEngine();
+  std::vector<std::string> texts;
+  for (int i = 0; i < 20; i++)
+    texts.push_back("filter" + std::to_string(i));
+  filterEngine.AddFilters(texts);
+
+  // A few filters don't cause the whole group to be processed again.
+  std::vector<std::string> actions;
+  filterEngine.SetFilterChangeCallback([&actions](const std::string& action, JsValue&&)
+  {
+    actions.push_back(action);
+  });
+  filterEngine.AddFilters({"adbanner.gif"});
+  ASSERT_EQ(std::vector<std::string>(1, "filter.added"), actions);
+  ASSERT_EQ(21u, filterEngine.GetListedFilters().size());
+  ASSERT_TRUE(filterEngine.Matches(
+    "http://example.org/adbanner.gif", AdblockPlus::FilterEngine::CONTENT_TYPE_IMAGE, ""));
+
+  actions.clear();
+  filterEngine.RemoveFilters({"adbanner.gif", "filter3"});
+  ASSERT_EQ(std::vector<std::string>(2, "filter.removed"), actions);
+  ASSERT_EQ(19u, filterEngine.GetListedFilters().size());
+  ASSERT_FALSE(filterEngine.GetFilter("filter3").IsListed());
+  ASSERT_FALSE(filterEngine.Matches(
+    "http://example.org/adbanner.gif", AdblockPlus::FilterEngine::CONTENT_TYPE_IMAGE, ""));
+}
+
+TEST_F(FilterEngineTest, FilterTextPages)
+{
+  auto& filterEngine = GetFilterEngine();
+  auto page = filterEngine.GetListedFilterTexts(0, 10);
+  EXPECT_EQ(0u, page.totalCount);
+  EXPECT_TRUE(page.filters.empty());
+
+  filterEngine.AddFilters({"foo", "@@bar", "##.ad", "baz", "qux"});
+  page = filterEngine.GetListedFilterTexts(1, 2);
+  EXPECT_EQ(5u, page.totalCount);
+  ASSERT_EQ(2u, page.filters.size());
+  EXPECT_EQ("@@bar", page.filters[0].text);
+  EXPECT_EQ(AdblockPlus::Filter::TYPE_EXCEPTION, page.filters[0].type);
+  EXPECT_EQ("##.ad", page.filters[1].text);
+  EXPECT_EQ(AdblockPlus::Filter::TYPE_ELEMHIDE, page.filters[1].type);
+
+  page = filterEngine.GetListedFilterTexts(4, 10);
+  ASSERT_EQ(1u, page.filters.size());
+  EXPECT_EQ("qux", page.filters[0].text);
+  EXPECT_EQ(AdblockPlus::Filter::TYPE_BLOCKING, page.filters[0].type);
+  EXPECT_TRUE(filterEngine.GetListedFilterTexts(5, 10).filters.empty());
+
+  page = filterEngine.GetSubscriptionFilterTexts("~user~0000", 0, 3);
+  EXPECT_EQ(5u, page.totalCount);
+  ASSERT_EQ(3u, page.filters.size());
+  EXPECT_EQ("foo", page.filters[0].text);
+
+  page = filterEngine.GetSubscriptionFilterTexts("https://unknown.example/list.txt", 0, 10);
+  EXPECT_EQ(0u, page.totalCount);
+  EXPECT_TRUE(page.filters.empty());
+}
+
+TEST_F(FilterEngineTest, IsListedFilter)
+{
+  auto& filterEngine = GetFilterEngine();
+  EXPECT_FALSE(filterEngine.IsListedFilter("foo"));
+  EXPECT_FALSE(filterEngine.IsListedFilter(""));
+
+  filterEngine.AddFilters({"foo", "@@bar"});
+  AdblockPlus::Filter::Type type = AdblockPlus::Filter::TYPE_INVALID;
+  EXPECT_TRUE(filterEngine.IsListedFilter("foo", &type));
+  EXPECT_EQ(AdblockPlus::Filter::TYPE_BLOCKING, type);
+  EXPECT_TRUE(filterEngine.IsListedFilter("@@bar", &type));
+  EXPECT_EQ(AdblockPlus::Filter::TYPE_EXCEPTION, type);
+  EXPECT_FALSE(filterEngine.IsListedFilter("baz"));
+  EXPECT_TRUE(filterEngine.IsListedFilter(" foo\t"));
+
+  // The index follows changes made through the Filter objects too.
+  filterEngine.GetFilter("baz").AddToList();
+  EXPECT_TRUE(filterEngine.IsListedFilter("baz"));
+  filterEngine.GetFilter("foo").RemoveFromList();
+  EXPECT_FALSE(filterEngine.IsListedFilter("foo"));
+  EXPECT_TRUE(filterEngine.IsListedFilter("@@bar"));
+}
+
+TEST_F(FilterEngineTest, ListedFilterIndexIsUpdatedIncrementally)
+{
+  auto& filterEngine = GetFilterEngine();
+  // Changes to a large part of a group replace its filters as a whole.
+  filterEngine.AddFilters({"foo", "bar", "baz", "qux", "quux"});
+  EXPECT_TRUE(filterEngine.IsListedFilter("foo"));
+  auto rebuildCount = [&filterEngine]
+  {
+    return filterEngine.GetMetrics()[Metrics::OPERATION_GET_LISTED_FILTERS].count;
+  };
+  uint64_t initialRebuildCount = rebuildCount();
+
+  for (int i = 0; i < 100; i++)
+  {
+    std::string text = "filter" + std::to_string(i);
+    filterEngine.AddFilters({text});
+    EXPECT_TRUE(filterEngine.IsListedFilter(text));
+  }
+  filterEngine.RemoveFilters({"foo", "filter0"});
+  EXPECT_FALSE(filterEngine.IsListedFilter("foo"));
+  EXPECT_FALSE(filterEngine.IsListedFilter("filter0"));
+  EXPECT_TRUE(filterEngine.IsListedFilter("filter99"));
+  EXPECT_EQ(initialRebuildCount, rebuildCount());
+}
+
+TEST_F(FilterEngineTest, FiltersOfDisabledGroupsAreNotListed)
+{
+  auto& filterEngine = GetFilterEngine();
+  filterEngine.AddFilters({"foo"});
+  EXPECT_TRUE(filterEngine.IsListedFilter("foo"));
+
+  GetJsEngine().Evaluate(
+    "for (let subscription of require('filterStorage').FilterStorage.subscriptions)"
+    "  if (subscription instanceof require('subscriptionClasses').SpecialSubscription)"
+    "    subscription.disabled = true;");
+  EXPECT_FALSE(filterEngine.IsListedFilter("foo"));
+  EXPECT_FALSE(filterEngine.IsListedFilter(" foo"));
+}
+
+TEST_F(FilterEngineTest, FilterHitStats)
+{
+  auto& filterEngine = GetFilterEngine();
+  EXPECT_TRUE(filterEngine.GetFilterHitStats().empty());
+
+  filterEngine.AddFilters({"adbanner.gif", "@@||example.com^$document"});
+  for (int i = 0; i < 3; i++)
+    filterEngine.Matches("http://example.org/adbanner.gif", FilterEngine::CONTENT_TYPE_IMAGE, "");
+  filterEngine.Matches("http://example.org/other.gif", FilterEngine::CONTENT_TYPE_IMAGE, "");
+  EXPECT_TRUE(filterEngine.IsDocumentWhitelisted("http://example.com/",
+    std::vector<std::string>()));
+
+  auto stats = filterEngine.GetFilterHitStats();
+  ASSERT_EQ(2u, stats.size());
+  EXPECT_EQ("adbanner.gif", stats[0].text);
+  EXPECT_EQ(3u, stats[0].hitCount);
+  EXPECT_LT(0, stats[0].lastHit);
+  EXPECT_EQ("@@||example.com^$document", stats[1].text);
+  EXPECT_EQ(1u, stats[1].hitCount);
+  EXPECT_EQ(1u, filterEngine.GetFilterHitStats(1).size());
+}
+
 TEST_F(FilterEngineTest, SubscriptionProperties)
 {
   AdblockPlus::Subscription subscription = GetFilterEngine().GetSubscription("foo");
@@ -551,6 +793,87 @@ TEST_F(FilterEngineTest, MatchesNestedFrameOnWhitelistedDomain)
   ASSERT_EQ(AdblockPlus::Filter::TYPE_EXCEPTION, match5->GetType());
 }
 
+TEST_F(FilterEngineTest, MatchesFrameTree)
+{
+  auto& filterEngine = GetFilterEngine();
+  filterEngine.GetFilter("adbanner.gif").AddToList();
+  filterEngine.GetFilter("@@||example.org^$document,domain=ads.com").AddToList();
+  auto& frameTree = filterEngine.GetFrameTree();
+
+  frameTree.AddFrame(1, "http://example.com/");
+  frameTree.AddFrame(2, 1, "http://ads.com/frame/");
+  AdblockPlus::FilterPtr match1 =
+    filterEngine.Matches("http://ads.com/adbanner.gif", AdblockPlus::FilterEngine::CONTENT_TYPE_IMAGE, 2);
+  ASSERT_TRUE(match1);
+  ASSERT_EQ(AdblockPlus::Filter::TYPE_BLOCKING, match1->GetType());
+
+  frameTree.AddFrame(3, "http://example.org/");
+  frameTree.AddFrame(4, 3, "http://ads.com/frame/");
+  AdblockPlus::FilterPtr match2 =
+    filterEngine.Matches("http://ads.com/adbanner.gif", AdblockPlus::FilterEngine::CONTENT_TYPE_IMAGE, 4);
+  ASSERT_TRUE(match2);
+  ASSERT_EQ(AdblockPlus::Filter::TYPE_EXCEPTION, match2->GetType());
+
+  // the cached whitelisting state is used for subsequent requests
+  AdblockPlus::FilterPtr match3 =
+    filterEngine.Matches("http://ads.com/adbanner.gif", AdblockPlus::FilterEngine::CONTENT_TYPE_IMAGE, 4);
+  ASSERT_TRUE(match3);
+  ASSERT_EQ(AdblockPlus::Filter::TYPE_EXCEPTION, match3->GetType());
+
+  AdblockPlus::FilterPtr match4 =
+    filterEngine.Matches("http://ads.com/adbanner.gif", AdblockPlus::FilterEngine::CONTENT_TYPE_IMAGE, 42);
+  ASSERT_TRUE(match4);
+  ASSERT_EQ(AdblockPlus::Filter::TYPE_BLOCKING, match4->GetType());
+}
+
+TEST_F(FilterEngineTest, MatchesFrameTreeAfterFilterChange)
+{
+  auto& filterEngine = GetFilterEngine();
+  filterEngine.GetFilter("adbanner.gif").AddToList();
+  auto& frameTree = filterEngine.GetFrameTree();
+  frameTree.AddFrame(1, "http://example.org/");
+  frameTree.AddFrame(2, 1, "http://ads.com/frame/");
+
+  AdblockPlus::FilterPtr match1 =
+    filterEngine.Matches("http://ads.com/adbanner.gif", AdblockPlus::FilterEngine::CONTENT_TYPE_IMAGE, 2);
+  ASSERT_TRUE(match1);
+  ASSERT_EQ(AdblockPlus::Filter::TYPE_BLOCKING, match1->GetType());
+
+  auto whitelistingFilter = filterEngine.GetFilter("@@||example.org^$document");
+  whitelistingFilter.AddToList();
+  AdblockPlus::FilterPtr match2 =
+    filterEngine.Matches("http://ads.com/adbanner.gif", AdblockPlus::FilterEngine::CONTENT_TYPE_IMAGE, 2);
+  ASSERT_TRUE(match2);
+  ASSERT_EQ(AdblockPlus::Filter::TYPE_EXCEPTION, match2->GetType());
+
+  whitelistingFilter.RemoveFromList();
+  AdblockPlus::FilterPtr match3 =
+    filterEngine.Matches("http://ads.com/adbanner.gif", AdblockPlus::FilterEngine::CONTENT_TYPE_IMAGE, 2);
+  ASSERT_TRUE(match3);
+  ASSERT_EQ(AdblockPlus::Filter::TYPE_BLOCKING, match3->GetType());
+}
+
+TEST_F(FilterEngineTest, Metrics)
+{
+  auto& filterEngine = GetFilterEngine();
+  filterEngine.GetFilter("adbanner.gif").AddToList();
+  filterEngine.Matches("http://example.org/adbanner.gif", AdblockPlus::FilterEngine::CONTENT_TYPE_IMAGE, "");
+  filterEngine.Matches("http://example.org/image.gif", AdblockPlus::FilterEngine::CONTENT_TYPE_IMAGE, "");
+  filterEngine.GetPref("patternsbackups");
+
+  std::vector<AdblockPlus::LatencyHistogram> metrics = filterEngine.GetMetrics();
+  ASSERT_EQ(static_cast<size_t>(AdblockPlus::Metrics::OPERATION_COUNT), metrics.size());
+  EXPECT_EQ(1u, metrics[AdblockPlus::Metrics::OPERATION_CREATE_FILTER_ENGINE].count);
+  EXPECT_EQ(2u, metrics[AdblockPlus::Metrics::OPERATION_MATCHES].count);
+  EXPECT_EQ(1u, metrics[AdblockPlus::Metrics::OPERATION_GET_FILTER].count);
+  EXPECT_EQ(1u, metrics[AdblockPlus::Metrics::OPERATION_GET_PREF].count);
+  EXPECT_EQ(0u, metrics[AdblockPlus::Metrics::OPERATION_SET_PREF].count);
+  EXPECT_LT(0u, metrics[AdblockPlus::Metrics::OPERATION_EVALUATE].count);
+  EXPECT_LT(0u, metrics[AdblockPlus::Metrics::OPERATION_V8_LOCK_WAIT].count);
+  EXPECT_LE(metrics[AdblockPlus::Metrics::OPERATION_MATCHES].GetPercentile(50),
+    metrics[AdblockPlus::Metrics::OPERATION_MATCHES].maxNanoseconds);
+}
+
 TEST_F(FilterEngineTest, FirstRunFlag)
 {
   ASSERT_FALSE(GetFilterEngine().IsFirstRun());
@@ -578,6 +901,62 @@ TEST_F(FilterEngineTest, SetRemoveFilterChangeCallback)
   EXPECT_EQ(1, timesCalled);
 }
 
+TEST_F(FilterEngineWithDelayedTimer, FilterChangesAreBatched)
+{
+  auto& filterEngine = GetFilterEngine();
+  int changeCount = 0;
+  filterEngine.SetFilterChangeCallback([&changeCount](const std::string&, JsValue&&)
+  {
+    ++changeCount;
+  });
+  std::vector<std::vector<FilterEngine::FilterChange>> batches;
+  filterEngine.SetFilterChangesCallback([&batches](std::vector<FilterEngine::FilterChange>&& changes)
+  {
+    batches.push_back(std::move(changes));
+  });
+
+  filterEngine.GetFilter("foo").AddToList();
+  filterEngine.GetFilter("bar").AddToList();
+  EXPECT_TRUE(batches.empty());
+  DelayedTimer::ProcessImmediateTimers(timerTasks);
+  ASSERT_EQ(1u, batches.size());
+  ASSERT_LE(2u, batches[0].size());
+  EXPECT_EQ("filter.added", batches[0][0].action);
+  EXPECT_EQ("foo", batches[0][0].item);
+  EXPECT_EQ("filter.added", batches[0][1].action);
+  EXPECT_EQ("bar", batches[0][1].item);
+  EXPECT_EQ(0, changeCount);
+
+  filterEngine.RemoveFilterChangesCallback();
+  filterEngine.GetFilter("foo").RemoveFromList();
+  EXPECT_LE(1, changeCount);
+  DelayedTimer::ProcessImmediateTimers(timerTasks);
+  EXPECT_EQ(1u, batches.size());
+}
+
+TEST_F(FilterEngineWithDelayedTimer, FilterChangesAreDeliveredOnScheduler)
+{
+  auto& filterEngine = GetFilterEngine();
+  std::vector<SchedulerTask> scheduledTasks;
+  std::vector<FilterEngine::FilterChange> changes;
+  filterEngine.SetFilterChangesCallback([&changes](std::vector<FilterEngine::FilterChange>&& reported)
+  {
+    changes = std::move(reported);
+  }, [&scheduledTasks](const SchedulerTask& task)
+  {
+    scheduledTasks.push_back(task);
+  });
+
+  filterEngine.GetFilter("foo").AddToList();
+  DelayedTimer::ProcessImmediateTimers(timerTasks);
+  ASSERT_EQ(1u, scheduledTasks.size());
+  EXPECT_TRUE(changes.empty());
+  scheduledTasks[0]();
+  ASSERT_FALSE(changes.empty());
+  EXPECT_EQ("filter.added", changes[0].action);
+  EXPECT_EQ("foo", changes[0].item);
+}
+
 TEST_F(FilterEngineTest, DocumentWhitelisting)
 {
   auto& filterEngine = GetFilterEngine();
@@ -665,6 +1044,92 @@ TEST_F(FilterEngineWithInMemoryFS, LangAndAASubscriptionsAreChosenOnFirstRun)
   EXPECT_TRUE(filterEngine.IsAAEnabled());
 }
 
+TEST_F(FilterEngineWithInMemoryFS, SaveFilterHitStats)
+{
+  InitPlatformAndAppInfo();
+  auto& filterEngine = CreateFilterEngine();
+  filterEngine.AddFilters({"adbanner.gif"});
+  filterEngine.Matches("http://example.org/adbanner.gif", FilterEngine::CONTENT_TYPE_IMAGE, "");
+  filterEngine.Matches("http://example.org/adbanner.gif", FilterEngine::CONTENT_TYPE_IMAGE, "");
+
+  std::string saveError = "not called";
+  filterEngine.SaveFilterHitStats([&saveError](const std::string& error)
+  {
+    saveError = error;
+  });
+  EXPECT_EQ("", saveError);
+
+  std::string content;
+  platform->WithFileSystem([&content](IFileSystem& fileSystem)
+  {
+    fileSystem.Read("filterhits.txt", [&content](IFileSystem::IOBuffer&& data, const std::string& error)
+    {
+      content.assign(data.begin(), data.end());
+    });
+  });
+  EXPECT_NE(std::string::npos, content.find("\n2\t")) << content;
+  EXPECT_NE(std::string::npos, content.find("\tadbanner.gif\n")) << content;
+
+  // The statistics are written to a temporary file first.
+  bool tempFileExists = true;
+  platform->WithFileSystem([&tempFileExists](IFileSystem& fileSystem)
+  {
+    fileSystem.Stat("filterhits.txt.tmp", [&tempFileExists](const IFileSystem::StatResult& result, const std::string& error)
+    {
+      tempFileExists = result.exists;
+    });
+  });
+  EXPECT_FALSE(tempFileExists);
+}
+
+TEST_F(FilterEngineWithInMemoryFS, WriteFilterIndex)
+{
+  InitPlatformAndAppInfo();
+  auto& filterEngine = CreateFilterEngine();
+  filterEngine.AddFilters({"adbanner.gif", "@@notbanner.gif", "tpbanner.gif$third-party",
+    "||example.net^$script,domain=example.com", "example.com##.ad", "##.generic"});
+
+  std::string writeError = "not called";
+  filterEngine.WriteFilterIndex("filters.idx", [&writeError](const std::string& error)
+  {
+    writeError = error;
+  });
+  EXPECT_EQ("", writeError);
+
+  IFileSystem::IOBuffer content;
+  platform->WithFileSystem([&content](IFileSystem& fileSystem)
+  {
+    fileSystem.Read("filters.idx", [&content](IFileSystem::IOBuffer&& data, const std::string& error)
+    {
+      content = std::move(data);
+    });
+  });
+  FilterIndexPtr index = FilterIndex::FromBuffer(content.data(), content.size());
+  EXPECT_EQ(6u, index->GetFilterCount());
+
+  const std::vector<std::pair<std::string, std::string>> requests = {
+    {"http://example.org/adbanner.gif", ""},
+    {"http://example.org/notbanner.gif", ""},
+    {"http://ads.example.org/tpbanner.gif", "http://www.example.org/"},
+    {"http://ads.example.net/tpbanner.gif", "http://www.example.org/"},
+    {"http://cdn.example.net/script.js", "http://example.com/"},
+    {"http://cdn.example.net/script.js", "http://example.org/"},
+  };
+  for (const auto& request : requests)
+  {
+    FilterPtr expected = filterEngine.Matches(request.first,
+      FilterEngine::CONTENT_TYPE_IMAGE | FilterEngine::CONTENT_TYPE_SCRIPT, request.second);
+    FilterEngine::FilterText actual;
+    bool matched = index->Matches(request.first,
+      FilterEngine::CONTENT_TYPE_IMAGE | FilterEngine::CONTENT_TYPE_SCRIPT, request.second, &actual);
+    ASSERT_EQ(static_cast<bool>(expected), matched) << request.first;
+    if (expected)
+      EXPECT_EQ(expected->GetProperty("text").AsString(), actual.text);
+  }
+  EXPECT_EQ(filterEngine.GetElementHidingSelectors("example.com"),
+    index->GetElementHidingSelectors("example.com"));
+}
+
 TEST_F(FilterEngineWithInMemoryFS, DisableSubscriptionsAutoSelectOnFirstRun)
 {
   InitPlatformAndAppInfo();
@@ -1010,3 +1475,74 @@ TEST_F(FilterEngineIsSubscriptionDownloadAllowedTest, ConfiguredConnectionTypeIs
     EXPECT_EQ(testConnection, capturedConnectionTypes[0].second);
   }
 }
+
+TEST_F(FilterEngineWithTempDirFS, RewritingFilterIndexKeepsOpenedIndexValid)
+{
+  auto& filterEngine = GetFilterEngine();
+  std::string path = ::testing::TempDir() + "rewritten.idx";
+  filterEngine.AddFilters({"adbanner.gif"});
+  std::string writeError = "not called";
+  filterEngine.WriteFilterIndex(path, [&writeError](const std::string& error)
+  {
+    writeError = error;
+  });
+  ASSERT_EQ("", writeError);
+  FilterIndexPtr index = FilterIndex::Open(path);
+  size_t filterCount = index->GetFilterCount();
+
+  filterEngine.AddFilters({"otherbanner.gif"});
+  filterEngine.WriteFilterIndex(path);
+
+  // The file was replaced, the index opened before still maps the old one.
+  EXPECT_EQ(filterCount, index->GetFilterCount());
+  EXPECT_TRUE(index->Matches("http://example.org/adbanner.gif",
+    FilterEngine::CONTENT_TYPE_IMAGE, ""));
+  EXPECT_FALSE(index->Matches("http://example.org/otherbanner.gif",
+    FilterEngine::CONTENT_TYPE_IMAGE, ""));
+  EXPECT_EQ(filterCount + 1, FilterIndex::Open(path)->GetFilterCount());
+  std::remove(path.c_str());
+}
+
+TEST(FilterEngineDefaultPlatformTest, DestroyingPlatformSavesFilterHitStats)
+{
+  const std::string basePath = ::testing::TempDir();
+  const std::string statsPath = basePath + "filterhits.txt";
+  for (const char* fileName : {"filterhits.txt", "patterns.ini", "prefs.json"})
+    std::remove((basePath + fileName).c_str());
+
+  DefaultPlatformBuilder platformBuilder;
+  platformBuilder.logSystem.reset(new LazyLogSystem());
+  // The save delay never passes.
+  platformBuilder.timer.reset(new NoopTimer());
+  platformBuilder.webRequest.reset(new NoopWebRequest());
+  platformBuilder.CreateDefaultFileSystem(basePath);
+  std::unique_ptr<Platform> platform = platformBuilder.CreatePlatform();
+  FilterEngine::CreationParameters createParams;
+  createParams.preconfiguredPrefs.emplace("first_run_subscription_auto_select",
+    platform->GetJsEngine().NewValue(false));
+  platform->CreateFilterEngineAsync(createParams);
+  auto& filterEngine = platform->GetFilterEngine();
+
+  // Saving fails until the statistics of previous sessions are loaded.
+  for (int i = 0; i < 100; i++)
+  {
+    std::promise<std::string> saved;
+    filterEngine.SaveFilterHitStats([&saved](const std::string& error)
+    {
+      saved.set_value(error);
+    });
+    if (saved.get_future().get().empty())
+      break;
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  }
+  filterEngine.AddFilters({"adbanner.gif"});
+  filterEngine.Matches("http://example.org/adbanner.gif", FilterEngine::CONTENT_TYPE_IMAGE, "");
+  platform.reset();
+
+  std::ifstream file(statsPath);
+  std::string content((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+  EXPECT_NE(std::string::npos, content.find("\n1\t")) << content;
+  EXPECT_NE(std::string::npos, content.find("\tadbanner.gif\n")) << content;
+  for (const char* fileName : {"filterhits.txt", "patterns.ini", "prefs.json"})
+    std::remove((basePath + fileName).c_str());
+}
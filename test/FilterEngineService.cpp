@@ -0,0 +1,207 @@
+/*
+ * This file is part of Adblock Plus <https://adblockplus.org/>,
+ * Copyright (C) 2006-present eyeo GmbH
+ *
+ * Adblock Plus is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 3 as
+ * published by the Free Software Foundation.
+ *
+ * Adblock Plus is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Adblock Plus.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <future>
+#include <thread>
+#include <unistd.h>
+#include <AdblockPlus/FilterEngineClient.h>
+#include <AdblockPlus/FilterEngineService.h>
+#include "BaseJsTest.h"
+#include "../src/ServiceProtocol.h"
+
+using namespace AdblockPlus;
+
+namespace
+{
+  class FilterEngineServiceTest : public BaseJsTest
+  {
+  protected:
+    std::string socketPath;
+    std::unique_ptr<FilterEngineService> service;
+
+    void SetUp() override
+    {
+      LazyFileSystem* fileSystem;
+      ThrowingPlatformCreationParameters platformParams;
+      platformParams.logSystem.reset(new LazyLogSystem());
+      platformParams.timer.reset(new NoopTimer());
+      platformParams.fileSystem.reset(fileSystem = new LazyFileSystem());
+      platformParams.webRequest.reset(new NoopWebRequest());
+      platform.reset(new Platform(std::move(platformParams)));
+      auto& filterEngine = ::CreateFilterEngine(*fileSystem, *platform);
+      filterEngine.AddFilters({"adbanner.gif", "@@notbanner.gif",
+        "@@||example.com^$document", "@@||example.net^$elemhide",
+        "example.org##.ad", "##.generic"});
+
+      socketPath = ::testing::TempDir() + "abpd-test.sock";
+      service.reset(new FilterEngineService(filterEngine, socketPath));
+    }
+
+    void TearDown() override
+    {
+      service.reset();
+      BaseJsTest::TearDown();
+    }
+  };
+}
+
+TEST_F(FilterEngineServiceTest, AnswersQueries)
+{
+  FilterEngineClientPtr client = FilterEngineClient::Connect(socketPath);
+  FilterEngine::FilterText filter;
+  EXPECT_TRUE(client->Matches("http://example.org/adbanner.gif",
+    FilterEngine::CONTENT_TYPE_IMAGE, {"http://example.org/"}, &filter));
+  EXPECT_EQ("adbanner.gif", filter.text);
+  EXPECT_EQ(Filter::TYPE_BLOCKING, filter.type);
+  EXPECT_TRUE(client->Matches("http://example.org/notbanner.gif",
+    FilterEngine::CONTENT_TYPE_IMAGE, {}, &filter));
+  EXPECT_EQ("@@notbanner.gif", filter.text);
+  EXPECT_EQ(Filter::TYPE_EXCEPTION, filter.type);
+  EXPECT_FALSE(client->Matches("http://example.org/foo.gif",
+    FilterEngine::CONTENT_TYPE_IMAGE, {}));
+
+  EXPECT_TRUE(client->IsDocumentWhitelisted("http://example.com/", {}));
+  EXPECT_FALSE(client->IsDocumentWhitelisted("http://example.org/", {}));
+  EXPECT_TRUE(client->IsElemhideWhitelisted("http://example.net/", {}));
+  EXPECT_FALSE(client->IsElemhideWhitelisted("http://example.org/", {}));
+
+  std::vector<std::string> selectors = client->GetElementHidingSelectors("example.org");
+  std::sort(selectors.begin(), selectors.end());
+  ASSERT_EQ(2u, selectors.size());
+  EXPECT_EQ(".ad", selectors[0]);
+  EXPECT_EQ(".generic", selectors[1]);
+}
+
+TEST_F(FilterEngineServiceTest, PipelinesBatches)
+{
+  FilterEngineClientPtr client = FilterEngineClient::Connect(socketPath);
+  const int requestCount = 100;
+  std::vector<FilterEngineClient::Query> queries(3);
+  queries[0].url = "http://example.org/adbanner.gif";
+  queries[1].url = "http://example.org/notbanner.gif";
+  queries[2].url = "http://example.org/foo.gif";
+  for (auto& query : queries)
+    query.contentTypeMask = FilterEngine::CONTENT_TYPE_IMAGE;
+
+  std::atomic<int> pending(requestCount);
+  std::atomic<int> failures(0);
+  std::promise<void> done;
+  for (int i = 0; i < requestCount; i++)
+  {
+    client->MatchesAsync(queries,
+      [&](std::vector<FilterEngineClient::MatchResult>&& results, const std::string& error)
+      {
+        if (!error.empty() || results.size() != 3 || !results[0].matched ||
+          results[0].filter.text != "adbanner.gif" ||
+          results[1].filter.type != Filter::TYPE_EXCEPTION || results[2].matched)
+        {
+          failures++;
+        }
+        if (--pending == 0)
+          done.set_value();
+      });
+  }
+  done.get_future().wait();
+  EXPECT_EQ(0, failures);
+}
+
+TEST_F(FilterEngineServiceTest, ReportsErrors)
+{
+  EXPECT_THROW(FilterEngineClient::Connect(socketPath + ".missing"), std::runtime_error);
+
+  FilterEngineClientPtr client = FilterEngineClient::Connect(socketPath);
+  EXPECT_FALSE(client->Matches("http://example.org/foo.gif",
+    FilterEngine::CONTENT_TYPE_IMAGE, {}));
+  service.reset();
+  EXPECT_THROW(client->Matches("http://example.org/adbanner.gif",
+    FilterEngine::CONTENT_TYPE_IMAGE, {}), std::runtime_error);
+
+  std::string error;
+  client->GetElementHidingSelectorsAsync({"example.org"},
+    [&error](std::vector<std::vector<std::string>>&& results, const std::string& callbackError)
+    {
+      error = callbackError;
+    });
+  EXPECT_FALSE(error.empty());
+}
+
+TEST_F(FilterEngineServiceTest, RefusesOversizedResponses)
+{
+  platform->GetFilterEngine().AddFilters({"##." + std::string(1024 * 1024, 'a')});
+  FilterEngineClientPtr client = FilterEngineClient::Connect(socketPath);
+  std::promise<std::string> error;
+  client->GetElementHidingSelectorsAsync(std::vector<std::string>(20, "example.com"),
+    [&error](std::vector<std::vector<std::string>>&& results, const std::string& callbackError)
+    {
+      error.set_value(callbackError);
+    });
+  EXPECT_FALSE(error.get_future().get().empty());
+
+  // The connection is still usable.
+  EXPECT_TRUE(client->Matches("http://example.org/adbanner.gif",
+    FilterEngine::CONTENT_TYPE_IMAGE, {}));
+}
+
+TEST_F(FilterEngineServiceTest, OnlyReplacesStaleSockets)
+{
+  auto& filterEngine = platform->GetFilterEngine();
+  EXPECT_THROW(FilterEngineService other(filterEngine, socketPath), std::runtime_error);
+  FilterEngineClientPtr client = FilterEngineClient::Connect(socketPath);
+  EXPECT_TRUE(client->Matches("http://example.org/adbanner.gif",
+    FilterEngine::CONTENT_TYPE_IMAGE, {}));
+
+  std::string filePath = ::testing::TempDir() + "abpd-test.txt";
+  {
+    std::ofstream file(filePath);
+    file << "data";
+  }
+  EXPECT_THROW(FilterEngineService other(filterEngine, filePath), std::runtime_error);
+  EXPECT_TRUE(std::ifstream(filePath).good());
+  std::remove(filePath.c_str());
+
+  // A socket nobody listens on anymore is replaced.
+  std::string stalePath = ::testing::TempDir() + "abpd-stale.sock";
+  close(ServiceProtocol::Listen(stalePath));
+  FilterEngineService other(filterEngine, stalePath);
+  EXPECT_TRUE(FilterEngineClient::Connect(stalePath)->Matches(
+    "http://example.org/adbanner.gif", FilterEngine::CONTENT_TYPE_IMAGE, {}));
+}
+
+TEST_F(FilterEngineServiceTest, StopsWhileClientsDontReadResponses)
+{
+  platform->GetFilterEngine().AddFilters({"##." + std::string(100 * 1024, 'a')});
+  int socket = ServiceProtocol::Connect(socketPath);
+  // Far more than the socket buffers hold, the service blocks sending.
+  std::string requests;
+  ServiceProtocol::Writer writer(requests);
+  for (uint32_t id = 0; id < 10; id++)
+  {
+    writer.BeginMessage(id, ServiceProtocol::OPCODE_GET_ELEMENT_HIDING_SELECTORS);
+    writer.WriteStrings(std::vector<std::string>(100, "example.com"));
+    writer.EndMessage();
+  }
+  ASSERT_TRUE(ServiceProtocol::SendAll(socket, requests));
+  std::this_thread::sleep_for(std::chrono::milliseconds(200));
+
+  service.reset();
+  close(socket);
+}
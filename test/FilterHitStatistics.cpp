@@ -0,0 +1,112 @@
+/*
+ * This file is part of Adblock Plus <https://adblockplus.org/>,
+ * Copyright (C) 2006-present eyeo GmbH
+ *
+ * Adblock Plus is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 3 as
+ * published by the Free Software Foundation.
+ *
+ * Adblock Plus is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Adblock Plus.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <gtest/gtest.h>
+#include <thread>
+#include "../src/FilterHitStatistics.h"
+
+using namespace AdblockPlus;
+
+TEST(FilterHitStatisticsTest, RecordsHitsOfAllThreads)
+{
+  FilterHitStatistics statistics;
+  std::atomic<int> saveRequests(0);
+  std::vector<std::thread> threads;
+  for (int i = 0; i < 4; i++)
+  {
+    threads.push_back(std::thread([&statistics, &saveRequests, i]
+    {
+      for (int hit = 0; hit < 1000; hit++)
+      {
+        if (statistics.RecordHit("foo", 100 + i))
+          saveRequests++;
+      }
+      if (statistics.RecordHit("bar" + std::to_string(i), 10))
+        saveRequests++;
+    }));
+  }
+  for (auto& thread : threads)
+    thread.join();
+
+  EXPECT_EQ(1, saveRequests);
+  auto stats = statistics.GetTop(0);
+  ASSERT_EQ(5u, stats.size());
+  EXPECT_EQ("foo", stats[0].text);
+  EXPECT_EQ(4000u, stats[0].hitCount);
+  EXPECT_EQ(103, stats[0].lastHit);
+  EXPECT_EQ("bar0", stats[1].text);
+  EXPECT_EQ(1u, stats[1].hitCount);
+  EXPECT_EQ("bar3", stats[4].text);
+
+  // Merged hits are kept.
+  statistics.RecordHit("bar3", 20);
+  stats = statistics.GetTop(2);
+  ASSERT_EQ(2u, stats.size());
+  EXPECT_EQ("foo", stats[0].text);
+  EXPECT_EQ("bar3", stats[1].text);
+  EXPECT_EQ(2u, stats[1].hitCount);
+  EXPECT_EQ(20, stats[1].lastHit);
+}
+
+TEST(FilterHitStatisticsTest, SerializeWaitsForLoad)
+{
+  FilterHitStatistics statistics;
+  std::string data;
+  EXPECT_FALSE(statistics.Load(""));
+  EXPECT_TRUE(statistics.Serialize(data));
+
+  FilterHitStatistics pending;
+  EXPECT_TRUE(pending.RecordHit("foo", 1));
+  EXPECT_FALSE(pending.Serialize(data));
+  EXPECT_FALSE(pending.RecordHit("foo", 2));
+  EXPECT_TRUE(pending.Load(""));
+  ASSERT_TRUE(pending.Serialize(data));
+  EXPECT_EQ("# Adblock Plus filter hits\n2\t2\tfoo\n", data);
+  EXPECT_TRUE(pending.RecordHit("foo", 3));
+}
+
+TEST(FilterHitStatisticsTest, LoadAddsSavedHits)
+{
+  FilterHitStatistics statistics;
+  statistics.RecordHit("foo", 200);
+  statistics.Load("# Adblock Plus filter hits\n"
+    "5\t100\tfoo\n"
+    "invalid\n"
+    "x\t1\tinvalid\n"
+    "2\t50\tbar baz\n");
+  auto stats = statistics.GetTop(0);
+  ASSERT_EQ(2u, stats.size());
+  EXPECT_EQ("foo", stats[0].text);
+  EXPECT_EQ(6u, stats[0].hitCount);
+  EXPECT_EQ(200, stats[0].lastHit);
+  EXPECT_EQ("bar baz", stats[1].text);
+  EXPECT_EQ(2u, stats[1].hitCount);
+  EXPECT_EQ(50, stats[1].lastHit);
+
+  std::string data;
+  ASSERT_TRUE(statistics.Serialize(data));
+  FilterHitStatistics reloaded;
+  reloaded.Load(data);
+  auto reloadedStats = reloaded.GetTop(0);
+  ASSERT_EQ(stats.size(), reloadedStats.size());
+  for (size_t i = 0; i < stats.size(); i++)
+  {
+    EXPECT_EQ(stats[i].text, reloadedStats[i].text);
+    EXPECT_EQ(stats[i].hitCount, reloadedStats[i].hitCount);
+    EXPECT_EQ(stats[i].lastHit, reloadedStats[i].lastHit);
+  }
+}
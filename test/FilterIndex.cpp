@@ -0,0 +1,222 @@
+/*
+ * This file is part of Adblock Plus <https://adblockplus.org/>,
+ * Copyright (C) 2006-present eyeo GmbH
+ *
+ * Adblock Plus is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 3 as
+ * published by the Free Software Foundation.
+ *
+ * Adblock Plus is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Adblock Plus.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <gtest/gtest.h>
+#include <AdblockPlus/FilterIndex.h>
+
+using namespace AdblockPlus;
+
+namespace
+{
+  class FilterIndexTest : public ::testing::Test
+  {
+  protected:
+    std::vector<uint8_t> data;
+    FilterIndexPtr index;
+
+    void Build(const std::vector<std::string>& filters)
+    {
+      FilterIndexBuilder builder;
+      builder.AddPublicSuffix("com", 0);
+      builder.AddPublicSuffix("co.uk", 0);
+      builder.AddPublicSuffix("blogspot.com", 1);
+      for (const auto& filter : filters)
+        builder.AddFilter(filter);
+      data = builder.Build();
+      index = FilterIndex::FromBuffer(data.data(), data.size());
+    }
+
+    std::string Match(const std::string& url,
+      ContentTypes::ContentTypeMask contentType = ContentTypes::CONTENT_TYPE_IMAGE,
+      const std::string& documentUrl = "")
+    {
+      FilterText filter;
+      if (!index->Matches(url, contentType, documentUrl, &filter))
+        return "";
+      return filter.text;
+    }
+  };
+}
+
+TEST_F(FilterIndexTest, MatchesBlockingAndExceptionFilters)
+{
+  Build({"! comment", "adbanner.gif", "@@notbanner.gif", "adbanner.gif",
+    "/ads/*", "tpbanner.gif$third-party", "fpbanner.gif$~third-party",
+    "combanner.gif$domain=example.com|~foo.example.com",
+    "||example.net^$script", "|http://start.", "end.png|",
+    "/regexp\\d+\\.png/", "CaseBanner.gif$match-case", "invalid$foo"});
+  EXPECT_EQ(11u, index->GetFilterCount());
+
+  EXPECT_EQ("adbanner.gif", Match("http://example.org/adbanner.gif"));
+  EXPECT_EQ("@@notbanner.gif", Match("http://example.org/notbanner.gif"));
+  EXPECT_EQ("/ads/*", Match("http://example.org/ads/foo"));
+  EXPECT_EQ("", Match("http://example.org/foo.gif"));
+
+  EXPECT_EQ("tpbanner.gif$third-party",
+    Match("http://ads.example.org/tpbanner.gif", ContentTypes::CONTENT_TYPE_IMAGE, "http://example.com/"));
+  EXPECT_EQ("",
+    Match("http://ads.example.com/tpbanner.gif", ContentTypes::CONTENT_TYPE_IMAGE, "http://example.com/"));
+  EXPECT_EQ("fpbanner.gif$~third-party",
+    Match("http://ads.example.com/fpbanner.gif", ContentTypes::CONTENT_TYPE_IMAGE, "http://www.example.com/"));
+  EXPECT_EQ("", Match("http://ads.foo.blogspot.com/fpbanner.gif",
+    ContentTypes::CONTENT_TYPE_IMAGE, "http://bar.blogspot.com/"));
+
+  EXPECT_EQ("combanner.gif$domain=example.com|~foo.example.com",
+    Match("http://ads.net/combanner.gif", ContentTypes::CONTENT_TYPE_IMAGE, "http://bar.example.com/"));
+  EXPECT_EQ("",
+    Match("http://ads.net/combanner.gif", ContentTypes::CONTENT_TYPE_IMAGE, "http://foo.example.com/"));
+  EXPECT_EQ("", Match("http://ads.net/combanner.gif", ContentTypes::CONTENT_TYPE_IMAGE, "http://example.org/"));
+
+  EXPECT_EQ("||example.net^$script",
+    Match("https://sub.example.net/foo.js", ContentTypes::CONTENT_TYPE_SCRIPT));
+  EXPECT_EQ("", Match("https://sub.example.net/foo.js"));
+  EXPECT_EQ("", Match("https://example.network/foo.js", ContentTypes::CONTENT_TYPE_SCRIPT));
+
+  EXPECT_EQ("|http://start.", Match("http://start.example.org/"));
+  EXPECT_EQ("", Match("http://foo.org/http://start."));
+  EXPECT_EQ("end.png|", Match("http://example.org/end.png"));
+  EXPECT_EQ("", Match("http://example.org/end.png?foo"));
+
+  EXPECT_EQ("/regexp\\d+\\.png/", Match("http://example.org/REGEXP12.png"));
+  EXPECT_EQ("", Match("http://example.org/regexp.png"));
+  EXPECT_EQ("CaseBanner.gif$match-case", Match("http://example.org/CaseBanner.gif"));
+  EXPECT_EQ("", Match("http://example.org/casebanner.gif"));
+  EXPECT_EQ("", Match("http://example.org/invalid"));
+}
+
+TEST_F(FilterIndexTest, MatchesRegularExpressionFilters)
+{
+  Build({"/^https?:\\/\\/ads\\./", "/\\bbanner(?:\\d{2,3}|[a-c]+)\\.gif/",
+    "/(a|b)*c$/", "/(?=lookahead)/", "/(back)\\1/"});
+  EXPECT_EQ("/^https?:\\/\\/ads\\./", Match("https://ads.example.org/"));
+  EXPECT_EQ("", Match("http://example.org/https://ads."));
+  EXPECT_EQ("/\\bbanner(?:\\d{2,3}|[a-c]+)\\.gif/", Match("http://example.org/BannerAB.gif"));
+  EXPECT_EQ("/\\bbanner(?:\\d{2,3}|[a-c]+)\\.gif/", Match("http://example.org/banner123.gif"));
+  EXPECT_EQ("", Match("http://example.org/banner1.gif"));
+  EXPECT_EQ("", Match("http://example.org/adbanner12.gif"));
+  // Lookaround assertions and backreferences aren't supported.
+  EXPECT_EQ("", Match("http://example.org/lookahead"));
+  EXPECT_EQ("", Match("http://example.org/backback"));
+
+  // Matching doesn't recurse per character of the URL.
+  std::string longUrl = "http://example.org/" + std::string(200000, 'a');
+  EXPECT_EQ("", Match(longUrl));
+  EXPECT_EQ("/(a|b)*c$/", Match(longUrl + "c"));
+}
+
+TEST_F(FilterIndexTest, WhitelistedDocuments)
+{
+  Build({"adbanner.gif", "@@||example.com^$document"});
+  std::vector<std::string> documentUrls = {"http://frame.org/", "http://example.com/"};
+  FilterText filter;
+  EXPECT_TRUE(index->Matches("http://ads.net/adbanner.gif",
+    ContentTypes::CONTENT_TYPE_IMAGE, documentUrls, &filter));
+  EXPECT_EQ("@@||example.com^$document", filter.text);
+  EXPECT_EQ(FilterTypes::TYPE_EXCEPTION, filter.type);
+
+  documentUrls = {"http://frame.org/", "http://example.org/"};
+  EXPECT_TRUE(index->Matches("http://ads.net/adbanner.gif",
+    ContentTypes::CONTENT_TYPE_IMAGE, documentUrls, &filter));
+  EXPECT_EQ("adbanner.gif", filter.text);
+  EXPECT_EQ(FilterTypes::TYPE_BLOCKING, filter.type);
+  EXPECT_EQ("@@||example.com^$document",
+    Match("http://ads.net/adbanner.gif", ContentTypes::CONTENT_TYPE_IMAGE, "http://example.com/"));
+}
+
+TEST_F(FilterIndexTest, ElementHidingSelectors)
+{
+  Build({"##.generic", "example.com##.specific", "~foo.example.com,example.com###id",
+    "example.org##.other", "foo.example.com#@#.generic", "example.com#?#.emulated",
+    "#@#.exception-only"});
+  std::vector<std::string> selectors = index->GetElementHidingSelectors("bar.example.com");
+  ASSERT_EQ(3u, selectors.size());
+  EXPECT_EQ(".generic", selectors[0]);
+  EXPECT_EQ(".specific", selectors[1]);
+  EXPECT_EQ("#id", selectors[2]);
+
+  selectors = index->GetElementHidingSelectors("foo.example.com");
+  ASSERT_EQ(1u, selectors.size());
+  EXPECT_EQ(".specific", selectors[0]);
+
+  selectors = index->GetElementHidingSelectors("example.net");
+  ASSERT_EQ(1u, selectors.size());
+  EXPECT_EQ(".generic", selectors[0]);
+}
+
+TEST_F(FilterIndexTest, OpensFiles)
+{
+  Build({"adbanner.gif"});
+  std::string path = ::testing::TempDir() + "filterindex.dat";
+  {
+    std::ofstream file(path, std::ios::binary);
+    file.write(reinterpret_cast<const char*>(data.data()), data.size());
+  }
+  FilterIndexPtr fileIndex = FilterIndex::Open(path);
+  EXPECT_EQ(1u, fileIndex->GetFilterCount());
+  EXPECT_TRUE(fileIndex->Matches("http://example.org/adbanner.gif",
+    ContentTypes::CONTENT_TYPE_IMAGE, ""));
+  std::remove(path.c_str());
+
+  EXPECT_THROW(FilterIndex::Open(path), std::runtime_error);
+}
+
+TEST_F(FilterIndexTest, RejectsInvalidData)
+{
+  Build({"adbanner.gif", "example.com##.foo"});
+  std::vector<uint8_t> truncated(data.begin(), data.end() - 1);
+  EXPECT_THROW(FilterIndex::FromBuffer(truncated.data(), truncated.size()), std::runtime_error);
+
+  // Text of the first filter out of bounds, the filter records start at the
+  // offset stored after magic, version, byte order, size and filter count.
+  std::vector<uint8_t> corrupt = data;
+  uint32_t filtersOffset;
+  std::memcpy(&filtersOffset, corrupt.data() + 24, sizeof(filtersOffset));
+  std::memset(corrupt.data() + filtersOffset, 0xFF, sizeof(uint32_t));
+  EXPECT_THROW(FilterIndex::FromBuffer(corrupt.data(), corrupt.size()), std::runtime_error);
+
+  std::vector<uint8_t> badMagic = data;
+  badMagic[0] = 'X';
+  EXPECT_THROW(FilterIndex::FromBuffer(badMagic.data(), badMagic.size()), std::runtime_error);
+}
+
+TEST_F(FilterIndexTest, ParsesFilterLists)
+{
+  FilterIndexBuilder builder;
+  builder.AddDefaultPublicSuffixes();
+  builder.AddFilterList("[Adblock Plus 2.0]\r\n! Title: test\r\n"
+    " ad banner.gif \r\n\r\n@@not\tbanner.gif\n"
+    " example.com , example.org ##  .foo  .bar \n"
+    "example.com#@# .foo  .bar\n"
+    "tp banner.gif$third-party");
+  index = builder.BuildIndex();
+  EXPECT_EQ(5u, index->GetFilterCount());
+
+  EXPECT_EQ("adbanner.gif", Match("http://example.org/adbanner.gif"));
+  EXPECT_EQ("@@notbanner.gif", Match("http://example.org/notbanner.gif"));
+  EXPECT_EQ("", Match("http://ads.example.co.uk/tpbanner.gif",
+    ContentTypes::CONTENT_TYPE_IMAGE, "http://www.example.co.uk/"));
+  EXPECT_EQ("tpbanner.gif$third-party", Match("http://ads.example.co.uk/tpbanner.gif",
+    ContentTypes::CONTENT_TYPE_IMAGE, "http://example.org/"));
+
+  std::vector<std::string> selectors = index->GetElementHidingSelectors("example.org");
+  ASSERT_EQ(1u, selectors.size());
+  EXPECT_EQ(".foo  .bar", selectors[0]);
+  EXPECT_TRUE(index->GetElementHidingSelectors("example.com").empty());
+}
@@ -0,0 +1,176 @@
+/*
+ * This file is part of Adblock Plus <https://adblockplus.org/>,
+ * Copyright (C) 2006-present eyeo GmbH
+ *
+ * Adblock Plus is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 3 as
+ * published by the Free Software Foundation.
+ *
+ * Adblock Plus is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Adblock Plus.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <atomic>
+#include <thread>
+#include <gtest/gtest.h>
+#include <AdblockPlus/FilterStore.h>
+
+using namespace AdblockPlus;
+
+namespace
+{
+  class FilterStoreTest : public ::testing::Test
+  {
+  protected:
+    FilterStorePtr store;
+
+    void SetUp() override
+    {
+      store = std::make_shared<FilterStore>();
+      store->SetSubscription("https://example.org/easylist.txt",
+        "[Adblock Plus 2.0]\n"
+        "adbanner.gif\n"
+        "tpbanner.gif$third-party\n"
+        "##.generic\n"
+        "example.com##.specific\n");
+      store->SetSubscription("https://example.org/exceptions.txt",
+        "@@||example.com/adbanner.gif\n");
+    }
+
+    std::string Match(const FilterProfile& profile, const std::string& url,
+      const std::string& documentUrl = "")
+    {
+      FilterText filter;
+      if (!profile.Matches(url, ContentTypes::CONTENT_TYPE_IMAGE, documentUrl, &filter))
+        return "";
+      return filter.text;
+    }
+  };
+}
+
+TEST_F(FilterStoreTest, ProfilesShareSubscriptions)
+{
+  FilterProfile first(store);
+  FilterProfile second(store);
+  EXPECT_EQ("adbanner.gif", Match(first, "http://example.org/adbanner.gif"));
+  EXPECT_EQ("adbanner.gif", Match(second, "http://example.org/adbanner.gif"));
+  EXPECT_EQ("@@||example.com/adbanner.gif", Match(first, "http://example.com/adbanner.gif"));
+  EXPECT_EQ("tpbanner.gif$third-party",
+    Match(first, "http://ads.example.org/tpbanner.gif", "http://example.co.uk/"));
+  EXPECT_EQ("", Match(first, "http://ads.example.co.uk/tpbanner.gif", "http://www.example.co.uk/"));
+
+  auto subscriptions = store->GetSubscriptions();
+  ASSERT_EQ(2u, subscriptions->size());
+  store->SetSubscription("https://example.org/easylist.txt", "otherbanner.gif");
+  EXPECT_EQ("", Match(first, "http://example.org/adbanner.gif"));
+  EXPECT_EQ("otherbanner.gif", Match(second, "http://example.org/otherbanner.gif"));
+  // Snapshots taken before keep the old index alive.
+  FilterText filter;
+  EXPECT_TRUE(subscriptions->at("https://example.org/easylist.txt")->Matches(
+    "http://example.org/adbanner.gif", ContentTypes::CONTENT_TYPE_IMAGE, "", &filter));
+
+  store->RemoveSubscription("https://example.org/easylist.txt");
+  EXPECT_EQ("", Match(first, "http://example.org/otherbanner.gif"));
+  EXPECT_EQ(1u, store->GetSubscriptions()->size());
+}
+
+TEST_F(FilterStoreTest, CustomFiltersArePerProfile)
+{
+  FilterProfile first(store);
+  FilterProfile second(store);
+  first.AddFilters({" custom banner.gif ", "@@||example.org^$document", "customBanner.gif", ""});
+  std::vector<std::string> expectedFilters = {"custombanner.gif", "@@||example.org^$document",
+    "customBanner.gif"};
+  EXPECT_EQ(expectedFilters, first.GetFilters());
+  EXPECT_TRUE(second.GetFilters().empty());
+
+  EXPECT_EQ("custombanner.gif", Match(first, "http://example.net/custombanner.gif"));
+  EXPECT_EQ("", Match(second, "http://example.net/custombanner.gif"));
+  // Exceptions of the profile override the shared subscriptions.
+  EXPECT_EQ("@@||example.org^$document",
+    Match(first, "http://ads.net/adbanner.gif", "http://example.org/"));
+  EXPECT_EQ("adbanner.gif", Match(second, "http://ads.net/adbanner.gif", "http://example.org/"));
+
+  first.RemoveFilter("@@||example.org^$document");
+  EXPECT_EQ("adbanner.gif", Match(first, "http://ads.net/adbanner.gif", "http://example.org/"));
+  EXPECT_EQ(2u, first.GetFilters().size());
+}
+
+TEST_F(FilterStoreTest, DisabledSubscriptions)
+{
+  FilterProfile first(store);
+  FilterProfile second(store);
+  first.SetSubscriptionDisabled("https://example.org/exceptions.txt", true);
+  EXPECT_TRUE(first.IsSubscriptionDisabled("https://example.org/exceptions.txt"));
+  EXPECT_FALSE(second.IsSubscriptionDisabled("https://example.org/exceptions.txt"));
+  EXPECT_EQ("adbanner.gif", Match(first, "http://example.com/adbanner.gif"));
+  EXPECT_EQ("@@||example.com/adbanner.gif", Match(second, "http://example.com/adbanner.gif"));
+
+  first.SetSubscriptionDisabled("https://example.org/exceptions.txt", false);
+  EXPECT_EQ("@@||example.com/adbanner.gif", Match(first, "http://example.com/adbanner.gif"));
+}
+
+TEST_F(FilterStoreTest, QueriesWhileSubscriptionsChange)
+{
+  FilterProfile profile(store);
+  std::atomic<bool> done(false);
+  std::atomic<int> failures(0);
+  std::vector<std::thread> readers;
+  for (int i = 0; i < 4; i++)
+  {
+    readers.emplace_back([&]
+    {
+      while (!done)
+      {
+        // The exception is never removed, the blocking filter comes and goes.
+        std::string filter = Match(profile, "http://example.com/adbanner.gif");
+        if (filter != "@@||example.com/adbanner.gif" && filter != "")
+          failures++;
+      }
+    });
+  }
+  for (int i = 0; i < 100; i++)
+  {
+    store->SetSubscription("https://example.org/easylist.txt",
+      i % 2 ? "adbanner.gif" : "otherbanner.gif");
+    profile.SetSubscriptionDisabled("https://example.org/easylist.txt", i % 3 == 0);
+  }
+  done = true;
+  for (auto& reader : readers)
+    reader.join();
+  EXPECT_EQ(0, failures);
+}
+
+TEST_F(FilterStoreTest, ElementHidingSelectors)
+{
+  FilterProfile first(store);
+  FilterProfile second(store);
+  // The filter which is also in the subscription only counts once.
+  first.AddFilters({"example.com#@#.generic", "example.com##.custom", "example.com##.specific"});
+
+  std::vector<std::string> expected = {".specific", ".custom"};
+  EXPECT_EQ(expected, first.GetElementHidingSelectors("example.com"));
+  expected = {".generic", ".specific"};
+  EXPECT_EQ(expected, second.GetElementHidingSelectors("example.com"));
+  expected = {".generic"};
+  EXPECT_EQ(expected, first.GetElementHidingSelectors("example.net"));
+}
+
+TEST_F(FilterStoreTest, Prefs)
+{
+  FilterProfile first(store);
+  FilterProfile second(store);
+  store->SetPref("enabled", "true");
+  first.SetPref("enabled", "false");
+  EXPECT_EQ("false", first.GetPref("enabled"));
+  EXPECT_EQ("true", second.GetPref("enabled"));
+  EXPECT_EQ("", first.GetPref("unknown"));
+
+  first.ResetPref("enabled");
+  EXPECT_EQ("true", first.GetPref("enabled"));
+}
@@ -0,0 +1,87 @@
+/*
+ * This file is part of Adblock Plus <https://adblockplus.org/>,
+ * Copyright (C) 2006-present eyeo GmbH
+ *
+ * Adblock Plus is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 3 as
+ * published by the Free Software Foundation.
+ *
+ * Adblock Plus is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Adblock Plus.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <AdblockPlus.h>
+#include <gtest/gtest.h>
+
+TEST(FrameTreeTest, UnknownFrame)
+{
+  AdblockPlus::FrameTree frameTree;
+  ASSERT_FALSE(frameTree.HasFrame(1));
+  ASSERT_TRUE(frameTree.GetDocumentUrls(1).empty());
+  ASSERT_THROW(frameTree.AddFrame(2, 1, "http://example.com/"), std::invalid_argument);
+}
+
+TEST(FrameTreeTest, NestedFrames)
+{
+  AdblockPlus::FrameTree frameTree;
+  frameTree.AddFrame(1, "http://example.com/");
+  frameTree.AddFrame(2, 1, "http://ads.com/frame/");
+  frameTree.AddFrame(3, 2, "http://ads.com/frame/nested/");
+  std::vector<std::string> documentUrls = frameTree.GetDocumentUrls(3);
+  ASSERT_EQ(3u, documentUrls.size());
+  ASSERT_EQ("http://ads.com/frame/nested/", documentUrls[0]);
+  ASSERT_EQ("http://ads.com/frame/", documentUrls[1]);
+  ASSERT_EQ("http://example.com/", documentUrls[2]);
+}
+
+TEST(FrameTreeTest, RemoveFrameRemovesDescendants)
+{
+  AdblockPlus::FrameTree frameTree;
+  frameTree.AddFrame(1, "http://example.com/");
+  frameTree.AddFrame(2, 1, "http://ads.com/frame/");
+  frameTree.AddFrame(3, 2, "http://ads.com/frame/nested/");
+  frameTree.AddFrame(4, 1, "http://example.com/frame/");
+  frameTree.RemoveFrame(2);
+  ASSERT_TRUE(frameTree.HasFrame(1));
+  ASSERT_FALSE(frameTree.HasFrame(2));
+  ASSERT_FALSE(frameTree.HasFrame(3));
+  ASSERT_TRUE(frameTree.HasFrame(4));
+}
+
+TEST(FrameTreeTest, NavigationReplacesFrame)
+{
+  AdblockPlus::FrameTree frameTree;
+  frameTree.AddFrame(1, "http://example.com/");
+  frameTree.AddFrame(2, 1, "http://ads.com/frame/");
+  frameTree.AddFrame(1, "http://example.org/");
+  ASSERT_FALSE(frameTree.HasFrame(2));
+  std::vector<std::string> documentUrls = frameTree.GetDocumentUrls(1);
+  ASSERT_EQ(1u, documentUrls.size());
+  ASSERT_EQ("http://example.org/", documentUrls[0]);
+}
+
+TEST(FrameTreeTest, FrameCantBeEmbeddedInItsDescendants)
+{
+  AdblockPlus::FrameTree frameTree;
+  frameTree.AddFrame(1, "http://example.com/");
+  frameTree.AddFrame(2, 1, "http://ads.com/frame/");
+  frameTree.AddFrame(3, 2, "http://ads.com/frame/nested/");
+  ASSERT_THROW(frameTree.AddFrame(2, 2, "http://example.org/"), std::invalid_argument);
+  ASSERT_THROW(frameTree.AddFrame(1, 3, "http://example.org/"), std::invalid_argument);
+  // Nothing changed.
+  ASSERT_EQ(3u, frameTree.GetDocumentUrls(3).size());
+
+  frameTree.AddFrame(3, 1, "http://example.org/");
+  std::vector<std::string> documentUrls = frameTree.GetDocumentUrls(3);
+  ASSERT_EQ(2u, documentUrls.size());
+  ASSERT_EQ("http://example.com/", documentUrls[1]);
+  frameTree.RemoveFrame(2);
+  ASSERT_TRUE(frameTree.HasFrame(3));
+  frameTree.RemoveFrame(1);
+  ASSERT_FALSE(frameTree.HasFrame(3));
+}
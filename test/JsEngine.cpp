@@ -160,6 +160,19 @@ TEST_F(JsEngineTest, EventCallbacks)
   ASSERT_FALSE(callbackCalled);
 }
 
+TEST_F(JsEngineTest, HeapStatistics)
+{
+  auto before = GetJsEngine().GetHeapStatistics();
+  ASSERT_GT(before.usedHeapSize, 0u);
+  ASSERT_LE(before.usedHeapSize, before.totalHeapSize);
+  ASSERT_LE(before.totalHeapSize, before.heapSizeLimit);
+
+  GetJsEngine().Evaluate("var strings = []; "
+    "for (var i = 0; i < 100000; i++) strings.push('string' + i);");
+  auto after = GetJsEngine().GetHeapStatistics();
+  ASSERT_GT(after.usedHeapSize, before.usedHeapSize);
+}
+
 TEST(NewJsEngineTest, GlobalPropertyTest)
 {
   Platform platform{ThrowingPlatformCreationParameters()};
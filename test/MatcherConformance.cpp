@@ -0,0 +1,225 @@
+/*
+ * This file is part of Adblock Plus <https://adblockplus.org/>,
+ * Copyright (C) 2006-present eyeo GmbH
+ *
+ * Adblock Plus is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 3 as
+ * published by the Free Software Foundation.
+ *
+ * Adblock Plus is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Adblock Plus.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <algorithm>
+#include <AdblockPlus/FilterIndex.h>
+#include "BaseJsTest.h"
+
+using namespace AdblockPlus;
+
+namespace
+{
+  // The same filter list is loaded into FilterEngine and into a FilterIndex,
+  // both have to come to the same results.
+  const char filterList[] =
+    "[Adblock Plus 2.0]\n"
+    "! Title: Conformance corpus\n"
+    "adbanner.gif\n"
+    "@@notbanner.gif\n"
+    " spaced banner .gif \n"
+    "/ads/*\n"
+    "/ads/allowed/*$~script\n"
+    "@@/ads/allowed/*$image\n"
+    "tpbanner.gif$third-party\n"
+    "fpbanner.gif$~third-party\n"
+    "domainbanner.gif$domain=example.com|~foo.example.com\n"
+    "||example.net^$script,domain=example.com\n"
+    "||tracker.example.org^$xmlhttprequest,ping\n"
+    "||frames.example.org^$subdocument\n"
+    "|http://start.\n"
+    "end.png|\n"
+    "/regexp\\d+\\.png/\n"
+    "/Banner\\d/$match-case\n"
+    "CaseBanner.gif$match-case\n"
+    "sitekeybanner.gif$sitekey=abc\n"
+    "$image,domain=image-only.example.org\n"
+    "@@||whitelisted.example.org^$document\n"
+    "@@||frame.example.com^$document\n"
+    "invalid.gif$foo\n"
+    "##.generic\n"
+    "##div > .generic-child\n"
+    "example.com##.specific\n"
+    "~foo.example.com,example.com###id\n"
+    "example.org,example.com## .spaced  selector \n"
+    "example.org##.other\n"
+    "foo.example.com#@#.generic\n"
+    "example.com#@#.specific\n"
+    "example.com#?#.emulated:-abp-has(.ad)\n"
+    "#@#.exception-only\n";
+
+  const FilterEngine::ContentTypeMask contentTypes[] = {
+    FilterEngine::CONTENT_TYPE_OTHER,
+    FilterEngine::CONTENT_TYPE_SCRIPT,
+    FilterEngine::CONTENT_TYPE_IMAGE,
+    FilterEngine::CONTENT_TYPE_SUBDOCUMENT,
+    FilterEngine::CONTENT_TYPE_XMLHTTPREQUEST,
+    FilterEngine::CONTENT_TYPE_PING
+  };
+
+  const char* urls[] = {
+    "http://example.org/adbanner.gif",
+    "http://example.org/notbanner.gif",
+    "http://example.org/spacedbanner.gif",
+    "http://example.org/ads/foo",
+    "http://example.org/ads/allowed/foo",
+    "http://ads.example.org/tpbanner.gif",
+    "http://ads.example.com/tpbanner.gif",
+    "http://ads.example.com/fpbanner.gif",
+    "http://ads.example.org/fpbanner.gif",
+    "http://ads.net/domainbanner.gif",
+    "https://cdn.example.net/script.js",
+    "https://example.network/script.js",
+    "https://tracker.example.org/collect",
+    "https://frames.example.org/frame.html",
+    "http://start.example.org/",
+    "http://foo.org/http://start.",
+    "http://example.org/end.png",
+    "http://example.org/end.png?foo",
+    "http://example.org/REGEXP12.png",
+    "http://example.org/Banner1",
+    "http://example.org/banner1",
+    "http://example.org/CaseBanner.gif",
+    "http://example.org/casebanner.gif",
+    "http://example.org/sitekeybanner.gif",
+    "http://image-only.example.org/foo",
+    "http://example.org/invalid.gif",
+    "http://example.org/"
+  };
+
+  const char* documentUrls[] = {
+    "",
+    "http://example.com/",
+    "http://www.example.com/",
+    "http://foo.example.com/",
+    "http://example.org/",
+    "http://image-only.example.org/",
+    "http://whitelisted.example.org/",
+    "http://127.0.0.1/"
+  };
+
+  const char* domains[] = {
+    "example.com",
+    "bar.example.com",
+    "foo.example.com",
+    "example.org",
+    "example.net"
+  };
+
+  class MatcherConformanceTest : public BaseJsTest
+  {
+  protected:
+    FilterIndexPtr index;
+
+    void SetUp() override
+    {
+      LazyFileSystem* fileSystem;
+      ThrowingPlatformCreationParameters platformParams;
+      platformParams.logSystem.reset(new LazyLogSystem());
+      platformParams.timer.reset(new NoopTimer());
+      platformParams.fileSystem.reset(fileSystem = new InMemoryFileSystem());
+      platformParams.webRequest.reset(new NoopWebRequest());
+      platform.reset(new Platform(std::move(platformParams)));
+      FilterEngine::CreationParameters createParams;
+      createParams.preconfiguredPrefs.emplace("first_run_subscription_auto_select",
+        GetJsEngine().NewValue(false));
+      ::CreateFilterEngine(*fileSystem, *platform, createParams);
+
+      std::vector<std::string> lines;
+      std::string text = filterList;
+      size_t start = text.find('\n') + 1;
+      while (start < text.size())
+      {
+        size_t end = text.find('\n', start);
+        lines.push_back(text.substr(start, end - start));
+        start = end + 1;
+      }
+      GetFilterEngine().AddFilters(lines);
+
+      FilterIndexBuilder builder;
+      builder.AddDefaultPublicSuffixes();
+      builder.AddFilterList(filterList);
+      index = builder.BuildIndex();
+    }
+
+    FilterEngine& GetFilterEngine()
+    {
+      return platform->GetFilterEngine();
+    }
+  };
+}
+
+TEST_F(MatcherConformanceTest, Matches)
+{
+  for (const char* url : urls)
+  {
+    for (const char* documentUrl : documentUrls)
+    {
+      for (auto contentType : contentTypes)
+      {
+        FilterPtr expected = GetFilterEngine().Matches(url, contentType, documentUrl);
+        FilterText actual;
+        bool matched = index->Matches(url, contentType, documentUrl, &actual);
+        ASSERT_EQ(static_cast<bool>(expected), matched)
+          << url << " " << contentType << " " << documentUrl;
+        if (expected)
+        {
+          EXPECT_EQ(expected->GetProperty("text").AsString(), actual.text)
+            << url << " " << contentType << " " << documentUrl;
+          EXPECT_EQ(expected->GetType(), actual.type);
+        }
+      }
+    }
+  }
+}
+
+TEST_F(MatcherConformanceTest, MatchesInFrames)
+{
+  const std::vector<std::vector<std::string>> frames = {
+    {"http://frame.org/", "http://example.com/"},
+    {"http://frame.example.com/", "http://example.org/"},
+    {"http://example.org/", "http://whitelisted.example.org/"},
+    {"http://www.example.com/", "http://example.org/"}
+  };
+  for (const char* url : urls)
+  {
+    for (const auto& documentUrls : frames)
+    {
+      FilterPtr expected = GetFilterEngine().Matches(url,
+        FilterEngine::CONTENT_TYPE_IMAGE, documentUrls);
+      FilterText actual;
+      bool matched = index->Matches(url, FilterEngine::CONTENT_TYPE_IMAGE,
+        documentUrls, &actual);
+      ASSERT_EQ(static_cast<bool>(expected), matched) << url << " " << documentUrls[0];
+      if (expected)
+      {
+        EXPECT_EQ(expected->GetProperty("text").AsString(), actual.text) << url;
+      }
+    }
+  }
+}
+
+TEST_F(MatcherConformanceTest, ElementHidingSelectors)
+{
+  for (const char* domain : domains)
+  {
+    std::vector<std::string> expected = GetFilterEngine().GetElementHidingSelectors(domain);
+    std::vector<std::string> actual = index->GetElementHidingSelectors(domain);
+    std::sort(expected.begin(), expected.end());
+    std::sort(actual.begin(), actual.end());
+    EXPECT_EQ(expected, actual) << domain;
+  }
+}
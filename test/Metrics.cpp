@@ -0,0 +1,119 @@
+/*
+ * This file is part of Adblock Plus <https://adblockplus.org/>,
+ * Copyright (C) 2006-present eyeo GmbH
+ *
+ * Adblock Plus is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 3 as
+ * published by the Free Software Foundation.
+ *
+ * Adblock Plus is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Adblock Plus.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <AdblockPlus.h>
+#include <gtest/gtest.h>
+#include <thread>
+
+using namespace AdblockPlus;
+
+namespace
+{
+  bool Contains(const std::string& text, const std::string& part)
+  {
+    return text.find(part) != std::string::npos;
+  }
+}
+
+TEST(MetricsTest, BucketBoundaries)
+{
+  for (uint64_t value = 0; value < 100000; value++)
+  {
+    size_t index = LatencyHistogram::GetBucketIndex(value);
+    ASSERT_LT(value, LatencyHistogram::GetBucketUpperBound(index)) << value;
+    if (index > 0)
+    {
+      ASSERT_GE(value, LatencyHistogram::GetBucketUpperBound(index - 1)) << value;
+    }
+  }
+  for (size_t index = 8; index < LatencyHistogram::bucketCount; index++)
+  {
+    uint64_t lowerBound = LatencyHistogram::GetBucketUpperBound(index - 1);
+    uint64_t upperBound = LatencyHistogram::GetBucketUpperBound(index);
+    ASSERT_EQ(index, LatencyHistogram::GetBucketIndex(lowerBound));
+    ASSERT_EQ(index, LatencyHistogram::GetBucketIndex(upperBound - 1));
+    ASSERT_LE(upperBound - lowerBound, lowerBound / 8);
+  }
+  ASSERT_EQ(LatencyHistogram::bucketCount - 1, LatencyHistogram::GetBucketIndex(UINT64_MAX));
+}
+
+TEST(MetricsTest, RecordsCalls)
+{
+  Metrics metrics;
+  for (int i = 1; i <= 100; i++)
+    metrics.Record(Metrics::OPERATION_MATCHES, std::chrono::microseconds(i));
+  metrics.Record(Metrics::OPERATION_GET_PREF, std::chrono::nanoseconds(5));
+
+  std::vector<LatencyHistogram> histograms = metrics.GetHistograms();
+  ASSERT_EQ(static_cast<size_t>(Metrics::OPERATION_COUNT), histograms.size());
+
+  const LatencyHistogram& matches = histograms[Metrics::OPERATION_MATCHES];
+  EXPECT_EQ("Matches", matches.name);
+  EXPECT_EQ(100u, matches.count);
+  EXPECT_EQ(5050000u, matches.totalNanoseconds);
+  EXPECT_EQ(100000u, matches.maxNanoseconds);
+  EXPECT_NEAR(50000, matches.GetPercentile(50), 50000 / 8);
+  EXPECT_NEAR(99000, matches.GetPercentile(99), 99000 / 8);
+  EXPECT_EQ(100000u, matches.GetPercentile(100));
+
+  const LatencyHistogram& getPref = histograms[Metrics::OPERATION_GET_PREF];
+  EXPECT_EQ(1u, getPref.count);
+  EXPECT_EQ(5u, getPref.GetPercentile(50));
+
+  EXPECT_EQ(0u, histograms[Metrics::OPERATION_SET_PREF].count);
+  EXPECT_EQ(0u, histograms[Metrics::OPERATION_SET_PREF].GetPercentile(50));
+}
+
+TEST(MetricsTest, AddsUpThreads)
+{
+  Metrics metrics;
+  std::vector<std::thread> threads;
+  for (int i = 0; i < 4; i++)
+  {
+    threads.emplace_back([&metrics]()
+    {
+      for (int j = 0; j < 1000; j++)
+        Metrics::Timer timer(metrics, Metrics::OPERATION_EVALUATE);
+    });
+  }
+  for (auto& thread : threads)
+    thread.join();
+  EXPECT_EQ(4000u, metrics.GetHistograms()[Metrics::OPERATION_EVALUATE].count);
+
+  // Metrics instances don't share their per thread histograms
+  Metrics otherMetrics;
+  otherMetrics.Record(Metrics::OPERATION_EVALUATE, std::chrono::nanoseconds(1));
+  metrics.Record(Metrics::OPERATION_EVALUATE, std::chrono::nanoseconds(1));
+  EXPECT_EQ(1u, otherMetrics.GetHistograms()[Metrics::OPERATION_EVALUATE].count);
+  EXPECT_EQ(4001u, metrics.GetHistograms()[Metrics::OPERATION_EVALUATE].count);
+}
+
+TEST(MetricsTest, PrometheusText)
+{
+  Metrics metrics;
+  metrics.Record(Metrics::OPERATION_MATCHES, std::chrono::microseconds(1));
+  metrics.Record(Metrics::OPERATION_MATCHES, std::chrono::microseconds(3));
+  std::string text = Metrics::ToPrometheusText(metrics.GetHistograms());
+  EXPECT_TRUE(Contains(text, "# TYPE abp_latency_seconds histogram\n"));
+  EXPECT_TRUE(Contains(text, "abp_latency_seconds_bucket{operation=\"Matches\",le=\"1.024e-06\"} 1\n"));
+  EXPECT_TRUE(Contains(text, "abp_latency_seconds_bucket{operation=\"Matches\",le=\"2.048e-06\"} 1\n"));
+  EXPECT_TRUE(Contains(text, "abp_latency_seconds_bucket{operation=\"Matches\",le=\"4.096e-06\"} 2\n"));
+  EXPECT_TRUE(Contains(text, "abp_latency_seconds_bucket{operation=\"Matches\",le=\"+Inf\"} 2\n"));
+  EXPECT_TRUE(Contains(text, "abp_latency_seconds_sum{operation=\"Matches\"} 4e-06\n"));
+  EXPECT_TRUE(Contains(text, "abp_latency_seconds_count{operation=\"Matches\"} 2\n"));
+  EXPECT_TRUE(Contains(text, "abp_latency_seconds_count{operation=\"GetPref\"} 0\n"));
+}
@@ -27,9 +27,11 @@ namespace
   class TestFileSystem : public LazyFileSystem
   {
     IOBuffer& prefsContents;
+    IOBuffer prefsTempContents;
+    int& prefsWriteCount;
   public:
-    explicit TestFileSystem(IOBuffer& prefsContent)
-      : prefsContents(prefsContent)
+    TestFileSystem(IOBuffer& prefsContent, int& prefsWriteCount)
+      : prefsContents(prefsContent), prefsWriteCount(prefsWriteCount)
     {
     }
     void Read(const std::string& fileName, const ReadCallback& callback) const override
@@ -50,9 +52,24 @@ namespace
     {
       scheduler([this, fileName, content, callback]
       {
-        if (fileName == "prefs.json")
+        if (fileName == "prefs.json.tmp")
+        {
+          prefsTempContents = content;
+          callback("");
+        }
+      });
+    }
+
+    void Move(const std::string& fromFileName, const std::string& toFileName,
+      const Callback& callback) override
+    {
+      scheduler([this, fromFileName, toFileName, callback]
+      {
+        if (fromFileName == "prefs.json.tmp" && toFileName == "prefs.json")
         {
-          prefsContents = content;
+          prefsContents = std::move(prefsTempContents);
+          prefsTempContents.clear();
+          ++prefsWriteCount;
           callback("");
         }
       });
@@ -80,19 +97,22 @@ namespace
     LazyFileSystem* fileSystem;
   protected:
     IFileSystem::IOBuffer prefsContent;
+    int prefsWriteCount;
+    DelayedTimer::SharedTasks timerTasks;
 
     void SetUp()
     {
+      prefsWriteCount = 0;
       ResetPlatform();
     }
 
     void ResetPlatform()
     {
       ThrowingPlatformCreationParameters platformParams;
-      platformParams.fileSystem.reset(fileSystem = new TestFileSystem(prefsContent));
+      platformParams.fileSystem.reset(fileSystem = new TestFileSystem(prefsContent, prefsWriteCount));
       platformParams.webRequest.reset(new NoopWebRequest());
       platformParams.logSystem.reset(new LazyLogSystem());
-      platformParams.timer.reset(new NoopTimer());
+      platformParams.timer = DelayedTimer::New(timerTasks);
       platform.reset(new Platform(std::move(platformParams)));
     }
 
@@ -101,6 +121,11 @@ namespace
     {
       AdblockPlus::FilterEngine::CreationParameters createParams;
       createParams.preconfiguredPrefs = preconfiguredPrefs;
+      return CreateFilterEngine(createParams);
+    }
+
+    FilterEngine& CreateFilterEngine(const AdblockPlus::FilterEngine::CreationParameters& createParams)
+    {
       return ::CreateFilterEngine(*fileSystem, *platform, createParams);
     }
   };
@@ -217,3 +242,151 @@ TEST_F(PrefsTest, PrefsPersistWhenPreconfigured)
     ASSERT_FALSE(filterEngine.GetPref("suppress_first_run_page").AsBool());
   }
 }
+
+TEST_F(PrefsTest, SetPrefs)
+{
+  auto& filterEngine = CreateFilterEngine();
+  prefsWriteCount = 0;
+
+  FilterEngine::Prefs prefs;
+  prefs.emplace("patternsbackupinterval", GetJsEngine().NewValue(48));
+  prefs.emplace("subscriptions_autoupdate", GetJsEngine().NewValue(false));
+  prefs.emplace("allowed_connection_type", GetJsEngine().NewValue("wifi"));
+  prefs.emplace("foobar", GetJsEngine().NewValue(2));
+  filterEngine.SetPrefs(prefs);
+
+  EXPECT_EQ(1, prefsWriteCount);
+  EXPECT_EQ(48, filterEngine.GetPref("patternsbackupinterval").AsInt());
+  EXPECT_FALSE(filterEngine.GetPref("subscriptions_autoupdate").AsBool());
+  EXPECT_EQ("wifi", filterEngine.GetPref("allowed_connection_type").AsString());
+  EXPECT_TRUE(filterEngine.GetPref("foobar").IsUndefined());
+}
+
+TEST_F(PrefsTest, SetPrefsIsAtomic)
+{
+  auto& filterEngine = CreateFilterEngine();
+  prefsWriteCount = 0;
+
+  FilterEngine::Prefs prefs;
+  prefs.emplace("patternsbackupinterval", GetJsEngine().NewValue(48));
+  prefs.emplace("subscriptions_autoupdate", GetJsEngine().NewValue("foo"));
+  ASSERT_ANY_THROW(filterEngine.SetPrefs(prefs));
+
+  EXPECT_EQ(0, prefsWriteCount);
+  EXPECT_EQ(24, filterEngine.GetPref("patternsbackupinterval").AsInt());
+  EXPECT_TRUE(filterEngine.GetPref("subscriptions_autoupdate").AsBool());
+}
+
+TEST_F(PrefsTest, SetPrefsPersist)
+{
+  {
+    auto& filterEngine = CreateFilterEngine();
+    FilterEngine::Prefs prefs;
+    prefs.emplace("patternsbackupinterval", GetJsEngine().NewValue(48));
+    prefs.emplace("subscriptions_autoupdate", GetJsEngine().NewValue(false));
+    filterEngine.SetPrefs(prefs);
+  }
+  ASSERT_FALSE(prefsContent.empty());
+
+  {
+    ResetPlatform();
+    auto& filterEngine = CreateFilterEngine();
+    ASSERT_EQ(48, filterEngine.GetPref("patternsbackupinterval").AsInt());
+    ASSERT_FALSE(filterEngine.GetPref("subscriptions_autoupdate").AsBool());
+  }
+}
+
+TEST_F(PrefsTest, TypedGetters)
+{
+  auto& filterEngine = CreateFilterEngine();
+  EXPECT_EQ(24, filterEngine.GetPrefInt("patternsbackupinterval"));
+  EXPECT_TRUE(filterEngine.GetPrefBool("subscriptions_autoupdate"));
+  EXPECT_EQ("https://easylist-downloads.adblockplus.org/exceptionrules.txt",
+    filterEngine.GetPrefString("subscriptions_exceptionsurl"));
+
+  EXPECT_THROW(filterEngine.GetPrefBool("foobar"), std::invalid_argument);
+  EXPECT_THROW(filterEngine.GetPrefBool("patternsbackupinterval"), std::invalid_argument);
+  EXPECT_THROW(filterEngine.GetPrefString("notificationdata"), std::invalid_argument);
+}
+
+TEST_F(PrefsTest, TypedGettersFollowChanges)
+{
+  auto& filterEngine = CreateFilterEngine();
+  filterEngine.SetPref("patternsbackupinterval", GetJsEngine().NewValue(48));
+  EXPECT_EQ(48, filterEngine.GetPrefInt("patternsbackupinterval"));
+
+  std::string cellular = "cellular";
+  filterEngine.SetAllowedConnectionType(&cellular);
+  auto allowedConnectionType = filterEngine.GetAllowedConnectionType();
+  ASSERT_TRUE(allowedConnectionType);
+  EXPECT_EQ("cellular", *allowedConnectionType);
+  filterEngine.SetAllowedConnectionType(nullptr);
+  EXPECT_FALSE(filterEngine.GetAllowedConnectionType());
+
+  FilterEngine::Prefs prefs;
+  prefs.emplace("subscriptions_autoupdate", GetJsEngine().NewValue(false));
+  prefs.emplace("allowed_connection_type", GetJsEngine().NewValue("wifi"));
+  filterEngine.SetPrefs(prefs);
+  EXPECT_FALSE(filterEngine.GetPrefBool("subscriptions_autoupdate"));
+  allowedConnectionType = filterEngine.GetAllowedConnectionType();
+  ASSERT_TRUE(allowedConnectionType);
+  EXPECT_EQ("wifi", *allowedConnectionType);
+}
+
+TEST_F(PrefsTest, TypedGettersReadLoadedPrefs)
+{
+  using IOBuffer = AdblockPlus::IFileSystem::IOBuffer;
+  std::string content = "{\"patternsbackupinterval\": 12, \"allowed_connection_type\": \"wifi\"}";
+  prefsContent = IOBuffer(content.cbegin(), content.cend());
+  auto& filterEngine = CreateFilterEngine();
+  EXPECT_EQ(12, filterEngine.GetPrefInt("patternsbackupinterval"));
+  EXPECT_EQ("wifi", filterEngine.GetPrefString("allowed_connection_type"));
+}
+
+TEST_F(PrefsTest, SaveDelay)
+{
+  FilterEngine::CreationParameters createParams;
+  createParams.prefsSaveDelay = std::chrono::milliseconds(1000);
+  auto& filterEngine = CreateFilterEngine(createParams);
+  timerTasks->clear();
+  prefsWriteCount = 0;
+
+  filterEngine.SetPref("update_last_check", GetJsEngine().NewValue(1));
+  filterEngine.SetPref("update_soft_expiration", GetJsEngine().NewValue(2));
+  filterEngine.SetPref("update_hard_expiration", GetJsEngine().NewValue(3));
+  EXPECT_EQ(0, prefsWriteCount);
+  ASSERT_EQ(1u, timerTasks->size());
+  EXPECT_EQ(1000, timerTasks->front().timeout.count());
+
+  timerTasks->front().callback();
+  EXPECT_EQ(1, prefsWriteCount);
+
+  ResetPlatform();
+  auto& reloadedFilterEngine = CreateFilterEngine();
+  EXPECT_EQ(3, reloadedFilterEngine.GetPrefInt("update_hard_expiration"));
+}
+
+TEST_F(PrefsTest, FlushPrefs)
+{
+  FilterEngine::CreationParameters createParams;
+  createParams.prefsSaveDelay = std::chrono::milliseconds(1000);
+  auto& filterEngine = CreateFilterEngine(createParams);
+  timerTasks->clear();
+  prefsWriteCount = 0;
+
+  filterEngine.SetPref("patternsbackupinterval", GetJsEngine().NewValue(48));
+  EXPECT_EQ(0, prefsWriteCount);
+
+  bool isFlushed = false;
+  filterEngine.FlushPrefs([&isFlushed]
+  {
+    isFlushed = true;
+  });
+  EXPECT_TRUE(isFlushed);
+  EXPECT_EQ(1, prefsWriteCount);
+
+  // nothing is left for the pending timer to save
+  ASSERT_EQ(1u, timerTasks->size());
+  timerTasks->front().callback();
+  EXPECT_EQ(1, prefsWriteCount);
+}
@@ -84,3 +84,47 @@ TEST(ReferrerMappingTest, CacheOnlyFiveUrls)
   ASSERT_EQ("sixth", referrerChain[4]);
   ASSERT_EQ("seventh", referrerChain[5]);
 }
+
+TEST(ReferrerMappingTest, ReaddedUrlIsKept)
+{
+  AdblockPlus::ReferrerMapping referrerMapping(2);
+  referrerMapping.Add("second", "first");
+  referrerMapping.Add("third", "second");
+  referrerMapping.Add("second", "first");
+  referrerMapping.Add("fourth", "third");
+  std::vector<std::string> referrerChain =
+    referrerMapping.BuildReferrerChain("second");
+  ASSERT_EQ(2u, referrerChain.size());
+  ASSERT_EQ("first", referrerChain[0]);
+  ASSERT_EQ("second", referrerChain[1]);
+  referrerChain = referrerMapping.BuildReferrerChain("third");
+  ASSERT_EQ(1u, referrerChain.size());
+  ASSERT_EQ("third", referrerChain[0]);
+}
+
+TEST(ReferrerMappingTest, ReferrerLoop)
+{
+  AdblockPlus::ReferrerMapping referrerMapping;
+  referrerMapping.Add("first", "second");
+  referrerMapping.Add("second", "first");
+  std::vector<std::string> referrerChain =
+    referrerMapping.BuildReferrerChain("first");
+  ASSERT_EQ(11u, referrerChain.size());
+  ASSERT_EQ("first", referrerChain[10]);
+  ASSERT_EQ("second", referrerChain[9]);
+  ASSERT_EQ("first", referrerChain[8]);
+}
+
+TEST(ReferrerMappingTest, CacheLimitedByBytes)
+{
+  const std::string prefix(1000, 'x');
+  AdblockPlus::ReferrerMapping referrerMapping(5000, 5000);
+  for (int i = 0; i < 10; i++)
+    referrerMapping.Add(prefix + std::to_string(i + 1), prefix + std::to_string(i));
+  std::vector<std::string> referrerChain =
+    referrerMapping.BuildReferrerChain(prefix + "10");
+  ASSERT_LT(1u, referrerChain.size());
+  ASSERT_GT(5u, referrerChain.size());
+  ASSERT_EQ(prefix + "10", referrerChain.back());
+  ASSERT_EQ(prefix + "9", referrerChain[referrerChain.size() - 2]);
+}
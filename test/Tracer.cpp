@@ -0,0 +1,124 @@
+/*
+ * This file is part of Adblock Plus <https://adblockplus.org/>,
+ * Copyright (C) 2006-present eyeo GmbH
+ *
+ * Adblock Plus is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 3 as
+ * published by the Free Software Foundation.
+ *
+ * Adblock Plus is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Adblock Plus.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "BaseJsTest.h"
+
+using namespace AdblockPlus;
+
+namespace
+{
+  bool Contains(const std::string& text, const std::string& part)
+  {
+    return text.find(part) != std::string::npos;
+  }
+
+  class TracerPlatformTest : public BaseJsTest
+  {
+  protected:
+    InMemoryFileSystem* fileSystem;
+
+    void SetUp() override
+    {
+      ThrowingPlatformCreationParameters platformParams;
+      platformParams.fileSystem.reset(fileSystem = new InMemoryFileSystem());
+      platform.reset(new Platform(std::move(platformParams)));
+    }
+
+    std::string ReadFile(const std::string& fileName)
+    {
+      std::string result;
+      fileSystem->Read(fileName,
+        [&result](IFileSystem::IOBuffer&& content, const std::string& error)
+        {
+          EXPECT_EQ("", error);
+          result.assign(content.begin(), content.end());
+        });
+      return result;
+    }
+  };
+}
+
+TEST(TracerTest, DisabledByDefault)
+{
+  Tracer tracer;
+  ASSERT_FALSE(tracer.IsEnabled());
+  {
+    Tracer::Scope scope(tracer, "test", "scope");
+  }
+  tracer.AddCompleteEvent("test", "event", Tracer::Clock::now(), Tracer::Clock::now());
+  ASSERT_EQ("{\"traceEvents\":[\n],\"displayTimeUnit\":\"ms\"}\n", tracer.Stop());
+}
+
+TEST(TracerTest, RecordsEvents)
+{
+  Tracer tracer;
+  tracer.Start();
+  ASSERT_TRUE(tracer.IsEnabled());
+  {
+    Tracer::Scope scope(tracer, "test", "scope", "some \"detail\"\n");
+  }
+  Tracer::Clock::time_point start = Tracer::Clock::now();
+  tracer.AddCompleteEvent("test", "event", start, start + std::chrono::milliseconds(2));
+  std::string trace = tracer.Stop();
+  ASSERT_FALSE(tracer.IsEnabled());
+
+  EXPECT_TRUE(Contains(trace, "{\"cat\":\"test\",\"name\":\"scope\",\"ph\":\"X\",\"pid\":1,\"tid\":1,"));
+  EXPECT_TRUE(Contains(trace, "\"args\":{\"detail\":\"some \\\"detail\\\"\\u000a\"}"));
+  EXPECT_TRUE(Contains(trace, "{\"cat\":\"test\",\"name\":\"event\","));
+  EXPECT_TRUE(Contains(trace, "\"dur\":2000}"));
+
+  // Nothing is recorded after stopping
+  tracer.AddCompleteEvent("test", "event", start, start);
+  tracer.Start();
+  ASSERT_FALSE(Contains(tracer.Stop(), "\"ph\""));
+}
+
+TEST(TracerTest, ThreadIds)
+{
+  Tracer tracer;
+  tracer.Start();
+  tracer.AddCompleteEvent("test", "main", Tracer::Clock::now(), Tracer::Clock::now());
+  std::thread([&tracer]()
+  {
+    tracer.AddCompleteEvent("test", "thread", Tracer::Clock::now(), Tracer::Clock::now());
+  }).join();
+  std::string trace = tracer.Stop();
+  EXPECT_TRUE(Contains(trace, "\"name\":\"main\",\"ph\":\"X\",\"pid\":1,\"tid\":1,"));
+  EXPECT_TRUE(Contains(trace, "\"name\":\"thread\",\"ph\":\"X\",\"pid\":1,\"tid\":2,"));
+}
+
+TEST_F(TracerPlatformTest, StopTracingWritesFile)
+{
+  platform->StartTracing();
+  GetJsEngine().Evaluate("1 + 1", "traced.js");
+  bool written = false;
+  platform->StopTracing("trace.json", [&written](const std::string& error)
+  {
+    EXPECT_EQ("", error);
+    written = true;
+  });
+  ASSERT_TRUE(written);
+
+  std::string trace = ReadFile("trace.json");
+  ASSERT_TRUE(Contains(trace, "{\"traceEvents\":["));
+#ifdef ABP_TRACE_EVENTS
+  EXPECT_TRUE(Contains(trace, "\"name\":\"Evaluate\""));
+  EXPECT_TRUE(Contains(trace, "\"args\":{\"detail\":\"traced.js\"}"));
+#else
+  EXPECT_FALSE(Contains(trace, "\"ph\""));
+#endif
+}